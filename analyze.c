@@ -0,0 +1,86 @@
+#define CL_TARGET_OPENCL_VERSION 300
+#include <CL/cl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <time.h>
+
+#include "helper_functions.h"
+#include "formats.h"
+#include "analysis.h"
+#include "generator.h"
+#include "enums.h"
+
+/*
+ * Structure of a matrix without running it: reads it with the Matrix Market reader (or generates it, see
+ * inc/generator.h), scans it on all OpenMP threads
+ * and writes the statistics as JSON (to stdout, or --output=FILE).
+ */
+int main(int argc, char *argv[])
+{
+    int number_of_rows;
+    int number_of_columns;
+    int number_of_nonzeroes;
+    cl_int *ptr;
+    cl_int *cols;
+    cl_double *data;
+    MatrixAnalysis analysis;
+    struct timespec start_time;
+    struct timespec end_time;
+    const char *filename = get_option(argc, argv, "--matrix", "databases/cant-sorted.mtx");
+    const char *output_filename = get_option(argc, argv, "--output", "");
+    const bool expand_symmetric = get_int_option(argc, argv, "--expand-symmetric", 1) != 0;
+    FILE *output = stdout;
+
+
+    /* read matrix */
+
+    clock_gettime(CLOCK_MONOTONIC, &start_time);
+
+    if (load_matrix(filename, expand_symmetric, &number_of_rows, &number_of_columns, &number_of_nonzeroes, &ptr, &cols, &data) == false)
+    {
+        return FileError;
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &end_time);
+    const double read_ms = (double)(end_time.tv_nsec - start_time.tv_nsec) / 1000000 + (double)(end_time.tv_sec - start_time.tv_sec) * 1000;
+
+
+    /* scan */
+
+    clock_gettime(CLOCK_MONOTONIC, &start_time);
+
+    scan_nonzeroes(ptr, cols, number_of_rows, number_of_columns, &analysis);
+    scan_row_lengths(ptr, number_of_rows, &analysis);
+
+    clock_gettime(CLOCK_MONOTONIC, &end_time);
+    const double scan_ms = (double)(end_time.tv_nsec - start_time.tv_nsec) / 1000000 + (double)(end_time.tv_sec - start_time.tv_sec) * 1000;
+
+
+    /* write JSON */
+
+    if (output_filename[0] != '\0')
+    {
+        output = fopen(output_filename, "w");
+
+        if (output == NULL)
+        {
+            perror(output_filename);
+            return FileError;
+        }
+    }
+
+    print_analysis_json(output, filename, expand_symmetric && is_symmetric_matrix_file(filename), &analysis, read_ms, scan_ms);
+
+    if (output != stdout)
+    {
+        fclose(output);
+    }
+
+    free(ptr);
+    free(cols);
+    free(data);
+
+    return Success;
+}
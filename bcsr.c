@@ -0,0 +1,367 @@
+#define CL_TARGET_OPENCL_VERSION 300
+#include <CL/cl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <time.h>
+
+#include "helper_functions.h"
+#include "formats.h"
+#include "precision.h"
+#include "enums.h"
+
+#define DEVICES_DEFAULT_SIZE 8
+#define MAX_BLOCK_SIZE 8
+
+int detect_block_size(cl_int *ptr, cl_int *cols, int number_of_rows, int number_of_columns, int number_of_nonzeroes);
+void compute_using_cpu(cl_double *block_data, cl_double *vect, cl_int *block_ptr, cl_int *block_col, int number_of_block_rows, int block_rows, int block_cols, int number_of_nonzeroes, cl_double **result);
+
+int main(int argc, char *argv[])
+{
+    cl_int error;
+    cl_uint number_of_devices = DEVICES_DEFAULT_SIZE;
+    cl_device_id device_ids[DEVICES_DEFAULT_SIZE];
+
+    if (get_device_ids(&device_ids[0], &number_of_devices) != CL_SUCCESS)
+    {
+        return OpenCLDeviceError;
+    }
+
+    for (cl_uint device_number = 0; device_number < number_of_devices; ++device_number)
+    {
+        int number_of_rows;
+        int number_of_columns;
+        int number_of_nonzeroes;
+        int number_of_blocks;
+        int i;
+        cl_int *ptr;
+        cl_int *cols;
+        cl_double *data;
+        cl_int *block_ptr;
+        cl_int *block_col;
+        cl_double *block_data;
+        cl_double *vect;
+        cl_double *output;
+        cl_double *output_cpu;
+        const char *filename = get_option(argc, argv, "--matrix", "databases/cant-sorted.mtx");
+        int block_size = get_int_option(argc, argv, "--block-size", 0);
+        char build_options[128];
+
+        size_t global_work_size[1] = { 8192 };
+        size_t local_work_size[1] = { 256 };
+        cl_uint work_dim = 1;
+
+
+        /* every work-item keeps BLOCK_ROWS sums in registers */
+        if (block_size > MAX_BLOCK_SIZE)
+        {
+            printf("--block-size must be at most %d\n", MAX_BLOCK_SIZE);
+            return OtherError;
+        }
+
+
+        /* prepare data for calculations */
+
+        if (read_csr_from_file(filename, true, &number_of_rows, &number_of_columns, &number_of_nonzeroes, &ptr, &cols, &data) == false)
+        {
+            return FileError;
+        }
+
+        if (block_size <= 0)
+        {
+            block_size = detect_block_size(ptr, cols, number_of_rows, number_of_columns, number_of_nonzeroes);
+        }
+
+        const int block_rows = block_size;
+        const int block_cols = block_size;
+        const int number_of_block_rows = (number_of_rows + block_rows - 1) / block_rows;
+        const int number_of_block_columns = (number_of_columns + block_cols - 1) / block_cols;
+
+        create_bcsr(ptr, cols, data, number_of_rows, number_of_columns, block_rows, block_cols, &block_ptr, &block_col, &block_data, &number_of_blocks);
+
+        const size_t block_data_size = (size_t)number_of_blocks * block_rows * block_cols;
+        const long csr_index_bytes = ((long)number_of_nonzeroes + number_of_rows + 1) * sizeof(cl_int);
+        const long bcsr_index_bytes = ((long)number_of_blocks + number_of_block_rows + 1) * sizeof(cl_int);
+
+        printf("BCSR %dx%d: %d blocks, fill ratio %.3lf, %ld explicit zeros stored\n",
+               block_rows, block_cols, number_of_blocks, (double)number_of_nonzeroes / block_data_size, (long)block_data_size - number_of_nonzeroes);
+        printf("index bytes: CSR %ld, BCSR %ld, saved %ld (%.1lf%%)\n",
+               csr_index_bytes, bcsr_index_bytes, csr_index_bytes - bcsr_index_bytes, 100.0 * (csr_index_bytes - bcsr_index_bytes) / csr_index_bytes);
+
+        /* the last block column may reach past the last column, padding of vect must be zero */
+        vect = (cl_double*)calloc(number_of_block_columns * block_cols, sizeof(cl_double));
+        for (i = 0; i < number_of_columns; ++i)
+        {
+            vect[i] = i;
+        }
+
+        output = (cl_double*)malloc(sizeof(cl_double) * number_of_block_rows * block_rows);
+        output_cpu = (cl_double*)malloc(sizeof(cl_double) * number_of_block_rows * block_rows);
+
+        const Precision value_precision = get_precision_option(argc, argv, "--precision");
+        const Precision vector_precision = get_precision_option(argc, argv, "--vector-precision");
+        const double tolerance = get_precision_tolerance(value_precision, vector_precision);
+
+        /* values and vector are narrowed once here, kernels widen them back to double */
+        void *device_data = convert_to_precision(block_data, block_data_size, value_precision);
+        void *device_vect = convert_to_precision(vect, number_of_block_columns * block_cols, vector_precision);
+
+        printf("values stored as %s, vector as %s\n", get_precision_name(value_precision), get_precision_name(vector_precision));
+
+
+        /* prepare OpenCL program */
+
+        cl_context context = clCreateContext(0, number_of_devices, device_ids, NULL, NULL, NULL);
+
+        if (NULL == context)
+        {
+            printf("context is null\n");
+            return OpenCLProgramError;
+        }
+
+        cl_command_queue command_queue = clCreateCommandQueueWithProperties(context, device_ids[0], 0, &error);
+
+        if (error != CL_SUCCESS)
+        {
+            printf("clCreateCommandQueueWithProperties error %d\n", error);
+            return OpenCLProgramError;
+        }
+
+        cl_mem buffer_block_ptr  = clCreateBuffer(context, CL_MEM_READ_ONLY, sizeof(cl_int) * (number_of_block_rows + 1), NULL, &error);
+        cl_mem buffer_block_col  = clCreateBuffer(context, CL_MEM_READ_ONLY, sizeof(cl_int) * number_of_blocks, NULL, &error);
+        cl_mem buffer_block_data = clCreateBuffer(context, CL_MEM_READ_ONLY, get_precision_size(value_precision) * block_data_size, NULL, &error);
+        cl_mem buffer_vect       = clCreateBuffer(context, CL_MEM_READ_ONLY, get_precision_size(vector_precision) * number_of_block_columns * block_cols, NULL, &error);
+        cl_mem buffer_output     = clCreateBuffer(context, CL_MEM_WRITE_ONLY, sizeof(cl_double) * number_of_block_rows * block_rows, NULL, &error);
+
+        if (error != CL_SUCCESS)
+        {
+            printf("clCreateBuffer error %d\n", error);
+            return OpenCLProgramError;
+        }
+
+        snprintf(build_options, sizeof(build_options), "-DBLOCK_ROWS=%d -DBLOCK_COLS=%d", block_rows, block_cols);
+        append_precision_build_options(build_options, sizeof(build_options), value_precision, vector_precision);
+
+        cl_program program = build_program_from_file(context, device_ids[0], "kernels/Bcsr.cl", build_options);
+
+        if (program == NULL)
+        {
+            return OpenCLProgramError;
+        }
+
+        cl_kernel kernel = clCreateKernel(program, "bcsr", &error);
+
+        if (error != CL_SUCCESS)
+        {
+            printf("clCreateKernel error %d\n", error);
+            return OpenCLProgramError;
+        }
+
+
+        /* set data to kernel */
+
+        error  = clSetKernelArg(kernel, 0, sizeof(cl_mem), (void*)&buffer_block_ptr);
+        error |= clSetKernelArg(kernel, 1, sizeof(cl_mem), (void*)&buffer_block_col);
+        error |= clSetKernelArg(kernel, 2, sizeof(cl_mem), (void*)&buffer_block_data);
+        error |= clSetKernelArg(kernel, 3, sizeof(cl_mem), (void*)&buffer_vect);
+        error |= clSetKernelArg(kernel, 4, sizeof(cl_mem), (void*)&buffer_output);
+        error |= clSetKernelArg(kernel, 5, sizeof(int), (void*)&number_of_block_rows);
+
+        if (error != CL_SUCCESS)
+        {
+            printf("clSetKernelArg errror\n");
+            return OpenCLProgramError;
+        }
+
+        error  = clEnqueueWriteBuffer(command_queue, buffer_block_ptr, CL_FALSE, 0, sizeof(cl_int) * (number_of_block_rows + 1), block_ptr, 0, NULL, NULL);
+        error |= clEnqueueWriteBuffer(command_queue, buffer_block_col, CL_FALSE, 0, sizeof(cl_int) * number_of_blocks, block_col, 0, NULL, NULL);
+        error |= clEnqueueWriteBuffer(command_queue, buffer_block_data, CL_FALSE, 0, get_precision_size(value_precision) * block_data_size, device_data, 0, NULL, NULL);
+        error |= clEnqueueWriteBuffer(command_queue, buffer_vect, CL_FALSE, 0, get_precision_size(vector_precision) * number_of_block_columns * block_cols, device_vect, 0, NULL, NULL);
+
+        if (error != CL_SUCCESS)
+        {
+            printf("clEnqueueWriteBuffer error %d\n", error);
+            return OpenCLProgramError;
+        }
+        clFinish(command_queue);
+
+
+        /* run program */
+
+        double ms = run_kernel(command_queue, kernel, work_dim, global_work_size, local_work_size);
+
+        if (ms < 0)
+        {
+            return OpenCLProgramError;
+        }
+
+        calculate_and_print_performance(ms, number_of_nonzeroes);
+        calculate_and_print_speed(ms, number_of_nonzeroes);
+
+
+        /* read output */
+
+        error = clEnqueueReadBuffer(command_queue, buffer_output, CL_TRUE, 0, sizeof(cl_double) * number_of_rows, output, 0, NULL, NULL);
+        clFinish(command_queue);
+
+        if (error != CL_SUCCESS)
+        {
+            printf("clEnqueueReadBuffer error %d\n", error);
+            return OpenCLProgramError;
+        }
+
+        if (check_result_with_tolerance(filename, vect, output, tolerance) == true)
+        {
+            printf("result is ok\n");
+        }
+        else
+        {
+            printf("result is wrong\n");
+        }
+
+
+        /* CPU */
+
+        compute_using_cpu(block_data, vect, block_ptr, block_col, number_of_block_rows, block_rows, block_cols, number_of_nonzeroes, &output_cpu);
+
+        if (check_result(filename, vect, output_cpu) == true)
+        {
+            printf("cpu result is ok\n");
+        }
+        else
+        {
+            printf("cpu result is wrong\n");
+        }
+
+
+        /* release memory */
+
+        clReleaseMemObject(buffer_block_ptr);
+        clReleaseMemObject(buffer_block_col);
+        clReleaseMemObject(buffer_block_data);
+        clReleaseMemObject(buffer_vect);
+        clReleaseMemObject(buffer_output);
+
+        free(ptr);
+        free(cols);
+        free(data);
+        free(block_ptr);
+        free(block_col);
+        free(block_data);
+        free(vect);
+        free(device_data);
+        free(device_vect);
+        free(output);
+        free(output_cpu);
+
+        clFlush(command_queue);
+        clReleaseCommandQueue(command_queue);
+        clReleaseKernel(kernel);
+        clReleaseProgram(program);
+        clReleaseContext(context);
+
+        break;
+    }
+
+    return Success;
+}
+
+/*!
+ * \brief Picks the square block size for which BCSR (values including explicit zeros plus indices) takes the least memory.
+ */
+int detect_block_size(cl_int *ptr, cl_int *cols, int number_of_rows, int number_of_columns, int number_of_nonzeroes)
+{
+    const int block_sizes[] = { 2, 3, 4, 6 };
+    const long csr_bytes = (long)number_of_nonzeroes * (sizeof(cl_double) + sizeof(cl_int)) + (number_of_rows + 1) * sizeof(cl_int);
+    long best_bytes = 0;
+    int best_block_size = block_sizes[0];
+    size_t i;
+
+    printf("CSR: %.2lf MB\n", csr_bytes * 1e-6);
+
+    for (i = 0; i < sizeof(block_sizes) / sizeof(block_sizes[0]); ++i)
+    {
+        const int block_size = block_sizes[i];
+        const long number_of_blocks = count_bcsr_blocks(ptr, cols, number_of_rows, number_of_columns, block_size, block_size);
+        const long number_of_block_rows = (number_of_rows + block_size - 1) / block_size;
+        const long bytes = number_of_blocks * (block_size * block_size * sizeof(cl_double) + sizeof(cl_int)) + (number_of_block_rows + 1) * sizeof(cl_int);
+
+        printf("BCSR %dx%d: fill ratio %.3lf, %.2lf MB\n",
+               block_size, block_size, (double)number_of_nonzeroes / (number_of_blocks * block_size * block_size), bytes * 1e-6);
+
+        if (i == 0 || bytes < best_bytes)
+        {
+            best_bytes = bytes;
+            best_block_size = block_size;
+        }
+    }
+
+    if (best_bytes >= csr_bytes)
+    {
+        printf("no block size makes the matrix smaller than CSR\n");
+    }
+
+    return best_block_size;
+}
+
+void compute_using_cpu(cl_double *block_data, cl_double *vect, cl_int *block_ptr, cl_int *block_col, int number_of_block_rows, int block_rows, int block_cols, int number_of_nonzeroes, cl_double **result)
+{
+    const int block_size = block_rows * block_cols;
+    int column_in_block[block_size];
+    int i;
+    struct timespec start_time;
+    struct timespec end_time;
+
+    for (i = 0; i < block_size; ++i)
+    {
+        column_in_block[i] = i % block_cols;
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &start_time);
+
+    #pragma omp parallel for shared(block_data, vect, block_ptr, block_col, number_of_block_rows, column_in_block, result) private(i)
+    for (i = 0; i < number_of_block_rows; ++i)
+    {
+        cl_double partial[block_size];
+        int j;
+        int k;
+
+        for (k = 0; k < block_size; ++k)
+        {
+            partial[k] = 0;
+        }
+
+        /* every block is multiplied element-wise first, rows of the block are summed once per block row */
+        for (j = block_ptr[i]; j < block_ptr[i+1]; ++j)
+        {
+            const cl_double *block = &block_data[(size_t)j * block_size];
+            const cl_double *x = &vect[block_col[j] * block_cols];
+
+            #pragma omp simd
+            for (k = 0; k < block_size; ++k)
+            {
+                partial[k] += block[k] * x[column_in_block[k]];
+            }
+        }
+
+        for (k = 0; k < block_rows; ++k)
+        {
+            cl_double sum = 0;
+            int c;
+
+            for (c = 0; c < block_cols; ++c)
+            {
+                sum += partial[k * block_cols + c];
+            }
+
+            (*result)[i * block_rows + k] = sum;
+        }
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &end_time);
+    double ms = (double)(end_time.tv_nsec - start_time.tv_nsec) / 1000000 + (double)(end_time.tv_sec - start_time.tv_sec) * 1000;
+
+    printf("\nCPU calculations\n");
+    calculate_and_print_performance(ms, number_of_nonzeroes);
+}
@@ -0,0 +1,551 @@
+#define CL_TARGET_OPENCL_VERSION 300
+#include <CL/cl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <time.h>
+
+#include "helper_functions.h"
+#include "formats.h"
+#include "precision.h"
+#include "enums.h"
+
+#define DEVICES_DEFAULT_SIZE 8
+
+/* indices of the device-side CG scalars, dot(r, z) alternates between the first two */
+#define PQ_INDEX 2
+#define RR_INDEX 3
+#define NUMBER_OF_SCALARS 4
+
+bool compute_inverse_diagonal(cl_int *ptr, cl_int *cols, cl_double *data, int number_of_rows, cl_double *inv_diag);
+double compute_residual_norm(cl_int *ptr, cl_int *cols, cl_double *data, const cl_double *b, const cl_double *x, int number_of_rows);
+cl_int enqueue_kernel(cl_command_queue command_queue, cl_kernel kernel, const size_t *global_work_size, const size_t *local_work_size);
+
+int main(int argc, char *argv[])
+{
+    cl_int error;
+    cl_uint number_of_devices = DEVICES_DEFAULT_SIZE;
+    cl_device_id device_ids[DEVICES_DEFAULT_SIZE];
+
+    if (get_device_ids(&device_ids[0], &number_of_devices) != CL_SUCCESS)
+    {
+        return OpenCLDeviceError;
+    }
+
+    for (cl_uint device_number = 0; device_number < number_of_devices; ++device_number)
+    {
+        int number_of_rows;
+        int number_of_columns;
+        int number_of_nonzeroes;
+        int number_of_slices;
+        int i;
+        int iteration;
+        int j;
+        cl_int *ptr;
+        cl_int *cols;
+        cl_double *data;
+        cl_int *row_indices;
+        cl_int *sell_cols;
+        cl_double *sell_data;
+        cl_double *b;
+        cl_double *x;
+        cl_double *zeroes;
+        cl_double *inv_diag;
+        cl_double scalars[NUMBER_OF_SCALARS] = { 0 };
+        double b_norm = 0;
+        double residual = 1;
+        double max_error = 0;
+        struct timespec start_time;
+        struct timespec end_time;
+        const char *filename = get_option(argc, argv, "--matrix", "databases/cant-sorted.mtx");
+        const char *format_name = get_option(argc, argv, "--format", "csr");
+        const char *preconditioner_name = get_option(argc, argv, "--preconditioner", "none");
+        const double tolerance = atof(get_option(argc, argv, "--tolerance", "1e-8"));
+        const int max_iterations = get_int_option(argc, argv, "--max-iterations", 10000);
+        const int check_every = get_int_option(argc, argv, "--check-every", 1);
+        const bool use_sell = strcmp(format_name, "sigma_c") == 0;
+        const bool use_jacobi = strcmp(preconditioner_name, "jacobi") == 0;
+        const double alpha = 1;
+        const double beta = 0;
+        const int C = 32;
+        char build_options[128] = "";
+
+        size_t global_work_size[1] = { 8192 };
+        size_t local_work_size[1] = { 256 };
+        size_t sell_global_work_size[1];
+        size_t sell_local_work_size[1] = { C };
+        size_t sum_work_size[1] = { 256 };
+
+        if ((!use_sell && strcmp(format_name, "csr") != 0) || (!use_jacobi && strcmp(preconditioner_name, "none") != 0) || check_every < 1)
+        {
+            printf("usage: cg [--matrix=FILE] [--format=csr|sigma_c] [--preconditioner=none|jacobi] [--tolerance=T] [--max-iterations=N] [--check-every=K]\n");
+            return OtherError;
+        }
+
+
+        /* prepare data for calculations, CG needs the whole symmetric matrix */
+
+        if (read_csr_from_file(filename, true, &number_of_rows, &number_of_columns, &number_of_nonzeroes, &ptr, &cols, &data) == false)
+        {
+            return FileError;
+        }
+
+        if (number_of_rows != number_of_columns)
+        {
+            printf("CG needs a square matrix\n");
+            return FileError;
+        }
+
+        create_sell(ptr, cols, data, number_of_rows, C, &number_of_slices, &row_indices, &sell_cols, &sell_data);
+
+        const long sell_size = row_indices[number_of_slices];
+        const int sell_rows = number_of_slices * C;
+        const int csr_groups = global_work_size[0] / local_work_size[0];
+        const int number_of_pq_partials = use_sell ? number_of_slices : csr_groups;
+
+        sell_global_work_size[0] = sell_rows;
+
+        /* vectors are padded to whole slices, padded rows of SELL-C give 0 and stay 0 */
+        b = (cl_double*)malloc(sizeof(cl_double) * sell_rows);
+        x = (cl_double*)malloc(sizeof(cl_double) * sell_rows);
+        zeroes = (cl_double*)calloc(sell_rows, sizeof(cl_double));
+        inv_diag = (cl_double*)malloc(sizeof(cl_double) * number_of_rows);
+
+        /* b = A * ones, so the exact solution is known */
+        for (i = 0; i < sell_rows; ++i)
+        {
+            b[i] = 0;
+        }
+
+        for (i = 0; i < number_of_rows; ++i)
+        {
+            for (j = ptr[i]; j < ptr[i+1]; ++j)
+            {
+                b[i] += data[j];
+            }
+
+            b_norm += b[i] * b[i];
+        }
+
+        b_norm = sqrt(b_norm);
+
+        if (use_jacobi && compute_inverse_diagonal(ptr, cols, data, number_of_rows, inv_diag) == false)
+        {
+            return OtherError;
+        }
+
+
+        /* prepare OpenCL program */
+
+        cl_context context = clCreateContext(0, number_of_devices, device_ids, NULL, NULL, NULL);
+
+        if (NULL == context)
+        {
+            printf("context is null\n");
+            return OpenCLProgramError;
+        }
+
+        cl_command_queue command_queue = clCreateCommandQueueWithProperties(context, device_ids[0], 0, &error);
+
+        if (error != CL_SUCCESS)
+        {
+            printf("clCreateCommandQueueWithProperties error %d\n", error);
+            return OpenCLProgramError;
+        }
+
+        cl_mem buffer_ptr         = clCreateBuffer(context, CL_MEM_READ_ONLY, sizeof(cl_int) * (number_of_rows + 1), NULL, &error);
+        cl_mem buffer_col         = clCreateBuffer(context, CL_MEM_READ_ONLY, sizeof(cl_int) * number_of_nonzeroes, NULL, &error);
+        cl_mem buffer_data        = clCreateBuffer(context, CL_MEM_READ_ONLY, sizeof(cl_double) * number_of_nonzeroes, NULL, &error);
+        cl_mem buffer_row_indices = clCreateBuffer(context, CL_MEM_READ_ONLY, sizeof(cl_int) * (number_of_slices + 1), NULL, &error);
+        cl_mem buffer_sell_cols   = clCreateBuffer(context, CL_MEM_READ_ONLY, sizeof(cl_int) * sell_size, NULL, &error);
+        cl_mem buffer_sell_data   = clCreateBuffer(context, CL_MEM_READ_ONLY, sizeof(cl_double) * sell_size, NULL, &error);
+        cl_mem buffer_inv_diag    = clCreateBuffer(context, CL_MEM_READ_ONLY, sizeof(cl_double) * number_of_rows, NULL, &error);
+        cl_mem buffer_x           = clCreateBuffer(context, CL_MEM_READ_WRITE, sizeof(cl_double) * sell_rows, NULL, &error);
+        cl_mem buffer_r           = clCreateBuffer(context, CL_MEM_READ_WRITE, sizeof(cl_double) * sell_rows, NULL, &error);
+        cl_mem buffer_z           = clCreateBuffer(context, CL_MEM_READ_WRITE, sizeof(cl_double) * sell_rows, NULL, &error);
+        cl_mem buffer_p           = clCreateBuffer(context, CL_MEM_READ_WRITE, sizeof(cl_double) * sell_rows, NULL, &error);
+        cl_mem buffer_q           = clCreateBuffer(context, CL_MEM_READ_WRITE, sizeof(cl_double) * sell_rows, NULL, &error);
+        cl_mem buffer_pq_partials = clCreateBuffer(context, CL_MEM_READ_WRITE, sizeof(cl_double) * number_of_pq_partials, NULL, &error);
+        cl_mem buffer_rz_partials = clCreateBuffer(context, CL_MEM_READ_WRITE, sizeof(cl_double) * csr_groups, NULL, &error);
+        cl_mem buffer_rr_partials = clCreateBuffer(context, CL_MEM_READ_WRITE, sizeof(cl_double) * csr_groups, NULL, &error);
+        cl_mem buffer_scalars     = clCreateBuffer(context, CL_MEM_READ_WRITE, sizeof(cl_double) * NUMBER_OF_SCALARS, NULL, &error);
+
+        if (error != CL_SUCCESS)
+        {
+            printf("clCreateBuffer error %d\n", error);
+            return OpenCLProgramError;
+        }
+
+        error  = clEnqueueWriteBuffer(command_queue, buffer_ptr, CL_FALSE, 0, sizeof(cl_int) * (number_of_rows + 1), ptr, 0, NULL, NULL);
+        error |= clEnqueueWriteBuffer(command_queue, buffer_col, CL_FALSE, 0, sizeof(cl_int) * number_of_nonzeroes, cols, 0, NULL, NULL);
+        error |= clEnqueueWriteBuffer(command_queue, buffer_data, CL_FALSE, 0, sizeof(cl_double) * number_of_nonzeroes, data, 0, NULL, NULL);
+        error |= clEnqueueWriteBuffer(command_queue, buffer_row_indices, CL_FALSE, 0, sizeof(cl_int) * (number_of_slices + 1), row_indices, 0, NULL, NULL);
+        error |= clEnqueueWriteBuffer(command_queue, buffer_sell_cols, CL_FALSE, 0, sizeof(cl_int) * sell_size, sell_cols, 0, NULL, NULL);
+        error |= clEnqueueWriteBuffer(command_queue, buffer_sell_data, CL_FALSE, 0, sizeof(cl_double) * sell_size, sell_data, 0, NULL, NULL);
+        error |= clEnqueueWriteBuffer(command_queue, buffer_inv_diag, CL_FALSE, 0, sizeof(cl_double) * number_of_rows, inv_diag, 0, NULL, NULL);
+        error |= clEnqueueWriteBuffer(command_queue, buffer_x, CL_FALSE, 0, sizeof(cl_double) * sell_rows, zeroes, 0, NULL, NULL);
+        error |= clEnqueueWriteBuffer(command_queue, buffer_r, CL_FALSE, 0, sizeof(cl_double) * sell_rows, b, 0, NULL, NULL);
+        error |= clEnqueueWriteBuffer(command_queue, buffer_z, CL_FALSE, 0, sizeof(cl_double) * sell_rows, zeroes, 0, NULL, NULL);
+        error |= clEnqueueWriteBuffer(command_queue, buffer_p, CL_FALSE, 0, sizeof(cl_double) * sell_rows, zeroes, 0, NULL, NULL);
+        error |= clEnqueueWriteBuffer(command_queue, buffer_q, CL_FALSE, 0, sizeof(cl_double) * sell_rows, zeroes, 0, NULL, NULL);
+        error |= clEnqueueWriteBuffer(command_queue, buffer_scalars, CL_FALSE, 0, sizeof(cl_double) * NUMBER_OF_SCALARS, scalars, 0, NULL, NULL);
+
+        if (error != CL_SUCCESS)
+        {
+            printf("clEnqueueWriteBuffer error %d\n", error);
+            return OpenCLProgramError;
+        }
+        clFinish(command_queue);
+
+        append_precision_build_options(build_options, sizeof(build_options), DoublePrecision, DoublePrecision);
+
+        cl_program spmv_program = build_program_from_file(context, device_ids[0], use_sell ? "kernels/Sigma_C.cl" : "kernels/Csr.cl", build_options);
+        cl_program blas_program = build_program_from_file(context, device_ids[0], "kernels/Blas.cl", build_options);
+
+        if (spmv_program == NULL || blas_program == NULL)
+        {
+            return OpenCLProgramError;
+        }
+
+        cl_kernel spmv_kernel = clCreateKernel(spmv_program, use_sell ? "sigma_c_axpby_dot" : "csr_axpby_dot", &error);
+        cl_kernel copy_kernel = clCreateKernel(blas_program, "axpby", &error);
+        cl_kernel dot_kernel = clCreateKernel(blas_program, use_jacobi ? "jacobi_dot_partials" : "dot_partials", &error);
+        cl_kernel sum_pq_kernel = clCreateKernel(blas_program, "sum_partials", &error);
+        cl_kernel sum_rz_kernel = clCreateKernel(blas_program, "sum_partials", &error);
+        cl_kernel sum_rr_kernel = clCreateKernel(blas_program, "sum_partials", &error);
+        cl_kernel solution_kernel = clCreateKernel(blas_program, "cg_update_solution", &error);
+        cl_kernel direction_kernel = clCreateKernel(blas_program, "cg_update_direction", &error);
+
+        if (error != CL_SUCCESS)
+        {
+            printf("clCreateKernel error %d\n", error);
+            return OpenCLProgramError;
+        }
+
+
+        /* set data to kernels */
+
+        const int pq_index = PQ_INDEX;
+        const int rr_index = RR_INDEX;
+        const double one = 1;
+        const double zero = 0;
+
+        /* q = A * p and partial sums of dot(p, q) */
+        if (use_sell)
+        {
+            error  = clSetKernelArg(spmv_kernel, 0, sizeof(cl_mem), (void*)&buffer_sell_data);
+            error |= clSetKernelArg(spmv_kernel, 1, sizeof(cl_mem), (void*)&buffer_sell_cols);
+            error |= clSetKernelArg(spmv_kernel, 2, sizeof(cl_mem), (void*)&buffer_p);
+            error |= clSetKernelArg(spmv_kernel, 3, sizeof(cl_mem), (void*)&buffer_q);
+            error |= clSetKernelArg(spmv_kernel, 4, sizeof(cl_mem), (void*)&buffer_row_indices);
+            error |= clSetKernelArg(spmv_kernel, 5, sizeof(int), (void*)&C);
+            error |= clSetKernelArg(spmv_kernel, 6, sizeof(double), (void*)&alpha);
+            error |= clSetKernelArg(spmv_kernel, 7, sizeof(double), (void*)&beta);
+            error |= clSetKernelArg(spmv_kernel, 8, sizeof(int), (void*)&number_of_rows);
+            error |= clSetKernelArg(spmv_kernel, 9, sizeof(cl_mem), (void*)&buffer_pq_partials);
+            error |= clSetKernelArg(spmv_kernel, 10, sizeof(cl_double) * C, NULL);
+        }
+        else
+        {
+            error  = clSetKernelArg(spmv_kernel, 0, sizeof(cl_mem), (void*)&buffer_ptr);
+            error |= clSetKernelArg(spmv_kernel, 1, sizeof(cl_mem), (void*)&buffer_col);
+            error |= clSetKernelArg(spmv_kernel, 2, sizeof(cl_mem), (void*)&buffer_data);
+            error |= clSetKernelArg(spmv_kernel, 3, sizeof(cl_mem), (void*)&buffer_p);
+            error |= clSetKernelArg(spmv_kernel, 4, sizeof(cl_mem), (void*)&buffer_q);
+            error |= clSetKernelArg(spmv_kernel, 5, sizeof(int), (void*)&number_of_rows);
+            error |= clSetKernelArg(spmv_kernel, 6, sizeof(double), (void*)&alpha);
+            error |= clSetKernelArg(spmv_kernel, 7, sizeof(double), (void*)&beta);
+            error |= clSetKernelArg(spmv_kernel, 8, sizeof(cl_mem), (void*)&buffer_pq_partials);
+            error |= clSetKernelArg(spmv_kernel, 9, sizeof(cl_double) * local_work_size[0], NULL);
+        }
+
+        /* p = z before the first iteration */
+        error |= clSetKernelArg(copy_kernel, 0, sizeof(cl_mem), use_jacobi ? (void*)&buffer_z : (void*)&buffer_r);
+        error |= clSetKernelArg(copy_kernel, 1, sizeof(cl_mem), (void*)&buffer_p);
+        error |= clSetKernelArg(copy_kernel, 2, sizeof(double), (void*)&one);
+        error |= clSetKernelArg(copy_kernel, 3, sizeof(double), (void*)&zero);
+        error |= clSetKernelArg(copy_kernel, 4, sizeof(int), (void*)&number_of_rows);
+
+        /* z = M^-1 * r with partial sums of dot(r, z) and dot(r, r), without preconditioner z is r */
+        if (use_jacobi)
+        {
+            error |= clSetKernelArg(dot_kernel, 0, sizeof(cl_mem), (void*)&buffer_r);
+            error |= clSetKernelArg(dot_kernel, 1, sizeof(cl_mem), (void*)&buffer_inv_diag);
+            error |= clSetKernelArg(dot_kernel, 2, sizeof(cl_mem), (void*)&buffer_z);
+            error |= clSetKernelArg(dot_kernel, 3, sizeof(cl_mem), (void*)&buffer_rz_partials);
+            error |= clSetKernelArg(dot_kernel, 4, sizeof(cl_mem), (void*)&buffer_rr_partials);
+            error |= clSetKernelArg(dot_kernel, 5, sizeof(int), (void*)&number_of_rows);
+            error |= clSetKernelArg(dot_kernel, 6, sizeof(cl_double) * local_work_size[0], NULL);
+        }
+        else
+        {
+            error |= clSetKernelArg(dot_kernel, 0, sizeof(cl_mem), (void*)&buffer_r);
+            error |= clSetKernelArg(dot_kernel, 1, sizeof(cl_mem), (void*)&buffer_r);
+            error |= clSetKernelArg(dot_kernel, 2, sizeof(cl_mem), (void*)&buffer_rz_partials);
+            error |= clSetKernelArg(dot_kernel, 3, sizeof(int), (void*)&number_of_rows);
+            error |= clSetKernelArg(dot_kernel, 4, sizeof(cl_double) * local_work_size[0], NULL);
+        }
+
+        error |= clSetKernelArg(sum_pq_kernel, 0, sizeof(cl_mem), (void*)&buffer_pq_partials);
+        error |= clSetKernelArg(sum_pq_kernel, 1, sizeof(cl_mem), (void*)&buffer_scalars);
+        error |= clSetKernelArg(sum_pq_kernel, 2, sizeof(int), (void*)&pq_index);
+        error |= clSetKernelArg(sum_pq_kernel, 3, sizeof(int), (void*)&number_of_pq_partials);
+        error |= clSetKernelArg(sum_pq_kernel, 4, sizeof(cl_double) * sum_work_size[0], NULL);
+
+        error |= clSetKernelArg(sum_rz_kernel, 0, sizeof(cl_mem), (void*)&buffer_rz_partials);
+        error |= clSetKernelArg(sum_rz_kernel, 1, sizeof(cl_mem), (void*)&buffer_scalars);
+        error |= clSetKernelArg(sum_rz_kernel, 3, sizeof(int), (void*)&csr_groups);
+        error |= clSetKernelArg(sum_rz_kernel, 4, sizeof(cl_double) * sum_work_size[0], NULL);
+
+        error |= clSetKernelArg(sum_rr_kernel, 0, sizeof(cl_mem), (void*)&buffer_rr_partials);
+        error |= clSetKernelArg(sum_rr_kernel, 1, sizeof(cl_mem), (void*)&buffer_scalars);
+        error |= clSetKernelArg(sum_rr_kernel, 2, sizeof(int), (void*)&rr_index);
+        error |= clSetKernelArg(sum_rr_kernel, 3, sizeof(int), (void*)&csr_groups);
+        error |= clSetKernelArg(sum_rr_kernel, 4, sizeof(cl_double) * sum_work_size[0], NULL);
+
+        error |= clSetKernelArg(solution_kernel, 0, sizeof(cl_mem), (void*)&buffer_x);
+        error |= clSetKernelArg(solution_kernel, 1, sizeof(cl_mem), (void*)&buffer_r);
+        error |= clSetKernelArg(solution_kernel, 2, sizeof(cl_mem), (void*)&buffer_p);
+        error |= clSetKernelArg(solution_kernel, 3, sizeof(cl_mem), (void*)&buffer_q);
+        error |= clSetKernelArg(solution_kernel, 4, sizeof(cl_mem), (void*)&buffer_scalars);
+        error |= clSetKernelArg(solution_kernel, 6, sizeof(int), (void*)&pq_index);
+        error |= clSetKernelArg(solution_kernel, 7, sizeof(int), (void*)&number_of_rows);
+
+        error |= clSetKernelArg(direction_kernel, 0, sizeof(cl_mem), (void*)&buffer_p);
+        error |= clSetKernelArg(direction_kernel, 1, sizeof(cl_mem), use_jacobi ? (void*)&buffer_z : (void*)&buffer_r);
+        error |= clSetKernelArg(direction_kernel, 2, sizeof(cl_mem), (void*)&buffer_scalars);
+        error |= clSetKernelArg(direction_kernel, 5, sizeof(int), (void*)&number_of_rows);
+
+        if (error != CL_SUCCESS)
+        {
+            printf("clSetKernelArg errror\n");
+            return OpenCLProgramError;
+        }
+
+
+        /* run programs */
+
+        printf("%s CG, %s preconditioner, %d rows, %d nonzeroes (symmetric part included)\n", format_name, preconditioner_name, number_of_rows, number_of_nonzeroes);
+
+        const int first_rz_index = 0;
+
+        /* r = b - A * 0, z = M^-1 * r, p = z, dot(r, z) into scalars[0] */
+        error  = enqueue_kernel(command_queue, dot_kernel, global_work_size, local_work_size);
+        error |= clSetKernelArg(sum_rz_kernel, 2, sizeof(int), (void*)&first_rz_index);
+        error |= enqueue_kernel(command_queue, sum_rz_kernel, sum_work_size, sum_work_size);
+        error |= enqueue_kernel(command_queue, copy_kernel, global_work_size, local_work_size);
+
+        if (error != CL_SUCCESS)
+        {
+            return OpenCLProgramError;
+        }
+        clFinish(command_queue);
+
+        clock_gettime(CLOCK_MONOTONIC, &start_time);
+
+        /*
+         * The host only enqueues, every scalar stays on the device. The residual is read back every check_every
+         * iterations, which is the only point the host waits for the device.
+         */
+        for (iteration = 0; iteration < max_iterations; )
+        {
+            const int rz_index = iteration % 2;
+            const int rz_next_index = (iteration + 1) % 2;
+
+            error  = enqueue_kernel(command_queue, spmv_kernel, use_sell ? sell_global_work_size : global_work_size, use_sell ? sell_local_work_size : local_work_size);
+            error |= enqueue_kernel(command_queue, sum_pq_kernel, sum_work_size, sum_work_size);
+
+            error |= clSetKernelArg(solution_kernel, 5, sizeof(int), (void*)&rz_index);
+            error |= enqueue_kernel(command_queue, solution_kernel, global_work_size, local_work_size);
+
+            error |= enqueue_kernel(command_queue, dot_kernel, global_work_size, local_work_size);
+            error |= clSetKernelArg(sum_rz_kernel, 2, sizeof(int), (void*)&rz_next_index);
+            error |= enqueue_kernel(command_queue, sum_rz_kernel, sum_work_size, sum_work_size);
+
+            if (use_jacobi)
+            {
+                error |= enqueue_kernel(command_queue, sum_rr_kernel, sum_work_size, sum_work_size);
+            }
+
+            error |= clSetKernelArg(direction_kernel, 3, sizeof(int), (void*)&rz_index);
+            error |= clSetKernelArg(direction_kernel, 4, sizeof(int), (void*)&rz_next_index);
+            error |= enqueue_kernel(command_queue, direction_kernel, global_work_size, local_work_size);
+
+            if (error != CL_SUCCESS)
+            {
+                return OpenCLProgramError;
+            }
+
+            ++iteration;
+
+            if (iteration % check_every == 0 || iteration == max_iterations)
+            {
+                /* without preconditioner dot(r, r) is dot(r, z) */
+                const int residual_index = use_jacobi ? RR_INDEX : rz_next_index;
+
+                error = clEnqueueReadBuffer(command_queue, buffer_scalars, CL_TRUE, sizeof(cl_double) * residual_index, sizeof(cl_double), &scalars[residual_index], 0, NULL, NULL);
+
+                if (error != CL_SUCCESS)
+                {
+                    printf("clEnqueueReadBuffer error %d\n", error);
+                    return OpenCLProgramError;
+                }
+
+                residual = sqrt(scalars[residual_index]) / b_norm;
+
+                if (iteration % 100 < check_every)
+                {
+                    printf("iteration %5d relative residual %e\n", iteration, residual);
+                }
+
+                if (residual <= tolerance || isnan(residual))
+                {
+                    break;
+                }
+            }
+        }
+
+        clFinish(command_queue);
+        clock_gettime(CLOCK_MONOTONIC, &end_time);
+
+        const double ms = (double)(end_time.tv_nsec - start_time.tv_nsec) / 1000000 + (double)(end_time.tv_sec - start_time.tv_sec) * 1000;
+
+        error = clEnqueueReadBuffer(command_queue, buffer_x, CL_TRUE, 0, sizeof(cl_double) * number_of_rows, x, 0, NULL, NULL);
+
+        if (error != CL_SUCCESS)
+        {
+            printf("clEnqueueReadBuffer error %d\n", error);
+            return OpenCLProgramError;
+        }
+
+        for (i = 0; i < number_of_rows; ++i)
+        {
+            max_error = fmax(max_error, fabs(x[i] - 1));
+        }
+
+        printf("%s after %d iterations, relative residual %e (recomputed on the host %e), largest error of x %e\n",
+               residual <= tolerance ? "converged" : "not converged", iteration, residual,
+               compute_residual_norm(ptr, cols, data, b, x, number_of_rows) / b_norm, max_error);
+        printf("time %.3lf ms, %.4lf ms per iteration\n", ms, ms / iteration);
+
+
+        /* release memory */
+
+        clReleaseKernel(spmv_kernel);
+        clReleaseKernel(copy_kernel);
+        clReleaseKernel(dot_kernel);
+        clReleaseKernel(sum_pq_kernel);
+        clReleaseKernel(sum_rz_kernel);
+        clReleaseKernel(sum_rr_kernel);
+        clReleaseKernel(solution_kernel);
+        clReleaseKernel(direction_kernel);
+
+        clReleaseMemObject(buffer_ptr);
+        clReleaseMemObject(buffer_col);
+        clReleaseMemObject(buffer_data);
+        clReleaseMemObject(buffer_row_indices);
+        clReleaseMemObject(buffer_sell_cols);
+        clReleaseMemObject(buffer_sell_data);
+        clReleaseMemObject(buffer_inv_diag);
+        clReleaseMemObject(buffer_x);
+        clReleaseMemObject(buffer_r);
+        clReleaseMemObject(buffer_z);
+        clReleaseMemObject(buffer_p);
+        clReleaseMemObject(buffer_q);
+        clReleaseMemObject(buffer_pq_partials);
+        clReleaseMemObject(buffer_rz_partials);
+        clReleaseMemObject(buffer_rr_partials);
+        clReleaseMemObject(buffer_scalars);
+
+        free(ptr);
+        free(cols);
+        free(data);
+        free(row_indices);
+        free(sell_cols);
+        free(sell_data);
+        free(b);
+        free(x);
+        free(zeroes);
+        free(inv_diag);
+
+        clFlush(command_queue);
+        clReleaseCommandQueue(command_queue);
+        clReleaseProgram(spmv_program);
+        clReleaseProgram(blas_program);
+        clReleaseContext(context);
+
+        break;
+    }
+
+    return Success;
+}
+
+/*!
+ * \brief Fills inv_diag with 1 / a_ii for the Jacobi preconditioner, fails when a diagonal entry is missing or 0.
+ */
+bool compute_inverse_diagonal(cl_int *ptr, cl_int *cols, cl_double *data, int number_of_rows, cl_double *inv_diag)
+{
+    int i;
+    int j;
+
+    for (i = 0; i < number_of_rows; ++i)
+    {
+        inv_diag[i] = 0;
+
+        for (j = ptr[i]; j < ptr[i+1]; ++j)
+        {
+            if (cols[j] == i)
+            {
+                inv_diag[i] += data[j];
+            }
+        }
+
+        if (inv_diag[i] == 0)
+        {
+            printf("no diagonal entry in row %d, Jacobi preconditioner can not be used\n", i);
+            return false;
+        }
+
+        inv_diag[i] = 1 / inv_diag[i];
+    }
+
+    return true;
+}
+
+double compute_residual_norm(cl_int *ptr, cl_int *cols, cl_double *data, const cl_double *b, const cl_double *x, int number_of_rows)
+{
+    double norm = 0;
+    int i;
+
+    #pragma omp parallel for shared(ptr, cols, data, b, x, number_of_rows) private(i) reduction(+:norm)
+    for (i = 0; i < number_of_rows; ++i)
+    {
+        double residual = b[i];
+        int j;
+
+        for (j = ptr[i]; j < ptr[i+1]; ++j)
+        {
+            residual -= data[j] * x[cols[j]];
+        }
+
+        norm += residual * residual;
+    }
+
+    return sqrt(norm);
+}
+
+/*!
+ * \brief Enqueues the kernel without waiting for it, unlike run_kernel.
+ */
+cl_int enqueue_kernel(cl_command_queue command_queue, cl_kernel kernel, const size_t *global_work_size, const size_t *local_work_size)
+{
+    cl_int error = clEnqueueNDRangeKernel(command_queue, kernel, 1, NULL, global_work_size, local_work_size, 0, NULL, NULL);
+
+    if (error != CL_SUCCESS)
+    {
+        printf("clEnqueueNDRangeKernel error %d\n", error);
+    }
+
+    return error;
+}
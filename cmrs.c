@@ -8,17 +8,17 @@
 #include <math.h>
 
 #include "helper_functions.h"
+#include "formats.h"
+#include "precision.h"
+#include "partition.h"
 #include "enums.h"
 
 #define DEVICES_DEFAULT_SIZE 8
 
-void compute_using_cpu(cl_double *data, cl_double *vect, cl_int *strip_ptr, cl_int *row_in_strip, cl_int *cols, int strip_ptr_size, int number_of_nonzeroes, int height, cl_double **result);
+void compute_using_cpu(cl_double *data, cl_double *vect, cl_int *strip_ptr, cl_int *row_in_strip, cl_int *cols, int number_of_nonzeroes, int height, const int *partition, int number_of_parts, cl_double **result);
 
 int main(int argc, char *argv[])
 {
-    (void)argc;
-    (void)argv;
-
     cl_int error;
     cl_uint number_of_devices = DEVICES_DEFAULT_SIZE;
     cl_device_id device_ids[DEVICES_DEFAULT_SIZE];
@@ -33,9 +33,10 @@ int main(int argc, char *argv[])
         int number_of_rows; 
         int number_of_columns;
         int number_of_nonzeroes;
+        int number_of_strips;
         int strip_ptr_size;
-        FILE *file;
         int i;
+        cl_int *ptr;
         cl_int *cols;
         cl_int *strip_ptr;
         cl_int *row_in_strip;
@@ -43,78 +44,27 @@ int main(int argc, char *argv[])
         cl_double *vect;
         cl_double *output;
         cl_double *output_cpu;
-        int height = 8;
-        const char *filename = "databases/cant-sorted.mtx";
-        struct timespec start_time;
-        struct timespec end_time;
+        int height = get_int_option(argc, argv, "--height", 8);
+        const char *filename = get_option(argc, argv, "--matrix", "databases/cant-sorted.mtx");
+        const bool compressed_indices = get_int_option(argc, argv, "--compressed-indices", 0) != 0;
         
-        size_t global_work_size[1] = { 8192 };
         size_t local_work_size[1] = { height * 4 };
+        size_t global_work_size[1] = { (8192 + local_work_size[0] - 1) / local_work_size[0] * local_work_size[0] };
         cl_uint work_dim = 1;
         
         
         /* prepare data for calculations */
         
-        file = fopen(filename, "r");
-        
-        if (file == NULL) 
-        {
-            perror(filename);
-            return FileError;
-        }
-        
-        if (read_size_of_matrices_from_file(file, &number_of_rows, &number_of_columns, &number_of_nonzeroes) == false)
+        if (read_csr_from_file(filename, true, &number_of_rows, &number_of_columns, &number_of_nonzeroes, &ptr, &cols, &data) == false)
         {
-            fclose(file);
             return FileError;
         }
-        
-        strip_ptr_size = ((int)ceil((double)number_of_rows / (double)height) + 1);
 
-        cols         = (cl_int *)malloc(number_of_nonzeroes * sizeof(cl_int));
-        data         = (cl_double *)malloc(number_of_nonzeroes * sizeof(cl_double));
-        strip_ptr    = (cl_int *)malloc(strip_ptr_size * sizeof(cl_int));
-        row_in_strip = (cl_int *)malloc(number_of_nonzeroes * sizeof(cl_int));
-        
-        strip_ptr[0] = 0;
-        
-        int previous_row = 1;
-        int current_strip_row = 0;
-        int strip_index = 1;
-        for (i = 0; i < number_of_nonzeroes; i++)
-        {
-            int current_row;
-            
-            fscanf(file, "%d %d %lg\n", &current_row, &cols[i], &data[i]);
+        /* strips come from CSR row pointers, so rows may come in any order and may be empty */
+        create_cmrs(ptr, number_of_rows, height, &number_of_strips, &strip_ptr, &row_in_strip);
+        strip_ptr_size = number_of_strips + 1;
 
-            cols[i]--;
-            
-            if (previous_row == current_row)
-            {
-                row_in_strip[i] = current_strip_row;
-            }
-            else 
-            {
-                previous_row = current_row;
-                
-                if (current_strip_row == height - 1)
-                {
-                    strip_ptr[strip_index] = i;
-                    strip_index++;
-                    current_strip_row = 0;
-                }
-                else 
-                {
-                    current_strip_row++;
-                }
-                
-                row_in_strip[i] = current_strip_row;
-            }
-        }
-
-        fclose(file);
-        
-        strip_ptr[strip_ptr_size - 1] = number_of_nonzeroes;
+        free(ptr);
 
         vect = (cl_double*)malloc(sizeof(cl_double) * number_of_columns);
         for (i = 0; i < number_of_columns; ++i) 
@@ -123,7 +73,17 @@ int main(int argc, char *argv[])
         }
         
         output = (cl_double*)malloc(sizeof(cl_double) * number_of_rows);
-        output_cpu = (cl_double*)malloc(sizeof(cl_double) * number_of_rows);
+        output_cpu = (cl_double*)calloc(number_of_rows, sizeof(cl_double));
+
+        const Precision value_precision = get_precision_option(argc, argv, "--precision");
+        const Precision vector_precision = get_precision_option(argc, argv, "--vector-precision");
+        const double tolerance = get_precision_tolerance(value_precision, vector_precision);
+
+        /* values and vector are narrowed once here, kernels widen them back to double */
+        void *device_data = convert_to_precision(data, number_of_nonzeroes, value_precision);
+        void *device_vect = convert_to_precision(vect, number_of_columns, vector_precision);
+
+        printf("values stored as %s, vector as %s\n", get_precision_name(value_precision), get_precision_name(vector_precision));
         
         
         /* prepare OpenCL program */
@@ -144,12 +104,12 @@ int main(int argc, char *argv[])
             return OpenCLProgramError;
         }
         
-        cl_mem buffer_data         = clCreateBuffer(context, CL_MEM_READ_ONLY, sizeof(cl_double) * number_of_nonzeroes, NULL, &error);
+        cl_mem buffer_data         = clCreateBuffer(context, CL_MEM_READ_ONLY, get_precision_size(value_precision) * number_of_nonzeroes, NULL, &error);
         cl_mem buffer_indices      = clCreateBuffer(context, CL_MEM_READ_ONLY, sizeof(cl_int) * number_of_nonzeroes, NULL, &error);
-        cl_mem buffer_vect         = clCreateBuffer(context, CL_MEM_READ_ONLY, sizeof(cl_double) * number_of_columns, NULL, &error);
+        cl_mem buffer_vect         = clCreateBuffer(context, CL_MEM_READ_ONLY, get_precision_size(vector_precision) * number_of_columns, NULL, &error);
         cl_mem buffer_strip_ptr    = clCreateBuffer(context, CL_MEM_READ_ONLY, sizeof(cl_int) * strip_ptr_size, NULL, &error);
         cl_mem buffer_row_in_strip = clCreateBuffer(context, CL_MEM_READ_ONLY, sizeof(cl_int) * number_of_nonzeroes, NULL, &error);
-        cl_mem buffer_output       = clCreateBuffer(context, CL_MEM_WRITE_ONLY, sizeof(cl_double) * number_of_rows, NULL, &error);
+        cl_mem buffer_output       = clCreateBuffer(context, CL_MEM_WRITE_ONLY, sizeof(cl_double) * (strip_ptr_size - 1) * height, NULL, &error);
         
         if (error != CL_SUCCESS)
         {
@@ -173,7 +133,11 @@ int main(int argc, char *argv[])
             return OpenCLProgramError;
         }
         
-        error = clBuildProgram(program, 0, NULL, NULL, NULL, NULL);
+        char build_options[128] = "";
+
+        append_precision_build_options(build_options, sizeof(build_options), value_precision, vector_precision);
+
+        error = clBuildProgram(program, 0, NULL, build_options, NULL, NULL);
         
         if (error != CL_SUCCESS)
         {
@@ -193,6 +157,11 @@ int main(int argc, char *argv[])
         /* set data to kernel */
         
         const int N = strip_ptr_size - 1;
+        const size_t partial_data_size = local_work_size[0] * height * sizeof(cl_double);
+        cl_ulong device_local_memory_size;
+        double ms = -1;
+
+        clGetDeviceInfo(device_ids[0], CL_DEVICE_LOCAL_MEM_SIZE, sizeof(cl_ulong), &device_local_memory_size, NULL);
         
         error  = clSetKernelArg(kernel, 0, sizeof(cl_mem), (void*)&buffer_data);
         error |= clSetKernelArg(kernel, 1, sizeof(cl_mem), (void*)&buffer_indices);
@@ -202,7 +171,7 @@ int main(int argc, char *argv[])
         error |= clSetKernelArg(kernel, 5, sizeof(cl_mem), (void*)&buffer_output);
         error |= clSetKernelArg(kernel, 6, sizeof(int), (void*)&N);
         error |= clSetKernelArg(kernel, 7, sizeof(int), (void*)&height);
-        error |= clSetKernelArg(kernel, 8, local_work_size[0] * height * sizeof(cl_double), NULL);
+        error |= clSetKernelArg(kernel, 8, partial_data_size, NULL);
         
         if (error != CL_SUCCESS)
         {
@@ -210,11 +179,11 @@ int main(int argc, char *argv[])
             return OpenCLProgramError;
         }
         
-        error  = clEnqueueWriteBuffer(command_queue, buffer_data, CL_FALSE, 0, sizeof(cl_double) * number_of_nonzeroes, data, 0, NULL, NULL);
+        error  = clEnqueueWriteBuffer(command_queue, buffer_data, CL_FALSE, 0, get_precision_size(value_precision) * number_of_nonzeroes, device_data, 0, NULL, NULL);
         error |= clEnqueueWriteBuffer(command_queue, buffer_indices, CL_FALSE, 0, sizeof(cl_int) * number_of_nonzeroes, cols, 0, NULL, NULL);
         error |= clEnqueueWriteBuffer(command_queue, buffer_strip_ptr, CL_FALSE, 0, sizeof(cl_int) * strip_ptr_size, strip_ptr, 0, NULL, NULL);
         error |= clEnqueueWriteBuffer(command_queue, buffer_row_in_strip, CL_FALSE, 0, sizeof(cl_int) * number_of_nonzeroes, row_in_strip, 0, NULL, NULL);
-        error |= clEnqueueWriteBuffer(command_queue, buffer_vect, CL_FALSE, 0, sizeof(cl_double) * number_of_columns, vect, 0, NULL, NULL);
+        error |= clEnqueueWriteBuffer(command_queue, buffer_vect, CL_FALSE, 0, get_precision_size(vector_precision) * number_of_columns, device_vect, 0, NULL, NULL);
         
         if (error != CL_SUCCESS)
         {
@@ -226,55 +195,254 @@ int main(int argc, char *argv[])
         
         /* run program */
         
-        cl_event nd_range_kernel_event;
+        if (partial_data_size <= device_local_memory_size)
+        {
+            ms = run_kernel(command_queue, kernel, work_dim, global_work_size, local_work_size);
 
-        clock_gettime(CLOCK_MONOTONIC, &start_time);
-        error = clEnqueueNDRangeKernel(command_queue, kernel, work_dim, NULL, global_work_size, local_work_size, 0, NULL, &nd_range_kernel_event);
-        clWaitForEvents(1, &nd_range_kernel_event);
-        clFinish(command_queue);
-        
-        clock_gettime(CLOCK_MONOTONIC, &end_time);
-        double ms = (double)(end_time.tv_nsec - start_time.tv_nsec) / 1000000 + (double)(end_time.tv_sec - start_time.tv_sec) * 1000;
+            if (ms < 0)
+            {
+                return OpenCLProgramError;
+            }
+
+            calculate_and_print_performance(ms, number_of_nonzeroes);
+            calculate_and_print_speed(ms, number_of_nonzeroes);
+
+
+            /* read output */
+
+            error = clEnqueueReadBuffer(command_queue, buffer_output, CL_TRUE, 0, sizeof(cl_double) * number_of_rows, output, 0, NULL, NULL);
+            clFinish(command_queue);
+
+            if (error != CL_SUCCESS)
+            {
+                printf("clEnqueueReadBuffer error %d\n", error);
+                return OpenCLProgramError;
+            }
 
-        calculate_and_print_performance(ms, number_of_nonzeroes);
-        calculate_and_print_speed(ms, number_of_nonzeroes);
+            if (check_result_with_tolerance(filename, vect, output, tolerance) == true)
+            {
+                printf("result is ok\n");
+            }
+            else
+            {
+                printf("result is wrong\n");
+            }
+        }
+        else
+        {
+            printf("cmrs kernel skipped: it needs %zu B of local memory, the device has %lu B\n", partial_data_size, (unsigned long)device_local_memory_size);
+        }
         
+//         for (i = 0; i < number_of_rows; ++i)
+//         {
+//             printf("%d: %d\n", i, output[i]);
+//         }
+
+
+        /* register-blocked kernel */
+
+        const bool use_subgroups = device_supports_extension(device_ids[0], "cl_khr_subgroups");
+        size_t registers_local_work_size[1] = { local_work_size[0] };
+
+        /* without sub-groups the work-group reduction needs a power-of-two local size, e.g. 32 for height 6 */
+        if (!use_subgroups)
+        {
+            registers_local_work_size[0] = 1;
+
+            while (registers_local_work_size[0] < local_work_size[0])
+            {
+                registers_local_work_size[0] <<= 1;
+            }
+        }
+
+        const size_t registers_global_work_size[1] = { (8192 + registers_local_work_size[0] - 1) / registers_local_work_size[0] * registers_local_work_size[0] };
+        const size_t registers_partial_data_size = use_subgroups ? sizeof(cl_double) : registers_local_work_size[0] * sizeof(cl_double);
+
+        char registers_build_options[128] = "";
+
+        if (use_subgroups)
+        {
+            strcpy(registers_build_options, "-cl-std=CL2.0 -DUSE_SUBGROUPS");
+        }
+
+        append_precision_build_options(registers_build_options, sizeof(registers_build_options), value_precision, vector_precision);
+
+        cl_program registers_program = build_program_from_file(context, device_ids[0], "kernels/Cmrs_Registers.cl", registers_build_options);
+
+        if (registers_program == NULL)
+        {
+            return OpenCLProgramError;
+        }
+
+        cl_kernel registers_kernel = clCreateKernel(registers_program, "cmrs_registers", &error);
+
         if (error != CL_SUCCESS)
         {
-            printf("clEnqueueNDRangeKernel error %d\n", error);
+            printf("clCreateKernel error %d\n", error);
             return OpenCLProgramError;
         }
-        
-        
-        /* read output */
-        
+
+        error  = clSetKernelArg(registers_kernel, 0, sizeof(cl_mem), (void*)&buffer_data);
+        error |= clSetKernelArg(registers_kernel, 1, sizeof(cl_mem), (void*)&buffer_indices);
+        error |= clSetKernelArg(registers_kernel, 2, sizeof(cl_mem), (void*)&buffer_strip_ptr);
+        error |= clSetKernelArg(registers_kernel, 3, sizeof(cl_mem), (void*)&buffer_row_in_strip);
+        error |= clSetKernelArg(registers_kernel, 4, sizeof(cl_mem), (void*)&buffer_vect);
+        error |= clSetKernelArg(registers_kernel, 5, sizeof(cl_mem), (void*)&buffer_output);
+        error |= clSetKernelArg(registers_kernel, 6, sizeof(int), (void*)&N);
+        error |= clSetKernelArg(registers_kernel, 7, sizeof(int), (void*)&height);
+        error |= clSetKernelArg(registers_kernel, 8, sizeof(int), (void*)&number_of_rows);
+        error |= clSetKernelArg(registers_kernel, 9, registers_partial_data_size, NULL);
+
+        if (error != CL_SUCCESS)
+        {
+            printf("clSetKernelArg errror\n");
+            return OpenCLProgramError;
+        }
+
+        double registers_ms = run_kernel(command_queue, registers_kernel, work_dim, registers_global_work_size, registers_local_work_size);
+
+        if (registers_ms < 0)
+        {
+            return OpenCLProgramError;
+        }
+
+        printf("\nRegister-blocked calculations (%s reduction)\n", use_subgroups ? "sub-group" : "work-group");
+        calculate_and_print_performance(registers_ms, number_of_nonzeroes);
+        calculate_and_print_speed(registers_ms, number_of_nonzeroes);
+
         error = clEnqueueReadBuffer(command_queue, buffer_output, CL_TRUE, 0, sizeof(cl_double) * number_of_rows, output, 0, NULL, NULL);
         clFinish(command_queue);
-        
+
         if (error != CL_SUCCESS)
         {
             printf("clEnqueueReadBuffer error %d\n", error);
             return OpenCLProgramError;
         }
-        
-        if (check_result(filename, vect, output) == true)
+
+        if (check_result_with_tolerance(filename, vect, output, tolerance) == true)
         {
-            printf("result is ok\n");
+            printf("register-blocked result is ok\n");
         }
         else
         {
-            printf("result is wrong\n");
+            printf("register-blocked result is wrong\n");
         }
-        
-//         for (i = 0; i < number_of_rows; ++i)
-//         {
-//             printf("%d: %d\n", i, output[i]);
-//         }
 
+        printf("\nOccupancy (height %d, local work size %zu, register-blocked %zu)\n", height, local_work_size[0], registers_local_work_size[0]);
+        print_kernel_occupancy("cmrs_registers", registers_kernel, device_ids[0]);
+
+        if (ms > 0)
+        {
+            print_kernel_occupancy("cmrs", kernel, device_ids[0]);
+            printf("register-blocked speedup %.2lfx\n", ms / registers_ms);
+        }
+
+
+        /* register-blocked kernel with columns as 16-bit offsets from the smallest column of the strip */
+
+        if (compressed_indices)
+        {
+            cl_ushort *deltas;
+            cl_int *bases;
+            cl_int *escaped_cols;
+            const int number_of_escaped = compress_column_indices(strip_ptr, N, cols, &deltas, &bases, &escaped_cols);
+
+            print_index_compression(number_of_nonzeroes, number_of_nonzeroes, N, number_of_escaped, get_precision_size(value_precision));
+
+            cl_mem buffer_deltas       = clCreateBuffer(context, CL_MEM_READ_ONLY, sizeof(cl_ushort) * number_of_nonzeroes, NULL, &error);
+            cl_mem buffer_bases        = clCreateBuffer(context, CL_MEM_READ_ONLY, sizeof(cl_int) * N, NULL, &error);
+            cl_mem buffer_escaped_cols = clCreateBuffer(context, CL_MEM_READ_ONLY, sizeof(cl_int) * (number_of_escaped > 0 ? number_of_escaped : 1), NULL, &error);
+
+            if (error != CL_SUCCESS)
+            {
+                printf("clCreateBuffer error %d\n", error);
+                return OpenCLProgramError;
+            }
+
+            cl_kernel compressed_kernel = clCreateKernel(registers_program, "cmrs_registers_compressed", &error);
+
+            if (error != CL_SUCCESS)
+            {
+                printf("clCreateKernel error %d\n", error);
+                return OpenCLProgramError;
+            }
+
+            error =  clSetKernelArg(compressed_kernel, 0, sizeof(cl_mem), (void*)&buffer_data);
+            error |= clSetKernelArg(compressed_kernel, 1, sizeof(cl_mem), (void*)&buffer_deltas);
+            error |= clSetKernelArg(compressed_kernel, 2, sizeof(cl_mem), (void*)&buffer_bases);
+            error |= clSetKernelArg(compressed_kernel, 3, sizeof(cl_mem), (void*)&buffer_escaped_cols);
+            error |= clSetKernelArg(compressed_kernel, 4, sizeof(cl_mem), (void*)&buffer_strip_ptr);
+            error |= clSetKernelArg(compressed_kernel, 5, sizeof(cl_mem), (void*)&buffer_row_in_strip);
+            error |= clSetKernelArg(compressed_kernel, 6, sizeof(cl_mem), (void*)&buffer_vect);
+            error |= clSetKernelArg(compressed_kernel, 7, sizeof(cl_mem), (void*)&buffer_output);
+            error |= clSetKernelArg(compressed_kernel, 8, sizeof(int), (void*)&N);
+            error |= clSetKernelArg(compressed_kernel, 9, sizeof(int), (void*)&height);
+            error |= clSetKernelArg(compressed_kernel, 10, sizeof(int), (void*)&number_of_rows);
+            error |= clSetKernelArg(compressed_kernel, 11, registers_partial_data_size, NULL);
+
+            if (error != CL_SUCCESS)
+            {
+                printf("clSetKernelArg errror\n");
+                return OpenCLProgramError;
+            }
+
+            error  = clEnqueueWriteBuffer(command_queue, buffer_deltas, CL_FALSE, 0, sizeof(cl_ushort) * number_of_nonzeroes, deltas, 0, NULL, NULL);
+            error |= clEnqueueWriteBuffer(command_queue, buffer_bases, CL_FALSE, 0, sizeof(cl_int) * N, bases, 0, NULL, NULL);
+            error |= clEnqueueWriteBuffer(command_queue, buffer_escaped_cols, CL_FALSE, 0, sizeof(cl_int) * (number_of_escaped > 0 ? number_of_escaped : 1), escaped_cols, 0, NULL, NULL);
+
+            if (error != CL_SUCCESS)
+            {
+                printf("clEnqueueWriteBuffer error %d\n", error);
+                return OpenCLProgramError;
+            }
+            clFinish(command_queue);
+
+            printf("\ncompressed column indices\n");
+
+            const double compressed_ms = run_kernel(command_queue, compressed_kernel, work_dim, registers_global_work_size, registers_local_work_size);
+
+            if (compressed_ms < 0)
+            {
+                return OpenCLProgramError;
+            }
+
+            calculate_and_print_performance(compressed_ms, number_of_nonzeroes);
+            printf("speedup over 32-bit columns (register-blocked kernel) %.2lf\n", registers_ms / compressed_ms);
+
+            error = clEnqueueReadBuffer(command_queue, buffer_output, CL_TRUE, 0, sizeof(cl_double) * number_of_rows, output, 0, NULL, NULL);
+
+            if (error != CL_SUCCESS)
+            {
+                printf("clEnqueueReadBuffer error %d\n", error);
+                return OpenCLProgramError;
+            }
+
+            if (check_result_with_tolerance(filename, vect, output, tolerance) == true)
+            {
+                printf("compressed result is ok\n");
+            }
+            else
+            {
+                printf("compressed result is wrong\n");
+            }
+
+            clReleaseMemObject(buffer_deltas);
+            clReleaseMemObject(buffer_bases);
+            clReleaseMemObject(buffer_escaped_cols);
+            clReleaseKernel(compressed_kernel);
+
+            free(deltas);
+            free(bases);
+            free(escaped_cols);
+        }
+
+
+        /* CPU, strips split once into ranges with equal nonzeroes, one per thread */
 
-        /* CPU */
+        const int number_of_parts = get_number_of_cpu_parts();
+        int *partition = create_balanced_partition(strip_ptr, strip_ptr_size - 1, number_of_parts);
 
-        compute_using_cpu(data, vect, strip_ptr, row_in_strip, cols, strip_ptr_size, number_of_nonzeroes, height, &output_cpu);
+        compute_using_cpu(data, vect, strip_ptr, row_in_strip, cols, number_of_nonzeroes, height, partition, number_of_parts, &output_cpu);
 
         if (check_result(filename, vect, output_cpu) == true)
         {
@@ -300,6 +468,9 @@ int main(int argc, char *argv[])
         free(strip_ptr);
         free(row_in_strip);
         free(vect);
+        free(partition);
+        free(device_data);
+        free(device_vect);
         free(output);
         free(output_cpu);
         free(source);
@@ -307,7 +478,9 @@ int main(int argc, char *argv[])
         clFlush(command_queue);
         clReleaseCommandQueue(command_queue);
         clReleaseKernel(kernel);
+        clReleaseKernel(registers_kernel);
         clReleaseProgram(program);
+        clReleaseProgram(registers_program);
         clReleaseContext(context);
         
         break;
@@ -316,24 +489,43 @@ int main(int argc, char *argv[])
     return Success;
 }
 
-void compute_using_cpu(cl_double *data, cl_double *vect, cl_int *strip_ptr, cl_int *row_in_strip, cl_int *cols, int strip_ptr_size, int number_of_nonzeroes, int height, cl_double **result)
+/*!
+ * \brief CMRS on the CPU, every part of the balanced partition of strips is timed separately.
+ */
+void compute_using_cpu(cl_double *data, cl_double *vect, cl_int *strip_ptr, cl_int *row_in_strip, cl_int *cols, int number_of_nonzeroes, int height, const int *partition, int number_of_parts, cl_double **result)
 {
-    int i;
     struct timespec start_time;
     struct timespec end_time;
+    double *thread_ms = (double*)malloc(sizeof(double) * number_of_parts);
 
     clock_gettime(CLOCK_MONOTONIC, &start_time);
 
-    #pragma omp parallel for shared(data, vect, strip_ptr, strip_ptr_size, row_in_strip, cols, result) private(i)
-    for (i = 0; i < strip_ptr_size - 1; ++i)
+    #pragma omp parallel num_threads(number_of_parts) shared(data, vect, strip_ptr, row_in_strip, cols, height, partition, number_of_parts, thread_ms, result)
     {
-        const int row_index = i * height;
-        const int end_index = strip_ptr[i + 1];
-        int current_index;
+        int part;
 
-        for (current_index = strip_ptr[i]; current_index < end_index; ++current_index)
+        for (part = omp_get_thread_num(); part < number_of_parts; part += omp_get_num_threads())
         {
-            (*result)[row_index + row_in_strip[current_index]] += data[current_index] * vect[cols[current_index]];
+            struct timespec thread_start_time;
+            struct timespec thread_end_time;
+            int i;
+
+            clock_gettime(CLOCK_MONOTONIC, &thread_start_time);
+
+            for (i = partition[part]; i < partition[part + 1]; ++i)
+            {
+                const int row_index = i * height;
+                const int end_index = strip_ptr[i + 1];
+                int current_index;
+
+                for (current_index = strip_ptr[i]; current_index < end_index; ++current_index)
+                {
+                    (*result)[row_index + row_in_strip[current_index]] += data[current_index] * vect[cols[current_index]];
+                }
+            }
+
+            clock_gettime(CLOCK_MONOTONIC, &thread_end_time);
+            thread_ms[part] = (double)(thread_end_time.tv_nsec - thread_start_time.tv_nsec) / 1000000 + (double)(thread_end_time.tv_sec - thread_start_time.tv_sec) * 1000;
         }
     }
 
@@ -342,4 +534,7 @@ void compute_using_cpu(cl_double *data, cl_double *vect, cl_int *strip_ptr, cl_i
 
     printf("\nCPU calculations\n");
     calculate_and_print_performance(ms, number_of_nonzeroes);
+    print_thread_times(thread_ms, number_of_parts);
+
+    free(thread_ms);
 }
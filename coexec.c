@@ -0,0 +1,366 @@
+#define CL_TARGET_OPENCL_VERSION 300
+#include <CL/cl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <time.h>
+#include <omp.h>
+
+#include "helper_functions.h"
+#include "formats.h"
+#include "precision.h"
+#include "partition.h"
+#include "enums.h"
+
+#define DEVICES_DEFAULT_SIZE 8
+#define MIN_DEVICE_SHARE 0.01
+#define MAX_DEVICE_SHARE 0.99
+
+int find_split_row(const cl_int *ptr, int number_of_rows, double device_share);
+cl_int run_coexecution(cl_command_queue command_queue, cl_kernel kernel, cl_mem buffer_output, cl_uint work_dim, const size_t *global_work_size, const size_t *local_work_size,
+                       const cl_double *data, const cl_double *vect, const cl_int *ptr, const cl_int *cols, int number_of_rows, int split_row, int number_of_parts,
+                       cl_double *output, double *device_ms, double *host_ms, double *total_ms);
+
+int main(int argc, char *argv[])
+{
+    cl_int error;
+    cl_uint number_of_devices = DEVICES_DEFAULT_SIZE;
+    cl_device_id device_ids[DEVICES_DEFAULT_SIZE];
+
+    if (get_device_ids(&device_ids[0], &number_of_devices) != CL_SUCCESS)
+    {
+        return OpenCLDeviceError;
+    }
+
+    for (cl_uint device_number = 0; device_number < number_of_devices; ++device_number)
+    {
+        int number_of_rows;
+        int number_of_columns;
+        int number_of_nonzeroes;
+        int i;
+        int iteration;
+        cl_int *ptr;
+        cl_int *cols;
+        cl_double *data;
+        cl_double *vect;
+        cl_double *output;
+        double device_ms;
+        double host_ms;
+        double total_ms;
+        double device_rate = 0;
+        double host_rate = 0;
+        const char *filename = get_option(argc, argv, "--matrix", "databases/cant-sorted.mtx");
+        const int iterations = get_int_option(argc, argv, "--iterations", 20);
+        double device_share = atof(get_option(argc, argv, "--device-share", "0.5"));
+        char build_options[128] = "";
+
+        size_t global_work_size[1] = { 8192 };
+        size_t local_work_size[1] = { 256 };
+        cl_uint work_dim = 1;
+
+        if (iterations < 1 || device_share < 0 || device_share > 1)
+        {
+            printf("--iterations must be at least 1 and --device-share between 0 and 1\n");
+            return OtherError;
+        }
+
+
+        /* prepare data for calculations */
+
+        if (read_csr_from_file(filename, true, &number_of_rows, &number_of_columns, &number_of_nonzeroes, &ptr, &cols, &data) == false)
+        {
+            return FileError;
+        }
+
+        vect = (cl_double*)malloc(sizeof(cl_double) * number_of_columns);
+        output = (cl_double*)malloc(sizeof(cl_double) * number_of_rows);
+
+        for (i = 0; i < number_of_columns; ++i)
+        {
+            vect[i] = i;
+        }
+
+        const Precision value_precision = get_precision_option(argc, argv, "--precision");
+        const Precision vector_precision = get_precision_option(argc, argv, "--vector-precision");
+        const double tolerance = get_precision_tolerance(value_precision, vector_precision);
+
+        void *device_data = convert_to_precision(data, number_of_nonzeroes, value_precision);
+        void *device_vect = convert_to_precision(vect, number_of_columns, vector_precision);
+
+        /* one host thread drives the device, the others multiply the rows of the host */
+        const int number_of_parts = get_number_of_cpu_parts() > 1 ? get_number_of_cpu_parts() - 1 : 1;
+
+        omp_set_max_active_levels(2);
+
+        printf("values stored as %s, vector as %s, %d host threads\n", get_precision_name(value_precision), get_precision_name(vector_precision), number_of_parts);
+
+
+        /* prepare OpenCL program */
+
+        cl_context context = clCreateContext(0, number_of_devices, device_ids, NULL, NULL, NULL);
+
+        if (NULL == context)
+        {
+            printf("context is null\n");
+            return OpenCLProgramError;
+        }
+
+        cl_command_queue command_queue = clCreateCommandQueueWithProperties(context, device_ids[0], 0, &error);
+
+        if (error != CL_SUCCESS)
+        {
+            printf("clCreateCommandQueueWithProperties error %d\n", error);
+            return OpenCLProgramError;
+        }
+
+        cl_mem buffer_ptr    = clCreateBuffer(context, CL_MEM_READ_ONLY, sizeof(cl_int) * (number_of_rows + 1), NULL, &error);
+        cl_mem buffer_col    = clCreateBuffer(context, CL_MEM_READ_ONLY, sizeof(cl_int) * number_of_nonzeroes, NULL, &error);
+        cl_mem buffer_data   = clCreateBuffer(context, CL_MEM_READ_ONLY, get_precision_size(value_precision) * number_of_nonzeroes, NULL, &error);
+        cl_mem buffer_vect   = clCreateBuffer(context, CL_MEM_READ_ONLY, get_precision_size(vector_precision) * number_of_columns, NULL, &error);
+        cl_mem buffer_output = clCreateBuffer(context, CL_MEM_WRITE_ONLY, sizeof(cl_double) * number_of_rows, NULL, &error);
+
+        if (error != CL_SUCCESS)
+        {
+            printf("clCreateBuffer error %d\n", error);
+            return OpenCLProgramError;
+        }
+
+        error  = clEnqueueWriteBuffer(command_queue, buffer_ptr, CL_FALSE, 0, sizeof(cl_int) * (number_of_rows + 1), ptr, 0, NULL, NULL);
+        error |= clEnqueueWriteBuffer(command_queue, buffer_col, CL_FALSE, 0, sizeof(cl_int) * number_of_nonzeroes, cols, 0, NULL, NULL);
+        error |= clEnqueueWriteBuffer(command_queue, buffer_data, CL_FALSE, 0, get_precision_size(value_precision) * number_of_nonzeroes, device_data, 0, NULL, NULL);
+        error |= clEnqueueWriteBuffer(command_queue, buffer_vect, CL_FALSE, 0, get_precision_size(vector_precision) * number_of_columns, device_vect, 0, NULL, NULL);
+
+        if (error != CL_SUCCESS)
+        {
+            printf("clEnqueueWriteBuffer error %d\n", error);
+            return OpenCLProgramError;
+        }
+        clFinish(command_queue);
+
+        append_precision_build_options(build_options, sizeof(build_options), value_precision, vector_precision);
+
+        cl_program program = build_program_from_file(context, device_ids[0], "kernels/Csr.cl", build_options);
+
+        if (program == NULL)
+        {
+            return OpenCLProgramError;
+        }
+
+        cl_kernel kernel = clCreateKernel(program, "csr", &error);
+
+        if (error != CL_SUCCESS)
+        {
+            printf("clCreateKernel error %d\n", error);
+            return OpenCLProgramError;
+        }
+
+        error  = clSetKernelArg(kernel, 0, sizeof(cl_mem), (void*)&buffer_ptr);
+        error |= clSetKernelArg(kernel, 1, sizeof(cl_mem), (void*)&buffer_col);
+        error |= clSetKernelArg(kernel, 2, sizeof(cl_mem), (void*)&buffer_data);
+        error |= clSetKernelArg(kernel, 3, sizeof(cl_mem), (void*)&buffer_vect);
+        error |= clSetKernelArg(kernel, 4, sizeof(cl_mem), (void*)&buffer_output);
+
+        if (error != CL_SUCCESS)
+        {
+            printf("clSetKernelArg errror\n");
+            return OpenCLProgramError;
+        }
+
+
+        /* each side alone, for comparison */
+
+        if (run_coexecution(command_queue, kernel, buffer_output, work_dim, global_work_size, local_work_size, data, vect, ptr, cols,
+                            number_of_rows, number_of_rows, number_of_parts, output, &device_ms, &host_ms, &total_ms) != CL_SUCCESS)
+        {
+            return OpenCLProgramError;
+        }
+
+        const double device_only_ms = total_ms;
+
+        if (run_coexecution(command_queue, kernel, buffer_output, work_dim, global_work_size, local_work_size, data, vect, ptr, cols,
+                            number_of_rows, 0, number_of_parts, output, &device_ms, &host_ms, &total_ms) != CL_SUCCESS)
+        {
+            return OpenCLProgramError;
+        }
+
+        const double host_only_ms = total_ms;
+
+        printf("device only %.3lf ms, host only %.3lf ms\n", device_only_ms, host_only_ms);
+
+
+        /* co-execution, the device share moves towards the ratio of the measured throughputs so that both sides finish together */
+
+        for (iteration = 0; iteration < iterations; ++iteration)
+        {
+            const int split_row = find_split_row(ptr, number_of_rows, device_share);
+            const int device_nonzeroes = ptr[split_row];
+            const int host_nonzeroes = number_of_nonzeroes - device_nonzeroes;
+
+            if (run_coexecution(command_queue, kernel, buffer_output, work_dim, global_work_size, local_work_size, data, vect, ptr, cols,
+                                number_of_rows, split_row, number_of_parts, output, &device_ms, &host_ms, &total_ms) != CL_SUCCESS)
+            {
+                return OpenCLProgramError;
+            }
+
+            printf("iteration %d: device share %.3lf (%d rows), device %.3lf ms, host %.3lf ms, total %.3lf ms\n",
+                   iteration, (double)device_nonzeroes / number_of_nonzeroes, split_row, device_ms, host_ms, total_ms);
+
+            /* a side without work keeps its last throughput */
+            if (device_nonzeroes > 0 && device_ms > 0)
+            {
+                device_rate = device_nonzeroes / device_ms;
+            }
+
+            if (host_nonzeroes > 0 && host_ms > 0)
+            {
+                host_rate = host_nonzeroes / host_ms;
+            }
+
+            if (device_rate > 0 && host_rate > 0)
+            {
+                device_share = 0.5 * device_share + 0.5 * device_rate / (device_rate + host_rate);
+                device_share = fmin(MAX_DEVICE_SHARE, fmax(MIN_DEVICE_SHARE, device_share));
+            }
+        }
+
+        printf("co-execution %.3lf ms, speedup %.2lf over device only, %.2lf over host only\n",
+               total_ms, device_only_ms / total_ms, host_only_ms / total_ms);
+
+        if (check_result_with_tolerance(filename, vect, output, tolerance) == true)
+        {
+            printf("result is ok\n");
+        }
+        else
+        {
+            printf("result is wrong\n");
+        }
+
+
+        /* release memory */
+
+        clReleaseMemObject(buffer_ptr);
+        clReleaseMemObject(buffer_col);
+        clReleaseMemObject(buffer_data);
+        clReleaseMemObject(buffer_vect);
+        clReleaseMemObject(buffer_output);
+
+        free(ptr);
+        free(cols);
+        free(data);
+        free(vect);
+        free(device_data);
+        free(device_vect);
+        free(output);
+
+        clFlush(command_queue);
+        clReleaseCommandQueue(command_queue);
+        clReleaseKernel(kernel);
+        clReleaseProgram(program);
+        clReleaseContext(context);
+
+        break;
+    }
+
+    return Success;
+}
+
+/*!
+ * \brief First row of the host part, so that the rows before it hold device_share of the nonzeroes.
+ */
+int find_split_row(const cl_int *ptr, int number_of_rows, double device_share)
+{
+    const long long target = (long long)(device_share * ptr[number_of_rows] + 0.5);
+    int low = 0;
+    int high = number_of_rows;
+
+    while (low < high)
+    {
+        const int middle = low + (high - low) / 2;
+
+        if (ptr[middle] < target)
+        {
+            low = middle + 1;
+        }
+        else
+        {
+            high = middle;
+        }
+    }
+
+    return low;
+}
+
+/*!
+ * \brief Rows 0 to split_row - 1 on the device, the others on number_of_parts host threads split by nonzeroes, at the same time.
+ *        device_ms includes reading the device rows back, total_ms is the time until both sides are done.
+ */
+cl_int run_coexecution(cl_command_queue command_queue, cl_kernel kernel, cl_mem buffer_output, cl_uint work_dim, const size_t *global_work_size, const size_t *local_work_size,
+                       const cl_double *data, const cl_double *vect, const cl_int *ptr, const cl_int *cols, int number_of_rows, int split_row, int number_of_parts,
+                       cl_double *output, double *device_ms, double *host_ms, double *total_ms)
+{
+    cl_int error = CL_SUCCESS;
+    struct timespec start_time;
+    struct timespec device_end_time;
+    struct timespec host_end_time;
+    int *partition = create_balanced_partition(ptr + split_row, number_of_rows - split_row, number_of_parts);
+
+    clock_gettime(CLOCK_MONOTONIC, &start_time);
+
+    #pragma omp parallel sections num_threads(2) shared(error, partition)
+    {
+        #pragma omp section
+        {
+            if (split_row > 0)
+            {
+                error  = clSetKernelArg(kernel, 5, sizeof(int), (void*)&split_row);
+                error |= clEnqueueNDRangeKernel(command_queue, kernel, work_dim, NULL, global_work_size, local_work_size, 0, NULL, NULL);
+                error |= clEnqueueReadBuffer(command_queue, buffer_output, CL_TRUE, 0, sizeof(cl_double) * split_row, output, 0, NULL, NULL);
+            }
+
+            clock_gettime(CLOCK_MONOTONIC, &device_end_time);
+        }
+
+        #pragma omp section
+        {
+            #pragma omp parallel num_threads(number_of_parts) shared(data, vect, ptr, cols, split_row, partition, number_of_parts, output)
+            {
+                int part;
+
+                for (part = omp_get_thread_num(); part < number_of_parts; part += omp_get_num_threads())
+                {
+                    int i;
+
+                    for (i = split_row + partition[part]; i < split_row + partition[part + 1]; ++i)
+                    {
+                        double sum = 0;
+                        int j;
+
+                        for (j = ptr[i]; j < ptr[i + 1]; ++j)
+                        {
+                            sum += data[j] * vect[cols[j]];
+                        }
+
+                        output[i] = sum;
+                    }
+                }
+            }
+
+            clock_gettime(CLOCK_MONOTONIC, &host_end_time);
+        }
+    }
+
+    free(partition);
+
+    if (error != CL_SUCCESS)
+    {
+        printf("device part error %d\n", error);
+        return error;
+    }
+
+    *device_ms = (double)(device_end_time.tv_nsec - start_time.tv_nsec) / 1000000 + (double)(device_end_time.tv_sec - start_time.tv_sec) * 1000;
+    *host_ms = (double)(host_end_time.tv_nsec - start_time.tv_nsec) / 1000000 + (double)(host_end_time.tv_sec - start_time.tv_sec) * 1000;
+    *total_ms = *device_ms > *host_ms ? *device_ms : *host_ms;
+
+    return CL_SUCCESS;
+}
@@ -0,0 +1,488 @@
+#define CL_TARGET_OPENCL_VERSION 300
+#include <CL/cl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "helper_functions.h"
+#include "formats.h"
+#include "precision.h"
+#include "counters.h"
+#include "enums.h"
+
+#define DEVICES_DEFAULT_SIZE 8
+#define DEFAULT_L2_CACHE_SIZE (256 * 1024)
+
+double compute_rows_using_cpu(const cl_double *data, const cl_double *vect, const cl_int *ptr, const cl_int *cols, int number_of_rows, int runs, cl_double *result, long long *misses);
+double compute_panels_using_cpu(const cl_double *data, const cl_double *vect, const cl_int *panel_ptr, const cl_int *segment_rows, const cl_int *segment_ptr, const cl_int *cols,
+                                int number_of_panels, int number_of_rows, int runs, cl_double *result, long long *misses);
+double run_panels(cl_command_queue command_queue, cl_kernel kernel, cl_mem buffer_output, const cl_int *panel_ptr, int number_of_panels, int number_of_rows, int number_of_columns,
+                  int panel_width, cl_uint work_dim, const size_t *global_work_size, const size_t *local_work_size);
+void print_misses(const char *name, double ms, long long misses, int number_of_nonzeroes);
+
+int main(int argc, char *argv[])
+{
+    cl_int error;
+    cl_uint number_of_devices = DEVICES_DEFAULT_SIZE;
+    cl_device_id device_ids[DEVICES_DEFAULT_SIZE];
+
+    if (get_device_ids(&device_ids[0], &number_of_devices) != CL_SUCCESS)
+    {
+        return OpenCLDeviceError;
+    }
+
+    for (cl_uint device_number = 0; device_number < number_of_devices; ++device_number)
+    {
+        int number_of_rows;
+        int number_of_columns;
+        int number_of_nonzeroes;
+        int number_of_panels;
+        int number_of_segments;
+        int number_of_tiles;
+        int number_of_tile_segments;
+        int i;
+        int run;
+        cl_int *ptr;
+        cl_int *cols;
+        cl_double *data;
+        cl_int *panel_ptr;
+        cl_int *segment_rows;
+        cl_int *segment_ptr;
+        cl_int *panel_cols;
+        cl_double *panel_data;
+        cl_int *tile_ptr;
+        cl_int *tile_segment_rows;
+        cl_int *tile_segment_ptr;
+        cl_int *tile_cols;
+        cl_double *tile_data;
+        cl_double *vect;
+        cl_double *output;
+        long long row_misses;
+        long long panel_misses;
+        double csr_ms = 0;
+        double tiles_ms = 0;
+        cl_ulong device_local_memory_size;
+        const char *filename = get_option(argc, argv, "--matrix", "databases/cant-sorted.mtx");
+        const int runs = get_int_option(argc, argv, "--runs", 10);
+        const long l2_cache_size = sysconf(_SC_LEVEL2_CACHE_SIZE) > 0 ? sysconf(_SC_LEVEL2_CACHE_SIZE) : DEFAULT_L2_CACHE_SIZE;
+        char build_options[128] = "";
+
+        size_t global_work_size[1] = { 8192 };
+        size_t local_work_size[1] = { 256 };
+        cl_uint work_dim = 1;
+
+        if (runs < 1)
+        {
+            printf("--runs must be at least 1\n");
+            return OtherError;
+        }
+
+
+        /* prepare data for calculations, panels of the vector take half of L2 on the host and half of local memory on the device */
+
+        if (read_csr_from_file(filename, true, &number_of_rows, &number_of_columns, &number_of_nonzeroes, &ptr, &cols, &data) == false)
+        {
+            return FileError;
+        }
+
+        clGetDeviceInfo(device_ids[0], CL_DEVICE_LOCAL_MEM_SIZE, sizeof(cl_ulong), &device_local_memory_size, NULL);
+
+        const int panel_width = get_int_option(argc, argv, "--panel-width", (int)(l2_cache_size / 2 / sizeof(cl_double)));
+        const int max_tile_width = (int)(device_local_memory_size / sizeof(cl_double));
+        int tile_width = get_int_option(argc, argv, "--tile-width", max_tile_width / 2);
+
+        if (tile_width > max_tile_width)
+        {
+            printf("--tile-width %d does not fit in %lu bytes of local memory, using %d\n", tile_width, (unsigned long)device_local_memory_size, max_tile_width);
+            tile_width = max_tile_width;
+        }
+
+        if (panel_width < 1 || tile_width < 1)
+        {
+            printf("--panel-width and --tile-width must be at least 1\n");
+            return OtherError;
+        }
+
+        create_column_panels(ptr, cols, data, number_of_rows, number_of_columns, panel_width, &number_of_panels,
+                             &panel_ptr, &number_of_segments, &segment_rows, &segment_ptr, &panel_cols, &panel_data);
+        create_column_panels(ptr, cols, data, number_of_rows, number_of_columns, tile_width, &number_of_tiles,
+                             &tile_ptr, &number_of_tile_segments, &tile_segment_rows, &tile_segment_ptr, &tile_cols, &tile_data);
+
+        vect = (cl_double*)malloc(sizeof(cl_double) * number_of_columns);
+        output = (cl_double*)malloc(sizeof(cl_double) * number_of_rows);
+
+        for (i = 0; i < number_of_columns; ++i)
+        {
+            vect[i] = i;
+        }
+
+        printf("vector %.1lf KB, L2 %ld KB\n", number_of_columns * sizeof(cl_double) / 1024.0, l2_cache_size / 1024);
+        printf("host: %d panels of %d columns, %d row segments (%.2lf per row)\n", number_of_panels, panel_width, number_of_segments, (double)number_of_segments / number_of_rows);
+        printf("device: %d tiles of %d columns, %d row segments (%.2lf per row)\n", number_of_tiles, tile_width, number_of_tile_segments, (double)number_of_tile_segments / number_of_rows);
+
+        const Precision value_precision = get_precision_option(argc, argv, "--precision");
+        const Precision vector_precision = get_precision_option(argc, argv, "--vector-precision");
+        const double tolerance = get_precision_tolerance(value_precision, vector_precision);
+        const size_t value_size = get_precision_size(value_precision);
+
+        void *device_data = convert_to_precision(data, number_of_nonzeroes, value_precision);
+        void *device_tile_data = convert_to_precision(tile_data, number_of_nonzeroes, value_precision);
+        void *device_vect = convert_to_precision(vect, number_of_columns, vector_precision);
+
+
+        /* CPU, gathers of the whole vector against one panel at a time */
+
+        const double rows_ms = compute_rows_using_cpu(data, vect, ptr, cols, number_of_rows, runs, output, &row_misses);
+        const double panels_ms = compute_panels_using_cpu(panel_data, vect, panel_ptr, segment_rows, segment_ptr, panel_cols, number_of_panels, number_of_rows, runs, output, &panel_misses);
+
+        printf("\nCPU calculations, %d runs\n", runs);
+        print_misses("row by row", rows_ms, row_misses, number_of_nonzeroes);
+        print_misses("column panels", panels_ms, panel_misses, number_of_nonzeroes);
+        printf("speedup %.2lf\n", rows_ms / panels_ms);
+
+        if (row_misses > 0 && panel_misses >= 0)
+        {
+            printf("gather misses reduced by %.1lf%%\n", 100.0 * (row_misses - panel_misses) / row_misses);
+        }
+
+        if (check_result(filename, vect, output) == true)
+        {
+            printf("cpu result is ok\n");
+        }
+        else
+        {
+            printf("cpu result is wrong\n");
+        }
+
+
+        /* prepare OpenCL program */
+
+        cl_context context = clCreateContext(0, number_of_devices, device_ids, NULL, NULL, NULL);
+
+        if (NULL == context)
+        {
+            printf("context is null\n");
+            return OpenCLProgramError;
+        }
+
+        cl_command_queue command_queue = clCreateCommandQueueWithProperties(context, device_ids[0], 0, &error);
+
+        if (error != CL_SUCCESS)
+        {
+            printf("clCreateCommandQueueWithProperties error %d\n", error);
+            return OpenCLProgramError;
+        }
+
+        cl_mem buffer_ptr                = clCreateBuffer(context, CL_MEM_READ_ONLY, sizeof(cl_int) * (number_of_rows + 1), NULL, &error);
+        cl_mem buffer_col                = clCreateBuffer(context, CL_MEM_READ_ONLY, sizeof(cl_int) * number_of_nonzeroes, NULL, &error);
+        cl_mem buffer_data               = clCreateBuffer(context, CL_MEM_READ_ONLY, value_size * number_of_nonzeroes, NULL, &error);
+        cl_mem buffer_tile_segment_rows  = clCreateBuffer(context, CL_MEM_READ_ONLY, sizeof(cl_int) * number_of_tile_segments, NULL, &error);
+        cl_mem buffer_tile_segment_ptr   = clCreateBuffer(context, CL_MEM_READ_ONLY, sizeof(cl_int) * (number_of_tile_segments + 1), NULL, &error);
+        cl_mem buffer_tile_col           = clCreateBuffer(context, CL_MEM_READ_ONLY, sizeof(cl_int) * number_of_nonzeroes, NULL, &error);
+        cl_mem buffer_tile_data          = clCreateBuffer(context, CL_MEM_READ_ONLY, value_size * number_of_nonzeroes, NULL, &error);
+        cl_mem buffer_vect               = clCreateBuffer(context, CL_MEM_READ_ONLY, get_precision_size(vector_precision) * number_of_columns, NULL, &error);
+        cl_mem buffer_output             = clCreateBuffer(context, CL_MEM_READ_WRITE, sizeof(cl_double) * number_of_rows, NULL, &error);
+
+        if (error != CL_SUCCESS)
+        {
+            printf("clCreateBuffer error %d\n", error);
+            return OpenCLProgramError;
+        }
+
+        error  = clEnqueueWriteBuffer(command_queue, buffer_ptr, CL_FALSE, 0, sizeof(cl_int) * (number_of_rows + 1), ptr, 0, NULL, NULL);
+        error |= clEnqueueWriteBuffer(command_queue, buffer_col, CL_FALSE, 0, sizeof(cl_int) * number_of_nonzeroes, cols, 0, NULL, NULL);
+        error |= clEnqueueWriteBuffer(command_queue, buffer_data, CL_FALSE, 0, value_size * number_of_nonzeroes, device_data, 0, NULL, NULL);
+        error |= clEnqueueWriteBuffer(command_queue, buffer_tile_segment_rows, CL_FALSE, 0, sizeof(cl_int) * number_of_tile_segments, tile_segment_rows, 0, NULL, NULL);
+        error |= clEnqueueWriteBuffer(command_queue, buffer_tile_segment_ptr, CL_FALSE, 0, sizeof(cl_int) * (number_of_tile_segments + 1), tile_segment_ptr, 0, NULL, NULL);
+        error |= clEnqueueWriteBuffer(command_queue, buffer_tile_col, CL_FALSE, 0, sizeof(cl_int) * number_of_nonzeroes, tile_cols, 0, NULL, NULL);
+        error |= clEnqueueWriteBuffer(command_queue, buffer_tile_data, CL_FALSE, 0, value_size * number_of_nonzeroes, device_tile_data, 0, NULL, NULL);
+        error |= clEnqueueWriteBuffer(command_queue, buffer_vect, CL_FALSE, 0, get_precision_size(vector_precision) * number_of_columns, device_vect, 0, NULL, NULL);
+
+        if (error != CL_SUCCESS)
+        {
+            printf("clEnqueueWriteBuffer error %d\n", error);
+            return OpenCLProgramError;
+        }
+        clFinish(command_queue);
+
+        append_precision_build_options(build_options, sizeof(build_options), value_precision, vector_precision);
+
+        cl_program program = build_program_from_file(context, device_ids[0], "kernels/Csr.cl", build_options);
+
+        if (program == NULL)
+        {
+            return OpenCLProgramError;
+        }
+
+        cl_kernel csr_kernel = clCreateKernel(program, "csr", &error);
+        cl_kernel panel_kernel = clCreateKernel(program, "csr_column_panel", &error);
+
+        if (error != CL_SUCCESS)
+        {
+            printf("clCreateKernel error %d\n", error);
+            return OpenCLProgramError;
+        }
+
+
+        /* set data to kernels, the panel range is set for every launch */
+
+        error  = clSetKernelArg(csr_kernel, 0, sizeof(cl_mem), (void*)&buffer_ptr);
+        error |= clSetKernelArg(csr_kernel, 1, sizeof(cl_mem), (void*)&buffer_col);
+        error |= clSetKernelArg(csr_kernel, 2, sizeof(cl_mem), (void*)&buffer_data);
+        error |= clSetKernelArg(csr_kernel, 3, sizeof(cl_mem), (void*)&buffer_vect);
+        error |= clSetKernelArg(csr_kernel, 4, sizeof(cl_mem), (void*)&buffer_output);
+        error |= clSetKernelArg(csr_kernel, 5, sizeof(int), (void*)&number_of_rows);
+
+        error |= clSetKernelArg(panel_kernel, 0, sizeof(cl_mem), (void*)&buffer_tile_segment_rows);
+        error |= clSetKernelArg(panel_kernel, 1, sizeof(cl_mem), (void*)&buffer_tile_segment_ptr);
+        error |= clSetKernelArg(panel_kernel, 2, sizeof(cl_mem), (void*)&buffer_tile_col);
+        error |= clSetKernelArg(panel_kernel, 3, sizeof(cl_mem), (void*)&buffer_tile_data);
+        error |= clSetKernelArg(panel_kernel, 4, sizeof(cl_mem), (void*)&buffer_vect);
+        error |= clSetKernelArg(panel_kernel, 5, sizeof(cl_mem), (void*)&buffer_output);
+        error |= clSetKernelArg(panel_kernel, 10, sizeof(cl_double) * tile_width, NULL);
+
+        if (error != CL_SUCCESS)
+        {
+            printf("clSetKernelArg errror\n");
+            return OpenCLProgramError;
+        }
+
+
+        /* run programs */
+
+        for (run = 0; run < runs; ++run)
+        {
+            const double ms = run_kernel(command_queue, csr_kernel, work_dim, global_work_size, local_work_size);
+
+            if (ms < 0)
+            {
+                return OpenCLProgramError;
+            }
+
+            csr_ms += ms;
+        }
+
+        for (run = 0; run < runs; ++run)
+        {
+            const double ms = run_panels(command_queue, panel_kernel, buffer_output, tile_ptr, number_of_tiles, number_of_rows, number_of_columns,
+                                         tile_width, work_dim, global_work_size, local_work_size);
+
+            if (ms < 0)
+            {
+                return OpenCLProgramError;
+            }
+
+            tiles_ms += ms;
+        }
+
+        printf("\nGPU calculations, %d runs\n", runs);
+        printf("csr %.4lf ms, column tiles in local memory %.4lf ms, speedup %.2lf\n", csr_ms / runs, tiles_ms / runs, csr_ms / tiles_ms);
+
+        error = clEnqueueReadBuffer(command_queue, buffer_output, CL_TRUE, 0, sizeof(cl_double) * number_of_rows, output, 0, NULL, NULL);
+
+        if (error != CL_SUCCESS)
+        {
+            printf("clEnqueueReadBuffer error %d\n", error);
+            return OpenCLProgramError;
+        }
+
+        if (check_result_with_tolerance(filename, vect, output, tolerance) == true)
+        {
+            printf("result is ok\n");
+        }
+        else
+        {
+            printf("result is wrong\n");
+        }
+
+
+        /* release memory */
+
+        clReleaseKernel(csr_kernel);
+        clReleaseKernel(panel_kernel);
+
+        clReleaseMemObject(buffer_ptr);
+        clReleaseMemObject(buffer_col);
+        clReleaseMemObject(buffer_data);
+        clReleaseMemObject(buffer_tile_segment_rows);
+        clReleaseMemObject(buffer_tile_segment_ptr);
+        clReleaseMemObject(buffer_tile_col);
+        clReleaseMemObject(buffer_tile_data);
+        clReleaseMemObject(buffer_vect);
+        clReleaseMemObject(buffer_output);
+
+        free(ptr);
+        free(cols);
+        free(data);
+        free(panel_ptr);
+        free(segment_rows);
+        free(segment_ptr);
+        free(panel_cols);
+        free(panel_data);
+        free(tile_ptr);
+        free(tile_segment_rows);
+        free(tile_segment_ptr);
+        free(tile_cols);
+        free(tile_data);
+        free(device_data);
+        free(device_tile_data);
+        free(device_vect);
+        free(vect);
+        free(output);
+
+        clFlush(command_queue);
+        clReleaseCommandQueue(command_queue);
+        clReleaseProgram(program);
+        clReleaseContext(context);
+
+        break;
+    }
+
+    return Success;
+}
+
+/*!
+ * \brief Plain CSR rows on the CPU, average time of runs multiplications and the last level cache read misses of all of them.
+ */
+double compute_rows_using_cpu(const cl_double *data, const cl_double *vect, const cl_int *ptr, const cl_int *cols, int number_of_rows, int runs, cl_double *result, long long *misses)
+{
+    const int number_of_threads = omp_get_max_threads();
+    struct timespec start_time;
+    struct timespec end_time;
+    int run;
+    int i;
+
+    int *counters = open_cache_counters(number_of_threads, LL_READ_MISSES);
+    clock_gettime(CLOCK_MONOTONIC, &start_time);
+
+    for (run = 0; run < runs; ++run)
+    {
+        #pragma omp parallel for num_threads(number_of_threads) shared(data, vect, ptr, cols, number_of_rows, result) private(i)
+        for (i = 0; i < number_of_rows; ++i)
+        {
+            double sum = 0;
+            int j;
+
+            for (j = ptr[i]; j < ptr[i + 1]; ++j)
+            {
+                sum += data[j] * vect[cols[j]];
+            }
+
+            result[i] = sum;
+        }
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &end_time);
+    *misses = close_cache_counters(counters, number_of_threads);
+
+    return ((double)(end_time.tv_nsec - start_time.tv_nsec) / 1000000 + (double)(end_time.tv_sec - start_time.tv_sec) * 1000) / runs;
+}
+
+/*!
+ * \brief Column panels in order on the CPU, the segments of a panel are split between threads and add to result,
+ *        so only one panel of the vector is gathered from at a time.
+ */
+double compute_panels_using_cpu(const cl_double *data, const cl_double *vect, const cl_int *panel_ptr, const cl_int *segment_rows, const cl_int *segment_ptr, const cl_int *cols,
+                                int number_of_panels, int number_of_rows, int runs, cl_double *result, long long *misses)
+{
+    const int number_of_threads = omp_get_max_threads();
+    struct timespec start_time;
+    struct timespec end_time;
+    int run;
+
+    int *counters = open_cache_counters(number_of_threads, LL_READ_MISSES);
+    clock_gettime(CLOCK_MONOTONIC, &start_time);
+
+    for (run = 0; run < runs; ++run)
+    {
+        memset(result, 0, sizeof(cl_double) * number_of_rows);
+
+        #pragma omp parallel num_threads(number_of_threads) shared(data, vect, panel_ptr, segment_rows, segment_ptr, cols, number_of_panels, result)
+        {
+            int panel;
+
+            for (panel = 0; panel < number_of_panels; ++panel)
+            {
+                int segment;
+
+                #pragma omp for
+                for (segment = panel_ptr[panel]; segment < panel_ptr[panel + 1]; ++segment)
+                {
+                    double sum = 0;
+                    int j;
+
+                    for (j = segment_ptr[segment]; j < segment_ptr[segment + 1]; ++j)
+                    {
+                        sum += data[j] * vect[cols[j]];
+                    }
+
+                    result[segment_rows[segment]] += sum;
+                }
+            }
+        }
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &end_time);
+    *misses = close_cache_counters(counters, number_of_threads);
+
+    return ((double)(end_time.tv_nsec - start_time.tv_nsec) / 1000000 + (double)(end_time.tv_sec - start_time.tv_sec) * 1000) / runs;
+}
+
+/*!
+ * \brief Zeroes output and launches the panel kernel once per panel, returns the time in milliseconds or a negative value on error.
+ */
+double run_panels(cl_command_queue command_queue, cl_kernel kernel, cl_mem buffer_output, const cl_int *panel_ptr, int number_of_panels, int number_of_rows, int number_of_columns,
+                  int panel_width, cl_uint work_dim, const size_t *global_work_size, const size_t *local_work_size)
+{
+    cl_int error;
+    struct timespec start_time;
+    struct timespec end_time;
+    int panel;
+
+    clock_gettime(CLOCK_MONOTONIC, &start_time);
+
+    if (zero_buffer(command_queue, buffer_output, sizeof(cl_double) * number_of_rows) < 0)
+    {
+        return -1;
+    }
+
+    for (panel = 0; panel < number_of_panels; ++panel)
+    {
+        const int first_segment = panel_ptr[panel];
+        const int number_of_segments = panel_ptr[panel + 1] - panel_ptr[panel];
+        const int first_column = panel * panel_width;
+        const int width = first_column + panel_width < number_of_columns ? panel_width : number_of_columns - first_column;
+
+        error  = clSetKernelArg(kernel, 6, sizeof(int), (void*)&first_segment);
+        error |= clSetKernelArg(kernel, 7, sizeof(int), (void*)&number_of_segments);
+        error |= clSetKernelArg(kernel, 8, sizeof(int), (void*)&first_column);
+        error |= clSetKernelArg(kernel, 9, sizeof(int), (void*)&width);
+        error |= clEnqueueNDRangeKernel(command_queue, kernel, work_dim, NULL, global_work_size, local_work_size, 0, NULL, NULL);
+
+        if (error != CL_SUCCESS)
+        {
+            printf("panel %d error %d\n", panel, error);
+            return -1;
+        }
+    }
+
+    clFinish(command_queue);
+    clock_gettime(CLOCK_MONOTONIC, &end_time);
+
+    return (double)(end_time.tv_nsec - start_time.tv_nsec) / 1000000 + (double)(end_time.tv_sec - start_time.tv_sec) * 1000;
+}
+
+void print_misses(const char *name, double ms, long long misses, int number_of_nonzeroes)
+{
+    if (misses >= 0)
+    {
+        printf("%-14s %.4lf ms, last level cache read misses per nonzero %.4lf\n", name, ms, (double)misses / number_of_nonzeroes);
+    }
+    else
+    {
+        printf("%-14s %.4lf ms, cache misses not available (no perf events)\n", name, ms);
+    }
+}
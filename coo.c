@@ -7,17 +7,31 @@
 #include <time.h>
 
 #include "helper_functions.h"
+#include "precision.h"
+#include "partition.h"
+#include "scheduler.h"
 #include "enums.h"
 
 #define DEVICES_DEFAULT_SIZE 8
 
-void compute_using_cpu(cl_double *data, cl_double *vect, cl_int *rows, cl_int *cols, int number_of_nonzeroes, cl_double **result);
+/*!
+ * \brief Arrays read by compute_coo_block, row_ptr is NULL when the entries are not sorted by row.
+ */
+typedef struct
+{
+    const cl_double *data;
+    const cl_double *vect;
+    const cl_int *rows;
+    const cl_int *cols;
+    const cl_int *row_ptr;
+    cl_double *result;
+} CooBlockArguments;
+
+void compute_using_cpu(cl_double *data, cl_double *vect, cl_int *rows, cl_int *cols, int number_of_nonzeroes, const int *partition, int number_of_parts, bool rows_owned, cl_double **result);
+void compute_coo_block(int first_unit, int last_unit, void *arguments);
 
 int main(int argc, char *argv[])
 {
-    (void)argc;
-    (void)argv;
-    
     cl_int error;
     cl_uint number_of_devices = DEVICES_DEFAULT_SIZE;
     cl_device_id device_ids[DEVICES_DEFAULT_SIZE];
@@ -32,6 +46,7 @@ int main(int argc, char *argv[])
         int number_of_rows;
         int number_of_columns;
         int number_of_nonzeroes;
+        int number_of_entries;
         int i;
         FILE *file;
         cl_int *rows;
@@ -59,32 +74,48 @@ int main(int argc, char *argv[])
             return FileError;
         }
         
-        if (read_size_of_matrices_from_file(file, &number_of_rows, &number_of_columns, &number_of_nonzeroes) == false)
+        if (read_size_of_matrices_from_file(file, &number_of_rows, &number_of_columns, &number_of_entries) == false)
         {
             fclose(file);
             return FileError;
         }
-        
-        global_work_size[0] = number_of_nonzeroes;
 
-        while (global_work_size[0] % local_work_size[0] != 0)
-        {
-            global_work_size[0]++;
-        }
+        /* entries keep the file order, a symmetric file gets the mirror of every off-diagonal entry right after it */
+        const bool symmetric = is_symmetric_matrix_file(filename);
+        const int capacity = symmetric ? 2 * number_of_entries : number_of_entries;
+
+        rows = (cl_int *)malloc(capacity * sizeof(cl_int));
+        cols = (cl_int *)malloc(capacity * sizeof(cl_int));
+        data = (cl_double *)malloc(capacity * sizeof(cl_double));
 
-        rows = (cl_int *)malloc(number_of_nonzeroes * sizeof(cl_int));
-        cols = (cl_int *)malloc(number_of_nonzeroes * sizeof(cl_int));
-        data = (cl_double *)malloc(number_of_nonzeroes * sizeof(cl_double));
+        number_of_nonzeroes = 0;
 
-        for (i = 0; i < number_of_nonzeroes; i++)
+        for (i = 0; i < number_of_entries; i++)
         {
-            fscanf(file, "%d %d %lg\n", &rows[i], &cols[i], &data[i]);
-            rows[i]--;  // adjust from 1-based to 0-based
-            cols[i]--;
+            const int entry = number_of_nonzeroes++;
+
+            read_matrix_entry(file, &rows[entry], &cols[entry], &data[entry]);
+            rows[entry]--;  // adjust from 1-based to 0-based
+            cols[entry]--;
+
+            if (symmetric && rows[entry] != cols[entry])
+            {
+                rows[number_of_nonzeroes] = cols[entry];
+                cols[number_of_nonzeroes] = rows[entry];
+                data[number_of_nonzeroes] = data[entry];
+                number_of_nonzeroes++;
+            }
         }
     
         fclose(file);
 
+        global_work_size[0] = number_of_nonzeroes;
+
+        while (global_work_size[0] % local_work_size[0] != 0)
+        {
+            global_work_size[0]++;
+        }
+
         vect = (cl_double*)malloc(sizeof(cl_double) * number_of_columns);
         for (i = 0; i < number_of_columns; ++i) 
         {
@@ -92,7 +123,17 @@ int main(int argc, char *argv[])
         }
         
         output = (cl_double*)malloc(sizeof(cl_double) * number_of_rows);
-        output_cpu = (cl_double*)malloc(sizeof(cl_double) * number_of_rows);
+        output_cpu = (cl_double*)calloc(number_of_rows, sizeof(cl_double));
+
+        const Precision value_precision = get_precision_option(argc, argv, "--precision");
+        const Precision vector_precision = get_precision_option(argc, argv, "--vector-precision");
+        const double tolerance = get_precision_tolerance(value_precision, vector_precision);
+
+        /* values and vector are narrowed once here, kernels widen them back to double */
+        void *device_data = convert_to_precision(data, number_of_nonzeroes, value_precision);
+        void *device_vect = convert_to_precision(vect, number_of_columns, vector_precision);
+
+        printf("values stored as %s, vector as %s\n", get_precision_name(value_precision), get_precision_name(vector_precision));
         
         
         /* prepare OpenCL program */
@@ -115,8 +156,8 @@ int main(int argc, char *argv[])
         
         cl_mem buffer_row    = clCreateBuffer(context, CL_MEM_READ_ONLY, sizeof(cl_int) * number_of_nonzeroes, NULL, &error);
         cl_mem buffer_col    = clCreateBuffer(context, CL_MEM_READ_ONLY, sizeof(cl_int) * number_of_nonzeroes, NULL, &error);
-        cl_mem buffer_data   = clCreateBuffer(context, CL_MEM_READ_ONLY, sizeof(cl_double) * number_of_nonzeroes, NULL, &error);
-        cl_mem buffer_vect   = clCreateBuffer(context, CL_MEM_READ_ONLY, sizeof(cl_double) * number_of_columns, NULL, &error);
+        cl_mem buffer_data   = clCreateBuffer(context, CL_MEM_READ_ONLY, get_precision_size(value_precision) * number_of_nonzeroes, NULL, &error);
+        cl_mem buffer_vect   = clCreateBuffer(context, CL_MEM_READ_ONLY, get_precision_size(vector_precision) * number_of_columns, NULL, &error);
         cl_mem buffer_output = clCreateBuffer(context, CL_MEM_WRITE_ONLY, sizeof(cl_double) * number_of_rows, NULL, &error);
         
         if (error != CL_SUCCESS)
@@ -141,7 +182,11 @@ int main(int argc, char *argv[])
             return OpenCLProgramError;
         }
         
-        error = clBuildProgram(program, 0, NULL, NULL, NULL, NULL);
+        char build_options[128] = "";
+
+        append_precision_build_options(build_options, sizeof(build_options), value_precision, vector_precision);
+
+        error = clBuildProgram(program, 0, NULL, build_options, NULL, NULL);
         
         if (error != CL_SUCCESS)
         {
@@ -175,8 +220,8 @@ int main(int argc, char *argv[])
         
         error  = clEnqueueWriteBuffer(command_queue, buffer_row, CL_FALSE, 0, sizeof(cl_int) * number_of_nonzeroes, rows, 0, NULL, NULL);
         error |= clEnqueueWriteBuffer(command_queue, buffer_col, CL_FALSE, 0, sizeof(cl_int) * number_of_nonzeroes, cols, 0, NULL, NULL);
-        error |= clEnqueueWriteBuffer(command_queue, buffer_data, CL_FALSE, 0, sizeof(cl_double) * number_of_nonzeroes, data, 0, NULL, NULL);
-        error |= clEnqueueWriteBuffer(command_queue, buffer_vect, CL_FALSE, 0, sizeof(cl_double) * number_of_columns, vect, 0, NULL, NULL);
+        error |= clEnqueueWriteBuffer(command_queue, buffer_data, CL_FALSE, 0, get_precision_size(value_precision) * number_of_nonzeroes, device_data, 0, NULL, NULL);
+        error |= clEnqueueWriteBuffer(command_queue, buffer_vect, CL_FALSE, 0, get_precision_size(vector_precision) * number_of_columns, device_vect, 0, NULL, NULL);
         
         if (error != CL_SUCCESS)
         {
@@ -220,7 +265,7 @@ int main(int argc, char *argv[])
             return OpenCLProgramError;
         }
         
-        if (check_result(filename, vect, output) == true)
+        if (check_result_with_tolerance(filename, vect, output, tolerance) == true)
         {
             printf("result is ok\n");
         }
@@ -235,9 +280,13 @@ int main(int argc, char *argv[])
 //         }
 
 
-        /* CPU */
-        
-        compute_using_cpu(data, vect, rows, cols, number_of_nonzeroes, &output_cpu);
+        /* CPU, entries split once into equal ranges, whole rows per thread when the file is sorted by row */
+
+        const int number_of_parts = get_number_of_cpu_parts();
+        int *partition;
+        const bool rows_owned = create_coo_partition(rows, number_of_nonzeroes, number_of_parts, &partition);
+
+        compute_using_cpu(data, vect, rows, cols, number_of_nonzeroes, partition, number_of_parts, rows_owned, &output_cpu);
 
 
         if (check_result(filename, vect, output_cpu) == true)
@@ -249,6 +298,44 @@ int main(int argc, char *argv[])
             printf("cpu result is wrong\n");
         }
 
+        if (get_int_option(argc, argv, "--work-stealing", 0) != 0)
+        {
+            /* entries sorted by row are grouped into rows, so blocks own whole rows; otherwise blocks of entries add atomically */
+            cl_int *row_ptr = NULL;
+
+            if (rows_owned)
+            {
+                row_ptr = (cl_int*)calloc(number_of_rows + 1, sizeof(cl_int));
+
+                for (i = 0; i < number_of_nonzeroes; ++i)
+                {
+                    row_ptr[rows[i] + 1]++;
+                }
+
+                for (i = 0; i < number_of_rows; ++i)
+                {
+                    row_ptr[i + 1] += row_ptr[i];
+                }
+            }
+
+            CooBlockArguments block_arguments = { data, vect, rows, cols, row_ptr, output_cpu };
+
+            printf("\nschedules of %s blocks\n", rows_owned ? "row" : "entry");
+            compare_schedules(row_ptr, rows_owned ? number_of_rows : number_of_nonzeroes, number_of_parts, get_int_option(argc, argv, "--runs", 10),
+                              compute_coo_block, &block_arguments, output_cpu, number_of_rows);
+
+            if (check_result(filename, vect, output_cpu) == true)
+            {
+                printf("work stealing result is ok\n");
+            }
+            else
+            {
+                printf("work stealing result is wrong\n");
+            }
+
+            free(row_ptr);
+        }
+
 
         /* release memory */
 
@@ -261,6 +348,9 @@ int main(int argc, char *argv[])
         free(cols);
         free(data);
         free(vect);
+        free(partition);
+        free(device_data);
+        free(device_vect);
         free(output);
         free(output_cpu);
         free(source);
@@ -277,24 +367,91 @@ int main(int argc, char *argv[])
     return Success;
 }
 
-void compute_using_cpu(cl_double *data, cl_double *vect, cl_int *rows, cl_int *cols, int number_of_nonzeroes, cl_double **result)
+/*!
+ * \brief COO on the CPU, every part of the partition is timed separately.
+ *        Atomics are only needed when rows_owned is false, then a row can be split between parts.
+ */
+void compute_using_cpu(cl_double *data, cl_double *vect, cl_int *rows, cl_int *cols, int number_of_nonzeroes, const int *partition, int number_of_parts, bool rows_owned, cl_double **result)
 {
-    int i;
     struct timespec start_time;
     struct timespec end_time;
+    double *thread_ms = (double*)malloc(sizeof(double) * number_of_parts);
 
     clock_gettime(CLOCK_MONOTONIC, &start_time);
 
-    #pragma omp parallel for shared(data, vect, rows, cols, number_of_nonzeroes, result) private(i)
-    for (i = 0; i < number_of_nonzeroes; ++i)
+    #pragma omp parallel num_threads(number_of_parts) shared(data, vect, rows, cols, partition, number_of_parts, rows_owned, thread_ms, result)
     {
-        #pragma omp atomic
-        (*result)[rows[i]] += data[i] * vect[cols[i]];
+        int part;
+
+        for (part = omp_get_thread_num(); part < number_of_parts; part += omp_get_num_threads())
+        {
+            struct timespec thread_start_time;
+            struct timespec thread_end_time;
+            int i;
+
+            clock_gettime(CLOCK_MONOTONIC, &thread_start_time);
+
+            if (rows_owned)
+            {
+                for (i = partition[part]; i < partition[part + 1]; ++i)
+                {
+                    (*result)[rows[i]] += data[i] * vect[cols[i]];
+                }
+            }
+            else
+            {
+                for (i = partition[part]; i < partition[part + 1]; ++i)
+                {
+                    #pragma omp atomic
+                    (*result)[rows[i]] += data[i] * vect[cols[i]];
+                }
+            }
+
+            clock_gettime(CLOCK_MONOTONIC, &thread_end_time);
+            thread_ms[part] = (double)(thread_end_time.tv_nsec - thread_start_time.tv_nsec) / 1000000 + (double)(thread_end_time.tv_sec - thread_start_time.tv_sec) * 1000;
+        }
     }
 
     clock_gettime(CLOCK_MONOTONIC, &end_time);
     double ms = (double)(end_time.tv_nsec - start_time.tv_nsec) / 1000000 + (double)(end_time.tv_sec - start_time.tv_sec) * 1000;
 
-    printf("\nCPU calculations\n");
+    printf("\nCPU calculations%s\n", rows_owned ? "" : " (entries not sorted by row, atomic updates)");
     calculate_and_print_performance(ms, number_of_nonzeroes);
+    print_thread_times(thread_ms, number_of_parts);
+
+    free(thread_ms);
+}
+
+/*!
+ * \brief A block of the schedules compared by --work-stealing: rows first_unit to last_unit - 1 when row_ptr is set,
+ *        entries otherwise.
+ */
+void compute_coo_block(int first_unit, int last_unit, void *arguments)
+{
+    const CooBlockArguments *coo = (const CooBlockArguments*)arguments;
+    int i;
+
+    if (coo->row_ptr != NULL)
+    {
+        for (i = first_unit; i < last_unit; ++i)
+        {
+            double sum = 0;
+            int j;
+
+            for (j = coo->row_ptr[i]; j < coo->row_ptr[i + 1]; ++j)
+            {
+                sum += coo->data[j] * coo->vect[coo->cols[j]];
+            }
+
+            coo->result[i] = sum;
+        }
+    }
+    else
+    {
+        for (i = first_unit; i < last_unit; ++i)
+        {
+            #pragma omp atomic
+            coo->result[coo->rows[i]] += coo->data[i] * coo->vect[coo->cols[i]];
+        }
+    }
 }
@@ -1,3 +1,4 @@
+#define _GNU_SOURCE
 #define CL_TARGET_OPENCL_VERSION 300
 #include <CL/cl.h>
 #include <stdio.h>                                                                                                                                               
@@ -5,19 +6,42 @@
 #include <string.h>
 #include <stdbool.h>
 #include <time.h>
+#include <immintrin.h>
 
 #include "helper_functions.h"
+#include "formats.h"
+#include "precision.h"
+#include "partition.h"
+#include "numa.h"
+#include "arena.h"
+#include "counters.h"
+#include "scheduler.h"
 #include "enums.h"
 
 #define DEVICES_DEFAULT_SIZE 8
 
-void compute_using_cpu(cl_double *data, cl_double *vect, cl_int *ptr, cl_int *cols, int number_of_rows, int number_of_nonzeroes, cl_double **result);
+/*!
+ * \brief Arrays read by compute_csr_block.
+ */
+typedef struct
+{
+    const cl_double *data;
+    const cl_double *vect;
+    const cl_int *ptr;
+    const cl_int *cols;
+    cl_double *result;
+} CsrBlockArguments;
+
+double compute_using_cpu(cl_double *data, cl_double *vect, cl_int *ptr, cl_int *cols, int number_of_rows, int number_of_nonzeroes, const int *partition, int number_of_parts, cl_double **result);
+double compute_using_cpu_simd(const cl_double *data, const cl_double *vect, const cl_int *ptr, const cl_int *cols, int number_of_rows, int number_of_nonzeroes, const int *partition, int number_of_parts, int vector_width, cl_double *result);
+double benchmark_cpu_layout(const cl_double *data, const cl_double *vect, cl_double **node_vects, const int *part_nodes, const cl_int *ptr, const cl_int *cols, const int *partition, int number_of_parts, int runs, cl_double *result);
+void compute_csr_block(int first_row, int last_row, void *arguments);
+double compute_row_using_cpu(const cl_double *data, const cl_double *vect, const cl_int *cols, int row_start, int row_end);
+double compute_row_using_avx2(const cl_double *data, const cl_double *vect, const cl_int *cols, int row_start, int row_end);
+double compute_row_using_avx512(const cl_double *data, const cl_double *vect, const cl_int *cols, int row_start, int row_end);
 
 int main(int argc, char *argv[])
 {
-    (void)argc;
-    (void)argv;
-    
     cl_int error;
     cl_uint number_of_devices = DEVICES_DEFAULT_SIZE;
     cl_device_id device_ids[DEVICES_DEFAULT_SIZE];
@@ -33,14 +57,22 @@ int main(int argc, char *argv[])
         int number_of_columns;
         int number_of_nonzeroes;
         int i;
-        FILE *file;
         cl_int *ptr;
         cl_int *cols;
         cl_double *data;
         cl_double *vect;
         cl_double *output;
         cl_double *output_cpu;
-        const char *filename = "databases/cant-sorted.mtx";
+        cl_double *output_simd;
+        const char *filename = get_option(argc, argv, "--matrix", "databases/cant-sorted.mtx");
+        const bool compressed_indices = get_int_option(argc, argv, "--compressed-indices", 0) != 0;
+        const bool pattern = is_pattern_matrix_file(filename);
+        const bool value_dictionary = get_int_option(argc, argv, "--value-dictionary", 1) != 0;
+        const bool numa = get_int_option(argc, argv, "--numa", 0) != 0;
+        const bool work_stealing = get_int_option(argc, argv, "--work-stealing", 0) != 0;
+        const bool huge_pages = get_int_option(argc, argv, "--huge-pages", 0) != 0;
+        const bool use_arena = huge_pages || get_int_option(argc, argv, "--arena", 0) != 0;
+        Arena arena = { 0 };
         struct timespec start_time;
         struct timespec end_time;
         
@@ -51,56 +83,113 @@ int main(int argc, char *argv[])
         
         /* prepare data for calculations */
         
-        file = fopen(filename, "r");
-        
-        if (file == NULL) 
+        if (read_csr_from_file(filename, true, &number_of_rows, &number_of_columns, &number_of_nonzeroes, &ptr, &cols, &data) == false)
         {
-            perror(filename);
             return FileError;
         }
-        
-        if (read_size_of_matrices_from_file(file, &number_of_rows, &number_of_columns, &number_of_nonzeroes) == false)
+
+        vect = (cl_double*)malloc(sizeof(cl_double) * number_of_columns);
+        for (i = 0; i < number_of_columns; ++i) 
         {
-            fclose(file);
-            return FileError;
+            vect[i] = i;
         }
-
-        ptr  = (cl_int *)malloc((number_of_rows + 1) * sizeof(cl_int));
-        cols = (cl_int *)malloc(number_of_nonzeroes * sizeof(cl_int));
-        data = (cl_double *)malloc(number_of_nonzeroes * sizeof(cl_double));
-
-        ptr[0] = 0;
-        ptr[number_of_rows] = number_of_nonzeroes;
-        int ptr_index = 1;
-        int previous_row = 0;
         
-        for (i = 0; i < number_of_nonzeroes; i++)
+        output = (cl_double*)malloc(sizeof(cl_double) * number_of_rows);
+        output_cpu = (cl_double*)calloc(number_of_rows, sizeof(cl_double));
+        output_simd = (cl_double*)malloc(sizeof(cl_double) * number_of_rows);
+
+        if (use_arena)
         {
-            int current_row;
-            
-            fscanf(file, "%d %d %lg\n", &current_row, &cols[i], &data[i]);
-            current_row--; // adjust from 1-based to 0-based
-            cols[i]--; 
-            
-            if (current_row != previous_row)
+            /* the same CPU loop on the malloc'ed arrays and on one aligned mapping, with data TLB misses where perf allows */
+            const size_t arena_size = sizeof(cl_int) * (number_of_rows + 1) + (sizeof(cl_int) + sizeof(cl_double)) * number_of_nonzeroes
+                                    + sizeof(cl_double) * (number_of_columns + 3 * number_of_rows);
+            const int runs = get_int_option(argc, argv, "--runs", 10);
+            const int number_of_parts = get_number_of_cpu_parts();
+            int *partition = create_balanced_partition(ptr, number_of_rows, number_of_parts);
+
+            if (create_arena(&arena, arena_size, 7, huge_pages) == false)
+            {
+                return OtherError;
+            }
+
+            int *counters = open_cache_counters(number_of_parts, DTLB_READ_MISSES);
+            const double malloc_ms = benchmark_cpu_layout(data, vect, NULL, NULL, ptr, cols, partition, number_of_parts, runs, output);
+            const long long malloc_misses = close_cache_counters(counters, number_of_parts);
+
+            cl_int *arena_ptr = (cl_int*)move_to_arena(&arena, ptr, sizeof(cl_int) * (number_of_rows + 1));
+            cl_int *arena_cols = (cl_int*)move_to_arena(&arena, cols, sizeof(cl_int) * number_of_nonzeroes);
+            cl_double *arena_data = (cl_double*)move_to_arena(&arena, data, sizeof(cl_double) * number_of_nonzeroes);
+            cl_double *arena_vect = (cl_double*)move_to_arena(&arena, vect, sizeof(cl_double) * number_of_columns);
+
+            /* outputs start from the zeroed mapping instead of a copy */
+            cl_double *arena_output = (cl_double*)arena_alloc(&arena, sizeof(cl_double) * number_of_rows);
+            cl_double *arena_output_cpu = (cl_double*)arena_alloc(&arena, sizeof(cl_double) * number_of_rows);
+            cl_double *arena_output_simd = (cl_double*)arena_alloc(&arena, sizeof(cl_double) * number_of_rows);
+
+            /* every array has to live in the mapping, free_arena is the only release below */
+            if (arena_ptr == NULL || arena_cols == NULL || arena_data == NULL || arena_vect == NULL
+                || arena_output == NULL || arena_output_cpu == NULL || arena_output_simd == NULL)
+            {
+                printf("arena of %zu bytes is too small, %zu bytes used\n", arena.size, arena.used);
+                return OtherError;
+            }
+
+            ptr = arena_ptr;
+            cols = arena_cols;
+            data = arena_data;
+            vect = arena_vect;
+
+            free(output);
+            free(output_cpu);
+            free(output_simd);
+            output = arena_output;
+            output_cpu = arena_output_cpu;
+            output_simd = arena_output_simd;
+
+            counters = open_cache_counters(number_of_parts, DTLB_READ_MISSES);
+            const double arena_ms = benchmark_cpu_layout(data, vect, NULL, NULL, ptr, cols, partition, number_of_parts, runs, output);
+            const long long arena_misses = close_cache_counters(counters, number_of_parts);
+
+            printf("arena of %.1lf MB%s, %d runs\n", arena.size / 1048576.0, arena.huge_pages ? " with transparent huge pages" : "", runs);
+            printf("malloc %.3lf ms, arena %.3lf ms, speedup %.2lf\n", malloc_ms, arena_ms, malloc_ms / arena_ms);
+
+            if (malloc_misses >= 0 && arena_misses >= 0)
             {
-                ptr[ptr_index] = i;
-                ptr_index++;
-                previous_row = current_row;
+                printf("dTLB read misses per run: malloc %lld, arena %lld (%.1lf%% fewer)\n", malloc_misses / runs, arena_misses / runs,
+                       malloc_misses > 0 ? 100.0 * (malloc_misses - arena_misses) / malloc_misses : 0.0);
             }
+            else
+            {
+                printf("dTLB read misses not available (no perf events)\n");
+            }
+
+            free(partition);
         }
-    
-        fclose(file);
 
-        vect = (cl_double*)malloc(sizeof(cl_double) * number_of_columns);
-        for (i = 0; i < number_of_columns; ++i) 
+        const Precision value_precision = get_precision_option(argc, argv, "--precision");
+        const Precision vector_precision = get_precision_option(argc, argv, "--vector-precision");
+        const double tolerance = get_precision_tolerance(value_precision, vector_precision);
+
+        /* values and vector are narrowed once here, kernels widen them back to double */
+        void *device_data = convert_to_precision(data, number_of_nonzeroes, value_precision);
+        void *device_vect = convert_to_precision(vect, number_of_columns, vector_precision);
+
+        printf("values stored as %s, vector as %s\n", get_precision_name(value_precision), get_precision_name(vector_precision));
+
+        /* values as codes into a table of the distinct values, when the table fits in constant memory */
+        cl_ulong max_constant_size = 0;
+        cl_double *dictionary = NULL;
+        void *codes = NULL;
+        size_t code_size = 0;
+        int number_of_values = 0;
+
+        clGetDeviceInfo(device_ids[0], CL_DEVICE_MAX_CONSTANT_BUFFER_SIZE, sizeof(cl_ulong), &max_constant_size, NULL);
+
+        if (value_dictionary)
         {
-            vect[i] = i;
+            number_of_values = create_value_dictionary(data, number_of_nonzeroes, max_constant_size / sizeof(cl_double), get_precision_size(value_precision), &dictionary, &codes, &code_size);
         }
         
-        output = (cl_double*)malloc(sizeof(cl_double) * number_of_rows);
-        output_cpu = (cl_double*)malloc(sizeof(cl_double) * number_of_rows);
-        
         
         /* prepare OpenCL program */
         
@@ -122,8 +211,8 @@ int main(int argc, char *argv[])
         
         cl_mem buffer_ptr    = clCreateBuffer(context, CL_MEM_READ_ONLY, sizeof(cl_int) * (number_of_rows + 1), NULL, &error);
         cl_mem buffer_col    = clCreateBuffer(context, CL_MEM_READ_ONLY, sizeof(cl_int) * number_of_nonzeroes, NULL, &error);
-        cl_mem buffer_data   = clCreateBuffer(context, CL_MEM_READ_ONLY, sizeof(cl_double) * number_of_nonzeroes, NULL, &error);
-        cl_mem buffer_vect   = clCreateBuffer(context, CL_MEM_READ_ONLY, sizeof(cl_double) * number_of_columns, NULL, &error);
+        cl_mem buffer_data   = clCreateBuffer(context, CL_MEM_READ_ONLY, get_precision_size(value_precision) * number_of_nonzeroes, NULL, &error);
+        cl_mem buffer_vect   = clCreateBuffer(context, CL_MEM_READ_ONLY, get_precision_size(vector_precision) * number_of_columns, NULL, &error);
         cl_mem buffer_output = clCreateBuffer(context, CL_MEM_WRITE_ONLY, sizeof(cl_double) * number_of_rows, NULL, &error);
         
         if (error != CL_SUCCESS)
@@ -148,7 +237,16 @@ int main(int argc, char *argv[])
             return OpenCLProgramError;
         }
         
-        error = clBuildProgram(program, 0, NULL, NULL, NULL, NULL);
+        char build_options[128] = "";
+
+        append_precision_build_options(build_options, sizeof(build_options), value_precision, vector_precision);
+
+        if (number_of_values > 0)
+        {
+            snprintf(build_options + strlen(build_options), sizeof(build_options) - strlen(build_options), " -DVALUE_CODE_BITS=%d", (int)code_size * 8);
+        }
+
+        error = clBuildProgram(program, 0, NULL, build_options, NULL, NULL);
         
         if (error != CL_SUCCESS)
         {
@@ -182,8 +280,8 @@ int main(int argc, char *argv[])
         
         error  = clEnqueueWriteBuffer(command_queue, buffer_ptr, CL_FALSE, 0, sizeof(cl_int) * (number_of_rows + 1), ptr, 0, NULL, NULL);
         error |= clEnqueueWriteBuffer(command_queue, buffer_col, CL_FALSE, 0, sizeof(cl_int) * number_of_nonzeroes, cols, 0, NULL, NULL);
-        error |= clEnqueueWriteBuffer(command_queue, buffer_data, CL_FALSE, 0, sizeof(cl_double) * number_of_nonzeroes, data, 0, NULL, NULL);
-        error |= clEnqueueWriteBuffer(command_queue, buffer_vect, CL_FALSE, 0, sizeof(cl_double) * number_of_columns, vect, 0, NULL, NULL);
+        error |= clEnqueueWriteBuffer(command_queue, buffer_data, CL_FALSE, 0, get_precision_size(value_precision) * number_of_nonzeroes, device_data, 0, NULL, NULL);
+        error |= clEnqueueWriteBuffer(command_queue, buffer_vect, CL_FALSE, 0, get_precision_size(vector_precision) * number_of_columns, device_vect, 0, NULL, NULL);
         
         if (error != CL_SUCCESS)
         {
@@ -226,7 +324,7 @@ int main(int argc, char *argv[])
             return OpenCLProgramError;
         }
         
-        if (check_result(filename, vect, output) == true)
+        if (check_result_with_tolerance(filename, vect, output, tolerance) == true)
         {
             printf("result is ok\n");
         }
@@ -241,9 +339,250 @@ int main(int argc, char *argv[])
 //         }
 
 
-        /* CPU */
+        /* columns as 16-bit offsets from the smallest column of the row */
+
+        if (compressed_indices)
+        {
+            cl_ushort *deltas;
+            cl_int *bases;
+            cl_int *escaped_cols;
+            const int number_of_escaped = compress_column_indices(ptr, number_of_rows, cols, &deltas, &bases, &escaped_cols);
+
+            print_index_compression(number_of_nonzeroes, number_of_nonzeroes, number_of_rows, number_of_escaped, get_precision_size(value_precision));
+
+            cl_mem buffer_deltas       = clCreateBuffer(context, CL_MEM_READ_ONLY, sizeof(cl_ushort) * number_of_nonzeroes, NULL, &error);
+            cl_mem buffer_bases        = clCreateBuffer(context, CL_MEM_READ_ONLY, sizeof(cl_int) * number_of_rows, NULL, &error);
+            cl_mem buffer_escaped_cols = clCreateBuffer(context, CL_MEM_READ_ONLY, sizeof(cl_int) * (number_of_escaped > 0 ? number_of_escaped : 1), NULL, &error);
+
+            if (error != CL_SUCCESS)
+            {
+                printf("clCreateBuffer error %d\n", error);
+                return OpenCLProgramError;
+            }
+
+            cl_kernel compressed_kernel = clCreateKernel(program, "csr_compressed", &error);
+
+            if (error != CL_SUCCESS)
+            {
+                printf("clCreateKernel error %d\n", error);
+                return OpenCLProgramError;
+            }
+
+            error =  clSetKernelArg(compressed_kernel, 0, sizeof(cl_mem), (void*)&buffer_ptr);
+            error |= clSetKernelArg(compressed_kernel, 1, sizeof(cl_mem), (void*)&buffer_deltas);
+            error |= clSetKernelArg(compressed_kernel, 2, sizeof(cl_mem), (void*)&buffer_bases);
+            error |= clSetKernelArg(compressed_kernel, 3, sizeof(cl_mem), (void*)&buffer_escaped_cols);
+            error |= clSetKernelArg(compressed_kernel, 4, sizeof(cl_mem), (void*)&buffer_data);
+            error |= clSetKernelArg(compressed_kernel, 5, sizeof(cl_mem), (void*)&buffer_vect);
+            error |= clSetKernelArg(compressed_kernel, 6, sizeof(cl_mem), (void*)&buffer_output);
+            error |= clSetKernelArg(compressed_kernel, 7, sizeof(int), (void*)&number_of_rows);
+
+            if (error != CL_SUCCESS)
+            {
+                printf("clSetKernelArg errror\n");
+                return OpenCLProgramError;
+            }
+
+            error  = clEnqueueWriteBuffer(command_queue, buffer_deltas, CL_FALSE, 0, sizeof(cl_ushort) * number_of_nonzeroes, deltas, 0, NULL, NULL);
+            error |= clEnqueueWriteBuffer(command_queue, buffer_bases, CL_FALSE, 0, sizeof(cl_int) * number_of_rows, bases, 0, NULL, NULL);
+            error |= clEnqueueWriteBuffer(command_queue, buffer_escaped_cols, CL_FALSE, 0, sizeof(cl_int) * (number_of_escaped > 0 ? number_of_escaped : 1), escaped_cols, 0, NULL, NULL);
+
+            if (error != CL_SUCCESS)
+            {
+                printf("clEnqueueWriteBuffer error %d\n", error);
+                return OpenCLProgramError;
+            }
+            clFinish(command_queue);
+
+            printf("\ncompressed column indices\n");
+
+            const double compressed_ms = run_kernel(command_queue, compressed_kernel, work_dim, global_work_size, local_work_size);
+
+            if (compressed_ms < 0)
+            {
+                return OpenCLProgramError;
+            }
+
+            calculate_and_print_performance(compressed_ms, number_of_nonzeroes);
+            printf("speedup over 32-bit columns %.2lf\n", ms / compressed_ms);
+
+            error = clEnqueueReadBuffer(command_queue, buffer_output, CL_TRUE, 0, sizeof(cl_double) * number_of_rows, output, 0, NULL, NULL);
+
+            if (error != CL_SUCCESS)
+            {
+                printf("clEnqueueReadBuffer error %d\n", error);
+                return OpenCLProgramError;
+            }
+
+            if (check_result_with_tolerance(filename, vect, output, tolerance) == true)
+            {
+                printf("compressed result is ok\n");
+            }
+            else
+            {
+                printf("compressed result is wrong\n");
+            }
+
+            clReleaseMemObject(buffer_deltas);
+            clReleaseMemObject(buffer_bases);
+            clReleaseMemObject(buffer_escaped_cols);
+            clReleaseKernel(compressed_kernel);
+
+            free(deltas);
+            free(bases);
+            free(escaped_cols);
+        }
+
+
+        /* values as 8- or 16-bit codes into the table of distinct values */
+
+        if (number_of_values > 0)
+        {
+            cl_mem buffer_codes      = clCreateBuffer(context, CL_MEM_READ_ONLY, code_size * number_of_nonzeroes, NULL, &error);
+            cl_mem buffer_dictionary = clCreateBuffer(context, CL_MEM_READ_ONLY, sizeof(cl_double) * number_of_values, NULL, &error);
+
+            if (error != CL_SUCCESS)
+            {
+                printf("clCreateBuffer error %d\n", error);
+                return OpenCLProgramError;
+            }
+
+            cl_kernel dictionary_kernel = clCreateKernel(program, "csr_dictionary", &error);
+
+            if (error != CL_SUCCESS)
+            {
+                printf("clCreateKernel error %d\n", error);
+                return OpenCLProgramError;
+            }
+
+            error  = clSetKernelArg(dictionary_kernel, 0, sizeof(cl_mem), (void*)&buffer_ptr);
+            error |= clSetKernelArg(dictionary_kernel, 1, sizeof(cl_mem), (void*)&buffer_col);
+            error |= clSetKernelArg(dictionary_kernel, 2, sizeof(cl_mem), (void*)&buffer_codes);
+            error |= clSetKernelArg(dictionary_kernel, 3, sizeof(cl_mem), (void*)&buffer_dictionary);
+            error |= clSetKernelArg(dictionary_kernel, 4, sizeof(cl_mem), (void*)&buffer_vect);
+            error |= clSetKernelArg(dictionary_kernel, 5, sizeof(cl_mem), (void*)&buffer_output);
+            error |= clSetKernelArg(dictionary_kernel, 6, sizeof(int), (void*)&number_of_rows);
+
+            if (error != CL_SUCCESS)
+            {
+                printf("clSetKernelArg errror\n");
+                return OpenCLProgramError;
+            }
+
+            error  = clEnqueueWriteBuffer(command_queue, buffer_codes, CL_FALSE, 0, code_size * number_of_nonzeroes, codes, 0, NULL, NULL);
+            error |= clEnqueueWriteBuffer(command_queue, buffer_dictionary, CL_FALSE, 0, sizeof(cl_double) * number_of_values, dictionary, 0, NULL, NULL);
+
+            if (error != CL_SUCCESS)
+            {
+                printf("clEnqueueWriteBuffer error %d\n", error);
+                return OpenCLProgramError;
+            }
+            clFinish(command_queue);
+
+            printf("\ndictionary-compressed values\n");
+            print_value_dictionary(number_of_nonzeroes, number_of_nonzeroes, number_of_values, code_size, get_precision_size(value_precision));
+
+            const double dictionary_ms = run_kernel(command_queue, dictionary_kernel, work_dim, global_work_size, local_work_size);
+
+            if (dictionary_ms < 0)
+            {
+                return OpenCLProgramError;
+            }
+
+            calculate_and_print_performance(dictionary_ms, number_of_nonzeroes);
+            printf("speedup over explicit values %.2lf\n", ms / dictionary_ms);
+
+            error = clEnqueueReadBuffer(command_queue, buffer_output, CL_TRUE, 0, sizeof(cl_double) * number_of_rows, output, 0, NULL, NULL);
+
+            if (error != CL_SUCCESS)
+            {
+                printf("clEnqueueReadBuffer error %d\n", error);
+                return OpenCLProgramError;
+            }
+
+            /* the dictionary keeps the values in double, so it is checked like the stored values */
+            if (check_result_with_tolerance(filename, vect, output, tolerance) == true)
+            {
+                printf("dictionary result is ok\n");
+            }
+            else
+            {
+                printf("dictionary result is wrong\n");
+            }
+
+            clReleaseMemObject(buffer_codes);
+            clReleaseMemObject(buffer_dictionary);
+            clReleaseKernel(dictionary_kernel);
+        }
+
+
+        /* pattern matrix: columns only, every value is 1 */
+
+        if (pattern)
+        {
+            const double value = 1;
+
+            cl_kernel pattern_kernel = clCreateKernel(program, "csr_pattern", &error);
+
+            if (error != CL_SUCCESS)
+            {
+                printf("clCreateKernel error %d\n", error);
+                return OpenCLProgramError;
+            }
+
+            error  = clSetKernelArg(pattern_kernel, 0, sizeof(cl_mem), (void*)&buffer_ptr);
+            error |= clSetKernelArg(pattern_kernel, 1, sizeof(cl_mem), (void*)&buffer_col);
+            error |= clSetKernelArg(pattern_kernel, 2, sizeof(cl_mem), (void*)&buffer_vect);
+            error |= clSetKernelArg(pattern_kernel, 3, sizeof(cl_mem), (void*)&buffer_output);
+            error |= clSetKernelArg(pattern_kernel, 4, sizeof(int), (void*)&number_of_rows);
+            error |= clSetKernelArg(pattern_kernel, 5, sizeof(double), (void*)&value);
+
+            if (error != CL_SUCCESS)
+            {
+                printf("clSetKernelArg errror\n");
+                return OpenCLProgramError;
+            }
+
+            printf("\npattern matrix without values\n");
+            print_pattern_savings(number_of_nonzeroes, number_of_nonzeroes, get_precision_size(value_precision));
+
+            const double pattern_ms = run_kernel(command_queue, pattern_kernel, work_dim, global_work_size, local_work_size);
+
+            if (pattern_ms < 0)
+            {
+                return OpenCLProgramError;
+            }
+
+            calculate_and_print_performance(pattern_ms, number_of_nonzeroes);
+            printf("speedup over explicit values %.2lf\n", ms / pattern_ms);
+
+            error = clEnqueueReadBuffer(command_queue, buffer_output, CL_TRUE, 0, sizeof(cl_double) * number_of_rows, output, 0, NULL, NULL);
+
+            if (error != CL_SUCCESS)
+            {
+                printf("clEnqueueReadBuffer error %d\n", error);
+                return OpenCLProgramError;
+            }
+
+            if (check_result_with_tolerance(filename, vect, output, tolerance) == true)
+            {
+                printf("pattern result is ok\n");
+            }
+            else
+            {
+                printf("pattern result is wrong\n");
+            }
+
+            clReleaseKernel(pattern_kernel);
+        }
+
+
+        /* CPU, rows split once into ranges with equal nonzeroes, one per thread */
+
+        const int number_of_parts = get_number_of_cpu_parts();
+        int *partition = create_balanced_partition(ptr, number_of_rows, number_of_parts);
 
-        compute_using_cpu(data, vect, ptr, cols, number_of_rows, number_of_nonzeroes, &output_cpu);
+        const double cpu_ms = compute_using_cpu(data, vect, ptr, cols, number_of_rows, number_of_nonzeroes, partition, number_of_parts, &output_cpu);
 
         if (check_result(filename, vect, output_cpu) == true)
         {
@@ -254,6 +593,94 @@ int main(int argc, char *argv[])
             printf("cpu result is wrong\n");
         }
 
+        /* explicitly vectorised rows, the widest instructions the CPU has unless --cpu-vector-width asks for fewer lanes */
+        const int cpu_vector_width = get_int_option(argc, argv, "--cpu-vector-width", get_cpu_vector_width());
+        const double simd_ms = compute_using_cpu_simd(data, vect, ptr, cols, number_of_rows, number_of_nonzeroes, partition, number_of_parts,
+                                                      cpu_vector_width < get_cpu_vector_width() ? cpu_vector_width : get_cpu_vector_width(), output_simd);
+
+        printf("speedup over the plain loop %.2lf\n", cpu_ms / simd_ms);
+
+        if (check_result(filename, vect, output_simd) == true)
+        {
+            printf("simd cpu result is ok\n");
+        }
+        else
+        {
+            printf("simd cpu result is wrong\n");
+        }
+
+        if (work_stealing)
+        {
+            CsrBlockArguments block_arguments = { data, vect, ptr, cols, output_simd };
+
+            printf("\nschedules of row blocks\n");
+            compare_schedules(ptr, number_of_rows, number_of_parts, get_int_option(argc, argv, "--runs", 10), compute_csr_block, &block_arguments, output_simd, number_of_rows);
+
+            if (check_result(filename, vect, output_simd) == true)
+            {
+                printf("work stealing result is ok\n");
+            }
+            else
+            {
+                printf("work stealing result is wrong\n");
+            }
+        }
+
+        if (numa)
+        {
+            /* the arrays as parsed (pages on the node of the parsing thread) against copies first touched by pinned threads */
+            const int runs = get_int_option(argc, argv, "--runs", 10);
+            const bool replicate_vector = get_int_option(argc, argv, "--replicate-vector", 1) != 0;
+            const double bytes = (double)number_of_nonzeroes * (sizeof(cl_double) + sizeof(cl_int))
+                               + (double)number_of_rows * (sizeof(cl_int) + sizeof(cl_double)) + (double)number_of_columns * sizeof(cl_double);
+            int *part_nodes = (int*)malloc(sizeof(int) * number_of_parts);
+            cl_double *output_numa = (cl_double*)malloc(sizeof(cl_double) * number_of_rows);
+
+            printf("\nNUMA layout, %d runs\n", runs);
+
+            const double current_ms = benchmark_cpu_layout(data, vect, NULL, NULL, ptr, cols, partition, number_of_parts, runs, output_numa);
+
+            pin_threads(number_of_parts, part_nodes);
+
+            cl_int *numa_ptr = (cl_int*)first_touch_copy(ptr, sizeof(cl_int), number_of_rows + 1, NULL, partition, number_of_parts);
+            cl_int *numa_cols = (cl_int*)first_touch_copy(cols, sizeof(cl_int), number_of_nonzeroes, ptr, partition, number_of_parts);
+            cl_double *numa_data = (cl_double*)first_touch_copy(data, sizeof(cl_double), number_of_nonzeroes, ptr, partition, number_of_parts);
+            cl_double *numa_output = (cl_double*)first_touch_copy(output_numa, sizeof(cl_double), number_of_rows, NULL, partition, number_of_parts);
+            cl_double **node_vects = replicate_vector ? replicate_vector_per_node(vect, number_of_columns, part_nodes, number_of_parts) : NULL;
+
+            const double numa_ms = benchmark_cpu_layout(numa_data, vect, node_vects, part_nodes, numa_ptr, numa_cols, partition, number_of_parts, runs, numa_output);
+
+            for (i = 0; i < number_of_parts; ++i)
+            {
+                printf("thread %d on node %d\n", i, part_nodes[i]);
+            }
+
+            printf("current layout %.3lf ms, %.2lf GB/s\n", current_ms, bytes / current_ms * 1e-6);
+            printf("first touch, pinned%s %.3lf ms, %.2lf GB/s\n", replicate_vector ? ", vector per node" : "", numa_ms, bytes / numa_ms * 1e-6);
+            printf("speedup %.2lf\n", current_ms / numa_ms);
+
+            if (check_result(filename, vect, numa_output) == true)
+            {
+                printf("numa cpu result is ok\n");
+            }
+            else
+            {
+                printf("numa cpu result is wrong\n");
+            }
+
+            if (node_vects != NULL)
+            {
+                free_vector_replicas(node_vects);
+            }
+
+            free(numa_ptr);
+            free(numa_cols);
+            free(numa_data);
+            free(numa_output);
+            free(output_numa);
+            free(part_nodes);
+        }
+
 
         /* release memory */
 
@@ -262,12 +689,26 @@ int main(int argc, char *argv[])
         clReleaseMemObject(buffer_data);
         clReleaseMemObject(buffer_vect);
         
-        free(ptr);
-        free(cols);
-        free(data);
-        free(vect);
-        free(output);
-        free(output_cpu);
+        if (use_arena)
+        {
+            free_arena(&arena);
+        }
+        else
+        {
+            free(ptr);
+            free(cols);
+            free(data);
+            free(vect);
+            free(output);
+            free(output_cpu);
+            free(output_simd);
+        }
+
+        free(partition);
+        free(device_data);
+        free(device_vect);
+        free(dictionary);
+        free(codes);
         free(source);
         
         clFlush(command_queue);
@@ -282,22 +723,41 @@ int main(int argc, char *argv[])
     return Success;
 }
 
-void compute_using_cpu(cl_double *data, cl_double *vect, cl_int *ptr, cl_int *cols, int number_of_rows, int number_of_nonzeroes, cl_double **result)
+/*!
+ * \brief CSR on the CPU, every part of the balanced partition is timed separately.
+ */
+double compute_using_cpu(cl_double *data, cl_double *vect, cl_int *ptr, cl_int *cols, int number_of_rows, int number_of_nonzeroes, const int *partition, int number_of_parts, cl_double **result)
 {
-    int i;
     struct timespec start_time;
     struct timespec end_time;
+    double *thread_ms = (double*)malloc(sizeof(double) * number_of_parts);
 
     clock_gettime(CLOCK_MONOTONIC, &start_time);
 
-    #pragma omp parallel for shared(data, vect, ptr, cols, number_of_rows, result) private(i)
-    for (i = 0; i < number_of_rows; ++i)
+    #pragma omp parallel num_threads(number_of_parts) shared(data, vect, ptr, cols, partition, number_of_parts, thread_ms, result)
     {
-        int j;
+        int part;
 
-        for (j = ptr[i]; j < ptr[i+1]; ++j)
+        for (part = omp_get_thread_num(); part < number_of_parts; part += omp_get_num_threads())
         {
-            (*result)[i] += data[j] * vect[cols[j]];
+            struct timespec thread_start_time;
+            struct timespec thread_end_time;
+            int i;
+
+            clock_gettime(CLOCK_MONOTONIC, &thread_start_time);
+
+            for (i = partition[part]; i < partition[part + 1]; ++i)
+            {
+                int j;
+
+                for (j = ptr[i]; j < ptr[i+1]; ++j)
+                {
+                    (*result)[i] += data[j] * vect[cols[j]];
+                }
+            }
+
+            clock_gettime(CLOCK_MONOTONIC, &thread_end_time);
+            thread_ms[part] = (double)(thread_end_time.tv_nsec - thread_start_time.tv_nsec) / 1000000 + (double)(thread_end_time.tv_sec - thread_start_time.tv_sec) * 1000;
         }
     }
 
@@ -306,4 +766,221 @@ void compute_using_cpu(cl_double *data, cl_double *vect, cl_int *ptr, cl_int *co
 
     printf("\nCPU calculations\n");
     calculate_and_print_performance(ms, number_of_nonzeroes);
+    print_thread_times(thread_ms, number_of_parts);
+
+    free(thread_ms);
+
+    return ms;
+}
+
+/*!
+ * \brief Rows first_row to last_row - 1, a block of the schedules compared by --work-stealing.
+ */
+void compute_csr_block(int first_row, int last_row, void *arguments)
+{
+    const CsrBlockArguments *csr = (const CsrBlockArguments*)arguments;
+    int i;
+
+    for (i = first_row; i < last_row; ++i)
+    {
+        double sum = 0;
+        int j;
+
+        for (j = csr->ptr[i]; j < csr->ptr[i + 1]; ++j)
+        {
+            sum += csr->data[j] * csr->vect[csr->cols[j]];
+        }
+
+        csr->result[i] = sum;
+    }
+}
+
+/*!
+ * \brief Average time of runs CPU multiplications over the partition. When node_vects is not NULL every part reads
+ *        the copy of the vector on its own NUMA node (part_nodes), otherwise the shared vect.
+ */
+double benchmark_cpu_layout(const cl_double *data, const cl_double *vect, cl_double **node_vects, const int *part_nodes, const cl_int *ptr, const cl_int *cols, const int *partition, int number_of_parts, int runs, cl_double *result)
+{
+    struct timespec start_time;
+    struct timespec end_time;
+    int run;
+
+    clock_gettime(CLOCK_MONOTONIC, &start_time);
+
+    for (run = 0; run < runs; ++run)
+    {
+        #pragma omp parallel num_threads(number_of_parts) shared(data, vect, node_vects, part_nodes, ptr, cols, partition, number_of_parts, result)
+        {
+            int part;
+
+            for (part = omp_get_thread_num(); part < number_of_parts; part += omp_get_num_threads())
+            {
+                const cl_double *part_vect = node_vects == NULL ? vect : node_vects[part_nodes[part]];
+                int i;
+
+                for (i = partition[part]; i < partition[part + 1]; ++i)
+                {
+                    double sum = 0;
+                    int j;
+
+                    for (j = ptr[i]; j < ptr[i + 1]; ++j)
+                    {
+                        sum += data[j] * part_vect[cols[j]];
+                    }
+
+                    result[i] = sum;
+                }
+            }
+        }
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &end_time);
+
+    return ((double)(end_time.tv_nsec - start_time.tv_nsec) / 1000000 + (double)(end_time.tv_sec - start_time.tv_sec) * 1000) / runs;
+}
+
+/*!
+ * \brief CSR on the CPU with every row computed by the explicitly vectorised function for vector_width doubles.
+ */
+double compute_using_cpu_simd(const cl_double *data, const cl_double *vect, const cl_int *ptr, const cl_int *cols, int number_of_rows, int number_of_nonzeroes, const int *partition, int number_of_parts, int vector_width, cl_double *result)
+{
+    struct timespec start_time;
+    struct timespec end_time;
+    double (*compute_row)(const cl_double *, const cl_double *, const cl_int *, int, int);
+
+    switch (vector_width)
+    {
+        case 8:
+            compute_row = compute_row_using_avx512;
+            break;
+        case 4:
+            compute_row = compute_row_using_avx2;
+            break;
+        default:
+            compute_row = compute_row_using_cpu;
+            break;
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &start_time);
+
+    #pragma omp parallel num_threads(number_of_parts) shared(data, vect, ptr, cols, partition, number_of_parts, result, compute_row)
+    {
+        int part;
+
+        for (part = omp_get_thread_num(); part < number_of_parts; part += omp_get_num_threads())
+        {
+            int i;
+
+            for (i = partition[part]; i < partition[part + 1]; ++i)
+            {
+                result[i] = compute_row(data, vect, cols, ptr[i], ptr[i + 1]);
+            }
+        }
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &end_time);
+    double ms = (double)(end_time.tv_nsec - start_time.tv_nsec) / 1000000 + (double)(end_time.tv_sec - start_time.tv_sec) * 1000;
+
+    printf("\nSIMD CPU calculations (%s)\n", vector_width == 8 ? "AVX-512" : vector_width == 4 ? "AVX2" : "omp simd");
+    calculate_and_print_performance(ms, number_of_nonzeroes);
+
+    return ms;
+}
+
+/*!
+ * \brief One row with omp simd and four independent sums, so the additions do not wait for each other.
+ */
+double compute_row_using_cpu(const cl_double *data, const cl_double *vect, const cl_int *cols, int row_start, int row_end)
+{
+    double sum[4] = { 0, 0, 0, 0 };
+    int j = row_start;
+    int k;
+
+    for (; j + 4 <= row_end; j += 4)
+    {
+        #pragma omp simd
+        for (k = 0; k < 4; ++k)
+        {
+            sum[k] += data[j + k] * vect[cols[j + k]];
+        }
+    }
+
+    for (; j < row_end; ++j)
+    {
+        sum[0] += data[j] * vect[cols[j]];
+    }
+
+    return (sum[0] + sum[1]) + (sum[2] + sum[3]);
+}
+
+/*!
+ * \brief Same as compute_row_using_cpu with two AVX2 gathers of 4 doubles per step and a scalar remainder.
+ */
+__attribute__((target("avx2,fma")))
+double compute_row_using_avx2(const cl_double *data, const cl_double *vect, const cl_int *cols, int row_start, int row_end)
+{
+    __m256d sum0 = _mm256_setzero_pd();
+    __m256d sum1 = _mm256_setzero_pd();
+    __m128d half;
+    double sum;
+    int j = row_start;
+
+    for (; j + 8 <= row_end; j += 8)
+    {
+        __m128i indices0 = _mm_loadu_si128((const __m128i *)&cols[j]);
+        __m128i indices1 = _mm_loadu_si128((const __m128i *)&cols[j + 4]);
+
+        sum0 = _mm256_fmadd_pd(_mm256_loadu_pd(&data[j]), _mm256_i32gather_pd(vect, indices0, sizeof(cl_double)), sum0);
+        sum1 = _mm256_fmadd_pd(_mm256_loadu_pd(&data[j + 4]), _mm256_i32gather_pd(vect, indices1, sizeof(cl_double)), sum1);
+    }
+
+    if (j + 4 <= row_end)
+    {
+        __m128i indices = _mm_loadu_si128((const __m128i *)&cols[j]);
+
+        sum0 = _mm256_fmadd_pd(_mm256_loadu_pd(&data[j]), _mm256_i32gather_pd(vect, indices, sizeof(cl_double)), sum0);
+        j += 4;
+    }
+
+    sum0 = _mm256_add_pd(sum0, sum1);
+    half = _mm_add_pd(_mm256_castpd256_pd128(sum0), _mm256_extractf128_pd(sum0, 1));
+    sum = _mm_cvtsd_f64(_mm_add_sd(half, _mm_unpackhi_pd(half, half)));
+
+    for (; j < row_end; ++j)
+    {
+        sum += data[j] * vect[cols[j]];
+    }
+
+    return sum;
+}
+
+/*!
+ * \brief Same as compute_row_using_cpu with two AVX-512 gathers of 8 doubles per step, the remainder is one masked gather.
+ */
+__attribute__((target("avx512f")))
+double compute_row_using_avx512(const cl_double *data, const cl_double *vect, const cl_int *cols, int row_start, int row_end)
+{
+    __m512d sum0 = _mm512_setzero_pd();
+    __m512d sum1 = _mm512_setzero_pd();
+    int j = row_start;
+
+    for (; j + 16 <= row_end; j += 16)
+    {
+        __m256i indices0 = _mm256_loadu_si256((const __m256i *)&cols[j]);
+        __m256i indices1 = _mm256_loadu_si256((const __m256i *)&cols[j + 8]);
+
+        sum0 = _mm512_fmadd_pd(_mm512_loadu_pd(&data[j]), _mm512_i32gather_pd(indices0, vect, sizeof(cl_double)), sum0);
+        sum1 = _mm512_fmadd_pd(_mm512_loadu_pd(&data[j + 8]), _mm512_i32gather_pd(indices1, vect, sizeof(cl_double)), sum1);
+    }
+
+    for (; j < row_end; j += 8)
+    {
+        const __mmask8 mask = row_end - j >= 8 ? 0xFF : (__mmask8)((1u << (row_end - j)) - 1);
+        __m256i indices = _mm512_castsi512_si256(_mm512_maskz_loadu_epi32(mask, &cols[j]));
+        __m512d values = _mm512_maskz_loadu_pd(mask, &data[j]);
+
+        sum0 = _mm512_fmadd_pd(values, _mm512_mask_i32gather_pd(_mm512_setzero_pd(), mask, indices, vect, sizeof(cl_double)), sum0);
+    }
+
+    return _mm512_reduce_add_pd(_mm512_add_pd(sum0, sum1));
 }
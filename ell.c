@@ -8,17 +8,17 @@
 #include <limits.h>
 
 #include "helper_functions.h"
+#include "formats.h"
+#include "precision.h"
+#include "partition.h"
 #include "enums.h"
 
 #define DEVICES_DEFAULT_SIZE 8
 
-void compute_using_cpu(cl_double *data, cl_double *vect, cl_int *cols, int number_of_rows, int longest_col, int number_of_nonzeroes, cl_double **result);
+void compute_using_cpu(cl_double *data, cl_double *vect, cl_int *cols, int number_of_rows, int longest_col, int number_of_nonzeroes, const int *partition, int number_of_parts, cl_double **result);
 
 int main(int argc, char *argv[])
 {
-    (void)argc;
-    (void)argv;
-    
     cl_int error;
     cl_uint number_of_devices = DEVICES_DEFAULT_SIZE;
     cl_device_id device_ids[DEVICES_DEFAULT_SIZE];
@@ -34,13 +34,16 @@ int main(int argc, char *argv[])
         int number_of_columns;
         int number_of_nonzeroes;
         int i;
-        FILE *file;
+        cl_int *ptr;
+        cl_int *csr_cols;
+        cl_double *csr_data;
         cl_int *cols;
         cl_double *data;
         cl_double *vect;
         cl_double *output;
         cl_double *output_cpu;
-        const char *filename = "databases/cant-sorted.mtx";
+        const char *filename = get_option(argc, argv, "--matrix", "databases/cant-sorted.mtx");
+        const bool pattern = is_pattern_matrix_file(filename);
         struct timespec start_time;
         struct timespec end_time;
         
@@ -51,119 +54,31 @@ int main(int argc, char *argv[])
         
         /* prepare data for calculations */
         
-        file = fopen(filename, "r");
-        
-        if (file == NULL) 
-        {
-            perror(filename);
-            return FileError;
-        }
-        
-        if (read_size_of_matrices_from_file(file, &number_of_rows, &number_of_columns, &number_of_nonzeroes) == false)
+        if (read_csr_from_file(filename, true, &number_of_rows, &number_of_columns, &number_of_nonzeroes, &ptr, &csr_cols, &csr_data) == false)
         {
-            fclose(file);
             return FileError;
         }
 
-        int longest_col = 0;
+        int longest_col;
         int shortest_col = INT_MAX;
-        int previous_row = 1;
-        int current_col_len = 0;
-        int sum_of_col_len = 0;
-        for (i = 0; i < number_of_nonzeroes; ++i)
+
+        for (i = 0; i < number_of_rows; ++i)
         {
-            int current_row;
-            int current_col;
-            double value;
-            
-            fscanf(file, "%d %d %lg\n", &current_row, &current_col, &value);
-            
-            if (current_row == previous_row)
-            {
-                current_col_len++;
-            }
-            else 
+            if (ptr[i + 1] - ptr[i] < shortest_col)
             {
-                previous_row = current_row;
-                
-                if (current_col_len > longest_col)
-                {
-                    longest_col = current_col_len;
-                }
-                if (current_col_len < shortest_col)
-                {
-                    shortest_col = current_col_len;
-                }
-                sum_of_col_len += current_col_len;
-                
-                current_col_len = 1;
+                shortest_col = ptr[i + 1] - ptr[i];
             }
         }
 
-        double average_col_len = (double)sum_of_col_len / (double)number_of_rows;
+        /* rows come from CSR, so they may be in any order in the file and may be empty */
+        create_ell(ptr, csr_cols, csr_data, number_of_rows, &longest_col, &cols, &data);
+
+        double average_col_len = (double)number_of_nonzeroes / (double)number_of_rows;
         printf("average column length %lf, shortest col %d, longest col %d\n", average_col_len, shortest_col, longest_col);
 
-        if (fseek(file, 0, SEEK_SET) != 0) 
-        {
-            perror(filename);
-            return FileError;
-        }
-        
-        if (read_size_of_matrices_from_file(file, &number_of_rows, &number_of_columns, &number_of_nonzeroes) == false)
-        {
-            fclose(file);
-            return FileError;
-        }
-        
-        cols = (cl_int *)malloc(longest_col * number_of_rows * sizeof(cl_int));
-        data = (cl_double *)malloc(longest_col * number_of_rows * sizeof(cl_double));
-        
-        previous_row = 1;
-        int current_index = 0;
-        int nonzeroes_in_row = 0;
-        for (i = 0; i < number_of_nonzeroes; ++i)
-        {
-            int current_row;
-            int current_col;
-            double value;
-            
-            fscanf(file, "%d %d %lg\n", &current_row, &current_col, &value);
-            
-            current_col--;
-            
-            if (previous_row == current_row)
-            {
-                data[current_index] = value;
-                cols[current_index] = current_col;
-                current_index++;
-                nonzeroes_in_row++;
-            }
-            else 
-            {
-                long k;
-                int diff = current_row - previous_row;
-                previous_row = current_row;
-                
-                for (k = nonzeroes_in_row; k < (long)longest_col * (long)diff; ++k)
-                {
-                    cols[current_index] = 0;
-                    current_index++;
-                }
-                
-                nonzeroes_in_row = 1;
-                cols[current_index] = current_col;
-                data[current_index] = value;
-                current_index++;
-            }
-        }
-        
-        for (i = nonzeroes_in_row; i < longest_col; ++i)
-        {
-            cols[current_index] = 0;
-            current_index++;
-        }
-        
-        fclose(file);
+        free(ptr);
+        free(csr_cols);
+        free(csr_data);
 
         vect = (cl_double*)malloc(sizeof(cl_double) * number_of_columns);
         for (i = 0; i < number_of_columns; ++i) 
@@ -172,7 +87,17 @@ int main(int argc, char *argv[])
         }
         
         output = (cl_double*)malloc(sizeof(cl_double) * number_of_rows);
-        output_cpu = (cl_double*)malloc(sizeof(cl_double) * number_of_rows);
+        output_cpu = (cl_double*)calloc(number_of_rows, sizeof(cl_double));
+
+        const Precision value_precision = get_precision_option(argc, argv, "--precision");
+        const Precision vector_precision = get_precision_option(argc, argv, "--vector-precision");
+        const double tolerance = get_precision_tolerance(value_precision, vector_precision);
+
+        /* values and vector are narrowed once here, kernels widen them back to double */
+        void *device_data = convert_to_precision(data, longest_col * number_of_rows, value_precision);
+        void *device_vect = convert_to_precision(vect, number_of_columns, vector_precision);
+
+        printf("values stored as %s, vector as %s\n", get_precision_name(value_precision), get_precision_name(vector_precision));
         
         
         /* prepare OpenCL program */
@@ -193,9 +118,9 @@ int main(int argc, char *argv[])
             return OpenCLProgramError;
         }
         
-        cl_mem buffer_data    = clCreateBuffer(context, CL_MEM_READ_ONLY, sizeof(cl_double) * longest_col * number_of_rows, NULL, &error);
+        cl_mem buffer_data    = clCreateBuffer(context, CL_MEM_READ_ONLY, get_precision_size(value_precision) * longest_col * number_of_rows, NULL, &error);
         cl_mem buffer_indices = clCreateBuffer(context, CL_MEM_READ_ONLY, sizeof(cl_int) * longest_col * number_of_rows, NULL, &error);
-        cl_mem buffer_vect    = clCreateBuffer(context, CL_MEM_READ_ONLY, sizeof(cl_double) * number_of_columns, NULL, &error);
+        cl_mem buffer_vect    = clCreateBuffer(context, CL_MEM_READ_ONLY, get_precision_size(vector_precision) * number_of_columns, NULL, &error);
         cl_mem buffer_output  = clCreateBuffer(context, CL_MEM_WRITE_ONLY, sizeof(cl_double) * number_of_rows, NULL, &error);
         
         if (error != CL_SUCCESS)
@@ -220,7 +145,11 @@ int main(int argc, char *argv[])
             return OpenCLProgramError;
         }
         
-        error = clBuildProgram(program, 0, NULL, NULL, NULL, NULL);
+        char build_options[128] = "";
+
+        append_precision_build_options(build_options, sizeof(build_options), value_precision, vector_precision);
+
+        error = clBuildProgram(program, 0, NULL, build_options, NULL, NULL);
         
         if (error != CL_SUCCESS)
         {
@@ -253,9 +182,9 @@ int main(int argc, char *argv[])
             return OpenCLProgramError;
         }
         
-        error  = clEnqueueWriteBuffer(command_queue, buffer_data, CL_FALSE, 0, sizeof(cl_double) * longest_col * number_of_rows, data, 0, NULL, NULL);
+        error  = clEnqueueWriteBuffer(command_queue, buffer_data, CL_FALSE, 0, get_precision_size(value_precision) * longest_col * number_of_rows, device_data, 0, NULL, NULL);
         error |= clEnqueueWriteBuffer(command_queue, buffer_indices, CL_FALSE, 0, sizeof(cl_int) * longest_col * number_of_rows, cols, 0, NULL, NULL);
-        error |= clEnqueueWriteBuffer(command_queue, buffer_vect, CL_FALSE, 0, sizeof(cl_double) * number_of_columns, vect, 0, NULL, NULL);
+        error |= clEnqueueWriteBuffer(command_queue, buffer_vect, CL_FALSE, 0, get_precision_size(vector_precision) * number_of_columns, device_vect, 0, NULL, NULL);
         
         if (error != CL_SUCCESS)
         {
@@ -298,7 +227,7 @@ int main(int argc, char *argv[])
             return OpenCLProgramError;
         }
         
-        if (check_result(filename, vect, output) == true)
+        if (check_result_with_tolerance(filename, vect, output, tolerance) == true)
         {
             printf("result is ok\n");
         }
@@ -313,9 +242,91 @@ int main(int argc, char *argv[])
 //         }
 
 
-        /* CPU */
+        /* pattern matrix: columns only, every value is 1 */
+
+        if (pattern)
+        {
+            const double value = 1;
+            cl_int *pattern_cols = create_pattern_indices(cols, data, (long)longest_col * number_of_rows);
+            cl_mem buffer_pattern_cols = clCreateBuffer(context, CL_MEM_READ_ONLY, sizeof(cl_int) * (long)longest_col * number_of_rows, NULL, &error);
+
+            if (error != CL_SUCCESS || clEnqueueWriteBuffer(command_queue, buffer_pattern_cols, CL_TRUE, 0, sizeof(cl_int) * (long)longest_col * number_of_rows, pattern_cols, 0, NULL, NULL) != CL_SUCCESS)
+            {
+                printf("pattern column buffer error\n");
+                return OpenCLProgramError;
+            }
+
+            cl_kernel pattern_kernel = clCreateKernel(program, "ell_pattern", &error);
+
+            if (error != CL_SUCCESS)
+            {
+                printf("clCreateKernel error %d\n", error);
+                return OpenCLProgramError;
+            }
+
+            error  = clSetKernelArg(pattern_kernel, 0, sizeof(cl_mem), (void*)&buffer_pattern_cols);
+            error |= clSetKernelArg(pattern_kernel, 1, sizeof(cl_mem), (void*)&buffer_vect);
+            error |= clSetKernelArg(pattern_kernel, 2, sizeof(cl_mem), (void*)&buffer_output);
+            error |= clSetKernelArg(pattern_kernel, 3, sizeof(int), (void*)&number_of_rows);
+            error |= clSetKernelArg(pattern_kernel, 4, sizeof(int), (void*)&longest_col);
+            error |= clSetKernelArg(pattern_kernel, 5, sizeof(double), (void*)&value);
+            error |= clSetKernelArg(pattern_kernel, 6, local_work_size[0] * sizeof(cl_double), NULL);
+
+            if (error != CL_SUCCESS)
+            {
+                printf("clSetKernelArg errror\n");
+                return OpenCLProgramError;
+            }
+
+            printf("\npattern matrix without values\n");
+            print_pattern_savings((long)longest_col * number_of_rows, number_of_nonzeroes, get_precision_size(value_precision));
+
+            const double pattern_ms = run_kernel(command_queue, pattern_kernel, work_dim, global_work_size, local_work_size);
+
+            if (pattern_ms < 0)
+            {
+                return OpenCLProgramError;
+            }
 
-        compute_using_cpu(data, vect, cols, number_of_rows, longest_col, number_of_nonzeroes, &output_cpu);
+            calculate_and_print_performance(pattern_ms, number_of_nonzeroes);
+            printf("speedup over explicit values %.2lf\n", ms / pattern_ms);
+
+            error = clEnqueueReadBuffer(command_queue, buffer_output, CL_TRUE, 0, sizeof(cl_double) * number_of_rows, output, 0, NULL, NULL);
+
+            if (error != CL_SUCCESS)
+            {
+                printf("clEnqueueReadBuffer error %d\n", error);
+                return OpenCLProgramError;
+            }
+
+            if (check_result_with_tolerance(filename, vect, output, tolerance) == true)
+            {
+                printf("pattern result is ok\n");
+            }
+            else
+            {
+                printf("pattern result is wrong\n");
+            }
+
+            clReleaseMemObject(buffer_pattern_cols);
+            free(pattern_cols);
+            clReleaseKernel(pattern_kernel);
+        }
+
+
+        /* CPU, every row stores longest_col entries so the partition balanced on stored entries is an even row split */
+
+        const int number_of_parts = get_number_of_cpu_parts();
+        cl_int *row_offsets = (cl_int*)malloc(sizeof(cl_int) * (number_of_rows + 1));
+
+        for (i = 0; i <= number_of_rows; ++i)
+        {
+            row_offsets[i] = i * longest_col;
+        }
+
+        int *partition = create_balanced_partition(row_offsets, number_of_rows, number_of_parts);
+
+        compute_using_cpu(data, vect, cols, number_of_rows, longest_col, number_of_nonzeroes, partition, number_of_parts, &output_cpu);
 
 
         if (check_result(filename, vect, output_cpu) == true)
@@ -338,6 +349,10 @@ int main(int argc, char *argv[])
         free(cols);
         free(data);
         free(vect);
+        free(row_offsets);
+        free(partition);
+        free(device_data);
+        free(device_vect);
         free(output);
         free(output_cpu);
         free(source);
@@ -354,24 +369,43 @@ int main(int argc, char *argv[])
     return Success;
 }
 
-void compute_using_cpu(cl_double *data, cl_double *vect, cl_int *cols, int number_of_rows, int longest_col, int number_of_nonzeroes, cl_double **result)
+/*!
+ * \brief ELL on the CPU, every part of the partition is timed separately.
+ */
+void compute_using_cpu(cl_double *data, cl_double *vect, cl_int *cols, int number_of_rows, int longest_col, int number_of_nonzeroes, const int *partition, int number_of_parts, cl_double **result)
 {
-    int i;
     struct timespec start_time;
     struct timespec end_time;
+    double *thread_ms = (double*)malloc(sizeof(double) * number_of_parts);
 
     clock_gettime(CLOCK_MONOTONIC, &start_time);
 
-    #pragma omp parallel for shared(data, vect, cols, number_of_rows, longest_col, result) private(i)
-    for (i = 0; i < number_of_rows; ++i)
+    #pragma omp parallel num_threads(number_of_parts) shared(data, vect, cols, longest_col, partition, number_of_parts, thread_ms, result)
     {
-        int offset = i * longest_col;
-        int k;
+        int part;
 
-        for (k = 0; k < longest_col; ++k)
+        for (part = omp_get_thread_num(); part < number_of_parts; part += omp_get_num_threads())
         {
-            int element_index = offset + k;
-            (*result)[i] += data[element_index] * vect[cols[element_index]];
+            struct timespec thread_start_time;
+            struct timespec thread_end_time;
+            int i;
+
+            clock_gettime(CLOCK_MONOTONIC, &thread_start_time);
+
+            for (i = partition[part]; i < partition[part + 1]; ++i)
+            {
+                int offset = i * longest_col;
+                int k;
+
+                for (k = 0; k < longest_col; ++k)
+                {
+                    int element_index = offset + k;
+                    (*result)[i] += data[element_index] * vect[cols[element_index]];
+                }
+            }
+
+            clock_gettime(CLOCK_MONOTONIC, &thread_end_time);
+            thread_ms[part] = (double)(thread_end_time.tv_nsec - thread_start_time.tv_nsec) / 1000000 + (double)(thread_end_time.tv_sec - thread_start_time.tv_sec) * 1000;
         }
     }
 
@@ -380,4 +414,7 @@ void compute_using_cpu(cl_double *data, cl_double *vect, cl_int *cols, int numbe
 
     printf("\nCPU calculations\n");
     calculate_and_print_performance(ms, number_of_nonzeroes);
+    print_thread_times(thread_ms, number_of_parts);
+
+    free(thread_ms);
 }
@@ -0,0 +1,526 @@
+#define CL_TARGET_OPENCL_VERSION 300
+#include <CL/cl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <time.h>
+
+#include "helper_functions.h"
+#include "formats.h"
+#include "precision.h"
+#include "enums.h"
+
+#define DEVICES_DEFAULT_SIZE 8
+
+void compute_reference(cl_int *ptr, cl_int *cols, cl_double *data, cl_double *vect, cl_double *y, int number_of_rows, double alpha, double beta, cl_double *result, double *dot);
+bool check_fused_result(const cl_double *expected, const cl_double *result, int number_of_rows, double expected_dot, double dot);
+void print_cg_traffic(const char *format, double matrix_bytes, int number_of_rows);
+
+int main(int argc, char *argv[])
+{
+    cl_int error;
+    cl_uint number_of_devices = DEVICES_DEFAULT_SIZE;
+    cl_device_id device_ids[DEVICES_DEFAULT_SIZE];
+
+    if (get_device_ids(&device_ids[0], &number_of_devices) != CL_SUCCESS)
+    {
+        return OpenCLDeviceError;
+    }
+
+    for (cl_uint device_number = 0; device_number < number_of_devices; ++device_number)
+    {
+        int number_of_rows;
+        int number_of_columns;
+        int number_of_nonzeroes;
+        int number_of_slices;
+        int i;
+        int format;
+        cl_int *ptr;
+        cl_int *cols;
+        cl_double *data;
+        cl_int *row_indices;
+        cl_int *sell_cols;
+        cl_double *sell_data;
+        cl_double *vect;
+        cl_double *y;
+        cl_double *output;
+        cl_double *expected;
+        double expected_dot;
+        double dot;
+        const char *filename = get_option(argc, argv, "--matrix", "databases/cant-sorted.mtx");
+        const double alpha = 2;
+        const double beta = 0.5;
+        const int C = 32;
+        const int warmup = get_int_option(argc, argv, "--warmup", 2);
+        const int repeats = get_int_option(argc, argv, "--repeats", 10);
+        char build_options[128] = "";
+
+        size_t global_work_size[1] = { 8192 };
+        size_t local_work_size[1] = { 256 };
+        size_t sell_global_work_size[1];
+        size_t sell_local_work_size[1] = { C };
+        size_t sum_work_size[1] = { 256 };
+        cl_uint work_dim = 1;
+
+
+        if (warmup < 0 || repeats < 1)
+        {
+            printf("--warmup must be at least 0 and --repeats at least 1\n");
+            return OtherError;
+        }
+
+
+        /* prepare data for calculations */
+
+        if (read_csr_from_file(filename, true, &number_of_rows, &number_of_columns, &number_of_nonzeroes, &ptr, &cols, &data) == false)
+        {
+            return FileError;
+        }
+
+        if (number_of_rows != number_of_columns)
+        {
+            printf("dot(x, A * x) needs a square matrix\n");
+            return FileError;
+        }
+
+        create_sell(ptr, cols, data, number_of_rows, C, &number_of_slices, &row_indices, &sell_cols, &sell_data);
+
+        const long sell_size = row_indices[number_of_slices];
+        const int sell_rows = number_of_slices * C;
+        const int csr_groups = global_work_size[0] / local_work_size[0];
+        const int max_partials = number_of_slices > csr_groups ? number_of_slices : csr_groups;
+
+        sell_global_work_size[0] = sell_rows;
+
+        vect = (cl_double*)malloc(sizeof(cl_double) * number_of_columns);
+        y = (cl_double*)malloc(sizeof(cl_double) * sell_rows);
+        output = (cl_double*)malloc(sizeof(cl_double) * sell_rows);
+        expected = (cl_double*)malloc(sizeof(cl_double) * number_of_rows);
+
+        for (i = 0; i < number_of_columns; ++i)
+        {
+            vect[i] = i % 100;
+        }
+
+        for (i = 0; i < sell_rows; ++i)
+        {
+            y[i] = 1;
+        }
+
+        compute_reference(ptr, cols, data, vect, y, number_of_rows, alpha, beta, expected, &expected_dot);
+
+
+        /* prepare OpenCL program */
+
+        cl_context context = clCreateContext(0, number_of_devices, device_ids, NULL, NULL, NULL);
+
+        if (NULL == context)
+        {
+            printf("context is null\n");
+            return OpenCLProgramError;
+        }
+
+        cl_command_queue command_queue = clCreateCommandQueueWithProperties(context, device_ids[0], 0, &error);
+
+        if (error != CL_SUCCESS)
+        {
+            printf("clCreateCommandQueueWithProperties error %d\n", error);
+            return OpenCLProgramError;
+        }
+
+        cl_mem buffer_ptr         = clCreateBuffer(context, CL_MEM_READ_ONLY, sizeof(cl_int) * (number_of_rows + 1), NULL, &error);
+        cl_mem buffer_col         = clCreateBuffer(context, CL_MEM_READ_ONLY, sizeof(cl_int) * number_of_nonzeroes, NULL, &error);
+        cl_mem buffer_data        = clCreateBuffer(context, CL_MEM_READ_ONLY, sizeof(cl_double) * number_of_nonzeroes, NULL, &error);
+        cl_mem buffer_row_indices = clCreateBuffer(context, CL_MEM_READ_ONLY, sizeof(cl_int) * (number_of_slices + 1), NULL, &error);
+        cl_mem buffer_sell_cols   = clCreateBuffer(context, CL_MEM_READ_ONLY, sizeof(cl_int) * sell_size, NULL, &error);
+        cl_mem buffer_sell_data   = clCreateBuffer(context, CL_MEM_READ_ONLY, sizeof(cl_double) * sell_size, NULL, &error);
+        cl_mem buffer_vect        = clCreateBuffer(context, CL_MEM_READ_ONLY, sizeof(cl_double) * number_of_columns, NULL, &error);
+        cl_mem buffer_y           = clCreateBuffer(context, CL_MEM_READ_WRITE, sizeof(cl_double) * sell_rows, NULL, &error);
+        cl_mem buffer_temporary   = clCreateBuffer(context, CL_MEM_READ_WRITE, sizeof(cl_double) * sell_rows, NULL, &error);
+        cl_mem buffer_partials    = clCreateBuffer(context, CL_MEM_READ_WRITE, sizeof(cl_double) * max_partials, NULL, &error);
+        cl_mem buffer_dot         = clCreateBuffer(context, CL_MEM_READ_WRITE, sizeof(cl_double), NULL, &error);
+
+        if (error != CL_SUCCESS)
+        {
+            printf("clCreateBuffer error %d\n", error);
+            return OpenCLProgramError;
+        }
+
+        error  = clEnqueueWriteBuffer(command_queue, buffer_ptr, CL_FALSE, 0, sizeof(cl_int) * (number_of_rows + 1), ptr, 0, NULL, NULL);
+        error |= clEnqueueWriteBuffer(command_queue, buffer_col, CL_FALSE, 0, sizeof(cl_int) * number_of_nonzeroes, cols, 0, NULL, NULL);
+        error |= clEnqueueWriteBuffer(command_queue, buffer_data, CL_FALSE, 0, sizeof(cl_double) * number_of_nonzeroes, data, 0, NULL, NULL);
+        error |= clEnqueueWriteBuffer(command_queue, buffer_row_indices, CL_FALSE, 0, sizeof(cl_int) * (number_of_slices + 1), row_indices, 0, NULL, NULL);
+        error |= clEnqueueWriteBuffer(command_queue, buffer_sell_cols, CL_FALSE, 0, sizeof(cl_int) * sell_size, sell_cols, 0, NULL, NULL);
+        error |= clEnqueueWriteBuffer(command_queue, buffer_sell_data, CL_FALSE, 0, sizeof(cl_double) * sell_size, sell_data, 0, NULL, NULL);
+        error |= clEnqueueWriteBuffer(command_queue, buffer_vect, CL_FALSE, 0, sizeof(cl_double) * number_of_columns, vect, 0, NULL, NULL);
+
+        if (error != CL_SUCCESS)
+        {
+            printf("clEnqueueWriteBuffer error %d\n", error);
+            return OpenCLProgramError;
+        }
+        clFinish(command_queue);
+
+        append_precision_build_options(build_options, sizeof(build_options), DoublePrecision, DoublePrecision);
+
+        cl_program csr_program = build_program_from_file(context, device_ids[0], "kernels/Csr.cl", build_options);
+        cl_program sell_program = build_program_from_file(context, device_ids[0], "kernels/Sigma_C.cl", build_options);
+        cl_program blas_program = build_program_from_file(context, device_ids[0], "kernels/Blas.cl", build_options);
+
+        if (csr_program == NULL || sell_program == NULL || blas_program == NULL)
+        {
+            return OpenCLProgramError;
+        }
+
+        cl_kernel kernels[2][3];
+
+        kernels[0][0] = clCreateKernel(csr_program, "csr", &error);
+        kernels[0][1] = clCreateKernel(csr_program, "csr_axpby_dot", &error);
+        kernels[0][2] = clCreateKernel(csr_program, "csr_axpby", &error);
+        kernels[1][0] = clCreateKernel(sell_program, "sigma_c", &error);
+        kernels[1][1] = clCreateKernel(sell_program, "sigma_c_axpby_dot", &error);
+        kernels[1][2] = clCreateKernel(sell_program, "sigma_c_axpby", &error);
+
+        cl_kernel axpby_kernel = clCreateKernel(blas_program, "axpby", &error);
+        cl_kernel dot_kernel = clCreateKernel(blas_program, "dot_partials", &error);
+        cl_kernel sum_kernel = clCreateKernel(blas_program, "sum_partials", &error);
+
+        if (error != CL_SUCCESS)
+        {
+            printf("clCreateKernel error %d\n", error);
+            return OpenCLProgramError;
+        }
+
+
+        /* set data to kernels */
+
+        const int dot_index = 0;
+
+        error  = clSetKernelArg(kernels[0][0], 0, sizeof(cl_mem), (void*)&buffer_ptr);
+        error |= clSetKernelArg(kernels[0][0], 1, sizeof(cl_mem), (void*)&buffer_col);
+        error |= clSetKernelArg(kernels[0][0], 2, sizeof(cl_mem), (void*)&buffer_data);
+        error |= clSetKernelArg(kernels[0][0], 3, sizeof(cl_mem), (void*)&buffer_vect);
+        error |= clSetKernelArg(kernels[0][0], 4, sizeof(cl_mem), (void*)&buffer_temporary);
+        error |= clSetKernelArg(kernels[0][0], 5, sizeof(int), (void*)&number_of_rows);
+
+        error |= clSetKernelArg(kernels[0][1], 0, sizeof(cl_mem), (void*)&buffer_ptr);
+        error |= clSetKernelArg(kernels[0][1], 1, sizeof(cl_mem), (void*)&buffer_col);
+        error |= clSetKernelArg(kernels[0][1], 2, sizeof(cl_mem), (void*)&buffer_data);
+        error |= clSetKernelArg(kernels[0][1], 3, sizeof(cl_mem), (void*)&buffer_vect);
+        error |= clSetKernelArg(kernels[0][1], 4, sizeof(cl_mem), (void*)&buffer_y);
+        error |= clSetKernelArg(kernels[0][1], 5, sizeof(int), (void*)&number_of_rows);
+        error |= clSetKernelArg(kernels[0][1], 6, sizeof(double), (void*)&alpha);
+        error |= clSetKernelArg(kernels[0][1], 7, sizeof(double), (void*)&beta);
+        error |= clSetKernelArg(kernels[0][1], 8, sizeof(cl_mem), (void*)&buffer_partials);
+        error |= clSetKernelArg(kernels[0][1], 9, sizeof(cl_double) * local_work_size[0], NULL);
+
+        error |= clSetKernelArg(kernels[0][2], 0, sizeof(cl_mem), (void*)&buffer_ptr);
+        error |= clSetKernelArg(kernels[0][2], 1, sizeof(cl_mem), (void*)&buffer_col);
+        error |= clSetKernelArg(kernels[0][2], 2, sizeof(cl_mem), (void*)&buffer_data);
+        error |= clSetKernelArg(kernels[0][2], 3, sizeof(cl_mem), (void*)&buffer_vect);
+        error |= clSetKernelArg(kernels[0][2], 4, sizeof(cl_mem), (void*)&buffer_y);
+        error |= clSetKernelArg(kernels[0][2], 5, sizeof(int), (void*)&number_of_rows);
+        error |= clSetKernelArg(kernels[0][2], 6, sizeof(double), (void*)&alpha);
+        error |= clSetKernelArg(kernels[0][2], 7, sizeof(double), (void*)&beta);
+
+        error |= clSetKernelArg(kernels[1][0], 0, sizeof(cl_mem), (void*)&buffer_sell_data);
+        error |= clSetKernelArg(kernels[1][0], 1, sizeof(cl_mem), (void*)&buffer_sell_cols);
+        error |= clSetKernelArg(kernels[1][0], 2, sizeof(cl_mem), (void*)&buffer_vect);
+        error |= clSetKernelArg(kernels[1][0], 3, sizeof(cl_mem), (void*)&buffer_temporary);
+        error |= clSetKernelArg(kernels[1][0], 4, sizeof(cl_mem), (void*)&buffer_row_indices);
+        error |= clSetKernelArg(kernels[1][0], 5, sizeof(int), (void*)&C);
+
+        error |= clSetKernelArg(kernels[1][1], 0, sizeof(cl_mem), (void*)&buffer_sell_data);
+        error |= clSetKernelArg(kernels[1][1], 1, sizeof(cl_mem), (void*)&buffer_sell_cols);
+        error |= clSetKernelArg(kernels[1][1], 2, sizeof(cl_mem), (void*)&buffer_vect);
+        error |= clSetKernelArg(kernels[1][1], 3, sizeof(cl_mem), (void*)&buffer_y);
+        error |= clSetKernelArg(kernels[1][1], 4, sizeof(cl_mem), (void*)&buffer_row_indices);
+        error |= clSetKernelArg(kernels[1][1], 5, sizeof(int), (void*)&C);
+        error |= clSetKernelArg(kernels[1][1], 6, sizeof(double), (void*)&alpha);
+        error |= clSetKernelArg(kernels[1][1], 7, sizeof(double), (void*)&beta);
+        error |= clSetKernelArg(kernels[1][1], 8, sizeof(int), (void*)&number_of_rows);
+        error |= clSetKernelArg(kernels[1][1], 9, sizeof(cl_mem), (void*)&buffer_partials);
+        error |= clSetKernelArg(kernels[1][1], 10, sizeof(cl_double) * C, NULL);
+
+        error |= clSetKernelArg(kernels[1][2], 0, sizeof(cl_mem), (void*)&buffer_sell_data);
+        error |= clSetKernelArg(kernels[1][2], 1, sizeof(cl_mem), (void*)&buffer_sell_cols);
+        error |= clSetKernelArg(kernels[1][2], 2, sizeof(cl_mem), (void*)&buffer_vect);
+        error |= clSetKernelArg(kernels[1][2], 3, sizeof(cl_mem), (void*)&buffer_y);
+        error |= clSetKernelArg(kernels[1][2], 4, sizeof(cl_mem), (void*)&buffer_row_indices);
+        error |= clSetKernelArg(kernels[1][2], 5, sizeof(int), (void*)&C);
+        error |= clSetKernelArg(kernels[1][2], 6, sizeof(double), (void*)&alpha);
+        error |= clSetKernelArg(kernels[1][2], 7, sizeof(double), (void*)&beta);
+
+        /* y = alpha * t + beta * y and dot(x, t) for the unfused runs, t = A * x */
+        error |= clSetKernelArg(axpby_kernel, 0, sizeof(cl_mem), (void*)&buffer_temporary);
+        error |= clSetKernelArg(axpby_kernel, 1, sizeof(cl_mem), (void*)&buffer_y);
+        error |= clSetKernelArg(axpby_kernel, 2, sizeof(double), (void*)&alpha);
+        error |= clSetKernelArg(axpby_kernel, 3, sizeof(double), (void*)&beta);
+        error |= clSetKernelArg(axpby_kernel, 4, sizeof(int), (void*)&number_of_rows);
+
+        error |= clSetKernelArg(dot_kernel, 0, sizeof(cl_mem), (void*)&buffer_vect);
+        error |= clSetKernelArg(dot_kernel, 1, sizeof(cl_mem), (void*)&buffer_temporary);
+        error |= clSetKernelArg(dot_kernel, 2, sizeof(cl_mem), (void*)&buffer_partials);
+        error |= clSetKernelArg(dot_kernel, 3, sizeof(int), (void*)&number_of_rows);
+        error |= clSetKernelArg(dot_kernel, 4, sizeof(cl_double) * local_work_size[0], NULL);
+
+        error |= clSetKernelArg(sum_kernel, 0, sizeof(cl_mem), (void*)&buffer_partials);
+        error |= clSetKernelArg(sum_kernel, 1, sizeof(cl_mem), (void*)&buffer_dot);
+        error |= clSetKernelArg(sum_kernel, 2, sizeof(int), (void*)&dot_index);
+        error |= clSetKernelArg(sum_kernel, 4, sizeof(cl_double) * sum_work_size[0], NULL);
+
+        if (error != CL_SUCCESS)
+        {
+            printf("clSetKernelArg errror\n");
+            return OpenCLProgramError;
+        }
+
+
+        /* run programs */
+
+        for (format = 0; format < 2; ++format)
+        {
+            const char *format_name = format == 0 ? "csr" : "sigma_c";
+            const size_t *spmv_global_work_size = format == 0 ? global_work_size : sell_global_work_size;
+            const size_t *spmv_local_work_size = format == 0 ? local_work_size : sell_local_work_size;
+            const int number_of_partials = format == 0 ? csr_groups : number_of_slices;
+            double unfused_ms = 0;
+            double fused_ms = 0;
+            double ms = 0;
+            int run;
+
+            printf("\n%s\n", format_name);
+
+            error = clSetKernelArg(sum_kernel, 3, sizeof(int), (void*)&number_of_partials);
+
+            if (error != CL_SUCCESS)
+            {
+                printf("clSetKernelArg errror\n");
+                return OpenCLProgramError;
+            }
+
+            /* t = A * x, dot(x, t), y = alpha * t + beta * y; y is reset before every run, times are averaged after the warmup */
+            for (run = 0; run < warmup + repeats; ++run)
+            {
+                error = clEnqueueWriteBuffer(command_queue, buffer_y, CL_TRUE, 0, sizeof(cl_double) * sell_rows, y, 0, NULL, NULL);
+
+                if (error != CL_SUCCESS)
+                {
+                    printf("clEnqueueWriteBuffer error %d\n", error);
+                    return OpenCLProgramError;
+                }
+
+                const double spmv_ms = run_kernel(command_queue, kernels[format][0], work_dim, spmv_global_work_size, spmv_local_work_size);
+                const double dot_ms = run_kernel(command_queue, dot_kernel, work_dim, global_work_size, local_work_size);
+                const double sum_ms = run_kernel(command_queue, sum_kernel, work_dim, sum_work_size, sum_work_size);
+                const double axpby_ms = run_kernel(command_queue, axpby_kernel, work_dim, global_work_size, local_work_size);
+
+                if (spmv_ms < 0 || dot_ms < 0 || sum_ms < 0 || axpby_ms < 0)
+                {
+                    return OpenCLProgramError;
+                }
+
+                if (run >= warmup)
+                {
+                    unfused_ms += (spmv_ms + dot_ms + sum_ms + axpby_ms) / repeats;
+                }
+            }
+
+            error  = clEnqueueReadBuffer(command_queue, buffer_y, CL_TRUE, 0, sizeof(cl_double) * number_of_rows, output, 0, NULL, NULL);
+            error |= clEnqueueReadBuffer(command_queue, buffer_dot, CL_TRUE, 0, sizeof(cl_double), &dot, 0, NULL, NULL);
+
+            if (error != CL_SUCCESS)
+            {
+                printf("clEnqueueReadBuffer error %d\n", error);
+                return OpenCLProgramError;
+            }
+
+            printf("separate kernels %.3lf ms, result is %s\n", unfused_ms, check_fused_result(expected, output, number_of_rows, expected_dot, dot) ? "ok" : "wrong");
+
+            /* the same in one pass over the matrix */
+            for (run = 0; run < warmup + repeats; ++run)
+            {
+                error = clEnqueueWriteBuffer(command_queue, buffer_y, CL_TRUE, 0, sizeof(cl_double) * sell_rows, y, 0, NULL, NULL);
+
+                if (error != CL_SUCCESS)
+                {
+                    printf("clEnqueueWriteBuffer error %d\n", error);
+                    return OpenCLProgramError;
+                }
+
+                const double fused_spmv_ms = run_kernel(command_queue, kernels[format][1], work_dim, spmv_global_work_size, spmv_local_work_size);
+                const double fused_sum_ms = run_kernel(command_queue, sum_kernel, work_dim, sum_work_size, sum_work_size);
+
+                if (fused_spmv_ms < 0 || fused_sum_ms < 0)
+                {
+                    return OpenCLProgramError;
+                }
+
+                if (run >= warmup)
+                {
+                    fused_ms += (fused_spmv_ms + fused_sum_ms) / repeats;
+                }
+            }
+
+            error  = clEnqueueReadBuffer(command_queue, buffer_y, CL_TRUE, 0, sizeof(cl_double) * number_of_rows, output, 0, NULL, NULL);
+            error |= clEnqueueReadBuffer(command_queue, buffer_dot, CL_TRUE, 0, sizeof(cl_double), &dot, 0, NULL, NULL);
+
+            if (error != CL_SUCCESS)
+            {
+                printf("clEnqueueReadBuffer error %d\n", error);
+                return OpenCLProgramError;
+            }
+
+            printf("fused kernel %.3lf ms, result is %s\n", fused_ms, check_fused_result(expected, output, number_of_rows, expected_dot, dot) ? "ok" : "wrong");
+            printf("speedup %.2lf\n", unfused_ms / fused_ms);
+
+            /* y = alpha * A * x + beta * y without the dot, checked against the same reference */
+            for (run = 0; run < warmup + repeats; ++run)
+            {
+                error = clEnqueueWriteBuffer(command_queue, buffer_y, CL_TRUE, 0, sizeof(cl_double) * sell_rows, y, 0, NULL, NULL);
+
+                if (error != CL_SUCCESS)
+                {
+                    printf("clEnqueueWriteBuffer error %d\n", error);
+                    return OpenCLProgramError;
+                }
+
+                const double run_ms = run_kernel(command_queue, kernels[format][2], work_dim, spmv_global_work_size, spmv_local_work_size);
+
+                if (run_ms < 0)
+                {
+                    return OpenCLProgramError;
+                }
+
+                if (run >= warmup)
+                {
+                    ms += run_ms / repeats;
+                }
+            }
+
+            if (clEnqueueReadBuffer(command_queue, buffer_y, CL_TRUE, 0, sizeof(cl_double) * number_of_rows, output, 0, NULL, NULL) != CL_SUCCESS)
+            {
+                return OpenCLProgramError;
+            }
+
+            printf("fused kernel without dot %.3lf ms, result is %s\n", ms, check_fused_result(expected, output, number_of_rows, expected_dot, expected_dot) ? "ok" : "wrong");
+
+            print_cg_traffic(format_name,
+                             format == 0 ? (double)number_of_nonzeroes * (sizeof(cl_double) + sizeof(cl_int)) + (number_of_rows + 1) * sizeof(cl_int)
+                                         : (double)sell_size * (sizeof(cl_double) + sizeof(cl_int)) + (number_of_slices + 1) * sizeof(cl_int),
+                             number_of_rows);
+        }
+
+
+        /* release memory */
+
+        for (format = 0; format < 2; ++format)
+        {
+            for (i = 0; i < 3; ++i)
+            {
+                clReleaseKernel(kernels[format][i]);
+            }
+        }
+
+        clReleaseKernel(axpby_kernel);
+        clReleaseKernel(dot_kernel);
+        clReleaseKernel(sum_kernel);
+
+        clReleaseMemObject(buffer_ptr);
+        clReleaseMemObject(buffer_col);
+        clReleaseMemObject(buffer_data);
+        clReleaseMemObject(buffer_row_indices);
+        clReleaseMemObject(buffer_sell_cols);
+        clReleaseMemObject(buffer_sell_data);
+        clReleaseMemObject(buffer_vect);
+        clReleaseMemObject(buffer_y);
+        clReleaseMemObject(buffer_temporary);
+        clReleaseMemObject(buffer_partials);
+        clReleaseMemObject(buffer_dot);
+
+        free(ptr);
+        free(cols);
+        free(data);
+        free(row_indices);
+        free(sell_cols);
+        free(sell_data);
+        free(vect);
+        free(y);
+        free(output);
+        free(expected);
+
+        clFlush(command_queue);
+        clReleaseCommandQueue(command_queue);
+        clReleaseProgram(csr_program);
+        clReleaseProgram(sell_program);
+        clReleaseProgram(blas_program);
+        clReleaseContext(context);
+
+        break;
+    }
+
+    return Success;
+}
+
+void compute_reference(cl_int *ptr, cl_int *cols, cl_double *data, cl_double *vect, cl_double *y, int number_of_rows, double alpha, double beta, cl_double *result, double *dot)
+{
+    double sum_of_dot = 0;
+    int i;
+
+    #pragma omp parallel for shared(ptr, cols, data, vect, y, number_of_rows, alpha, beta, result) private(i) reduction(+:sum_of_dot)
+    for (i = 0; i < number_of_rows; ++i)
+    {
+        double sum = 0;
+        int j;
+
+        for (j = ptr[i]; j < ptr[i+1]; ++j)
+        {
+            sum += data[j] * vect[cols[j]];
+        }
+
+        result[i] = alpha * sum + beta * y[i];
+        sum_of_dot += vect[i] * sum;
+    }
+
+    *dot = sum_of_dot;
+}
+
+bool check_fused_result(const cl_double *expected, const cl_double *result, int number_of_rows, double expected_dot, double dot)
+{
+    int i;
+
+    for (i = 0; i < number_of_rows; ++i)
+    {
+        if (fabs(expected[i] - result[i]) > EPSILON * fmax(1, fabs(expected[i])))
+        {
+            printf("wrong value at index %d: expected %f - calculated %f\n", i, expected[i], result[i]);
+            return false;
+        }
+    }
+
+    if (fabs(expected_dot - dot) > EPSILON * fmax(1, fabs(expected_dot)))
+    {
+        printf("wrong dot: expected %f - calculated %f\n", expected_dot, dot);
+        return false;
+    }
+
+    return true;
+}
+
+/*!
+ * \brief Prints the modelled bytes one CG iteration moves with separate kernels and with A * p fused with dot(p, A * p).
+ *
+ * An iteration is q = A * p, dot(p, q), x += a * p, r -= a * q, dot(r, r) and p = r + b * p. Separately the SpMV reads A and p
+ * and writes q (2 vectors), dot(p, q) reads 2, each update reads 2 and writes 1 (9) and dot(r, r) reads 1: 14 vectors.
+ * Fused, p and q are not read again for the dot: 12 vectors. Vectors above are read once, caches are not counted.
+ */
+void print_cg_traffic(const char *format, double matrix_bytes, int number_of_rows)
+{
+    const double vector_bytes = (double)number_of_rows * sizeof(cl_double);
+    const double unfused_bytes = matrix_bytes + 14 * vector_bytes;
+    const double fused_bytes = matrix_bytes + 12 * vector_bytes;
+
+    printf("%s modelled memory traffic per CG iteration: separate %.3lf MB, fused %.3lf MB, saved %.3lf MB (%.1lf%%)\n",
+           format, unfused_bytes * 1e-6, fused_bytes * 1e-6, (unfused_bytes - fused_bytes) * 1e-6, 100 * (unfused_bytes - fused_bytes) / unfused_bytes);
+}
@@ -0,0 +1,85 @@
+#define CL_TARGET_OPENCL_VERSION 300
+#include <CL/cl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <time.h>
+
+#include "helper_functions.h"
+#include "formats.h"
+#include "generator.h"
+#include "enums.h"
+
+/*
+ * Builds a synthetic matrix on all OpenMP threads, prints its size and how fast it was generated and optionally writes
+ * it to a Matrix Market (.mtx) or binary CSR (.bin) file, which every driver reading matrices through load_matrix
+ * accepts. No OpenCL device is used.
+ */
+int main(int argc, char *argv[])
+{
+    int number_of_rows;
+    int number_of_columns;
+    int number_of_nonzeroes;
+    cl_int *ptr;
+    cl_int *cols;
+    cl_double *data;
+    struct timespec start_time;
+    struct timespec end_time;
+    const char *spec = get_option(argc, argv, "--matrix", "stencil3d:100");
+    const char *output_filename = get_option(argc, argv, "--output", "");
+
+
+    /* generate */
+
+    clock_gettime(CLOCK_MONOTONIC, &start_time);
+
+    if (generate_matrix(spec, &number_of_rows, &number_of_columns, &number_of_nonzeroes, &ptr, &cols, &data) == false)
+    {
+        return OtherError;
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &end_time);
+    const double generate_ms = (double)(end_time.tv_nsec - start_time.tv_nsec) / 1000000 + (double)(end_time.tv_sec - start_time.tv_sec) * 1000;
+
+    printf("%s: %d rows, %d nonzeroes (%.2lf per row), %.1lf ms on %d threads, %.1lf M nonzeroes/s\n", spec, number_of_rows, number_of_nonzeroes,
+           (double)number_of_nonzeroes / number_of_rows, generate_ms, omp_get_max_threads(), number_of_nonzeroes / generate_ms * 1e-3);
+
+
+    /* write */
+
+    if (output_filename[0] != '\0')
+    {
+        bool written;
+
+        clock_gettime(CLOCK_MONOTONIC, &start_time);
+
+        if (is_binary_csr_file(output_filename))
+        {
+            written = write_csr_to_binary_file(output_filename, number_of_rows, number_of_columns, ptr, cols, data);
+        }
+        else
+        {
+            written = write_csr_to_matrix_market_file(output_filename, number_of_rows, number_of_columns, ptr, cols, data);
+        }
+
+        if (!written)
+        {
+            return FileError;
+        }
+
+        clock_gettime(CLOCK_MONOTONIC, &end_time);
+        const double write_ms = (double)(end_time.tv_nsec - start_time.tv_nsec) / 1000000 + (double)(end_time.tv_sec - start_time.tv_sec) * 1000;
+
+        printf("written to %s in %.1lf ms\n", output_filename, write_ms);
+    }
+
+
+    /* release memory */
+
+    free(ptr);
+    free(cols);
+    free(data);
+
+    return Success;
+}
@@ -0,0 +1,407 @@
+#ifndef _ANALYSIS_H
+#define _ANALYSIS_H
+
+#define CL_TARGET_OPENCL_VERSION 300
+#include <CL/cl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <math.h>
+#include <omp.h>
+
+#define HISTOGRAM_BUCKETS 32
+#define NUMBER_OF_BLOCK_SHAPES 5
+#define NUMBER_OF_SLICE_HEIGHTS 4
+#define NUMBER_OF_SORT_WINDOWS 3
+#define SCAN_CHUNK_ROWS 1536
+#define ANALYSIS_STRIP_HEIGHT 8
+#define ANALYSIS_SLICE_HEIGHT 32
+
+/* block rows of every shape must not cross chunks, so SCAN_CHUNK_ROWS is a multiple of all of them */
+const int block_shapes[NUMBER_OF_BLOCK_SHAPES] = { 2, 3, 4, 6, 8 };
+const int slice_heights[NUMBER_OF_SLICE_HEIGHTS] = { 8, 16, 32, 64 };
+/* 1 is no sorting, the others are multiples of every slice height */
+const int sort_windows[NUMBER_OF_SORT_WINDOWS] = { 1, 256, 4096 };
+
+typedef struct
+{
+    int number_of_rows;
+    int number_of_columns;
+    int number_of_nonzeroes;
+    int shortest_row;
+    int longest_row;
+    int empty_rows;
+    double row_mean;
+    double row_variance;
+    long long row_histogram[HISTOGRAM_BUCKETS];
+    int lower_bandwidth;
+    int upper_bandwidth;
+    long long profile;
+    long long blocks[NUMBER_OF_BLOCK_SHAPES];
+    int occupied_diagonals;
+    long long diagonal_slots;
+    int main_diagonal_nonzeroes;
+    long long sell_slots[NUMBER_OF_SORT_WINDOWS][NUMBER_OF_SLICE_HEIGHTS];
+    int hyb_width;
+    long long hyb_coo_entries;
+} MatrixAnalysis;
+
+/*!
+ * \brief Bucket 0 holds empty rows, bucket b rows of 2^(b-1) to 2^b - 1 elements.
+ */
+int get_histogram_bucket(int row_length)
+{
+    int bucket = 0;
+
+    while (row_length > 0 && bucket < HISTOGRAM_BUCKETS - 1)
+    {
+        row_length >>= 1;
+        ++bucket;
+    }
+
+    return bucket;
+}
+
+/*!
+ * \brief Row statistics, bandwidth, profile, diagonals and the blocks of every shape in one pass over the nonzeroes. Threads take
+ *        chunks of SCAN_CHUNK_ROWS rows and keep their own histogram and, for every shape, the last block row seen in each
+ *        block column; occupied diagonals are marked in one shared array (every thread only ever writes 1).
+ */
+void scan_nonzeroes(const cl_int *ptr, const cl_int *cols, int number_of_rows, int number_of_columns, MatrixAnalysis *analysis)
+{
+    const int number_of_chunks = (number_of_rows + SCAN_CHUNK_ROWS - 1) / SCAN_CHUNK_ROWS;
+    char *diagonals = (char*)calloc((size_t)number_of_rows + number_of_columns, sizeof(char));
+    long long row_length_squares = 0;
+    long long profile = 0;
+    int lower_bandwidth = 0;
+    int upper_bandwidth = 0;
+    int shortest_row = number_of_rows > 0 ? ptr[1] - ptr[0] : 0;
+    int longest_row = 0;
+    int empty_rows = 0;
+    int main_diagonal_nonzeroes = 0;
+    int i;
+
+    memset(analysis->row_histogram, 0, sizeof(analysis->row_histogram));
+    memset(analysis->blocks, 0, sizeof(analysis->blocks));
+
+    #pragma omp parallel shared(ptr, cols, number_of_rows, number_of_columns, analysis, diagonals) \
+        reduction(+:row_length_squares, profile, empty_rows, main_diagonal_nonzeroes) reduction(max:lower_bandwidth, upper_bandwidth, longest_row) reduction(min:shortest_row)
+    {
+        long long histogram[HISTOGRAM_BUCKETS] = { 0 };
+        long long blocks[NUMBER_OF_BLOCK_SHAPES] = { 0 };
+        int *last_block_row[NUMBER_OF_BLOCK_SHAPES];
+        int chunk;
+        int s;
+        int b;
+
+        for (s = 0; s < NUMBER_OF_BLOCK_SHAPES; ++s)
+        {
+            const int number_of_block_columns = (number_of_columns + block_shapes[s] - 1) / block_shapes[s];
+
+            last_block_row[s] = (int*)malloc(sizeof(int) * number_of_block_columns);
+            memset(last_block_row[s], 0xff, sizeof(int) * number_of_block_columns);
+        }
+
+        #pragma omp for schedule(dynamic, 1)
+        for (chunk = 0; chunk < number_of_chunks; ++chunk)
+        {
+            const int last_row = (chunk + 1) * SCAN_CHUNK_ROWS < number_of_rows ? (chunk + 1) * SCAN_CHUNK_ROWS : number_of_rows;
+            int row;
+
+            for (row = chunk * SCAN_CHUNK_ROWS; row < last_row; ++row)
+            {
+                const int row_length = ptr[row + 1] - ptr[row];
+                int first_column = row;
+                int j;
+
+                histogram[get_histogram_bucket(row_length)]++;
+                row_length_squares += (long long)row_length * row_length;
+                empty_rows += row_length == 0;
+                shortest_row = row_length < shortest_row ? row_length : shortest_row;
+                longest_row = row_length > longest_row ? row_length : longest_row;
+
+                for (j = ptr[row]; j < ptr[row + 1]; ++j)
+                {
+                    const int col = cols[j];
+
+                    lower_bandwidth = row - col > lower_bandwidth ? row - col : lower_bandwidth;
+                    upper_bandwidth = col - row > upper_bandwidth ? col - row : upper_bandwidth;
+                    first_column = col < first_column ? col : first_column;
+                    main_diagonal_nonzeroes += col == row;
+                    __atomic_store_n(&diagonals[col - row + number_of_rows], 1, __ATOMIC_RELAXED);
+
+                    for (s = 0; s < NUMBER_OF_BLOCK_SHAPES; ++s)
+                    {
+                        const int block_row = row / block_shapes[s];
+                        const int block_column = col / block_shapes[s];
+
+                        if (last_block_row[s][block_column] != block_row)
+                        {
+                            last_block_row[s][block_column] = block_row;
+                            blocks[s]++;
+                        }
+                    }
+                }
+
+                profile += row - first_column;
+            }
+        }
+
+        #pragma omp critical
+        {
+            for (b = 0; b < HISTOGRAM_BUCKETS; ++b)
+            {
+                analysis->row_histogram[b] += histogram[b];
+            }
+
+            for (s = 0; s < NUMBER_OF_BLOCK_SHAPES; ++s)
+            {
+                analysis->blocks[s] += blocks[s];
+            }
+        }
+
+        for (s = 0; s < NUMBER_OF_BLOCK_SHAPES; ++s)
+        {
+            free(last_block_row[s]);
+        }
+    }
+
+    /* diagonal d = col - row covers rows max(0, -d) to min(rows, columns - d) - 1, its length counts towards DIA storage */
+    analysis->occupied_diagonals = 0;
+    analysis->diagonal_slots = 0;
+
+    for (i = 0; i < number_of_rows + number_of_columns; ++i)
+    {
+        if (diagonals[i])
+        {
+            const long long d = i - number_of_rows;
+            const long long first_row = d < 0 ? -d : 0;
+            const long long last_row = number_of_columns - d < number_of_rows ? number_of_columns - d : number_of_rows;
+
+            analysis->occupied_diagonals++;
+            analysis->diagonal_slots += last_row - first_row;
+        }
+    }
+
+    free(diagonals);
+
+    analysis->number_of_rows = number_of_rows;
+    analysis->number_of_columns = number_of_columns;
+    analysis->number_of_nonzeroes = ptr[number_of_rows];
+    analysis->shortest_row = shortest_row;
+    analysis->longest_row = longest_row;
+    analysis->empty_rows = empty_rows;
+    analysis->row_mean = number_of_rows > 0 ? (double)ptr[number_of_rows] / number_of_rows : 0;
+    analysis->row_variance = number_of_rows > 0 ? (double)row_length_squares / number_of_rows - analysis->row_mean * analysis->row_mean : 0;
+    analysis->lower_bandwidth = lower_bandwidth;
+    analysis->upper_bandwidth = upper_bandwidth;
+    analysis->profile = profile;
+    analysis->main_diagonal_nonzeroes = main_diagonal_nonzeroes;
+}
+
+int compare_ints_decreasing(const void *a, const void *b)
+{
+    return *(const int*)b - *(const int*)a;
+}
+
+/*!
+ * \brief SELL-C-sigma slots for every slice height and sort window from the row lengths only: rows are sorted by decreasing
+ *        length within each window (not for window 1), every slice of C rows takes C times its longest row, like create_sell.
+ *        Also the HYB split, whose ELL part is as wide as at least a third of the rows.
+ */
+void scan_row_lengths(const cl_int *ptr, int number_of_rows, MatrixAnalysis *analysis)
+{
+    int w;
+    int i;
+
+    for (w = 0; w < NUMBER_OF_SORT_WINDOWS; ++w)
+    {
+        const int window_rows = sort_windows[w] > 1 ? sort_windows[w] : slice_heights[NUMBER_OF_SLICE_HEIGHTS - 1];
+        const int number_of_windows = (number_of_rows + window_rows - 1) / window_rows;
+        long long slots[NUMBER_OF_SLICE_HEIGHTS] = { 0 };
+        int window;
+
+        #pragma omp parallel shared(ptr, number_of_rows, w) reduction(+:slots[:NUMBER_OF_SLICE_HEIGHTS])
+        {
+            int *lengths = (int*)calloc(window_rows, sizeof(int));
+
+            #pragma omp for schedule(static)
+            for (window = 0; window < number_of_windows; ++window)
+            {
+                const int first_row = window * window_rows;
+                int c;
+                int r;
+
+                for (r = 0; r < window_rows; ++r)
+                {
+                    lengths[r] = first_row + r < number_of_rows ? ptr[first_row + r + 1] - ptr[first_row + r] : 0;
+                }
+
+                if (sort_windows[w] > 1)
+                {
+                    qsort(lengths, window_rows, sizeof(int), compare_ints_decreasing);
+                }
+
+                for (c = 0; c < NUMBER_OF_SLICE_HEIGHTS; ++c)
+                {
+                    const int C = slice_heights[c];
+                    int slice;
+
+                    /* slices past the last row are not stored */
+                    for (slice = 0; slice < window_rows / C && first_row + slice * C < number_of_rows; ++slice)
+                    {
+                        int longest = 0;
+
+                        for (r = slice * C; r < (slice + 1) * C; ++r)
+                        {
+                            longest = lengths[r] > longest ? lengths[r] : longest;
+                        }
+
+                        slots[c] += (long long)longest * C;
+                    }
+                }
+            }
+
+            free(lengths);
+        }
+
+        memcpy(analysis->sell_slots[w], slots, sizeof(slots));
+    }
+
+    /* rows_reaching[l] is the number of rows with at least l elements */
+    long long *rows_reaching = (long long*)calloc(analysis->longest_row + 2, sizeof(long long));
+
+    for (i = 0; i < number_of_rows; ++i)
+    {
+        rows_reaching[ptr[i + 1] - ptr[i]]++;
+    }
+
+    for (i = analysis->longest_row - 1; i >= 0; --i)
+    {
+        rows_reaching[i] += rows_reaching[i + 1];
+    }
+
+    analysis->hyb_width = 0;
+    analysis->hyb_coo_entries = 0;
+
+    for (i = analysis->longest_row; i > 0; --i)
+    {
+        if (rows_reaching[i] >= (number_of_rows + 2) / 3)
+        {
+            analysis->hyb_width = i;
+            break;
+        }
+    }
+
+    for (i = analysis->hyb_width + 1; i <= analysis->longest_row; ++i)
+    {
+        analysis->hyb_coo_entries += rows_reaching[i];
+    }
+
+    free(rows_reaching);
+}
+
+/*!
+ * \brief Writes the analysis as JSON. Predicted bytes are the matrix arrays with double values and int indices as the kernels
+ *        read them (padding included), plus the input and output vectors once.
+ */
+void print_analysis_json(FILE *file, const char *filename, bool expanded, const MatrixAnalysis *analysis, double read_ms, double scan_ms)
+{
+    const long long nonzeroes = analysis->number_of_nonzeroes;
+    const long long rows = analysis->number_of_rows;
+    const long long element_bytes = sizeof(cl_double) + sizeof(cl_int);
+    const long long vector_bytes = (long long)sizeof(cl_double) * (analysis->number_of_columns + rows);
+    const long long sell_slices = (rows + ANALYSIS_SLICE_HEIGHT - 1) / ANALYSIS_SLICE_HEIGHT;
+    const long long cmrs_strips = (rows + ANALYSIS_STRIP_HEIGHT - 1) / ANALYSIS_STRIP_HEIGHT;
+    int sell_column = 0;
+    int w;
+    int c;
+    int s;
+    int b;
+
+    for (c = 0; c < NUMBER_OF_SLICE_HEIGHTS; ++c)
+    {
+        sell_column = slice_heights[c] == ANALYSIS_SLICE_HEIGHT ? c : sell_column;
+    }
+
+    fprintf(file, "{\n");
+    fprintf(file, "  \"matrix\": ");
+    print_json_string(file, filename);
+    fprintf(file, ",\n");
+    fprintf(file, "  \"symmetric_expanded\": %s,\n", expanded ? "true" : "false");
+    fprintf(file, "  \"rows\": %d,\n  \"columns\": %d,\n  \"nonzeroes\": %d,\n", analysis->number_of_rows, analysis->number_of_columns, analysis->number_of_nonzeroes);
+    fprintf(file, "  \"read_ms\": %.3lf,\n  \"scan_ms\": %.3lf,\n  \"threads\": %d,\n", read_ms, scan_ms, omp_get_max_threads());
+
+    fprintf(file, "  \"row_length\": {\"min\": %d, \"max\": %d, \"mean\": %.6g, \"variance\": %.6g, \"empty_rows\": %d,\n",
+            analysis->shortest_row, analysis->longest_row, analysis->row_mean, analysis->row_variance, analysis->empty_rows);
+    fprintf(file, "    \"histogram\": [");
+
+    for (b = 0, s = 0; b < HISTOGRAM_BUCKETS; ++b)
+    {
+        if (analysis->row_histogram[b] > 0)
+        {
+            fprintf(file, "%s\n      {\"min\": %lld, \"max\": %lld, \"rows\": %lld}", s++ > 0 ? "," : "",
+                    b == 0 ? 0 : 1LL << (b - 1), b == 0 ? 0 : (1LL << b) - 1, analysis->row_histogram[b]);
+        }
+    }
+
+    fprintf(file, "\n    ]},\n");
+
+    fprintf(file, "  \"bandwidth\": %d,\n  \"lower_bandwidth\": %d,\n  \"upper_bandwidth\": %d,\n  \"profile\": %lld,\n",
+            analysis->lower_bandwidth > analysis->upper_bandwidth ? analysis->lower_bandwidth : analysis->upper_bandwidth,
+            analysis->lower_bandwidth, analysis->upper_bandwidth, analysis->profile);
+
+    fprintf(file, "  \"block_fill\": {");
+
+    for (s = 0; s < NUMBER_OF_BLOCK_SHAPES; ++s)
+    {
+        fprintf(file, "%s\"%dx%d\": {\"blocks\": %lld, \"fill\": %.6g}", s > 0 ? ", " : "", block_shapes[s], block_shapes[s], analysis->blocks[s],
+                analysis->blocks[s] > 0 ? (double)nonzeroes / ((double)analysis->blocks[s] * block_shapes[s] * block_shapes[s]) : 0.0);
+    }
+
+    fprintf(file, "},\n");
+
+    fprintf(file, "  \"diagonals\": {\"occupied\": %d, \"main_diagonal_nonzeroes\": %d, \"fill\": %.6g},\n",
+            analysis->occupied_diagonals, analysis->main_diagonal_nonzeroes, analysis->diagonal_slots > 0 ? (double)nonzeroes / analysis->diagonal_slots : 0.0);
+
+    fprintf(file, "  \"ell\": {\"width\": %d, \"padding\": %.6g},\n", analysis->longest_row,
+            nonzeroes > 0 ? (double)(rows * analysis->longest_row - nonzeroes) / nonzeroes : 0.0);
+
+    fprintf(file, "  \"sell_padding\": [");
+
+    for (w = 0; w < NUMBER_OF_SORT_WINDOWS; ++w)
+    {
+        for (c = 0; c < NUMBER_OF_SLICE_HEIGHTS; ++c)
+        {
+            fprintf(file, "%s\n    {\"C\": %d, \"sigma\": %d, \"padding\": %.6g}", w + c > 0 ? "," : "", slice_heights[c], sort_windows[w],
+                    nonzeroes > 0 ? (double)(analysis->sell_slots[w][c] - nonzeroes) / nonzeroes : 0.0);
+        }
+    }
+
+    fprintf(file, "\n  ],\n");
+
+    fprintf(file, "  \"hyb\": {\"width\": %d, \"coo_entries\": %lld},\n", analysis->hyb_width, analysis->hyb_coo_entries);
+
+    fprintf(file, "  \"predicted_bytes\": {\n");
+    fprintf(file, "    \"vectors\": %lld,\n", vector_bytes);
+    fprintf(file, "    \"coo\": %lld,\n", nonzeroes * (element_bytes + (long long)sizeof(cl_int)));
+    fprintf(file, "    \"csr\": %lld,\n", nonzeroes * element_bytes + (rows + 1) * (long long)sizeof(cl_int));
+    fprintf(file, "    \"ell\": %lld,\n", rows * analysis->longest_row * element_bytes);
+    fprintf(file, "    \"sell_%d\": %lld,\n", ANALYSIS_SLICE_HEIGHT, analysis->sell_slots[0][sell_column] * element_bytes + (sell_slices + 1) * (long long)sizeof(cl_int));
+    fprintf(file, "    \"cmrs_%d\": %lld,\n", ANALYSIS_STRIP_HEIGHT, nonzeroes * (element_bytes + (long long)sizeof(cl_int)) + (cmrs_strips + 1) * (long long)sizeof(cl_int));
+
+    for (s = 0; s < NUMBER_OF_BLOCK_SHAPES; ++s)
+    {
+        const long long block_rows = (rows + block_shapes[s] - 1) / block_shapes[s];
+
+        fprintf(file, "    \"bcsr_%dx%d\": %lld,\n", block_shapes[s], block_shapes[s],
+                analysis->blocks[s] * ((long long)block_shapes[s] * block_shapes[s] * sizeof(cl_double) + sizeof(cl_int)) + (block_rows + 1) * (long long)sizeof(cl_int));
+    }
+
+    fprintf(file, "    \"dia\": %lld,\n", (long long)analysis->occupied_diagonals * (rows * (long long)sizeof(cl_double) + (long long)sizeof(cl_int)));
+    fprintf(file, "    \"hyb\": %lld\n", rows * analysis->hyb_width * element_bytes + analysis->hyb_coo_entries * (element_bytes + (long long)sizeof(cl_int)));
+    fprintf(file, "  }\n}\n");
+}
+
+#endif
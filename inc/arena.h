@@ -0,0 +1,114 @@
+#ifndef _ARENA_H
+#define _ARENA_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#define ARENA_ALIGNMENT 64
+#define HUGE_PAGE_SIZE (2 * 1024 * 1024)
+
+/*!
+ * \brief One mapping holding all arrays of a matrix. Arrays start on a cache line, arrays of at least a page on a page,
+ *        and the whole mapping is freed by free_arena.
+ */
+typedef struct
+{
+    char *base;
+    size_t size;
+    size_t used;
+    size_t page_size;
+    bool huge_pages;
+} Arena;
+
+/*!
+ * \brief Maps size bytes (plus room for alignment of number_of_arrays arrays). With huge_pages the mapping is rounded
+ *        to 2 MB and transparent huge pages are requested with madvise; huge_pages is cleared when the kernel refuses.
+ */
+bool create_arena(Arena *arena, size_t size, int number_of_arrays, bool huge_pages)
+{
+    arena->page_size = (size_t)sysconf(_SC_PAGESIZE);
+    arena->size = size + (size_t)number_of_arrays * arena->page_size;
+    arena->used = 0;
+    arena->huge_pages = huge_pages;
+
+    if (huge_pages)
+    {
+        arena->size = (arena->size + HUGE_PAGE_SIZE - 1) / HUGE_PAGE_SIZE * HUGE_PAGE_SIZE;
+    }
+
+    arena->base = (char*)mmap(NULL, arena->size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+    if (arena->base == MAP_FAILED)
+    {
+        perror("mmap");
+        arena->base = NULL;
+        return false;
+    }
+
+#ifdef MADV_HUGEPAGE
+    if (huge_pages && madvise(arena->base, arena->size, MADV_HUGEPAGE) != 0)
+    {
+        perror("madvise(MADV_HUGEPAGE)");
+        arena->huge_pages = false;
+    }
+#else
+    arena->huge_pages = false;
+#endif
+
+    return true;
+}
+
+/*!
+ * \brief Returns size bytes from the arena, NULL when it is full.
+ */
+void* arena_alloc(Arena *arena, size_t size)
+{
+    const size_t alignment = size >= arena->page_size ? arena->page_size : ARENA_ALIGNMENT;
+    const size_t offset = (arena->used + alignment - 1) / alignment * alignment;
+
+    if (offset + size > arena->size)
+    {
+        return NULL;
+    }
+
+    arena->used = offset + size;
+
+    return arena->base + offset;
+}
+
+/*!
+ * \brief Copies size bytes into the arena and frees the source, returns the copy. Returns NULL and keeps the source
+ *        when the arena is full, so the caller still owns it.
+ */
+void* move_to_arena(Arena *arena, void *source, size_t size)
+{
+    void *copy = arena_alloc(arena, size);
+
+    if (copy == NULL)
+    {
+        return NULL;
+    }
+
+    memcpy(copy, source, size);
+    free(source);
+
+    return copy;
+}
+
+void free_arena(Arena *arena)
+{
+    if (arena->base != NULL)
+    {
+        munmap(arena->base, arena->size);
+    }
+
+    arena->base = NULL;
+    arena->size = 0;
+    arena->used = 0;
+}
+
+#endif
@@ -0,0 +1,512 @@
+#ifndef _BENCH_H
+#define _BENCH_H
+
+#define CL_TARGET_OPENCL_VERSION 300
+#include <CL/cl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+
+#include "helper_functions.h"
+#include "formats.h"
+#include "selector.h"
+#include "enums.h"
+
+#define MAX_FORMAT_ARRAYS 6
+
+/*!
+ * \brief Times of one format on one matrix. Kernel times are over the repeats after the warmup runs,
+ *        footprint_bytes is the size of the matrix arrays on the device (padding included).
+ */
+typedef struct
+{
+    double conversion_ms;
+    double upload_ms;
+    double median_ms;
+    double min_ms;
+    double max_ms;
+    size_t footprint_bytes;
+    bool correct;
+} BenchmarkResult;
+
+/*!
+ * \brief Median of number_of_values values, which are left sorted.
+ */
+double sort_and_get_median(double *values, int number_of_values)
+{
+    qsort(values, number_of_values, sizeof(double), compare_doubles);
+
+    return number_of_values % 2 == 1 ? values[number_of_values / 2] : (values[number_of_values / 2 - 1] + values[number_of_values / 2]) / 2;
+}
+
+void compute_reference(const cl_int *ptr, const cl_int *cols, const cl_double *data, const cl_double *vect, int number_of_rows, cl_double *result)
+{
+    int i;
+
+    #pragma omp parallel for shared(ptr, cols, data, vect, number_of_rows, result) private(i)
+    for (i = 0; i < number_of_rows; ++i)
+    {
+        double sum = 0;
+        int j;
+
+        for (j = ptr[i]; j < ptr[i+1]; ++j)
+        {
+            sum += data[j] * vect[cols[j]];
+        }
+
+        result[i] = sum;
+    }
+}
+
+/*!
+ * \brief The formats add the elements of a row in different orders, so rows are compared relative to the largest reference value.
+ */
+bool check_against_reference(const cl_double *expected, const cl_double *result, int number_of_rows, bool verbose)
+{
+    double reference_max = 0;
+    int i;
+
+    for (i = 0; i < number_of_rows; ++i)
+    {
+        reference_max = fmax(reference_max, fabs(expected[i]));
+    }
+
+    for (i = 0; i < number_of_rows; ++i)
+    {
+        if (fabs(expected[i] - result[i]) > EPSILON * fmax(1, reference_max))
+        {
+            if (verbose)
+            {
+                printf("wrong value at index %d: expected %f - calculated %f\n", i, expected[i], result[i]);
+            }
+
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void add_format_array(void **arrays, size_t *sizes, bool *owned, int *number_of_arrays, void *array, size_t size, bool owned_array)
+{
+    arrays[*number_of_arrays] = array;
+    sizes[*number_of_arrays] = size;
+    owned[*number_of_arrays] = owned_array;
+    (*number_of_arrays)++;
+}
+
+/*!
+ * \brief Host CSR with OpenMP, timed like the device formats (nothing to convert or upload).
+ */
+void benchmark_host_csr(const cl_int *ptr, const cl_int *cols, const cl_double *data, int number_of_rows, const cl_double *vect, const cl_double *expected,
+                        int warmup, int repeats, double *run_ms, BenchmarkResult *benchmark)
+{
+    cl_double *result = (cl_double*)malloc(sizeof(cl_double) * number_of_rows);
+    struct timespec start_time;
+    struct timespec end_time;
+    int run;
+
+    for (run = -warmup; run < repeats; ++run)
+    {
+        clock_gettime(CLOCK_MONOTONIC, &start_time);
+        compute_reference(ptr, cols, data, vect, number_of_rows, result);
+        clock_gettime(CLOCK_MONOTONIC, &end_time);
+
+        if (run >= 0)
+        {
+            run_ms[run] = (double)(end_time.tv_nsec - start_time.tv_nsec) / 1000000 + (double)(end_time.tv_sec - start_time.tv_sec) * 1000;
+        }
+    }
+
+    benchmark->conversion_ms = 0;
+    benchmark->upload_ms = 0;
+    benchmark->footprint_bytes = sizeof(cl_int) * ((size_t)number_of_rows + 1) + (sizeof(cl_int) + sizeof(cl_double)) * (size_t)ptr[number_of_rows];
+    benchmark->correct = check_against_reference(expected, result, number_of_rows, false);
+
+    double *sorted = (double*)malloc(sizeof(double) * repeats);
+
+    memcpy(sorted, run_ms, sizeof(double) * repeats);
+    benchmark->median_ms = sort_and_get_median(sorted, repeats);
+    benchmark->min_ms = sorted[0];
+    benchmark->max_ms = sorted[repeats - 1];
+
+    free(sorted);
+    free(result);
+}
+
+/*!
+ * \brief Builds the SpMV kernels the per-format programs run (kernels/Coo.cl, Csr.cl, Ell.cl, Sigma_C.cl and Cmrs.cl, values
+ *        and vector in double) into programs, indexed by SpmvFormat. HYB has no program of its own, it runs ell and coo.
+ */
+bool build_format_programs(cl_context context, cl_device_id device, cl_program *programs)
+{
+    const char *files[NumberOfFormats] = { "kernels/Coo.cl", "kernels/Csr.cl", "kernels/Ell.cl", "kernels/Sigma_C.cl", "kernels/Cmrs.cl", NULL };
+    int format;
+
+    for (format = 0; format < NumberOfFormats; ++format)
+    {
+        programs[format] = files[format] == NULL ? NULL : build_program_from_file(context, device, files[format], "-I kernels");
+
+        if (files[format] != NULL && programs[format] == NULL)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void release_format_programs(cl_program *programs)
+{
+    int format;
+
+    for (format = 0; format < NumberOfFormats; ++format)
+    {
+        if (programs[format] != NULL)
+        {
+            clReleaseProgram(programs[format]);
+        }
+    }
+}
+
+/*!
+ * \brief Converts the CSR matrix into the format (timed as conversion), creates and writes its buffers (timed as upload), runs
+ *        its kernels warmup + repeats times and checks the last product against expected. run_ms gets the time of every repeat.
+ *        programs come from build_format_programs, so every format is timed with the kernel its own program runs; HYB runs ell
+ *        on the ELL part and then adds the COO part with coo. Returns Success or OpenCLProgramError.
+ */
+int benchmark_format(cl_context context, cl_command_queue command_queue, cl_program *programs, SpmvFormat format,
+                     const LaunchParameters *parameters, cl_int *ptr, cl_int *cols, cl_double *data, int number_of_rows, int number_of_columns,
+                     const cl_double *vect, const cl_double *expected, int warmup, int repeats, double *run_ms, BenchmarkResult *benchmark)
+{
+    const int number_of_nonzeroes = ptr[number_of_rows];
+    const size_t global_work_size[1] = { parameters->global_work_size };
+    const size_t local_work_size[1] = { parameters->local_work_size };
+    const cl_uint work_dim = 1;
+    void *host_arrays[MAX_FORMAT_ARRAYS];
+    size_t array_sizes[MAX_FORMAT_ARRAYS];
+    bool owned[MAX_FORMAT_ARRAYS];
+    cl_mem buffers[MAX_FORMAT_ARRAYS];
+    cl_kernel kernels[2] = { NULL, NULL };
+    struct timespec start_time;
+    struct timespec end_time;
+    int number_of_arrays = 0;
+    int number_of_kernels = 1;
+    int output_rows = number_of_rows;
+    int row_size = 0;
+    int number_of_coo_entries = 0;
+    cl_int error = CL_SUCCESS;
+    int run;
+    int i;
+
+
+    /* conversion */
+
+    clock_gettime(CLOCK_MONOTONIC, &start_time);
+
+    switch (format)
+    {
+        case CooFormat:
+        {
+            cl_int *rows = (cl_int*)malloc(sizeof(cl_int) * number_of_nonzeroes);
+
+            for (i = 0; i < number_of_rows; ++i)
+            {
+                int j;
+
+                for (j = ptr[i]; j < ptr[i + 1]; ++j)
+                {
+                    rows[j] = i;
+                }
+            }
+
+            add_format_array(host_arrays, array_sizes, owned, &number_of_arrays, rows, sizeof(cl_int) * number_of_nonzeroes, true);
+            add_format_array(host_arrays, array_sizes, owned, &number_of_arrays, cols, sizeof(cl_int) * number_of_nonzeroes, false);
+            add_format_array(host_arrays, array_sizes, owned, &number_of_arrays, data, sizeof(cl_double) * number_of_nonzeroes, false);
+            break;
+        }
+        case EllFormat:
+        {
+            cl_int *ell_cols;
+            cl_double *ell_data;
+
+            create_ell(ptr, cols, data, number_of_rows, &row_size, &ell_cols, &ell_data);
+
+            add_format_array(host_arrays, array_sizes, owned, &number_of_arrays, ell_data, sizeof(cl_double) * row_size * number_of_rows, true);
+            add_format_array(host_arrays, array_sizes, owned, &number_of_arrays, ell_cols, sizeof(cl_int) * row_size * number_of_rows, true);
+            break;
+        }
+        case SellFormat:
+        {
+            int number_of_slices;
+            cl_int *row_indices;
+            cl_int *sell_cols;
+            cl_double *sell_data;
+
+            create_sell(ptr, cols, data, number_of_rows, parameters->slice_height, &number_of_slices, &row_indices, &sell_cols, &sell_data);
+
+            add_format_array(host_arrays, array_sizes, owned, &number_of_arrays, sell_data, sizeof(cl_double) * row_indices[number_of_slices], true);
+            add_format_array(host_arrays, array_sizes, owned, &number_of_arrays, sell_cols, sizeof(cl_int) * row_indices[number_of_slices], true);
+            add_format_array(host_arrays, array_sizes, owned, &number_of_arrays, row_indices, sizeof(cl_int) * (number_of_slices + 1), true);
+            output_rows = number_of_slices * parameters->slice_height;
+            break;
+        }
+        case CmrsFormat:
+        {
+            int number_of_strips;
+            cl_int *strip_ptr;
+            cl_int *row_in_strip;
+
+            create_cmrs(ptr, number_of_rows, parameters->strip_height, &number_of_strips, &strip_ptr, &row_in_strip);
+
+            add_format_array(host_arrays, array_sizes, owned, &number_of_arrays, data, sizeof(cl_double) * number_of_nonzeroes, false);
+            add_format_array(host_arrays, array_sizes, owned, &number_of_arrays, cols, sizeof(cl_int) * number_of_nonzeroes, false);
+            add_format_array(host_arrays, array_sizes, owned, &number_of_arrays, strip_ptr, sizeof(cl_int) * (number_of_strips + 1), true);
+            add_format_array(host_arrays, array_sizes, owned, &number_of_arrays, row_in_strip, sizeof(cl_int) * number_of_nonzeroes, true);
+            output_rows = number_of_strips * parameters->strip_height;
+            break;
+        }
+        case HybFormat:
+        {
+            cl_int *ell_cols;
+            cl_double *ell_data;
+            cl_int *coo_rows;
+            cl_int *coo_cols;
+            cl_double *coo_data;
+
+            row_size = parameters->hyb_width;
+            number_of_coo_entries = create_hyb(ptr, cols, data, number_of_rows, row_size, &ell_cols, &ell_data, &coo_rows, &coo_cols, &coo_data);
+            number_of_kernels = number_of_coo_entries > 0 ? 2 : 1;
+
+            add_format_array(host_arrays, array_sizes, owned, &number_of_arrays, ell_data, sizeof(cl_double) * row_size * number_of_rows, true);
+            add_format_array(host_arrays, array_sizes, owned, &number_of_arrays, ell_cols, sizeof(cl_int) * row_size * number_of_rows, true);
+            add_format_array(host_arrays, array_sizes, owned, &number_of_arrays, coo_rows, sizeof(cl_int) * number_of_coo_entries, true);
+            add_format_array(host_arrays, array_sizes, owned, &number_of_arrays, coo_cols, sizeof(cl_int) * number_of_coo_entries, true);
+            add_format_array(host_arrays, array_sizes, owned, &number_of_arrays, coo_data, sizeof(cl_double) * number_of_coo_entries, true);
+            break;
+        }
+        default:
+            add_format_array(host_arrays, array_sizes, owned, &number_of_arrays, ptr, sizeof(cl_int) * (number_of_rows + 1), false);
+            add_format_array(host_arrays, array_sizes, owned, &number_of_arrays, cols, sizeof(cl_int) * number_of_nonzeroes, false);
+            add_format_array(host_arrays, array_sizes, owned, &number_of_arrays, data, sizeof(cl_double) * number_of_nonzeroes, false);
+            break;
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &end_time);
+    benchmark->conversion_ms = (double)(end_time.tv_nsec - start_time.tv_nsec) / 1000000 + (double)(end_time.tv_sec - start_time.tv_sec) * 1000;
+
+
+    /* upload, empty arrays (ELL part of HYB with width 0, no COO part) get a one element buffer */
+
+    clock_gettime(CLOCK_MONOTONIC, &start_time);
+
+    benchmark->footprint_bytes = 0;
+
+    for (i = 0; i < number_of_arrays; ++i)
+    {
+        buffers[i] = clCreateBuffer(context, CL_MEM_READ_ONLY, array_sizes[i] > 0 ? array_sizes[i] : sizeof(cl_double), NULL, &error);
+
+        if (error != CL_SUCCESS)
+        {
+            printf("clCreateBuffer error %d\n", error);
+            return OpenCLProgramError;
+        }
+
+        if (array_sizes[i] > 0)
+        {
+            error = clEnqueueWriteBuffer(command_queue, buffers[i], CL_FALSE, 0, array_sizes[i], host_arrays[i], 0, NULL, NULL);
+
+            if (error != CL_SUCCESS)
+            {
+                printf("clEnqueueWriteBuffer error %d\n", error);
+                return OpenCLProgramError;
+            }
+        }
+
+        benchmark->footprint_bytes += array_sizes[i];
+    }
+
+    cl_mem buffer_vect = clCreateBuffer(context, CL_MEM_READ_ONLY, sizeof(cl_double) * number_of_columns, NULL, &error);
+    cl_mem buffer_output = clCreateBuffer(context, CL_MEM_READ_WRITE, sizeof(cl_double) * output_rows, NULL, &error);
+
+    if (error != CL_SUCCESS)
+    {
+        printf("clCreateBuffer error %d\n", error);
+        return OpenCLProgramError;
+    }
+
+    error = clEnqueueWriteBuffer(command_queue, buffer_vect, CL_FALSE, 0, sizeof(cl_double) * number_of_columns, vect, 0, NULL, NULL);
+
+    if (error != CL_SUCCESS)
+    {
+        printf("clEnqueueWriteBuffer error %d\n", error);
+        return OpenCLProgramError;
+    }
+
+    clFinish(command_queue);
+    clock_gettime(CLOCK_MONOTONIC, &end_time);
+    benchmark->upload_ms = (double)(end_time.tv_nsec - start_time.tv_nsec) / 1000000 + (double)(end_time.tv_sec - start_time.tv_sec) * 1000;
+
+    for (i = 0; i < number_of_arrays; ++i)
+    {
+        if (owned[i])
+        {
+            free(host_arrays[i]);
+        }
+    }
+
+
+    /* kernels */
+
+    switch (format)
+    {
+        case CooFormat:
+            kernels[0] = clCreateKernel(programs[CooFormat], "coo", &error);
+            error |= clSetKernelArg(kernels[0], 0, sizeof(cl_mem), (void*)&buffers[0]);
+            error |= clSetKernelArg(kernels[0], 1, sizeof(cl_mem), (void*)&buffers[1]);
+            error |= clSetKernelArg(kernels[0], 2, sizeof(cl_mem), (void*)&buffers[2]);
+            error |= clSetKernelArg(kernels[0], 3, sizeof(cl_mem), (void*)&buffer_vect);
+            error |= clSetKernelArg(kernels[0], 4, sizeof(cl_mem), (void*)&buffer_output);
+            error |= clSetKernelArg(kernels[0], 5, sizeof(int), (void*)&number_of_nonzeroes);
+            break;
+        case EllFormat:
+        case HybFormat:
+            kernels[0] = clCreateKernel(programs[EllFormat], "ell", &error);
+            error |= clSetKernelArg(kernels[0], 0, sizeof(cl_mem), (void*)&buffers[0]);
+            error |= clSetKernelArg(kernels[0], 1, sizeof(cl_mem), (void*)&buffers[1]);
+            error |= clSetKernelArg(kernels[0], 2, sizeof(cl_mem), (void*)&buffer_vect);
+            error |= clSetKernelArg(kernels[0], 3, sizeof(cl_mem), (void*)&buffer_output);
+            error |= clSetKernelArg(kernels[0], 4, sizeof(int), (void*)&number_of_rows);
+            error |= clSetKernelArg(kernels[0], 5, sizeof(int), (void*)&row_size);
+            error |= clSetKernelArg(kernels[0], 6, sizeof(cl_double) * parameters->local_work_size, NULL);
+
+            if (format == HybFormat)
+            {
+                kernels[1] = clCreateKernel(programs[CooFormat], "coo", &error);
+                error |= clSetKernelArg(kernels[1], 0, sizeof(cl_mem), (void*)&buffers[2]);
+                error |= clSetKernelArg(kernels[1], 1, sizeof(cl_mem), (void*)&buffers[3]);
+                error |= clSetKernelArg(kernels[1], 2, sizeof(cl_mem), (void*)&buffers[4]);
+                error |= clSetKernelArg(kernels[1], 3, sizeof(cl_mem), (void*)&buffer_vect);
+                error |= clSetKernelArg(kernels[1], 4, sizeof(cl_mem), (void*)&buffer_output);
+                error |= clSetKernelArg(kernels[1], 5, sizeof(int), (void*)&number_of_coo_entries);
+            }
+            break;
+        case SellFormat:
+            kernels[0] = clCreateKernel(programs[SellFormat], "sigma_c", &error);
+            error |= clSetKernelArg(kernels[0], 0, sizeof(cl_mem), (void*)&buffers[0]);
+            error |= clSetKernelArg(kernels[0], 1, sizeof(cl_mem), (void*)&buffers[1]);
+            error |= clSetKernelArg(kernels[0], 2, sizeof(cl_mem), (void*)&buffer_vect);
+            error |= clSetKernelArg(kernels[0], 3, sizeof(cl_mem), (void*)&buffer_output);
+            error |= clSetKernelArg(kernels[0], 4, sizeof(cl_mem), (void*)&buffers[2]);
+            error |= clSetKernelArg(kernels[0], 5, sizeof(int), (void*)&parameters->slice_height);
+            break;
+        case CmrsFormat:
+        {
+            const int number_of_strips = output_rows / parameters->strip_height;
+
+            kernels[0] = clCreateKernel(programs[CmrsFormat], "cmrs", &error);
+            error |= clSetKernelArg(kernels[0], 0, sizeof(cl_mem), (void*)&buffers[0]);
+            error |= clSetKernelArg(kernels[0], 1, sizeof(cl_mem), (void*)&buffers[1]);
+            error |= clSetKernelArg(kernels[0], 2, sizeof(cl_mem), (void*)&buffers[2]);
+            error |= clSetKernelArg(kernels[0], 3, sizeof(cl_mem), (void*)&buffers[3]);
+            error |= clSetKernelArg(kernels[0], 4, sizeof(cl_mem), (void*)&buffer_vect);
+            error |= clSetKernelArg(kernels[0], 5, sizeof(cl_mem), (void*)&buffer_output);
+            error |= clSetKernelArg(kernels[0], 6, sizeof(int), (void*)&number_of_strips);
+            error |= clSetKernelArg(kernels[0], 7, sizeof(int), (void*)&parameters->strip_height);
+            error |= clSetKernelArg(kernels[0], 8, sizeof(cl_double) * parameters->local_work_size * parameters->strip_height, NULL);
+            break;
+        }
+        default:
+            kernels[0] = clCreateKernel(programs[CsrFormat], "csr", &error);
+            error |= clSetKernelArg(kernels[0], 0, sizeof(cl_mem), (void*)&buffers[0]);
+            error |= clSetKernelArg(kernels[0], 1, sizeof(cl_mem), (void*)&buffers[1]);
+            error |= clSetKernelArg(kernels[0], 2, sizeof(cl_mem), (void*)&buffers[2]);
+            error |= clSetKernelArg(kernels[0], 3, sizeof(cl_mem), (void*)&buffer_vect);
+            error |= clSetKernelArg(kernels[0], 4, sizeof(cl_mem), (void*)&buffer_output);
+            error |= clSetKernelArg(kernels[0], 5, sizeof(int), (void*)&number_of_rows);
+            break;
+    }
+
+    if (error != CL_SUCCESS)
+    {
+        printf("clSetKernelArg errror\n");
+        return OpenCLProgramError;
+    }
+
+    for (run = -warmup; run < repeats; ++run)
+    {
+        double ms = 0;
+        int kernel;
+
+        /* coo adds to the output, ell of HYB overwrites it */
+        if (format == CooFormat && zero_buffer(command_queue, buffer_output, sizeof(cl_double) * output_rows) < 0)
+        {
+            return OpenCLProgramError;
+        }
+
+        for (kernel = 0; kernel < number_of_kernels; ++kernel)
+        {
+            const size_t coo_global_work_size[1] = { (size_t)(number_of_coo_entries + 63) / 64 * 64 };
+            const size_t coo_local_work_size[1] = { 64 };
+            const double kernel_ms = kernel == 1 ? run_kernel(command_queue, kernels[kernel], work_dim, coo_global_work_size, coo_local_work_size)
+                                                 : run_kernel(command_queue, kernels[kernel], work_dim, global_work_size, local_work_size);
+
+            if (kernel_ms < 0)
+            {
+                return OpenCLProgramError;
+            }
+
+            ms += kernel_ms;
+        }
+
+        if (run >= 0)
+        {
+            run_ms[run] = ms;
+        }
+    }
+
+    cl_double *result = (cl_double*)malloc(sizeof(cl_double) * number_of_rows);
+
+    error = clEnqueueReadBuffer(command_queue, buffer_output, CL_TRUE, 0, sizeof(cl_double) * number_of_rows, result, 0, NULL, NULL);
+
+    if (error != CL_SUCCESS)
+    {
+        printf("clEnqueueReadBuffer error %d\n", error);
+        return OpenCLProgramError;
+    }
+
+    benchmark->correct = check_against_reference(expected, result, number_of_rows, false);
+
+    double *sorted = (double*)malloc(sizeof(double) * repeats);
+
+    memcpy(sorted, run_ms, sizeof(double) * repeats);
+    benchmark->median_ms = sort_and_get_median(sorted, repeats);
+    benchmark->min_ms = sorted[0];
+    benchmark->max_ms = sorted[repeats - 1];
+
+    for (i = 0; i < 2; ++i)
+    {
+        if (kernels[i] != NULL)
+        {
+            clReleaseKernel(kernels[i]);
+        }
+    }
+
+    for (i = 0; i < number_of_arrays; ++i)
+    {
+        clReleaseMemObject(buffers[i]);
+    }
+
+    clReleaseMemObject(buffer_vect);
+    clReleaseMemObject(buffer_output);
+
+    free(sorted);
+    free(result);
+
+    return Success;
+}
+
+#endif
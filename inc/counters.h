@@ -0,0 +1,87 @@
+#ifndef _COUNTERS_H
+#define _COUNTERS_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <sys/ioctl.h>
+#include <linux/perf_event.h>
+#include <omp.h>
+
+#define DTLB_READ_MISSES (PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16))
+#define LL_READ_MISSES (PERF_COUNT_HW_CACHE_LL | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16))
+
+/*!
+ * \brief Opens a hardware cache event counter (config is one of the *_READ_MISSES above) in every thread of a team of
+ *        number_of_threads threads. An entry is -1 where perf events are not available (no PMU, perf_event_paranoid).
+ */
+int* open_cache_counters(int number_of_threads, unsigned long long config)
+{
+    int *counters = (int*)malloc(sizeof(int) * number_of_threads);
+
+    #pragma omp parallel num_threads(number_of_threads) shared(counters, config)
+    {
+        struct perf_event_attr attributes;
+
+        memset(&attributes, 0, sizeof(attributes));
+        attributes.type = PERF_TYPE_HW_CACHE;
+        attributes.size = sizeof(attributes);
+        attributes.config = config;
+        attributes.disabled = 1;
+        attributes.exclude_kernel = 1;
+        attributes.exclude_hv = 1;
+
+        const int counter = (int)syscall(SYS_perf_event_open, &attributes, 0, -1, -1, 0);
+
+        if (counter >= 0)
+        {
+            ioctl(counter, PERF_EVENT_IOC_RESET, 0);
+            ioctl(counter, PERF_EVENT_IOC_ENABLE, 0);
+        }
+
+        counters[omp_get_thread_num()] = counter;
+    }
+
+    return counters;
+}
+
+/*!
+ * \brief Sums and closes the counters, -1 when any of them could not be opened.
+ */
+long long close_cache_counters(int *counters, int number_of_threads)
+{
+    long long sum = 0;
+    int thread;
+
+    for (thread = 0; thread < number_of_threads; ++thread)
+    {
+        long long misses;
+
+        if (counters[thread] < 0)
+        {
+            sum = -1;
+            continue;
+        }
+
+        ioctl(counters[thread], PERF_EVENT_IOC_DISABLE, 0);
+
+        if (read(counters[thread], &misses, sizeof(misses)) != sizeof(misses))
+        {
+            sum = -1;
+        }
+        else if (sum >= 0)
+        {
+            sum += misses;
+        }
+
+        close(counters[thread]);
+    }
+
+    free(counters);
+
+    return sum;
+}
+
+#endif
@@ -7,7 +7,27 @@ typedef enum
     OpenCLDeviceError,
     OpenCLProgramError,
     FileError,
-    OtherError
+    OtherError,
+    PerformanceRegression
 } ReturnCode;
 
+/* must match PRECISION_* in kernels/Precision.h */
+typedef enum
+{
+    DoublePrecision,
+    SinglePrecision,
+    HalfPrecision
+} Precision;
+
+typedef enum
+{
+    CooFormat,
+    CsrFormat,
+    EllFormat,
+    SellFormat,
+    CmrsFormat,
+    HybFormat,
+    NumberOfFormats
+} SpmvFormat;
+
 #endif /* _ENUMS_H_ */
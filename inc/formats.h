@@ -0,0 +1,769 @@
+#ifndef _FORMATS_H
+#define _FORMATS_H
+
+#define CL_TARGET_OPENCL_VERSION 300
+#include <CL/cl.h>
+#include <limits.h>
+#include <string.h>
+
+#include "helper_functions.h"
+
+/*!
+ * \brief Reads the whole matrix into CSR, entries of a row keep their order from the file but rows may come in any order.
+ *
+ * With expand_symmetric the triangle missing from a symmetric file is added, otherwise the file is taken as it is.
+ */
+bool read_csr_from_file(const char *filename, bool expand_symmetric, int *number_of_rows, int *number_of_columns, int *number_of_nonzeroes, cl_int **ptr, cl_int **cols, cl_double **data)
+{
+    FILE *file;
+    MM_typecode matcode;
+    int i;
+    int number_of_entries;
+    cl_int *file_rows;
+    cl_int *file_cols;
+    cl_double *file_data;
+    cl_int *position;
+
+    file = fopen(filename, "r");
+
+    if (file == NULL)
+    {
+        perror(filename);
+        return false;
+    }
+
+    if (mm_read_banner(file, &matcode) != 0 || fseek(file, 0, SEEK_SET) != 0)
+    {
+        printf("Could not process Matrix Market banner.\n");
+        fclose(file);
+        return false;
+    }
+
+    if (read_size_of_matrices_from_file(file, number_of_rows, number_of_columns, &number_of_entries) == false)
+    {
+        fclose(file);
+        return false;
+    }
+
+    expand_symmetric = expand_symmetric && mm_is_symmetric(matcode);
+
+    file_rows = (cl_int *)malloc(number_of_entries * sizeof(cl_int));
+    file_cols = (cl_int *)malloc(number_of_entries * sizeof(cl_int));
+    file_data = (cl_double *)malloc(number_of_entries * sizeof(cl_double));
+
+    *ptr = (cl_int *)calloc(*number_of_rows + 1, sizeof(cl_int));
+    *number_of_nonzeroes = number_of_entries;
+
+    for (i = 0; i < number_of_entries; i++)
+    {
+        read_matrix_entry(file, &file_rows[i], &file_cols[i], &file_data[i]);
+        file_rows[i]--; // adjust from 1-based to 0-based
+        file_cols[i]--;
+
+        (*ptr)[file_rows[i] + 1]++;
+
+        if (expand_symmetric && file_rows[i] != file_cols[i])
+        {
+            (*ptr)[file_cols[i] + 1]++;
+            (*number_of_nonzeroes)++;
+        }
+    }
+
+    fclose(file);
+
+    for (i = 0; i < *number_of_rows; i++)
+    {
+        (*ptr)[i + 1] += (*ptr)[i];
+    }
+
+    *cols = (cl_int *)malloc(*number_of_nonzeroes * sizeof(cl_int));
+    *data = (cl_double *)malloc(*number_of_nonzeroes * sizeof(cl_double));
+
+    position = (cl_int *)malloc(*number_of_rows * sizeof(cl_int));
+    memcpy(position, *ptr, *number_of_rows * sizeof(cl_int));
+
+    for (i = 0; i < number_of_entries; i++)
+    {
+        int index = position[file_rows[i]]++;
+
+        (*cols)[index] = file_cols[i];
+        (*data)[index] = file_data[i];
+
+        if (expand_symmetric && file_rows[i] != file_cols[i])
+        {
+            index = position[file_cols[i]]++;
+
+            (*cols)[index] = file_rows[i];
+            (*data)[index] = file_data[i];
+        }
+    }
+
+    free(position);
+    free(file_rows);
+    free(file_cols);
+    free(file_data);
+
+    return true;
+}
+
+/*
+ * Binary CSR files are the 8 magic bytes, the number of rows, columns and nonzeroes as 32-bit ints and then
+ * ptr, cols and data as they are in memory, so they load without parsing. They are not portable across endianness.
+ */
+const char binary_csr_magic[8] = { 'S', 'P', 'M', 'V', 'C', 'S', 'R', '1' };
+
+bool is_binary_csr_file(const char *filename)
+{
+    const size_t length = strlen(filename);
+
+    return length > 4 && strcmp(filename + length - 4, ".bin") == 0;
+}
+
+bool write_csr_to_binary_file(const char *filename, int number_of_rows, int number_of_columns, const cl_int *ptr, const cl_int *cols, const cl_double *data)
+{
+    const cl_int sizes[3] = { number_of_rows, number_of_columns, ptr[number_of_rows] };
+    FILE *file = fopen(filename, "wb");
+
+    if (file == NULL)
+    {
+        perror(filename);
+        return false;
+    }
+
+    const bool written = fwrite(binary_csr_magic, sizeof(binary_csr_magic), 1, file) == 1 &&
+                         fwrite(sizes, sizeof(sizes), 1, file) == 1 &&
+                         fwrite(ptr, sizeof(cl_int), number_of_rows + 1, file) == (size_t)number_of_rows + 1 &&
+                         fwrite(cols, sizeof(cl_int), sizes[2], file) == (size_t)sizes[2] &&
+                         fwrite(data, sizeof(cl_double), sizes[2], file) == (size_t)sizes[2];
+
+    if (fclose(file) != 0 || !written)
+    {
+        perror(filename);
+        return false;
+    }
+
+    return true;
+}
+
+bool read_csr_from_binary_file(const char *filename, int *number_of_rows, int *number_of_columns, int *number_of_nonzeroes, cl_int **ptr, cl_int **cols, cl_double **data)
+{
+    char magic[sizeof(binary_csr_magic)];
+    cl_int sizes[3];
+    FILE *file = fopen(filename, "rb");
+
+    if (file == NULL)
+    {
+        perror(filename);
+        return false;
+    }
+
+    if (fread(magic, sizeof(magic), 1, file) != 1 || memcmp(magic, binary_csr_magic, sizeof(magic)) != 0 ||
+        fread(sizes, sizeof(sizes), 1, file) != 1 || sizes[0] < 0 || sizes[1] < 0 || sizes[2] < 0)
+    {
+        printf("%s is not a binary CSR file\n", filename);
+        fclose(file);
+        return false;
+    }
+
+    *number_of_rows = sizes[0];
+    *number_of_columns = sizes[1];
+    *number_of_nonzeroes = sizes[2];
+    *ptr = (cl_int *)malloc((*number_of_rows + 1) * sizeof(cl_int));
+    *cols = (cl_int *)malloc(*number_of_nonzeroes * sizeof(cl_int));
+    *data = (cl_double *)malloc(*number_of_nonzeroes * sizeof(cl_double));
+
+    if (fread(*ptr, sizeof(cl_int), *number_of_rows + 1, file) != (size_t)*number_of_rows + 1 ||
+        fread(*cols, sizeof(cl_int), *number_of_nonzeroes, file) != (size_t)*number_of_nonzeroes ||
+        fread(*data, sizeof(cl_double), *number_of_nonzeroes, file) != (size_t)*number_of_nonzeroes)
+    {
+        printf("%s is truncated\n", filename);
+        fclose(file);
+        free(*ptr);
+        free(*cols);
+        free(*data);
+        return false;
+    }
+
+    fclose(file);
+
+    return true;
+}
+
+bool write_csr_to_matrix_market_file(const char *filename, int number_of_rows, int number_of_columns, const cl_int *ptr, const cl_int *cols, const cl_double *data)
+{
+    FILE *file = fopen(filename, "w");
+    int i;
+    int j;
+
+    if (file == NULL)
+    {
+        perror(filename);
+        return false;
+    }
+
+    /* large buffer, the file of a big matrix is tens of gigabytes */
+    char *buffer = (char *)malloc(1 << 24);
+    setvbuf(file, buffer, _IOFBF, 1 << 24);
+
+    fprintf(file, "%%%%MatrixMarket matrix coordinate real general\n%d %d %d\n", number_of_rows, number_of_columns, ptr[number_of_rows]);
+
+    for (i = 0; i < number_of_rows; ++i)
+    {
+        for (j = ptr[i]; j < ptr[i + 1]; ++j)
+        {
+            fprintf(file, "%d %d %.17g\n", i + 1, cols[j] + 1, data[j]);
+        }
+    }
+
+    const bool closed = fclose(file) == 0;
+
+    free(buffer);
+
+    if (!closed)
+    {
+        perror(filename);
+        return false;
+    }
+
+    return true;
+}
+
+/*!
+ * \brief Counts the block_rows x block_cols blocks of the CSR matrix that hold at least one nonzero.
+ */
+long count_bcsr_blocks(cl_int *ptr, cl_int *cols, int number_of_rows, int number_of_columns, int block_rows, int block_cols)
+{
+    const int number_of_block_rows = (number_of_rows + block_rows - 1) / block_rows;
+    const int number_of_block_columns = (number_of_columns + block_cols - 1) / block_cols;
+    cl_int *last_block_row = (cl_int *)malloc(number_of_block_columns * sizeof(cl_int));
+    long number_of_blocks = 0;
+    int block_row;
+    int i;
+
+    for (i = 0; i < number_of_block_columns; i++)
+    {
+        last_block_row[i] = -1;
+    }
+
+    for (block_row = 0; block_row < number_of_block_rows; block_row++)
+    {
+        const int first_row = block_row * block_rows;
+        const int last_row = first_row + block_rows < number_of_rows ? first_row + block_rows : number_of_rows;
+        int j;
+
+        for (j = ptr[first_row]; j < ptr[last_row]; j++)
+        {
+            const int block_column = cols[j] / block_cols;
+
+            if (last_block_row[block_column] != block_row)
+            {
+                last_block_row[block_column] = block_row;
+                number_of_blocks++;
+            }
+        }
+    }
+
+    free(last_block_row);
+
+    return number_of_blocks;
+}
+
+/*!
+ * \brief Converts CSR into BCSR, every block is stored row-major and blocks of a block row keep the order in which they are first met.
+ */
+void create_bcsr(cl_int *ptr, cl_int *cols, cl_double *data, int number_of_rows, int number_of_columns, int block_rows, int block_cols, cl_int **block_ptr, cl_int **block_col, cl_double **block_data, int *number_of_blocks)
+{
+    const int number_of_block_rows = (number_of_rows + block_rows - 1) / block_rows;
+    const int number_of_block_columns = (number_of_columns + block_cols - 1) / block_cols;
+    const int block_size = block_rows * block_cols;
+    cl_int *block_index = (cl_int *)malloc(number_of_block_columns * sizeof(cl_int));
+    cl_int *last_block_row = (cl_int *)malloc(number_of_block_columns * sizeof(cl_int));
+    int block_row;
+    int i;
+
+    *number_of_blocks = (int)count_bcsr_blocks(ptr, cols, number_of_rows, number_of_columns, block_rows, block_cols);
+
+    *block_ptr  = (cl_int *)malloc((number_of_block_rows + 1) * sizeof(cl_int));
+    *block_col  = (cl_int *)malloc(*number_of_blocks * sizeof(cl_int));
+    *block_data = (cl_double *)calloc((size_t)*number_of_blocks * block_size, sizeof(cl_double));
+
+    for (i = 0; i < number_of_block_columns; i++)
+    {
+        last_block_row[i] = -1;
+    }
+
+    (*block_ptr)[0] = 0;
+
+    int current_block = 0;
+
+    for (block_row = 0; block_row < number_of_block_rows; block_row++)
+    {
+        int row;
+
+        for (row = block_row * block_rows; row < (block_row + 1) * block_rows && row < number_of_rows; row++)
+        {
+            int j;
+
+            for (j = ptr[row]; j < ptr[row + 1]; j++)
+            {
+                const int block_column = cols[j] / block_cols;
+
+                if (last_block_row[block_column] != block_row)
+                {
+                    last_block_row[block_column] = block_row;
+                    block_index[block_column] = current_block;
+                    (*block_col)[current_block] = block_column;
+                    current_block++;
+                }
+
+                (*block_data)[(size_t)block_index[block_column] * block_size + (row % block_rows) * block_cols + cols[j] % block_cols] += data[j];
+            }
+        }
+
+        (*block_ptr)[block_row + 1] = current_block;
+    }
+
+    free(block_index);
+    free(last_block_row);
+}
+
+/*!
+ * \brief Converts CSR into ELL with rows stored one after another, row_size is the length of the longest row and padding has value 0 and column 0.
+ */
+void create_ell(cl_int *ptr, cl_int *cols, cl_double *data, int number_of_rows, int *row_size, cl_int **ell_cols, cl_double **ell_data)
+{
+    int i;
+
+    *row_size = 0;
+
+    for (i = 0; i < number_of_rows; i++)
+    {
+        *row_size = ptr[i + 1] - ptr[i] > *row_size ? ptr[i + 1] - ptr[i] : *row_size;
+    }
+
+    *ell_cols = (cl_int *)calloc((size_t)*row_size * number_of_rows, sizeof(cl_int));
+    *ell_data = (cl_double *)calloc((size_t)*row_size * number_of_rows, sizeof(cl_double));
+
+    for (i = 0; i < number_of_rows; i++)
+    {
+        memcpy(&(*ell_cols)[(size_t)i * *row_size], &cols[ptr[i]], (ptr[i + 1] - ptr[i]) * sizeof(cl_int));
+        memcpy(&(*ell_data)[(size_t)i * *row_size], &data[ptr[i]], (ptr[i + 1] - ptr[i]) * sizeof(cl_double));
+    }
+}
+
+/*!
+ * \brief Converts CSR into HYB: the first width elements of every row go to ELL (padded like create_ell), the rest to COO
+ *        sorted by row. Returns the number of COO entries.
+ */
+int create_hyb(cl_int *ptr, cl_int *cols, cl_double *data, int number_of_rows, int width, cl_int **ell_cols, cl_double **ell_data,
+               cl_int **coo_rows, cl_int **coo_cols, cl_double **coo_data)
+{
+    int number_of_coo_entries = 0;
+    int i;
+
+    for (i = 0; i < number_of_rows; i++)
+    {
+        number_of_coo_entries += ptr[i + 1] - ptr[i] > width ? ptr[i + 1] - ptr[i] - width : 0;
+    }
+
+    *ell_cols = (cl_int *)calloc((size_t)width * number_of_rows, sizeof(cl_int));
+    *ell_data = (cl_double *)calloc((size_t)width * number_of_rows, sizeof(cl_double));
+    *coo_rows = (cl_int *)malloc(number_of_coo_entries * sizeof(cl_int));
+    *coo_cols = (cl_int *)malloc(number_of_coo_entries * sizeof(cl_int));
+    *coo_data = (cl_double *)malloc(number_of_coo_entries * sizeof(cl_double));
+
+    int current_entry = 0;
+
+    for (i = 0; i < number_of_rows; i++)
+    {
+        const int row_length = ptr[i + 1] - ptr[i];
+        const int ell_length = row_length < width ? row_length : width;
+        int j;
+
+        memcpy(&(*ell_cols)[(size_t)i * width], &cols[ptr[i]], ell_length * sizeof(cl_int));
+        memcpy(&(*ell_data)[(size_t)i * width], &data[ptr[i]], ell_length * sizeof(cl_double));
+
+        for (j = ptr[i] + ell_length; j < ptr[i + 1]; j++)
+        {
+            (*coo_rows)[current_entry] = i;
+            (*coo_cols)[current_entry] = cols[j];
+            (*coo_data)[current_entry] = data[j];
+            current_entry++;
+        }
+    }
+
+    return number_of_coo_entries;
+}
+
+/*!
+ * \brief Converts CSR into SELL-C (no sorting of rows), element j of row r of slice s is stored at row_indices[s] + j * C + r.
+ *
+ * Padding has value 0 and repeats the last column of its row (the previous row for empty rows, the first column of the
+ * slice for leading empty rows), so it does not widen the column range of the slice.
+ */
+void create_sell(cl_int *ptr, cl_int *cols, cl_double *data, int number_of_rows, int C, int *number_of_slices, cl_int **row_indices, cl_int **sell_cols, cl_double **sell_data)
+{
+    int slice;
+
+    *number_of_slices = (number_of_rows + C - 1) / C;
+    *row_indices = (cl_int *)malloc((*number_of_slices + 1) * sizeof(cl_int));
+    (*row_indices)[0] = 0;
+
+    for (slice = 0; slice < *number_of_slices; slice++)
+    {
+        int longest_row = 0;
+        int row;
+
+        for (row = slice * C; row < (slice + 1) * C && row < number_of_rows; row++)
+        {
+            longest_row = ptr[row + 1] - ptr[row] > longest_row ? ptr[row + 1] - ptr[row] : longest_row;
+        }
+
+        (*row_indices)[slice + 1] = (*row_indices)[slice] + longest_row * C;
+    }
+
+    *sell_cols = (cl_int *)calloc((*row_indices)[*number_of_slices], sizeof(cl_int));
+    *sell_data = (cl_double *)calloc((*row_indices)[*number_of_slices], sizeof(cl_double));
+
+    for (slice = 0; slice < *number_of_slices; slice++)
+    {
+        const int slice_width = ((*row_indices)[slice + 1] - (*row_indices)[slice]) / C;
+        int padding_col = 0;
+        int r;
+
+        for (r = slice * C; r < (slice + 1) * C && r < number_of_rows; r++)
+        {
+            if (ptr[r + 1] > ptr[r])
+            {
+                padding_col = cols[ptr[r]];
+                break;
+            }
+        }
+
+        for (r = 0; r < C; r++)
+        {
+            const int row = slice * C + r;
+            const int row_length = row < number_of_rows ? ptr[row + 1] - ptr[row] : 0;
+            int j;
+
+            for (j = 0; j < slice_width; j++)
+            {
+                const int index = (*row_indices)[slice] + j * C + r;
+
+                if (j < row_length)
+                {
+                    (*sell_cols)[index] = cols[ptr[row] + j];
+                    (*sell_data)[index] = data[ptr[row] + j];
+                    padding_col = cols[ptr[row] + j];
+                }
+                else
+                {
+                    (*sell_cols)[index] = padding_col;
+                }
+            }
+        }
+    }
+}
+
+/*!
+ * \brief Converts CSR into CMRS with strips of height rows, elements keep the CSR order so they are sorted by row within a strip.
+ */
+void create_cmrs(cl_int *ptr, int number_of_rows, int height, int *number_of_strips, cl_int **strip_ptr, cl_int **row_in_strip)
+{
+    int strip;
+    int row;
+
+    *number_of_strips = (number_of_rows + height - 1) / height;
+    *strip_ptr = (cl_int *)malloc((*number_of_strips + 1) * sizeof(cl_int));
+    *row_in_strip = (cl_int *)malloc(ptr[number_of_rows] * sizeof(cl_int));
+
+    for (strip = 0; strip <= *number_of_strips; strip++)
+    {
+        (*strip_ptr)[strip] = ptr[strip * height < number_of_rows ? strip * height : number_of_rows];
+    }
+
+    for (row = 0; row < number_of_rows; row++)
+    {
+        int j;
+
+        for (j = ptr[row]; j < ptr[row + 1]; j++)
+        {
+            (*row_in_strip)[j] = row % height;
+        }
+    }
+}
+
+/*!
+ * \brief Splits CSR into panels of panel_width columns stored one after another. A panel keeps only its non-empty rows:
+ *        segment s is the part of row segment_rows[s] with elements segment_ptr[s] to segment_ptr[s + 1] - 1, and panel p
+ *        holds segments panel_ptr[p] to panel_ptr[p + 1] - 1 in row order.
+ */
+void create_column_panels(cl_int *ptr, cl_int *cols, cl_double *data, int number_of_rows, int number_of_columns, int panel_width, int *number_of_panels,
+                          cl_int **panel_ptr, int *number_of_segments, cl_int **segment_rows, cl_int **segment_ptr, cl_int **panel_cols, cl_double **panel_data)
+{
+    const int number_of_nonzeroes = ptr[number_of_rows];
+    int panel;
+    int row;
+
+    *number_of_panels = (number_of_columns + panel_width - 1) / panel_width;
+
+    cl_int *last_row = (cl_int *)malloc(*number_of_panels * sizeof(cl_int));
+    cl_int *next_segment = (cl_int *)calloc(*number_of_panels + 1, sizeof(cl_int));
+    cl_int *next_element = (cl_int *)calloc(*number_of_panels + 1, sizeof(cl_int));
+
+    for (panel = 0; panel < *number_of_panels; panel++)
+    {
+        last_row[panel] = -1;
+    }
+
+    /* segments and elements per panel, then their first positions */
+    for (row = 0; row < number_of_rows; row++)
+    {
+        int j;
+
+        for (j = ptr[row]; j < ptr[row + 1]; j++)
+        {
+            panel = cols[j] / panel_width;
+
+            if (last_row[panel] != row)
+            {
+                last_row[panel] = row;
+                next_segment[panel + 1]++;
+            }
+
+            next_element[panel + 1]++;
+        }
+    }
+
+    for (panel = 0; panel < *number_of_panels; panel++)
+    {
+        next_segment[panel + 1] += next_segment[panel];
+        next_element[panel + 1] += next_element[panel];
+        last_row[panel] = -1;
+    }
+
+    *number_of_segments = next_segment[*number_of_panels];
+    *panel_ptr = (cl_int *)malloc((*number_of_panels + 1) * sizeof(cl_int));
+    *segment_rows = (cl_int *)malloc(*number_of_segments * sizeof(cl_int));
+    *segment_ptr = (cl_int *)malloc((*number_of_segments + 1) * sizeof(cl_int));
+    *panel_cols = (cl_int *)malloc(number_of_nonzeroes * sizeof(cl_int));
+    *panel_data = (cl_double *)malloc(number_of_nonzeroes * sizeof(cl_double));
+
+    memcpy(*panel_ptr, next_segment, (*number_of_panels + 1) * sizeof(cl_int));
+    (*segment_ptr)[*number_of_segments] = number_of_nonzeroes;
+
+    for (row = 0; row < number_of_rows; row++)
+    {
+        int j;
+
+        for (j = ptr[row]; j < ptr[row + 1]; j++)
+        {
+            panel = cols[j] / panel_width;
+
+            if (last_row[panel] != row)
+            {
+                last_row[panel] = row;
+                (*segment_rows)[next_segment[panel]] = row;
+                (*segment_ptr)[next_segment[panel]] = next_element[panel];
+                next_segment[panel]++;
+            }
+
+            (*panel_cols)[next_element[panel]] = cols[j];
+            (*panel_data)[next_element[panel]] = data[j];
+            next_element[panel]++;
+        }
+    }
+
+    free(last_row);
+    free(next_segment);
+    free(next_element);
+}
+
+/*!
+ * \brief Stores the columns of every segment (a row, slice or strip between two segment_ptr entries) as 16-bit offsets from the smallest column of the segment.
+ *
+ * A segment spanning more than USHRT_MAX columns is escaped: its columns are kept in escaped_cols and its base is
+ * -1 - (position of its first column in escaped_cols), which load_column in kernels/Indices.h decodes.
+ * Returns the number of escaped columns.
+ */
+int compress_column_indices(const cl_int *segment_ptr, int number_of_segments, const cl_int *cols, cl_ushort **deltas, cl_int **bases, cl_int **escaped_cols)
+{
+    int number_of_escaped = 0;
+    int i;
+
+    *deltas = (cl_ushort *)calloc(segment_ptr[number_of_segments], sizeof(cl_ushort));
+    *bases  = (cl_int *)malloc(number_of_segments * sizeof(cl_int));
+
+    for (i = 0; i < number_of_segments; i++)
+    {
+        int min_col = INT_MAX;
+        int max_col = 0;
+        int j;
+
+        for (j = segment_ptr[i]; j < segment_ptr[i + 1]; j++)
+        {
+            min_col = cols[j] < min_col ? cols[j] : min_col;
+            max_col = cols[j] > max_col ? cols[j] : max_col;
+        }
+
+        if (min_col == INT_MAX)
+        {
+            (*bases)[i] = 0;
+        }
+        else if (max_col - min_col > USHRT_MAX)
+        {
+            (*bases)[i] = -1 - number_of_escaped;
+            number_of_escaped += segment_ptr[i + 1] - segment_ptr[i];
+        }
+        else
+        {
+            (*bases)[i] = min_col;
+
+            for (j = segment_ptr[i]; j < segment_ptr[i + 1]; j++)
+            {
+                (*deltas)[j] = (cl_ushort)(cols[j] - min_col);
+            }
+        }
+    }
+
+    /* never empty, so that it can always be passed as a buffer */
+    *escaped_cols = (cl_int *)malloc((number_of_escaped > 0 ? number_of_escaped : 1) * sizeof(cl_int));
+
+    for (i = 0; i < number_of_segments; i++)
+    {
+        if ((*bases)[i] < 0)
+        {
+            memcpy(&(*escaped_cols)[-1 - (*bases)[i]], &cols[segment_ptr[i]], (segment_ptr[i + 1] - segment_ptr[i]) * sizeof(cl_int));
+        }
+    }
+
+    return number_of_escaped;
+}
+
+/*!
+ * \brief Prints the bytes moved per nonzero for values and column indices with 32-bit columns and with 16-bit offsets.
+ *
+ * Padding (SELL) is included in number_of_elements, row or slice pointers are the same for both and are left out.
+ */
+void print_index_compression(long number_of_elements, int number_of_nonzeroes, int number_of_segments, int number_of_escaped, size_t value_size)
+{
+    const double plain_bytes = (double)number_of_elements * (value_size + sizeof(cl_int));
+    const double compressed_bytes = (double)number_of_elements * (value_size + sizeof(cl_ushort)) + ((double)number_of_segments + number_of_escaped) * sizeof(cl_int);
+
+    printf("bytes per nonzero: 32-bit columns %.2lf, 16-bit offsets %.2lf (%d of %ld columns escaped)\n",
+           plain_bytes / number_of_nonzeroes, compressed_bytes / number_of_nonzeroes, number_of_escaped, number_of_elements);
+}
+
+/*!
+ * \brief Returns the column indices of a padded format (ELL, SELL) of a pattern matrix with padding marked by -1.
+ *
+ * Every entry of a pattern matrix is 1, so the elements with value 0 are exactly the padding.
+ */
+cl_int* create_pattern_indices(const cl_int *cols, const cl_double *data, long number_of_elements)
+{
+    cl_int *pattern_cols = (cl_int *)malloc(number_of_elements * sizeof(cl_int));
+    long i;
+
+    for (i = 0; i < number_of_elements; i++)
+    {
+        pattern_cols[i] = data[i] == 0 ? -1 : cols[i];
+    }
+
+    return pattern_cols;
+}
+
+/*!
+ * \brief Prints the bytes moved per nonzero for values and column indices with explicit values and with columns only.
+ */
+void print_pattern_savings(long number_of_elements, int number_of_nonzeroes, size_t value_size)
+{
+    const double explicit_bytes = (double)number_of_elements * (value_size + sizeof(cl_int));
+    const double pattern_bytes = (double)number_of_elements * sizeof(cl_int);
+
+    printf("bytes per nonzero: explicit values %.2lf, pattern %.2lf (%.1lf%% less)\n",
+           explicit_bytes / number_of_nonzeroes, pattern_bytes / number_of_nonzeroes, 100 * (explicit_bytes - pattern_bytes) / explicit_bytes);
+}
+
+int compare_doubles(const void *a, const void *b)
+{
+    const double x = *(const double *)a;
+    const double y = *(const double *)b;
+
+    return (x > y) - (x < y);
+}
+
+/*!
+ * \brief Replaces the values by 8-bit (up to 256 distinct values) or 16-bit codes into a sorted table of the distinct values.
+ *
+ * Returns the number of distinct values, or 0 without allocating anything when there are more than max_dictionary_size
+ * of them, more than 16-bit codes can address, or the codes and the table would not be smaller than values of value_size
+ * bytes. codes are cl_uchar or cl_ushort as told by code_size.
+ */
+int create_value_dictionary(const cl_double *data, long number_of_elements, int max_dictionary_size, size_t value_size, cl_double **dictionary, void **codes, size_t *code_size)
+{
+    cl_double *sorted = (cl_double *)malloc(number_of_elements * sizeof(cl_double));
+    int number_of_values = 0;
+    long i;
+
+    memcpy(sorted, data, number_of_elements * sizeof(cl_double));
+    qsort(sorted, number_of_elements, sizeof(cl_double), compare_doubles);
+
+    for (i = 0; i < number_of_elements; i++)
+    {
+        if (i == 0 || sorted[i] != sorted[number_of_values - 1])
+        {
+            if (number_of_values == max_dictionary_size || number_of_values == USHRT_MAX + 1)
+            {
+                free(sorted);
+                return 0;
+            }
+
+            sorted[number_of_values++] = sorted[i];
+        }
+    }
+
+    *code_size = number_of_values <= UCHAR_MAX + 1 ? sizeof(cl_uchar) : sizeof(cl_ushort);
+
+    if ((double)number_of_elements * *code_size + (double)number_of_values * sizeof(cl_double) >= (double)number_of_elements * value_size)
+    {
+        free(sorted);
+        return 0;
+    }
+
+    *dictionary = (cl_double *)realloc(sorted, number_of_values * sizeof(cl_double));
+    *codes = malloc(number_of_elements * *code_size);
+
+    for (i = 0; i < number_of_elements; i++)
+    {
+        const cl_double *entry = (const cl_double *)bsearch(&data[i], *dictionary, number_of_values, sizeof(cl_double), compare_doubles);
+        const long code = entry - *dictionary;
+
+        if (*code_size == sizeof(cl_uchar))
+        {
+            ((cl_uchar *)*codes)[i] = code;
+        }
+        else
+        {
+            ((cl_ushort *)*codes)[i] = code;
+        }
+    }
+
+    return number_of_values;
+}
+
+/*!
+ * \brief Prints the bytes moved per nonzero for values and column indices with explicit values and with dictionary codes.
+ *
+ * The dictionary itself is counted once, it stays in constant memory for the whole kernel.
+ */
+void print_value_dictionary(long number_of_elements, int number_of_nonzeroes, int number_of_values, size_t code_size, size_t value_size)
+{
+    const double explicit_bytes = (double)number_of_elements * (value_size + sizeof(cl_int));
+    const double dictionary_bytes = (double)number_of_elements * (code_size + sizeof(cl_int)) + (double)number_of_values * sizeof(cl_double);
+
+    printf("%d distinct values, %d-bit codes\n", number_of_values, (int)code_size * 8);
+    printf("bytes per nonzero: explicit values %.2lf, dictionary %.2lf (%.1lf%% less)\n",
+           explicit_bytes / number_of_nonzeroes, dictionary_bytes / number_of_nonzeroes, 100 * (explicit_bytes - dictionary_bytes) / explicit_bytes);
+}
+
+#endif /* _FORMATS_H */
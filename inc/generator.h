@@ -0,0 +1,653 @@
+#ifndef _GENERATOR_H
+#define _GENERATOR_H
+
+#define CL_TARGET_OPENCL_VERSION 300
+#include <CL/cl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <limits.h>
+#include <math.h>
+#include <omp.h>
+
+#include "formats.h"
+
+#define NUMBER_OF_GENERATORS 6
+#define DEFAULT_GENERATOR_SEED 1
+
+/* R-MAT quadrant probabilities of Graph500 (a, b, c, d) = (0.57, 0.19, 0.19, 0.05) as the chance of a row bit of 1,
+   c + d, and of a column bit of 1 after a row bit of 0, b / (a + b), or 1, d / (c + d), the last two in 1/65536 */
+#define RMAT_ROW_BIT 0.24
+#define RMAT_COLUMN_BIT_AFTER_0 16384
+#define RMAT_COLUMN_BIT_AFTER_1 13653
+#define POISSON_INVERSION_LIMIT 30.0
+
+/*
+ * Synthetic matrices built straight into CSR, so benchmarks do not depend on files and scale to any size. A matrix is
+ * named by a spec:
+ *
+ *   stencil2d:N                  5-point Laplacian on an N x N grid
+ *   stencil3d:N                  7-point Laplacian on an N x N x N grid
+ *   banded:ROWS:HALF_WIDTH       every diagonal up to HALF_WIDTH away from the main one
+ *   fem2d:N:B                    N x N mesh nodes coupled to their 8 neighbours, B unknowns per node (dense B x B blocks)
+ *   random:ROWS:PER_ROW[:SEED]   PER_ROW uniformly spread columns in every row
+ *   rmat:SCALE:EDGES[:SEED]      R-MAT power-law graph with 2^SCALE vertices and about EDGES edges per vertex
+ *
+ * All of them are square. Every row can work out its length on its own, so ptr is a parallel prefix sum of the lengths
+ * and the rows are then filled independently, without atomics or a global sort. Random numbers come from a
+ * counter-based hash of the seed and the row, so a matrix is the same for any number of threads.
+ */
+
+const char *generator_names[NUMBER_OF_GENERATORS] = { "stencil2d", "stencil3d", "banded", "fem2d", "random", "rmat" };
+
+/*!
+ * \brief SplitMix64 finaliser, a good hash of a 64-bit counter.
+ */
+unsigned long long mix_bits(unsigned long long x)
+{
+    x += 0x9e3779b97f4a7c15ULL;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+
+    return x ^ (x >> 31);
+}
+
+int compare_ints(const void *a, const void *b)
+{
+    const int x = *(const int*)a;
+    const int y = *(const int*)b;
+
+    return (x > y) - (x < y);
+}
+
+/*!
+ * \brief Turns ptr[i + 1] = length of row i into row offsets on all threads. Returns the number of nonzeroes, or -1
+ *        (leaving ptr undefined) when it does not fit into cl_int.
+ */
+long long prefix_sum_row_lengths(cl_int *ptr, int number_of_rows)
+{
+    long long *partial = (long long*)calloc(omp_get_max_threads() + 1, sizeof(long long));
+    long long total = 0;
+
+    ptr[0] = 0;
+
+    #pragma omp parallel shared(ptr, number_of_rows, partial, total)
+    {
+        const int thread = omp_get_thread_num();
+        const int number_of_threads = omp_get_num_threads();
+        const int first = (long long)number_of_rows * thread / number_of_threads;
+        const int last = (long long)number_of_rows * (thread + 1) / number_of_threads;
+        long long sum = 0;
+        int i;
+
+        for (i = first; i < last; ++i)
+        {
+            sum += ptr[i + 1];
+            ptr[i + 1] = sum > INT_MAX ? INT_MAX : sum;
+        }
+
+        partial[thread + 1] = sum;
+
+        #pragma omp barrier
+        #pragma omp single
+        {
+            int t;
+
+            for (t = 1; t <= number_of_threads; ++t)
+            {
+                partial[t] += partial[t - 1];
+            }
+
+            total = partial[number_of_threads];
+        }
+
+        if (total <= INT_MAX)
+        {
+            for (i = first; i < last; ++i)
+            {
+                ptr[i + 1] += partial[thread];
+            }
+        }
+    }
+
+    free(partial);
+
+    if (total > INT_MAX)
+    {
+        printf("%lld nonzeroes do not fit into 32-bit indices\n", total);
+        return -1;
+    }
+
+    return total;
+}
+
+/*!
+ * \brief Allocates cols and data for ptr[number_of_rows] elements.
+ */
+void allocate_generated_matrix(const cl_int *ptr, int number_of_rows, cl_int **cols, cl_double **data)
+{
+    *cols = (cl_int*)malloc(sizeof(cl_int) * ptr[number_of_rows]);
+    *data = (cl_double*)malloc(sizeof(cl_double) * ptr[number_of_rows]);
+}
+
+/*!
+ * \brief Laplacian on a grid of nx x ny x nz points (nz = 1 for 2D): 2 * dimensions on the diagonal, -1 for every neighbour.
+ */
+bool generate_stencil(int nx, int ny, int nz, cl_int **ptr, cl_int **cols, cl_double **data)
+{
+    const int number_of_rows = nx * ny * nz;
+    const double diagonal = nz > 1 ? 6.0 : 4.0;
+    int i;
+
+    *ptr = (cl_int*)malloc(sizeof(cl_int) * (number_of_rows + 1));
+
+    #pragma omp parallel for schedule(static)
+    for (i = 0; i < number_of_rows; ++i)
+    {
+        const int x = i % nx;
+        const int y = i / nx % ny;
+        const int z = i / nx / ny;
+
+        (*ptr)[i + 1] = 1 + (x > 0) + (x < nx - 1) + (y > 0) + (y < ny - 1) + (z > 0) + (z < nz - 1);
+    }
+
+    if (prefix_sum_row_lengths(*ptr, number_of_rows) < 0)
+    {
+        free(*ptr);
+        return false;
+    }
+
+    allocate_generated_matrix(*ptr, number_of_rows, cols, data);
+
+    #pragma omp parallel for schedule(static)
+    for (i = 0; i < number_of_rows; ++i)
+    {
+        const int x = i % nx;
+        const int y = i / nx % ny;
+        const int z = i / nx / ny;
+        const int plane = nx * ny;
+        int j = (*ptr)[i];
+
+        /* columns in increasing order: below, up, left, centre, right, down, above */
+        if (z > 0)
+        {
+            (*cols)[j] = i - plane;
+            (*data)[j++] = -1.0;
+        }
+
+        if (y > 0)
+        {
+            (*cols)[j] = i - nx;
+            (*data)[j++] = -1.0;
+        }
+
+        if (x > 0)
+        {
+            (*cols)[j] = i - 1;
+            (*data)[j++] = -1.0;
+        }
+
+        (*cols)[j] = i;
+        (*data)[j++] = diagonal;
+
+        if (x < nx - 1)
+        {
+            (*cols)[j] = i + 1;
+            (*data)[j++] = -1.0;
+        }
+
+        if (y < ny - 1)
+        {
+            (*cols)[j] = i + nx;
+            (*data)[j++] = -1.0;
+        }
+
+        if (z < nz - 1)
+        {
+            (*cols)[j] = i + plane;
+            (*data)[j++] = -1.0;
+        }
+    }
+
+    return true;
+}
+
+bool generate_banded(int number_of_rows, int half_width, cl_int **ptr, cl_int **cols, cl_double **data)
+{
+    int i;
+
+    *ptr = (cl_int*)malloc(sizeof(cl_int) * (number_of_rows + 1));
+
+    #pragma omp parallel for schedule(static)
+    for (i = 0; i < number_of_rows; ++i)
+    {
+        const int first = i - half_width > 0 ? i - half_width : 0;
+        const int last = i < number_of_rows - 1 - half_width ? i + half_width : number_of_rows - 1;
+
+        (*ptr)[i + 1] = last - first + 1;
+    }
+
+    if (prefix_sum_row_lengths(*ptr, number_of_rows) < 0)
+    {
+        free(*ptr);
+        return false;
+    }
+
+    allocate_generated_matrix(*ptr, number_of_rows, cols, data);
+
+    #pragma omp parallel for schedule(static)
+    for (i = 0; i < number_of_rows; ++i)
+    {
+        const int first = i - half_width > 0 ? i - half_width : 0;
+        int j;
+
+        for (j = (*ptr)[i]; j < (*ptr)[i + 1]; ++j)
+        {
+            const int col = first + j - (*ptr)[i];
+
+            (*cols)[j] = col;
+            (*data)[j] = col == i ? 2.0 * half_width + 1 : -1.0;
+        }
+    }
+
+    return true;
+}
+
+/*!
+ * \brief Node (x, y) of an n x n mesh is coupled to itself and its (up to 8) neighbours, every coupling is a dense
+ *        block_size x block_size block, as in bilinear elements with block_size unknowns per node.
+ */
+bool generate_fem_2d(int n, int block_size, cl_int **ptr, cl_int **cols, cl_double **data)
+{
+    const int number_of_rows = n * n * block_size;
+    int i;
+
+    *ptr = (cl_int*)malloc(sizeof(cl_int) * (number_of_rows + 1));
+
+    #pragma omp parallel for schedule(static)
+    for (i = 0; i < number_of_rows; ++i)
+    {
+        const int x = i / block_size % n;
+        const int y = i / block_size / n;
+
+        (*ptr)[i + 1] = (1 + (x > 0) + (x < n - 1)) * (1 + (y > 0) + (y < n - 1)) * block_size;
+    }
+
+    if (prefix_sum_row_lengths(*ptr, number_of_rows) < 0)
+    {
+        free(*ptr);
+        return false;
+    }
+
+    allocate_generated_matrix(*ptr, number_of_rows, cols, data);
+
+    #pragma omp parallel for schedule(static)
+    for (i = 0; i < number_of_rows; ++i)
+    {
+        const int node = i / block_size;
+        const int x = node % n;
+        const int y = node / n;
+        int j = (*ptr)[i];
+        int dx;
+        int dy;
+        int b;
+
+        /* neighbours row by row, so the columns increase */
+        for (dy = -1; dy <= 1; ++dy)
+        {
+            for (dx = -1; dx <= 1; ++dx)
+            {
+                if (x + dx < 0 || x + dx >= n || y + dy < 0 || y + dy >= n)
+                {
+                    continue;
+                }
+
+                for (b = 0; b < block_size; ++b)
+                {
+                    (*cols)[j] = (node + dy * n + dx) * block_size + b;
+                    (*data)[j] = (*cols)[j] == i ? (*ptr)[i + 1] - (*ptr)[i] : -1.0;
+                    ++j;
+                }
+            }
+        }
+    }
+
+    return true;
+}
+
+/*!
+ * \brief Row i gets one column drawn uniformly from each of per_row equal ranges of the columns, so the columns are
+ *        distinct and sorted without a sort, and values uniform in [0.5, 1.5).
+ */
+bool generate_random(int number_of_rows, int per_row, unsigned long long seed, cl_int **ptr, cl_int **cols, cl_double **data)
+{
+    int i;
+
+    per_row = per_row < number_of_rows ? per_row : number_of_rows;
+    *ptr = (cl_int*)malloc(sizeof(cl_int) * (number_of_rows + 1));
+
+    #pragma omp parallel for schedule(static)
+    for (i = 0; i < number_of_rows; ++i)
+    {
+        (*ptr)[i + 1] = per_row;
+    }
+
+    if (prefix_sum_row_lengths(*ptr, number_of_rows) < 0)
+    {
+        free(*ptr);
+        return false;
+    }
+
+    allocate_generated_matrix(*ptr, number_of_rows, cols, data);
+
+    #pragma omp parallel for schedule(static)
+    for (i = 0; i < number_of_rows; ++i)
+    {
+        unsigned long long state = mix_bits(seed ^ mix_bits(i));
+        int k;
+
+        for (k = 0; k < per_row; ++k)
+        {
+            const long long first = (long long)number_of_rows * k / per_row;
+            const long long width = (long long)number_of_rows * (k + 1) / per_row - first;
+            const unsigned long long bits = mix_bits(state++);
+
+            (*cols)[(*ptr)[i] + k] = first + (bits >> 32) % width;
+            (*data)[(*ptr)[i] + k] = 0.5 + (double)(bits & 0xffffffffULL) / 4294967296.0;
+        }
+    }
+
+    return true;
+}
+
+/*!
+ * \brief Uniform in (0, 1], the next number of the stream state.
+ */
+double get_uniform(unsigned long long *state)
+{
+    return (double)((mix_bits((*state)++) >> 11) + 1) / 9007199254740992.0;
+}
+
+/*!
+ * \brief Poisson number with the given mean, by inversion for small means and from the normal approximation for large ones.
+ */
+int get_poisson(double mean, unsigned long long *state)
+{
+    if (mean < POISSON_INVERSION_LIMIT)
+    {
+        const double u = get_uniform(state);
+        double p = exp(-mean);
+        double cdf = p;
+        int k = 0;
+
+        while (u > cdf && p > 0)
+        {
+            ++k;
+            p *= mean / k;
+            cdf += p;
+        }
+
+        return k;
+    }
+
+    const double z = sqrt(-2 * log(get_uniform(state))) * cos(2 * M_PI * get_uniform(state));
+    const double k = floor(mean + sqrt(mean) * z + 0.5);
+
+    return k < 0 ? 0 : (k > INT_MAX ? INT_MAX : (int)k);
+}
+
+/*!
+ * \brief Sorts short arrays by insertion and long ones with qsort.
+ */
+void sort_ints(cl_int *values, int number_of_values)
+{
+    int i;
+
+    if (number_of_values > 32)
+    {
+        qsort(values, number_of_values, sizeof(cl_int), compare_ints);
+        return;
+    }
+
+    for (i = 1; i < number_of_values; ++i)
+    {
+        const cl_int value = values[i];
+        int j;
+
+        for (j = i; j > 0 && values[j - 1] > value; --j)
+        {
+            values[j] = values[j - 1];
+        }
+
+        values[j] = value;
+    }
+}
+
+/*!
+ * \brief Number of R-MAT edges of row, a Poisson number with the row's share of the edges, edge_factor * 2^scale *
+ *        0.76^zeroes * 0.24^ones of its bits. state is left at the start of the row's columns.
+ */
+int get_rmat_row_length(int scale, int edge_factor, unsigned long long seed, int row, unsigned long long *state)
+{
+    const int ones = __builtin_popcount(row);
+    const double mean = (double)edge_factor * ldexp(1.0, scale) * pow(1 - RMAT_ROW_BIT, scale - ones) * pow(RMAT_ROW_BIT, ones);
+
+    *state = mix_bits(seed ^ mix_bits(row));
+
+    return get_poisson(mean, state);
+}
+
+/*!
+ * \brief Draws the sorted columns of the length edges of row, 16 random bits per level.
+ */
+void draw_rmat_columns(int scale, int row, int length, unsigned long long state, cl_int *columns)
+{
+    unsigned int thresholds[32];
+    int level;
+    int k;
+
+    for (level = 0; level < scale; ++level)
+    {
+        thresholds[level] = (row >> (scale - 1 - level) & 1) ? RMAT_COLUMN_BIT_AFTER_1 : RMAT_COLUMN_BIT_AFTER_0;
+    }
+
+    for (k = 0; k < length; ++k)
+    {
+        unsigned long long bits = 0;
+        int col = 0;
+
+        for (level = 0; level < scale; ++level)
+        {
+            if (level % 4 == 0)
+            {
+                bits = mix_bits(state++);
+            }
+
+            col = col << 1 | ((bits & 0xffff) < thresholds[level]);
+            bits >>= 16;
+        }
+
+        columns[k] = col;
+    }
+
+    sort_ints(columns, length);
+}
+
+/*!
+ * \brief R-MAT matrix with 2^scale rows and about edge_factor * 2^scale edges.
+ *
+ * In R-MAT every level picks a quadrant, and the column bit only depends on the row bit of the same level, so a row can
+ * draw its own columns instead of waiting for the edges that happen to land in it: the rows draw their lengths, then
+ * their columns into one edge array at the offsets of the lengths, and the distinct columns are compacted into the result
+ * (a value is the number of duplicates merged into it). Rows are independent Poisson numbers rather than one multinomial
+ * over all edges, so the total only matches on average. Power-law rows are very uneven, so the schedule is dynamic.
+ */
+bool generate_rmat(int scale, int edge_factor, unsigned long long seed, cl_int **ptr, cl_int **cols, cl_double **data)
+{
+    const int number_of_rows = 1 << scale;
+    cl_int *edge_ptr = (cl_int*)malloc(sizeof(cl_int) * (number_of_rows + 1));
+    int i;
+
+    #pragma omp parallel for schedule(static)
+    for (i = 0; i < number_of_rows; ++i)
+    {
+        unsigned long long state;
+
+        edge_ptr[i + 1] = get_rmat_row_length(scale, edge_factor, seed, i, &state);
+    }
+
+    if (prefix_sum_row_lengths(edge_ptr, number_of_rows) < 0)
+    {
+        free(edge_ptr);
+        return false;
+    }
+
+    cl_int *edge_cols = (cl_int*)malloc(sizeof(cl_int) * edge_ptr[number_of_rows]);
+
+    *ptr = (cl_int*)malloc(sizeof(cl_int) * (number_of_rows + 1));
+
+    #pragma omp parallel for schedule(dynamic, 256)
+    for (i = 0; i < number_of_rows; ++i)
+    {
+        unsigned long long state;
+        const int length = get_rmat_row_length(scale, edge_factor, seed, i, &state);
+        cl_int *columns = edge_cols + edge_ptr[i];
+        int distinct = 0;
+        int j;
+
+        draw_rmat_columns(scale, i, length, state, columns);
+
+        for (j = 0; j < length; ++j)
+        {
+            distinct += j == 0 || columns[j] != columns[j - 1];
+        }
+
+        (*ptr)[i + 1] = distinct;
+    }
+
+    prefix_sum_row_lengths(*ptr, number_of_rows);
+    allocate_generated_matrix(*ptr, number_of_rows, cols, data);
+
+    #pragma omp parallel for schedule(dynamic, 256)
+    for (i = 0; i < number_of_rows; ++i)
+    {
+        int k = (*ptr)[i] - 1;
+        int j;
+
+        for (j = edge_ptr[i]; j < edge_ptr[i + 1]; ++j)
+        {
+            if (j == edge_ptr[i] || edge_cols[j] != edge_cols[j - 1])
+            {
+                (*cols)[++k] = edge_cols[j];
+                (*data)[k] = 0.0;
+            }
+
+            (*data)[k] += 1.0;
+        }
+    }
+
+    free(edge_ptr);
+    free(edge_cols);
+
+    return true;
+}
+
+/*!
+ * \brief Whether the spec names a generator rather than a file.
+ */
+bool is_generator_spec(const char *spec)
+{
+    int g;
+
+    for (g = 0; g < NUMBER_OF_GENERATORS; ++g)
+    {
+        const size_t length = strlen(generator_names[g]);
+
+        if (strncmp(spec, generator_names[g], length) == 0 && spec[length] == ':')
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/*!
+ * \brief Builds the matrix named by spec, prints an error and returns false when the spec is wrong or the matrix
+ *        does not fit into 32-bit indices.
+ */
+bool generate_matrix(const char *spec, int *number_of_rows, int *number_of_columns, int *number_of_nonzeroes, cl_int **ptr, cl_int **cols, cl_double **data)
+{
+    unsigned long long seed = DEFAULT_GENERATOR_SEED;
+    int n;
+    int m;
+    bool generated;
+
+    if (sscanf(spec, "stencil2d:%d", &n) == 1 && n > 0 && (long long)n * n < INT_MAX)
+    {
+        *number_of_rows = n * n;
+        generated = generate_stencil(n, n, 1, ptr, cols, data);
+    }
+    else if (sscanf(spec, "stencil3d:%d", &n) == 1 && n > 0 && (long long)n * n * n < INT_MAX)
+    {
+        *number_of_rows = n * n * n;
+        generated = generate_stencil(n, n, n, ptr, cols, data);
+    }
+    else if (sscanf(spec, "banded:%d:%d", &n, &m) == 2 && n > 0 && m >= 0 && n < INT_MAX)
+    {
+        *number_of_rows = n;
+        generated = generate_banded(n, m, ptr, cols, data);
+    }
+    else if (sscanf(spec, "fem2d:%d:%d", &n, &m) == 2 && n > 0 && m > 0 && (long long)n * n * m < INT_MAX)
+    {
+        *number_of_rows = n * n * m;
+        generated = generate_fem_2d(n, m, ptr, cols, data);
+    }
+    else if (sscanf(spec, "random:%d:%d:%llu", &n, &m, &seed) >= 2 && n > 0 && m > 0 && n < INT_MAX)
+    {
+        *number_of_rows = n;
+        generated = generate_random(n, m, seed, ptr, cols, data);
+    }
+    else if (sscanf(spec, "rmat:%d:%d:%llu", &n, &m, &seed) >= 2 && n >= 0 && n <= 30 && m > 0)
+    {
+        *number_of_rows = 1 << n;
+        generated = generate_rmat(n, m, seed, ptr, cols, data);
+    }
+    else
+    {
+        printf("bad matrix spec %s, use stencil2d:N, stencil3d:N, banded:ROWS:HALF_WIDTH, fem2d:N:B, random:ROWS:PER_ROW[:SEED] or rmat:SCALE:EDGES[:SEED]\n", spec);
+        return false;
+    }
+
+    if (!generated)
+    {
+        return false;
+    }
+
+    *number_of_columns = *number_of_rows;
+    *number_of_nonzeroes = (*ptr)[*number_of_rows];
+
+    return true;
+}
+
+/*!
+ * \brief Generates the matrix when name is a generator spec, loads it from a binary CSR file when it ends with .bin
+ *        and reads it from the Matrix Market file otherwise.
+ */
+bool load_matrix(const char *name, bool expand_symmetric, int *number_of_rows, int *number_of_columns, int *number_of_nonzeroes, cl_int **ptr, cl_int **cols, cl_double **data)
+{
+    if (is_generator_spec(name))
+    {
+        return generate_matrix(name, number_of_rows, number_of_columns, number_of_nonzeroes, ptr, cols, data);
+    }
+
+    if (is_binary_csr_file(name))
+    {
+        return read_csr_from_binary_file(name, number_of_rows, number_of_columns, number_of_nonzeroes, ptr, cols, data);
+    }
+
+    return read_csr_from_file(name, expand_symmetric, number_of_rows, number_of_columns, number_of_nonzeroes, ptr, cols, data);
+}
+
+#endif /* _GENERATOR_H */
@@ -73,7 +73,10 @@ void read_build_program_info(cl_program program, cl_device_id device)
     free(log);
 }
 
-cl_int get_device_ids(cl_device_id *device_ids, cl_uint *number_of_devices)
+/*!
+ * \brief Devices of the given type (CL_DEVICE_TYPE_GPU, CL_DEVICE_TYPE_CPU, CL_DEVICE_TYPE_ALL) on the first platform that has any.
+ */
+cl_int get_device_ids_of_type(cl_device_type device_type, cl_device_id *device_ids, cl_uint *number_of_devices)
 {
     cl_int error;
     cl_uint number_of_platforms;
@@ -105,7 +108,7 @@ cl_int get_device_ids(cl_device_id *device_ids, cl_uint *number_of_devices)
 
     for (cl_uint platform_number = 0; platform_number < number_of_platforms; ++platform_number)
     {
-        error = clGetDeviceIDs(platform_ids[platform_number], CL_DEVICE_TYPE_GPU, 0, NULL, &max_number_of_devices);
+        error = clGetDeviceIDs(platform_ids[platform_number], device_type, 0, NULL, &max_number_of_devices);
 
         if (0 == max_number_of_devices)
         {
@@ -118,7 +121,7 @@ cl_int get_device_ids(cl_device_id *device_ids, cl_uint *number_of_devices)
             *number_of_devices = max_number_of_devices;
         }
 
-        error = clGetDeviceIDs(platform_ids[platform_number], CL_DEVICE_TYPE_GPU, *number_of_devices, device_ids, NULL);
+        error = clGetDeviceIDs(platform_ids[platform_number], device_type, *number_of_devices, device_ids, NULL);
         
         break;
     }
@@ -128,6 +131,201 @@ cl_int get_device_ids(cl_device_id *device_ids, cl_uint *number_of_devices)
     return error;
 }
 
+cl_int get_device_ids(cl_device_id *device_ids, cl_uint *number_of_devices)
+{
+    return get_device_ids_of_type(CL_DEVICE_TYPE_GPU, device_ids, number_of_devices);
+}
+
+/*!
+ * \brief Returns the value of the "--name=value" command line option or default_value if it is not given.
+ */
+const char* get_option(int argc, char *argv[], const char *name, const char *default_value)
+{
+    size_t name_length = strlen(name);
+    int i;
+
+    for (i = 1; i < argc; ++i)
+    {
+        if (strncmp(argv[i], name, name_length) == 0 && argv[i][name_length] == '=')
+        {
+            return &argv[i][name_length + 1];
+        }
+    }
+
+    return default_value;
+}
+
+int get_int_option(int argc, char *argv[], const char *name, int default_value)
+{
+    const char *value = get_option(argc, argv, name, NULL);
+
+    if (value == NULL)
+    {
+        return default_value;
+    }
+
+    return atoi(value);
+}
+
+bool device_supports_extension(cl_device_id device, const char *extension)
+{
+    size_t extensions_size;
+    char *extensions;
+    bool supported;
+
+    if (clGetDeviceInfo(device, CL_DEVICE_EXTENSIONS, 0, NULL, &extensions_size) != CL_SUCCESS)
+    {
+        return false;
+    }
+
+    extensions = (char *)malloc(extensions_size);
+    clGetDeviceInfo(device, CL_DEVICE_EXTENSIONS, extensions_size, extensions, NULL);
+
+    supported = strstr(extensions, extension) != NULL;
+
+    free(extensions);
+
+    return supported;
+}
+
+/*!
+ * \brief Reads, creates and builds the program for the device, prints the build log and returns NULL on failure.
+ */
+cl_program build_program_from_file(cl_context context, cl_device_id device, const char *file, const char *options)
+{
+    cl_int error;
+    size_t size_of_cl_file;
+    char *source = read_source_from_cl_file(file, &size_of_cl_file);
+
+    if (source == NULL)
+    {
+        return NULL;
+    }
+
+    cl_program program = clCreateProgramWithSource(context, 1, (const char **)&source, &size_of_cl_file, &error);
+
+    free(source);
+
+    if (error != CL_SUCCESS)
+    {
+        printf("clCreateProgramWithSource error %d\n", error);
+        return NULL;
+    }
+
+    error = clBuildProgram(program, 1, &device, options, NULL, NULL);
+
+    if (error != CL_SUCCESS)
+    {
+        read_build_program_info(program, device);
+        clReleaseProgram(program);
+        return NULL;
+    }
+
+    return program;
+}
+
+/*!
+ * \brief Runs the kernel once and returns its time in milliseconds, or a negative value on error.
+ */
+double run_kernel(cl_command_queue command_queue, cl_kernel kernel, cl_uint work_dim, const size_t *global_work_size, const size_t *local_work_size)
+{
+    cl_int error;
+    cl_event nd_range_kernel_event;
+    struct timespec start_time;
+    struct timespec end_time;
+
+    clock_gettime(CLOCK_MONOTONIC, &start_time);
+    error = clEnqueueNDRangeKernel(command_queue, kernel, work_dim, NULL, global_work_size, local_work_size, 0, NULL, &nd_range_kernel_event);
+
+    if (error != CL_SUCCESS)
+    {
+        printf("clEnqueueNDRangeKernel error %d\n", error);
+        return -1;
+    }
+
+    clWaitForEvents(1, &nd_range_kernel_event);
+    clFinish(command_queue);
+
+    clock_gettime(CLOCK_MONOTONIC, &end_time);
+    clReleaseEvent(nd_range_kernel_event);
+
+    return (double)(end_time.tv_nsec - start_time.tv_nsec) / 1000000 + (double)(end_time.tv_sec - start_time.tv_sec) * 1000;
+}
+
+/*!
+ * \brief Fills the buffer with zeroes and returns the time in milliseconds, or a negative value on error.
+ */
+double zero_buffer(cl_command_queue command_queue, cl_mem buffer, size_t size)
+{
+    const cl_int zero = 0;
+    struct timespec start_time;
+    struct timespec end_time;
+
+    clock_gettime(CLOCK_MONOTONIC, &start_time);
+
+    if (clEnqueueFillBuffer(command_queue, buffer, &zero, sizeof(zero), 0, size, 0, NULL, NULL) != CL_SUCCESS)
+    {
+        printf("clEnqueueFillBuffer error\n");
+        return -1;
+    }
+
+    clFinish(command_queue);
+    clock_gettime(CLOCK_MONOTONIC, &end_time);
+
+    return (double)(end_time.tv_nsec - start_time.tv_nsec) / 1000000 + (double)(end_time.tv_sec - start_time.tv_sec) * 1000;
+}
+
+/*!
+ * \brief Prints the resources the kernel needs, kernel arguments must be set before calling this function.
+ */
+void print_kernel_occupancy(const char *name, cl_kernel kernel, cl_device_id device)
+{
+    cl_ulong local_memory_size = 0;
+    cl_ulong private_memory_size = 0;
+    cl_ulong device_local_memory_size = 0;
+    cl_uint compute_units = 0;
+    size_t work_group_size = 0;
+
+    clGetKernelWorkGroupInfo(kernel, device, CL_KERNEL_LOCAL_MEM_SIZE, sizeof(cl_ulong), &local_memory_size, NULL);
+    clGetKernelWorkGroupInfo(kernel, device, CL_KERNEL_PRIVATE_MEM_SIZE, sizeof(cl_ulong), &private_memory_size, NULL);
+    clGetKernelWorkGroupInfo(kernel, device, CL_KERNEL_WORK_GROUP_SIZE, sizeof(size_t), &work_group_size, NULL);
+    clGetDeviceInfo(device, CL_DEVICE_LOCAL_MEM_SIZE, sizeof(cl_ulong), &device_local_memory_size, NULL);
+    clGetDeviceInfo(device, CL_DEVICE_MAX_COMPUTE_UNITS, sizeof(cl_uint), &compute_units, NULL);
+
+    printf("%s: local memory %lu B per work-group, private memory %lu B per work-item, max work-group size %zu\n",
+           name, (unsigned long)local_memory_size, (unsigned long)private_memory_size, work_group_size);
+
+    if (local_memory_size > 0)
+    {
+        printf("%s: local memory allows %lu resident work-groups per compute unit (%u compute units)\n",
+               name, (unsigned long)(device_local_memory_size / local_memory_size), compute_units);
+    }
+    else
+    {
+        printf("%s: local memory does not limit resident work-groups (%u compute units)\n", name, compute_units);
+    }
+}
+
+/*!
+ * \brief Returns how many doubles fit into the widest vector register supported by the CPU.
+ */
+int get_cpu_vector_width(void)
+{
+    __builtin_cpu_init();
+
+    if (__builtin_cpu_supports("avx512f"))
+    {
+        return 8;
+    }
+
+    if (__builtin_cpu_supports("avx2"))
+    {
+        return 4;
+    }
+
+    return 2;
+}
+
 /*!
  * \brief File must be opened before calling this function.
  */
@@ -164,6 +362,109 @@ bool read_size_of_matrices_from_file(FILE *file, int *number_of_rows, int *numbe
     return true;
 }
 
+/*!
+ * \brief Reads one "row col value" line, pattern files have no value and their entries read as 1.
+ */
+bool read_matrix_entry(FILE *file, int *row, int *col, double *value)
+{
+    char line[MM_MAX_LINE_LENGTH + 1];
+
+    if (fgets(line, sizeof(line), file) == NULL)
+    {
+        return false;
+    }
+
+    switch (sscanf(line, "%d %d %lg", row, col, value))
+    {
+        case 3:
+            return true;
+        case 2:
+            *value = 1;
+            return true;
+        default:
+            return false;
+    }
+}
+
+bool is_pattern_matrix_file(const char *filename)
+{
+    MM_typecode matcode;
+    FILE *file = fopen(filename, "r");
+    bool pattern;
+
+    if (file == NULL)
+    {
+        return false;
+    }
+
+    pattern = mm_read_banner(file, &matcode) == 0 && mm_is_pattern(matcode);
+
+    fclose(file);
+
+    return pattern;
+}
+
+/*!
+ * \brief Returns true when the Matrix Market banner says the file stores one triangle of a symmetric matrix.
+ */
+bool is_symmetric_matrix_file(const char *filename)
+{
+    MM_typecode matcode;
+    FILE *file = fopen(filename, "r");
+    bool symmetric;
+
+    if (file == NULL)
+    {
+        return false;
+    }
+
+    symmetric = mm_read_banner(file, &matcode) == 0 && mm_is_symmetric(matcode);
+
+    fclose(file);
+
+    return symmetric;
+}
+
+/*!
+ * \brief Writes text as a quoted JSON string.
+ */
+void print_json_string(FILE *file, const char *text)
+{
+    fputc('"', file);
+
+    for (; *text != '\0'; ++text)
+    {
+        if (*text == '"' || *text == '\\')
+        {
+            fputc('\\', file);
+        }
+
+        fputc(*text, file);
+    }
+
+    fputc('"', file);
+}
+
+/*!
+ * \brief Writes text as a quoted CSV field, quotes inside doubled.
+ */
+void print_csv_string(FILE *file, const char *text)
+{
+    fputc('"', file);
+
+    for (; *text != '\0'; ++text)
+    {
+        if (*text == '"')
+        {
+            fputc('"', file);
+        }
+
+        fputc(*text, file);
+    }
+
+    fputc('"', file);
+}
+
 void calculate_and_print_performance(double ms, int number_of_nonzeroes)
 {
     printf("Your calculations took %.2lf ms to run.\n", ms);
@@ -181,7 +482,14 @@ void calculate_and_print_speed(double ms, int number_of_nonzeroes)
            (2 * number_of_nonzeroes) * sizeof(cl_double) / (ms) * 1e-6);
 }
 
-bool check_result(const char *filename, cl_double *vect, cl_double *result)
+/*!
+ * \brief Compares result with the product computed in double from the file and reports the error relative to the reference.
+ *        A symmetric file is multiplied as the full matrix, every off-diagonal entry also counting for its mirror.
+ *
+ * A row is wrong when it differs by more than EPSILON plus tolerance times the largest absolute value of the reference,
+ * so with tolerance 0 every row must match within EPSILON.
+ */
+bool check_result_with_tolerance(const char *filename, cl_double *vect, cl_double *result, double tolerance)
 {
     FILE *file;
     int number_of_rows;
@@ -189,6 +497,12 @@ bool check_result(const char *filename, cl_double *vect, cl_double *result)
     int number_of_nonzeroes;
     int i;
     cl_double *data;
+    const bool symmetric = is_symmetric_matrix_file(filename);
+    double error_norm = 0;
+    double reference_norm = 0;
+    double reference_max = 0;
+    double max_relative_error = 0;
+    bool is_ok = true;
     
     file = fopen(filename, "r");
 
@@ -212,27 +526,52 @@ bool check_result(const char *filename, cl_double *vect, cl_double *result)
         int current_row;
         int current_col;
         
-        fscanf(file, "%d %d %lg\n", &current_row, &current_col, &value);
+        read_matrix_entry(file, &current_row, &current_col, &value);
         current_row--; // adjust from 1-based to 0-based
         current_col--; 
         data[current_row] += value * vect[current_col];
+
+        if (symmetric && current_row != current_col)
+        {
+            data[current_col] += value * vect[current_row];
+        }
     }
     
     for (i = 0; i < number_of_rows; ++i)
     {
-        if (fabs(data[i] - result[i]) > EPSILON)
+        const double difference = fabs(data[i] - result[i]);
+
+        error_norm += difference * difference;
+        reference_norm += data[i] * data[i];
+        reference_max = fmax(reference_max, fabs(data[i]));
+
+        if (data[i] != 0)
+        {
+            max_relative_error = fmax(max_relative_error, difference / fabs(data[i]));
+        }
+    }
+
+    for (i = 0; i < number_of_rows; ++i)
+    {
+        if (fabs(data[i] - result[i]) > EPSILON + tolerance * reference_max)
         {
             printf("wrong value at index %d: expected %f - calculated %f\n", i, data[i], result[i]);
-            free(data);
-            fclose(file);
-            return false;
+            is_ok = false;
+            break;
         }
     }
+
+    printf("relative error %e (largest in a row %e)\n", reference_norm > 0 ? sqrt(error_norm / reference_norm) : sqrt(error_norm), max_relative_error);
     
     fclose(file);
     free(data);
     
-    return true;
+    return is_ok;
+}
+
+bool check_result(const char *filename, cl_double *vect, cl_double *result)
+{
+    return check_result_with_tolerance(filename, vect, result, 0);
 }
     
 #endif /* _HELPER_FUNCTIONS_H */
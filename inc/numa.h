@@ -0,0 +1,153 @@
+#ifndef _NUMA_H
+#define _NUMA_H
+
+/* sched_setaffinity needs _GNU_SOURCE defined before the first system header of the program */
+#define CL_TARGET_OPENCL_VERSION 300
+#include <CL/cl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sched.h>
+#include <unistd.h>
+#include <omp.h>
+
+#define MAX_NUMA_NODES 64
+
+/*!
+ * \brief NUMA node of a logical CPU read from sysfs, 0 when the kernel does not report nodes.
+ */
+int get_numa_node_of_cpu(int cpu)
+{
+    char path[64];
+    int node;
+
+    for (node = 0; node < MAX_NUMA_NODES; ++node)
+    {
+        snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/node%d", cpu, node);
+
+        if (access(path, F_OK) == 0)
+        {
+            return node;
+        }
+    }
+
+    return 0;
+}
+
+/*!
+ * \brief Pins OpenMP thread t of a team of number_of_parts threads to the t-th CPU the process may run on
+ *        and stores the NUMA node of that CPU in part_nodes[t]. The pinning stays with the threads of the team.
+ */
+void pin_threads(int number_of_parts, int *part_nodes)
+{
+    cpu_set_t allowed;
+    int *cpus = (int*)malloc(sizeof(int) * number_of_parts);
+    int number_of_cpus = 0;
+    int cpu;
+
+    sched_getaffinity(0, sizeof(allowed), &allowed);
+
+    for (cpu = 0; cpu < CPU_SETSIZE && number_of_cpus < number_of_parts; ++cpu)
+    {
+        if (CPU_ISSET(cpu, &allowed))
+        {
+            cpus[number_of_cpus++] = cpu;
+        }
+    }
+
+    #pragma omp parallel num_threads(number_of_parts) shared(cpus, number_of_cpus, part_nodes)
+    {
+        const int thread = omp_get_thread_num();
+        const int thread_cpu = cpus[thread % number_of_cpus];
+        cpu_set_t mask;
+
+        CPU_ZERO(&mask);
+        CPU_SET(thread_cpu, &mask);
+
+        if (sched_setaffinity(0, sizeof(mask), &mask) != 0)
+        {
+            perror("sched_setaffinity");
+        }
+
+        part_nodes[thread] = get_numa_node_of_cpu(thread_cpu);
+    }
+
+    free(cpus);
+}
+
+/*!
+ * \brief Copies number_of_elements elements so that every page is first written by the thread that later reads it.
+ *        Part p copies units partition[p] to partition[p + 1] - 1, that is elements prefix[unit] for CSR columns
+ *        and values or the units themselves (row pointer, output) when prefix is NULL.
+ */
+void* first_touch_copy(const void *source, size_t element_size, int number_of_elements, const cl_int *prefix, const int *partition, int number_of_parts)
+{
+    char *copy = (char*)malloc(element_size * number_of_elements);
+
+    #pragma omp parallel num_threads(number_of_parts) shared(source, element_size, number_of_elements, prefix, partition, number_of_parts, copy)
+    {
+        int part;
+
+        for (part = omp_get_thread_num(); part < number_of_parts; part += omp_get_num_threads())
+        {
+            const int begin = prefix == NULL ? partition[part] : prefix[partition[part]];
+            const int end = part == number_of_parts - 1 ? number_of_elements : prefix == NULL ? partition[part + 1] : prefix[partition[part + 1]];
+
+            memcpy(copy + element_size * begin, (const char*)source + element_size * begin, element_size * (end - begin));
+        }
+    }
+
+    return copy;
+}
+
+/*!
+ * \brief One copy of the vector per NUMA node used by the parts, written by the first thread of the node.
+ *        Nodes without threads stay NULL.
+ */
+cl_double** replicate_vector_per_node(const cl_double *vect, int size, const int *part_nodes, int number_of_parts)
+{
+    cl_double **node_vects = (cl_double**)calloc(MAX_NUMA_NODES, sizeof(cl_double*));
+    int *node_owner = (int*)malloc(sizeof(int) * MAX_NUMA_NODES);
+    int part;
+
+    for (part = 0; part < MAX_NUMA_NODES; ++part)
+    {
+        node_owner[part] = -1;
+    }
+
+    for (part = number_of_parts - 1; part >= 0; --part)
+    {
+        node_owner[part_nodes[part]] = part;
+    }
+
+    #pragma omp parallel num_threads(number_of_parts) shared(vect, size, part_nodes, number_of_parts, node_vects, node_owner)
+    {
+        const int thread = omp_get_thread_num();
+
+        if (node_owner[part_nodes[thread]] == thread)
+        {
+            cl_double *copy = (cl_double*)malloc(sizeof(cl_double) * size);
+
+            memcpy(copy, vect, sizeof(cl_double) * size);
+            node_vects[part_nodes[thread]] = copy;
+        }
+    }
+
+    free(node_owner);
+
+    return node_vects;
+}
+
+void free_vector_replicas(cl_double **node_vects)
+{
+    int node;
+
+    for (node = 0; node < MAX_NUMA_NODES; ++node)
+    {
+        free(node_vects[node]);
+    }
+
+    free(node_vects);
+}
+
+#endif
@@ -0,0 +1,130 @@
+#ifndef _PARTITION_H
+#define _PARTITION_H
+
+#define CL_TARGET_OPENCL_VERSION 300
+#include <CL/cl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <omp.h>
+
+/*!
+ * \brief Splits number_of_units rows (or strips) into number_of_parts ranges with about the same number of nonzeroes.
+ *        prefix holds number_of_units + 1 offsets (ptr of CSR, strip_ptr of CMRS), part p owns units bounds[p] to bounds[p + 1] - 1.
+ */
+int* create_balanced_partition(const cl_int *prefix, int number_of_units, int number_of_parts)
+{
+    int *bounds = (int*)malloc(sizeof(int) * (number_of_parts + 1));
+    const long long total = (long long)prefix[number_of_units] - prefix[0];
+    int part;
+
+    bounds[0] = 0;
+    bounds[number_of_parts] = number_of_units;
+
+    for (part = 1; part < number_of_parts; ++part)
+    {
+        const long long target = prefix[0] + total * part / number_of_parts;
+        int low = bounds[part - 1];
+        int high = number_of_units;
+
+        /* first unit starting at or after the target, then the nearer of it and the one before */
+        while (low < high)
+        {
+            const int middle = low + (high - low) / 2;
+
+            if (prefix[middle] < target)
+            {
+                low = middle + 1;
+            }
+            else
+            {
+                high = middle;
+            }
+        }
+
+        if (low > bounds[part - 1] && target - prefix[low - 1] < prefix[low] - target)
+        {
+            --low;
+        }
+
+        bounds[part] = low;
+    }
+
+    return bounds;
+}
+
+/*!
+ * \brief Splits COO entries into number_of_parts equal ranges. When the entries are sorted by row every bound is moved
+ *        to the next row start, so no row is shared and the parts can write output without atomics.
+ *        Returns whether that was possible.
+ */
+bool create_coo_partition(const cl_int *rows, int number_of_nonzeroes, int number_of_parts, int **bounds)
+{
+    bool sorted_by_row = true;
+    int part;
+    int i;
+
+    for (i = 1; i < number_of_nonzeroes && sorted_by_row; ++i)
+    {
+        sorted_by_row = rows[i - 1] <= rows[i];
+    }
+
+    *bounds = (int*)malloc(sizeof(int) * (number_of_parts + 1));
+    (*bounds)[0] = 0;
+    (*bounds)[number_of_parts] = number_of_nonzeroes;
+
+    for (part = 1; part < number_of_parts; ++part)
+    {
+        int bound = (int)((long long)number_of_nonzeroes * part / number_of_parts);
+
+        if (bound < (*bounds)[part - 1])
+        {
+            bound = (*bounds)[part - 1];
+        }
+
+        while (sorted_by_row && bound > 0 && bound < number_of_nonzeroes && rows[bound] == rows[bound - 1])
+        {
+            ++bound;
+        }
+
+        (*bounds)[part] = bound;
+    }
+
+    return sorted_by_row;
+}
+
+/*!
+ * \brief Number of parts for the CPU partitions, one per OpenMP thread.
+ */
+int get_number_of_cpu_parts(void)
+{
+    return omp_get_max_threads();
+}
+
+/*!
+ * \brief Prints the time of every thread and how much longer the slowest one took than the average.
+ */
+void print_thread_times(const double *thread_ms, int number_of_threads)
+{
+    double sum = 0;
+    double slowest = 0;
+    int thread;
+
+    for (thread = 0; thread < number_of_threads; ++thread)
+    {
+        printf("thread %d: %.3lf ms\n", thread, thread_ms[thread]);
+        sum += thread_ms[thread];
+
+        if (thread_ms[thread] > slowest)
+        {
+            slowest = thread_ms[thread];
+        }
+    }
+
+    if (sum > 0)
+    {
+        printf("imbalance (slowest / average) %.2lf\n", slowest * number_of_threads / sum);
+    }
+}
+
+#endif
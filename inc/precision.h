@@ -0,0 +1,196 @@
+#ifndef _PRECISION_H
+#define _PRECISION_H
+
+#define CL_TARGET_OPENCL_VERSION 300
+#include <CL/cl.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "helper_functions.h"
+#include "enums.h"
+
+/*!
+ * \brief Reads a precision option (double, float or half), double when it is not given.
+ */
+Precision get_precision_option(int argc, char *argv[], const char *name)
+{
+    const char *value = get_option(argc, argv, name, "double");
+
+    if (strcmp(value, "float") == 0 || strcmp(value, "single") == 0)
+    {
+        return SinglePrecision;
+    }
+
+    if (strcmp(value, "half") == 0)
+    {
+        return HalfPrecision;
+    }
+
+    if (strcmp(value, "double") != 0)
+    {
+        printf("unknown precision %s, double is used\n", value);
+    }
+
+    return DoublePrecision;
+}
+
+const char* get_precision_name(Precision precision)
+{
+    switch (precision)
+    {
+        case SinglePrecision:
+            return "float";
+        case HalfPrecision:
+            return "half";
+        default:
+            return "double";
+    }
+}
+
+size_t get_precision_size(Precision precision)
+{
+    switch (precision)
+    {
+        case SinglePrecision:
+            return sizeof(cl_float);
+        case HalfPrecision:
+            return sizeof(cl_half);
+        default:
+            return sizeof(cl_double);
+    }
+}
+
+/*!
+ * \brief Largest error of the result, relative to its largest value, expected when values and vector are stored with given precisions.
+ */
+double get_precision_tolerance(Precision value_precision, Precision vector_precision)
+{
+    if (value_precision == HalfPrecision || vector_precision == HalfPrecision)
+    {
+        return 1e-2;
+    }
+
+    if (value_precision == SinglePrecision || vector_precision == SinglePrecision)
+    {
+        return 1e-5;
+    }
+
+    return 0;
+}
+
+/*!
+ * \brief Converts float to IEEE 754 half with rounding to nearest even, values out of range become infinity.
+ */
+cl_half convert_float_to_half(float value)
+{
+    uint32_t bits;
+
+    memcpy(&bits, &value, sizeof(bits));
+
+    const uint32_t sign = (bits >> 16) & 0x8000;
+    const int exponent = (int)((bits >> 23) & 0xff) - 127 + 15;
+    uint32_t mantissa = bits & 0x7fffff;
+    uint32_t half;
+    uint32_t remainder;
+    uint32_t halfway;
+
+    if (((bits >> 23) & 0xff) == 0xff)
+    {
+        return (cl_half)(sign | 0x7c00 | (mantissa != 0 ? 0x200 : 0));
+    }
+
+    if (exponent >= 31)
+    {
+        return (cl_half)(sign | 0x7c00);
+    }
+
+    if (exponent <= 0)
+    {
+        /* subnormal half */
+        if (exponent < -10)
+        {
+            return (cl_half)sign;
+        }
+
+        const int shift = 14 - exponent;
+
+        mantissa |= 0x800000;
+        half = mantissa >> shift;
+        remainder = mantissa & ((1u << shift) - 1);
+        halfway = 1u << (shift - 1);
+    }
+    else
+    {
+        half = ((uint32_t)exponent << 10) | (mantissa >> 13);
+        remainder = mantissa & 0x1fff;
+        halfway = 0x1000;
+    }
+
+    /* a carry out of the mantissa correctly moves to the exponent */
+    if (remainder > halfway || (remainder == halfway && (half & 1)))
+    {
+        half++;
+    }
+
+    return (cl_half)(sign | half);
+}
+
+/*!
+ * \brief Copies values into a new array of given precision, the only place where double data is narrowed for the device.
+ *
+ * Values which become infinite or zero in the new precision are counted and reported.
+ */
+void* convert_to_precision(const cl_double *values, size_t number_of_values, Precision precision)
+{
+    void *converted = malloc(number_of_values * get_precision_size(precision));
+    size_t overflows = 0;
+    size_t underflows = 0;
+    size_t i;
+
+    switch (precision)
+    {
+        case SinglePrecision:
+            for (i = 0; i < number_of_values; ++i)
+            {
+                const cl_float value = (cl_float)values[i];
+
+                overflows += isinf(value) && !isinf(values[i]);
+                underflows += value == 0 && values[i] != 0;
+                ((cl_float *)converted)[i] = value;
+            }
+            break;
+        case HalfPrecision:
+            for (i = 0; i < number_of_values; ++i)
+            {
+                const cl_half value = convert_float_to_half((float)values[i]);
+
+                overflows += (value & 0x7fff) == 0x7c00 && !isinf(values[i]);
+                underflows += (value & 0x7fff) == 0 && values[i] != 0;
+                ((cl_half *)converted)[i] = value;
+            }
+            break;
+        default:
+            memcpy(converted, values, number_of_values * sizeof(cl_double));
+            break;
+    }
+
+    if (overflows > 0 || underflows > 0)
+    {
+        printf("%s: %zu values out of range, %zu values flushed to zero\n", get_precision_name(precision), overflows, underflows);
+    }
+
+    return converted;
+}
+
+/*!
+ * \brief Appends the options selecting storage precisions in kernels/Precision.h to the build options.
+ */
+void append_precision_build_options(char *options, size_t size, Precision value_precision, Precision vector_precision)
+{
+    const size_t length = strlen(options);
+
+    snprintf(options + length, size - length, "%s-I kernels -DVALUE_PRECISION=%d -DVECTOR_PRECISION=%d",
+             length > 0 ? " " : "", (int)value_precision, (int)vector_precision);
+}
+
+#endif /* _PRECISION_H */
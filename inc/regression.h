@@ -0,0 +1,303 @@
+#ifndef _REGRESSION_H
+#define _REGRESSION_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <math.h>
+
+#include "helper_functions.h"
+
+#define MAX_BASELINE_ENTRIES 256
+#define MAX_BASELINE_RUNS 256
+#define BASELINE_NAME_SIZE 256
+
+/*
+ * Baselines keep every repeat of every (matrix, format) run, not just the median, so a new run can be compared with a
+ * rank test instead of a single number. The file is JSON, written by write_baseline and read back by read_baseline,
+ * which only understands the keys it writes.
+ */
+
+typedef struct
+{
+    char matrix[BASELINE_NAME_SIZE];
+    char format[16];
+    double median_ms;
+    int number_of_runs;
+    double run_ms[MAX_BASELINE_RUNS];
+} BaselineEntry;
+
+typedef struct
+{
+    char device[BASELINE_NAME_SIZE];
+    int number_of_entries;
+    BaselineEntry entries[MAX_BASELINE_ENTRIES];
+} Baseline;
+
+typedef enum
+{
+    Unchanged,
+    Improved,
+    Regressed
+} Verdict;
+
+const char *verdict_names[] = { "unchanged", "improved", "REGRESSED" };
+
+/*!
+ * \brief Adds an entry (run_ms holds number_of_runs times), false when the baseline is full.
+ */
+bool add_baseline_entry(Baseline *baseline, const char *matrix, const char *format, const double *run_ms, int number_of_runs, double median_ms)
+{
+    if (baseline->number_of_entries == MAX_BASELINE_ENTRIES)
+    {
+        printf("more than %d baseline entries\n", MAX_BASELINE_ENTRIES);
+        return false;
+    }
+
+    BaselineEntry *entry = &baseline->entries[baseline->number_of_entries++];
+
+    snprintf(entry->matrix, sizeof(entry->matrix), "%s", matrix);
+    snprintf(entry->format, sizeof(entry->format), "%s", format);
+    entry->median_ms = median_ms;
+    entry->number_of_runs = number_of_runs < MAX_BASELINE_RUNS ? number_of_runs : MAX_BASELINE_RUNS;
+    memcpy(entry->run_ms, run_ms, sizeof(double) * entry->number_of_runs);
+
+    return true;
+}
+
+const BaselineEntry* find_baseline_entry(const Baseline *baseline, const char *matrix, const char *format)
+{
+    int e;
+
+    for (e = 0; e < baseline->number_of_entries; ++e)
+    {
+        if (strcmp(baseline->entries[e].matrix, matrix) == 0 && strcmp(baseline->entries[e].format, format) == 0)
+        {
+            return &baseline->entries[e];
+        }
+    }
+
+    return NULL;
+}
+
+bool write_baseline(const char *filename, const Baseline *baseline, int warmup, int repeats)
+{
+    FILE *file = fopen(filename, "w");
+    int e;
+    int r;
+
+    if (file == NULL)
+    {
+        perror(filename);
+        return false;
+    }
+
+    fprintf(file, "{\n  \"device\": ");
+    print_json_string(file, baseline->device);
+    fprintf(file, ",\n  \"warmup\": %d,\n  \"repeats\": %d,\n  \"results\": [", warmup, repeats);
+
+    for (e = 0; e < baseline->number_of_entries; ++e)
+    {
+        const BaselineEntry *entry = &baseline->entries[e];
+
+        fprintf(file, "%s\n    {\"matrix\": ", e == 0 ? "" : ",");
+        print_json_string(file, entry->matrix);
+        fprintf(file, ", \"format\": \"%s\", \"median_ms\": %.6lf, \"runs_ms\": [", entry->format, entry->median_ms);
+
+        for (r = 0; r < entry->number_of_runs; ++r)
+        {
+            fprintf(file, "%s%.6lf", r == 0 ? "" : ", ", entry->run_ms[r]);
+        }
+
+        fprintf(file, "]}");
+    }
+
+    fprintf(file, "\n  ]\n}\n");
+    fclose(file);
+
+    return true;
+}
+
+/*!
+ * \brief Points after "key": and the spaces following it in text, NULL when the key is not there.
+ */
+const char* find_json_value(const char *text, const char *key)
+{
+    char quoted[64];
+    const char *found;
+
+    snprintf(quoted, sizeof(quoted), "\"%s\":", key);
+    found = strstr(text, quoted);
+
+    if (found == NULL)
+    {
+        return NULL;
+    }
+
+    for (found += strlen(quoted); *found == ' ' || *found == '\n' || *found == '\t' || *found == '\r'; ++found)
+    {
+    }
+
+    return found;
+}
+
+/*!
+ * \brief Copies the JSON string at text (escapes undone) into value, false when text is not a string.
+ */
+bool read_json_string(const char *text, char *value, size_t size)
+{
+    size_t length = 0;
+
+    if (text == NULL || *text != '"')
+    {
+        return false;
+    }
+
+    for (++text; *text != '"' && *text != '\0'; ++text)
+    {
+        if (*text == '\\' && text[1] != '\0')
+        {
+            ++text;
+        }
+
+        if (length + 1 < size)
+        {
+            value[length++] = *text;
+        }
+    }
+
+    value[length] = '\0';
+
+    return *text == '"';
+}
+
+bool read_baseline(const char *filename, Baseline *baseline)
+{
+    FILE *file = fopen(filename, "rb");
+    long size;
+
+    if (file == NULL)
+    {
+        return false;
+    }
+
+    fseek(file, 0, SEEK_END);
+    size = ftell(file);
+    rewind(file);
+
+    char *text = (char*)malloc(size + 1);
+    text[fread(text, 1, size, file)] = '\0';
+    fclose(file);
+
+    baseline->number_of_entries = 0;
+
+    if (!read_json_string(find_json_value(text, "device"), baseline->device, sizeof(baseline->device)))
+    {
+        baseline->device[0] = '\0';
+    }
+
+    /* every object in "results" starts with its matrix and ends at the first } after it */
+    const char *object = strstr(text, "\"results\"");
+
+    while (object != NULL && (object = strstr(object, "{\"matrix\"")) != NULL)
+    {
+        const char *end = strchr(object, '}');
+        BaselineEntry *entry = &baseline->entries[baseline->number_of_entries];
+        const char *value;
+        char *next;
+
+        if (end == NULL || baseline->number_of_entries == MAX_BASELINE_ENTRIES)
+        {
+            break;
+        }
+
+        if (!read_json_string(find_json_value(object, "matrix"), entry->matrix, sizeof(entry->matrix)) ||
+            !read_json_string(find_json_value(object, "format"), entry->format, sizeof(entry->format)) ||
+            (value = find_json_value(object, "median_ms")) == NULL || value > end ||
+            (value = find_json_value(object, "runs_ms")) == NULL || value > end || *value != '[')
+        {
+            printf("%s: bad entry at offset %ld\n", filename, (long)(object - text));
+            free(text);
+            return false;
+        }
+
+        entry->median_ms = strtod(find_json_value(object, "median_ms"), NULL);
+        entry->number_of_runs = 0;
+
+        for (++value; value < end && *value != ']' && entry->number_of_runs < MAX_BASELINE_RUNS; value = next)
+        {
+            entry->run_ms[entry->number_of_runs] = strtod(value, &next);
+
+            if (next == value)
+            {
+                break;
+            }
+
+            ++entry->number_of_runs;
+
+            for (; *next == ',' || *next == ' '; ++next)
+            {
+            }
+        }
+
+        ++baseline->number_of_entries;
+        object = end;
+    }
+
+    free(text);
+
+    return true;
+}
+
+/*!
+ * \brief One-sided Mann-Whitney U test: the probability of seeing current this much slower than baseline (or more)
+ *        when both come from the same distribution. Normal approximation with continuity correction, which is
+ *        close enough from about 8 repeats on each side.
+ */
+double mann_whitney_p_value(const double *current, int number_of_current, const double *baseline, int number_of_baseline)
+{
+    const double n1 = number_of_current;
+    const double n2 = number_of_baseline;
+    double u = 0.0;
+    int i;
+    int j;
+
+    for (i = 0; i < number_of_current; ++i)
+    {
+        for (j = 0; j < number_of_baseline; ++j)
+        {
+            u += current[i] > baseline[j] ? 1.0 : (current[i] == baseline[j] ? 0.5 : 0.0);
+        }
+    }
+
+    const double z = (u - n1 * n2 / 2 - 0.5) / sqrt(n1 * n2 * (n1 + n2 + 1) / 12);
+
+    return 0.5 * erfc(z / sqrt(2.0));
+}
+
+/*!
+ * \brief A run regressed when its median is more than threshold (relative) above the baseline median and the
+ *        slowdown is significant at alpha, and improved on the same conditions the other way round. Anything
+ *        else is noise. ratio gets current / baseline median, p_value the one-sided p of the slowdown.
+ */
+Verdict compare_with_baseline(const BaselineEntry *entry, const double *run_ms, int number_of_runs, double median_ms,
+                              double threshold, double alpha, double *ratio, double *p_value)
+{
+    *ratio = median_ms / entry->median_ms;
+    *p_value = mann_whitney_p_value(run_ms, number_of_runs, entry->run_ms, entry->number_of_runs);
+
+    if (*ratio > 1 + threshold && *p_value < alpha)
+    {
+        return Regressed;
+    }
+
+    if (*ratio < 1 - threshold && mann_whitney_p_value(entry->run_ms, entry->number_of_runs, run_ms, number_of_runs) < alpha)
+    {
+        return Improved;
+    }
+
+    return Unchanged;
+}
+
+#endif /* _REGRESSION_H */
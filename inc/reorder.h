@@ -0,0 +1,392 @@
+#ifndef _REORDER_H
+#define _REORDER_H
+
+#define CL_TARGET_OPENCL_VERSION 300
+#include <CL/cl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define PSEUDO_PERIPHERAL_ITERATIONS 5
+
+/*
+ * Symmetric permutations P A P^T of square CSR matrices. A permutation perm maps new indices to old ones,
+ * perm[new] = old, so x is gathered with permute_vector before the multiplication and y scattered back
+ * with unpermute_vector after it.
+ */
+
+int compare_long_longs(const void *a, const void *b)
+{
+    const long long x = *(const long long*)a;
+    const long long y = *(const long long*)b;
+
+    return (x > y) - (x < y);
+}
+
+/*!
+ * \brief Pattern of A + A^T without the diagonal as adjacency lists, degree[v] is the length of the list of v.
+ */
+void create_symmetric_graph(const cl_int *ptr, const cl_int *cols, int n, cl_int **graph_ptr, cl_int **graph_cols, cl_int **degree)
+{
+    int i;
+    int j;
+
+    *graph_ptr = (cl_int*)calloc(n + 1, sizeof(cl_int));
+    *degree = (cl_int*)calloc(n, sizeof(cl_int));
+
+    for (i = 0; i < n; ++i)
+    {
+        for (j = ptr[i]; j < ptr[i + 1]; ++j)
+        {
+            if (cols[j] != i)
+            {
+                (*graph_ptr)[i + 1]++;
+                (*graph_ptr)[cols[j] + 1]++;
+            }
+        }
+    }
+
+    for (i = 0; i < n; ++i)
+    {
+        (*graph_ptr)[i + 1] += (*graph_ptr)[i];
+    }
+
+    *graph_cols = (cl_int*)malloc(sizeof(cl_int) * (*graph_ptr)[n]);
+
+    /* a pair stored in both triangles is listed twice, which only costs a visited check */
+    for (i = 0; i < n; ++i)
+    {
+        for (j = ptr[i]; j < ptr[i + 1]; ++j)
+        {
+            if (cols[j] != i)
+            {
+                (*graph_cols)[(*graph_ptr)[i] + (*degree)[i]++] = cols[j];
+                (*graph_cols)[(*graph_ptr)[cols[j]] + (*degree)[cols[j]]++] = i;
+            }
+        }
+    }
+}
+
+/*!
+ * \brief Breadth-first search from start that appends the vertices to order (starting at position first) and marks them
+ *        with stamp. With sort_by_degree the unvisited neighbours of every vertex are appended by increasing degree (Cuthill-McKee).
+ *        Returns the number of levels, last_level_start is the position in order where the deepest level begins.
+ */
+int breadth_first_search(const cl_int *graph_ptr, const cl_int *graph_cols, const cl_int *degree, int start, int stamp, int sort_by_degree,
+                         cl_int *mark, cl_int *order, int first, int *last_level_start, int *end)
+{
+    long long *neighbours = NULL;
+    int neighbours_size = 0;
+    int head = first;
+    int tail = first;
+    int level_end = first + 1;
+    int levels = 0;
+
+    order[tail++] = start;
+    mark[start] = stamp;
+    *last_level_start = first;
+
+    while (head < tail)
+    {
+        const int vertex = order[head++];
+        int count = 0;
+        int j;
+
+        for (j = graph_ptr[vertex]; j < graph_ptr[vertex + 1]; ++j)
+        {
+            const int neighbour = graph_cols[j];
+
+            if (mark[neighbour] != stamp)
+            {
+                mark[neighbour] = stamp;
+
+                if (sort_by_degree)
+                {
+                    if (count == neighbours_size)
+                    {
+                        neighbours_size = neighbours_size == 0 ? 64 : 2 * neighbours_size;
+                        neighbours = (long long*)realloc(neighbours, sizeof(long long) * neighbours_size);
+                    }
+
+                    neighbours[count++] = ((long long)degree[neighbour] << 32) | neighbour;
+                }
+                else
+                {
+                    order[tail++] = neighbour;
+                }
+            }
+        }
+
+        if (sort_by_degree)
+        {
+            qsort(neighbours, count, sizeof(long long), compare_long_longs);
+
+            for (j = 0; j < count; ++j)
+            {
+                order[tail++] = (int)(neighbours[j] & 0xffffffff);
+            }
+        }
+
+        if (head == level_end)
+        {
+            ++levels;
+
+            if (tail > level_end)
+            {
+                *last_level_start = level_end;
+            }
+
+            level_end = tail;
+        }
+    }
+
+    free(neighbours);
+    *end = tail;
+
+    return levels;
+}
+
+/*!
+ * \brief Reverse Cuthill-McKee ordering of A + A^T. Every connected component starts from a pseudo-peripheral vertex,
+ *        found by repeated searches from the smallest degree vertex of the deepest level while the depth grows.
+ */
+int* create_rcm_permutation(const cl_int *ptr, const cl_int *cols, int n)
+{
+    cl_int *graph_ptr;
+    cl_int *graph_cols;
+    cl_int *degree;
+    cl_int *mark = (cl_int*)calloc(n, sizeof(cl_int));
+    cl_int *order = (cl_int*)malloc(sizeof(cl_int) * n);
+    cl_int *scratch = (cl_int*)malloc(sizeof(cl_int) * n);
+    int *perm = (int*)malloc(sizeof(int) * n);
+    int stamp = 0;
+    int numbered = 0;
+    int vertex;
+    int i;
+
+    create_symmetric_graph(ptr, cols, n, &graph_ptr, &graph_cols, &degree);
+
+    /* vertices by increasing degree, the first unnumbered one starts the next component */
+    long long *by_degree = (long long*)malloc(sizeof(long long) * n);
+
+    for (i = 0; i < n; ++i)
+    {
+        by_degree[i] = ((long long)degree[i] << 32) | i;
+    }
+
+    qsort(by_degree, n, sizeof(long long), compare_long_longs);
+
+    for (i = 0; i < n; ++i)
+    {
+        int start = (int)(by_degree[i] & 0xffffffff);
+        int last_level_start;
+        int end;
+        int iteration;
+
+        if (mark[start] == -1)
+        {
+            continue;
+        }
+
+        int levels = breadth_first_search(graph_ptr, graph_cols, degree, start, ++stamp, 0, mark, scratch, 0, &last_level_start, &end);
+
+        for (iteration = 0; iteration < PSEUDO_PERIPHERAL_ITERATIONS; ++iteration)
+        {
+            int candidate = scratch[last_level_start];
+            int candidate_last_level_start;
+            int candidate_end;
+            int k;
+
+            for (k = last_level_start + 1; k < end; ++k)
+            {
+                if (degree[scratch[k]] < degree[candidate])
+                {
+                    candidate = scratch[k];
+                }
+            }
+
+            const int candidate_levels = breadth_first_search(graph_ptr, graph_cols, degree, candidate, ++stamp, 0, mark, scratch, 0, &candidate_last_level_start, &candidate_end);
+
+            if (candidate_levels <= levels)
+            {
+                break;
+            }
+
+            start = candidate;
+            levels = candidate_levels;
+            last_level_start = candidate_last_level_start;
+            end = candidate_end;
+        }
+
+        breadth_first_search(graph_ptr, graph_cols, degree, start, -1, 1, mark, order, numbered, &last_level_start, &numbered);
+    }
+
+    for (vertex = 0; vertex < n; ++vertex)
+    {
+        perm[vertex] = order[n - 1 - vertex];
+    }
+
+    free(graph_ptr);
+    free(graph_cols);
+    free(degree);
+    free(mark);
+    free(order);
+    free(scratch);
+    free(by_degree);
+
+    return perm;
+}
+
+/*!
+ * \brief Rows (and columns) by decreasing number of nonzeroes, rows of equal length keep their order.
+ */
+int* create_degree_permutation(const cl_int *ptr, int n)
+{
+    long long *keys = (long long*)malloc(sizeof(long long) * n);
+    int *perm = (int*)malloc(sizeof(int) * n);
+    int i;
+
+    for (i = 0; i < n; ++i)
+    {
+        keys[i] = ((long long)(ptr[n] - (ptr[i + 1] - ptr[i])) << 32) | i;
+    }
+
+    qsort(keys, n, sizeof(long long), compare_long_longs);
+
+    for (i = 0; i < n; ++i)
+    {
+        perm[i] = (int)(keys[i] & 0xffffffff);
+    }
+
+    free(keys);
+
+    return perm;
+}
+
+/*!
+ * \brief P A P^T in CSR, the elements of every row sorted by their new column.
+ */
+void permute_csr(const cl_int *ptr, const cl_int *cols, const cl_double *data, int n, const int *perm, cl_int **new_ptr, cl_int **new_cols, cl_double **new_data)
+{
+    int *inverse = (int*)malloc(sizeof(int) * n);
+    long long *keys = NULL;
+    int keys_size = 0;
+    int i;
+    int j;
+
+    for (i = 0; i < n; ++i)
+    {
+        inverse[perm[i]] = i;
+    }
+
+    *new_ptr = (cl_int*)malloc(sizeof(cl_int) * (n + 1));
+    *new_cols = (cl_int*)malloc(sizeof(cl_int) * ptr[n]);
+    *new_data = (cl_double*)malloc(sizeof(cl_double) * ptr[n]);
+    (*new_ptr)[0] = 0;
+
+    for (i = 0; i < n; ++i)
+    {
+        const int row = perm[i];
+        const int length = ptr[row + 1] - ptr[row];
+        const int offset = (*new_ptr)[i];
+
+        if (length > keys_size)
+        {
+            keys_size = length;
+            keys = (long long*)realloc(keys, sizeof(long long) * keys_size);
+        }
+
+        /* new column and position of the element in the old row */
+        for (j = 0; j < length; ++j)
+        {
+            keys[j] = ((long long)inverse[cols[ptr[row] + j]] << 32) | j;
+        }
+
+        qsort(keys, length, sizeof(long long), compare_long_longs);
+
+        for (j = 0; j < length; ++j)
+        {
+            (*new_cols)[offset + j] = (cl_int)(keys[j] >> 32);
+            (*new_data)[offset + j] = data[ptr[row] + (keys[j] & 0xffffffff)];
+        }
+
+        (*new_ptr)[i + 1] = offset + length;
+    }
+
+    free(inverse);
+    free(keys);
+}
+
+void permute_vector(const cl_double *vect, const int *perm, int n, cl_double *result)
+{
+    int i;
+
+    for (i = 0; i < n; ++i)
+    {
+        result[i] = vect[perm[i]];
+    }
+}
+
+void unpermute_vector(const cl_double *vect, const int *perm, int n, cl_double *result)
+{
+    int i;
+
+    for (i = 0; i < n; ++i)
+    {
+        result[perm[i]] = vect[i];
+    }
+}
+
+/*!
+ * \brief Largest distance of an element from the diagonal.
+ */
+int compute_bandwidth(const cl_int *ptr, const cl_int *cols, int n)
+{
+    int bandwidth = 0;
+    int i;
+    int j;
+
+    for (i = 0; i < n; ++i)
+    {
+        for (j = ptr[i]; j < ptr[i + 1]; ++j)
+        {
+            const int distance = cols[j] > i ? cols[j] - i : i - cols[j];
+
+            if (distance > bandwidth)
+            {
+                bandwidth = distance;
+            }
+        }
+    }
+
+    return bandwidth;
+}
+
+/*!
+ * \brief Sum over rows of the distance from the first element left of the diagonal to the diagonal.
+ */
+long long compute_profile(const cl_int *ptr, const cl_int *cols, int n)
+{
+    long long profile = 0;
+    int i;
+    int j;
+
+    for (i = 0; i < n; ++i)
+    {
+        int first = i;
+
+        for (j = ptr[i]; j < ptr[i + 1]; ++j)
+        {
+            if (cols[j] < first)
+            {
+                first = cols[j];
+            }
+        }
+
+        profile += i - first;
+    }
+
+    return profile;
+}
+
+#endif
@@ -0,0 +1,342 @@
+#ifndef _SCHEDULER_H
+#define _SCHEDULER_H
+
+#define CL_TARGET_OPENCL_VERSION 300
+#include <CL/cl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <time.h>
+#include <omp.h>
+
+#include "partition.h"
+
+#define NUMBER_OF_BLOCK_SIZES 5
+#define AUTOTUNE_RUNS 3
+
+/*!
+ * \brief Computes units (rows, or COO entries) first_unit to last_unit - 1 of a block.
+ */
+typedef void (*BlockFunction)(int first_unit, int last_unit, void *arguments);
+
+/*!
+ * \brief Splits units into blocks of about block_nonzeroes nonzeroes, a longer row is a block on its own.
+ *        prefix is the row pointer with number_of_units + 1 entries, NULL when every unit is one nonzero.
+ */
+int* create_blocks(const cl_int *prefix, int number_of_units, int block_nonzeroes, int *number_of_blocks)
+{
+    const long long total = prefix == NULL ? number_of_units : (long long)prefix[number_of_units] - prefix[0];
+    int block;
+
+    *number_of_blocks = (int)((total + block_nonzeroes - 1) / block_nonzeroes);
+
+    if (*number_of_blocks < 1)
+    {
+        *number_of_blocks = 1;
+    }
+
+    if (prefix != NULL)
+    {
+        return create_balanced_partition(prefix, number_of_units, *number_of_blocks);
+    }
+
+    int *bounds = (int*)malloc(sizeof(int) * (*number_of_blocks + 1));
+
+    for (block = 0; block < *number_of_blocks; ++block)
+    {
+        bounds[block] = block * block_nonzeroes;
+    }
+
+    bounds[*number_of_blocks] = number_of_units;
+
+    return bounds;
+}
+
+/*!
+ * \brief A deque is the range of block numbers [first, last) packed into one word, so the owner taking from the front
+ *        and thieves taking from the back both finish with a single compare-and-swap.
+ */
+unsigned long long pack_blocks(unsigned int first, unsigned int last)
+{
+    return ((unsigned long long)first << 32) | last;
+}
+
+int pop_block(unsigned long long *deque)
+{
+    unsigned long long range = __atomic_load_n(deque, __ATOMIC_ACQUIRE);
+
+    while ((unsigned int)(range >> 32) < (unsigned int)range)
+    {
+        const unsigned int first = (unsigned int)(range >> 32);
+
+        if (__atomic_compare_exchange_n(deque, &range, pack_blocks(first + 1, (unsigned int)range), false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+        {
+            return (int)first;
+        }
+    }
+
+    return -1;
+}
+
+/*!
+ * \brief Takes the back half of the first non-empty deque after a random victim, keeps one block and puts the rest
+ *        into the (empty) deque of the thief. Returns -1 when every deque was seen empty.
+ */
+int steal_blocks(unsigned long long *deques, int thief, int number_of_threads, unsigned int *seed)
+{
+    const int start = (int)(rand_r(seed) % number_of_threads);
+    int k;
+
+    for (k = 0; k < number_of_threads; ++k)
+    {
+        const int victim = (start + k) % number_of_threads;
+        unsigned long long range = __atomic_load_n(&deques[victim], __ATOMIC_ACQUIRE);
+
+        if (victim == thief)
+        {
+            continue;
+        }
+
+        while ((unsigned int)(range >> 32) < (unsigned int)range)
+        {
+            const unsigned int first = (unsigned int)(range >> 32);
+            const unsigned int last = (unsigned int)range;
+            const unsigned int stolen_first = last - (last - first + 1) / 2;
+
+            if (__atomic_compare_exchange_n(&deques[victim], &range, pack_blocks(first, stolen_first), false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+            {
+                __atomic_store_n(&deques[thief], pack_blocks(stolen_first + 1, last), __ATOMIC_RELEASE);
+                return (int)stolen_first;
+            }
+        }
+    }
+
+    return -1;
+}
+
+/*!
+ * \brief Runs all blocks on number_of_threads threads, each starting with an equal range of blocks and stealing when
+ *        its deque is empty. idle_ms[t] is the time from thread t running out of work until the last thread finished.
+ *        Returns the time in milliseconds.
+ */
+double run_work_stealing(const int *block_bounds, int number_of_blocks, int number_of_threads, BlockFunction compute, void *arguments, double *idle_ms)
+{
+    unsigned long long *deques = (unsigned long long*)malloc(sizeof(unsigned long long) * number_of_threads);
+    struct timespec *finish_times = (struct timespec*)malloc(sizeof(struct timespec) * number_of_threads);
+    struct timespec start_time;
+    struct timespec end_time;
+    int thread;
+
+    for (thread = 0; thread < number_of_threads; ++thread)
+    {
+        deques[thread] = pack_blocks((unsigned int)((long long)number_of_blocks * thread / number_of_threads),
+                                     (unsigned int)((long long)number_of_blocks * (thread + 1) / number_of_threads));
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &start_time);
+
+    for (thread = 0; thread < number_of_threads; ++thread)
+    {
+        finish_times[thread] = start_time;
+    }
+
+    #pragma omp parallel num_threads(number_of_threads) shared(block_bounds, deques, finish_times, compute, arguments)
+    {
+        const int own = omp_get_thread_num();
+        unsigned int seed = (unsigned int)own + 1;
+
+        while (true)
+        {
+            int block = pop_block(&deques[own]);
+
+            if (block < 0)
+            {
+                block = steal_blocks(deques, own, number_of_threads, &seed);
+            }
+
+            if (block < 0)
+            {
+                break;
+            }
+
+            compute(block_bounds[block], block_bounds[block + 1], arguments);
+        }
+
+        clock_gettime(CLOCK_MONOTONIC, &finish_times[own]);
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &end_time);
+
+    for (thread = 0; thread < number_of_threads; ++thread)
+    {
+        idle_ms[thread] = (double)(end_time.tv_nsec - finish_times[thread].tv_nsec) / 1000000 + (double)(end_time.tv_sec - finish_times[thread].tv_sec) * 1000;
+    }
+
+    free(deques);
+    free(finish_times);
+
+    return (double)(end_time.tv_nsec - start_time.tv_nsec) / 1000000 + (double)(end_time.tv_sec - start_time.tv_sec) * 1000;
+}
+
+/*!
+ * \brief Same blocks with an OpenMP schedule, static (equal numbers of blocks) or dynamic (one block at a time).
+ */
+double run_omp_schedule(const int *block_bounds, int number_of_blocks, int number_of_threads, bool dynamic, BlockFunction compute, void *arguments, double *idle_ms)
+{
+    struct timespec *finish_times = (struct timespec*)malloc(sizeof(struct timespec) * number_of_threads);
+    struct timespec start_time;
+    struct timespec end_time;
+    int thread;
+
+    omp_set_schedule(dynamic ? omp_sched_dynamic : omp_sched_static, dynamic ? 1 : 0);
+    clock_gettime(CLOCK_MONOTONIC, &start_time);
+
+    for (thread = 0; thread < number_of_threads; ++thread)
+    {
+        finish_times[thread] = start_time;
+    }
+
+    #pragma omp parallel num_threads(number_of_threads) shared(block_bounds, number_of_blocks, finish_times, compute, arguments)
+    {
+        int block;
+
+        #pragma omp for schedule(runtime) nowait
+        for (block = 0; block < number_of_blocks; ++block)
+        {
+            compute(block_bounds[block], block_bounds[block + 1], arguments);
+        }
+
+        clock_gettime(CLOCK_MONOTONIC, &finish_times[omp_get_thread_num()]);
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &end_time);
+
+    for (thread = 0; thread < number_of_threads; ++thread)
+    {
+        idle_ms[thread] = (double)(end_time.tv_nsec - finish_times[thread].tv_nsec) / 1000000 + (double)(end_time.tv_sec - finish_times[thread].tv_sec) * 1000;
+    }
+
+    free(finish_times);
+
+    return (double)(end_time.tv_nsec - start_time.tv_nsec) / 1000000 + (double)(end_time.tv_sec - start_time.tv_sec) * 1000;
+}
+
+/*!
+ * \brief Tries blocks of 256 to 65536 nonzeroes with work stealing and returns the fastest size.
+ */
+int autotune_block_nonzeroes(const cl_int *prefix, int number_of_units, int number_of_threads, BlockFunction compute, void *arguments)
+{
+    const int block_sizes[NUMBER_OF_BLOCK_SIZES] = { 256, 1024, 4096, 16384, 65536 };
+    double *idle_ms = (double*)malloc(sizeof(double) * number_of_threads);
+    double best_ms = 0;
+    int best_size = block_sizes[0];
+    int size;
+
+    for (size = 0; size < NUMBER_OF_BLOCK_SIZES; ++size)
+    {
+        int number_of_blocks;
+        int *block_bounds = create_blocks(prefix, number_of_units, block_sizes[size], &number_of_blocks);
+        double ms = 0;
+        int run;
+
+        /* fewer blocks than threads leaves threads without work */
+        if (size > 0 && number_of_blocks < number_of_threads)
+        {
+            free(block_bounds);
+            break;
+        }
+
+        for (run = 0; run < AUTOTUNE_RUNS; ++run)
+        {
+            ms += run_work_stealing(block_bounds, number_of_blocks, number_of_threads, compute, arguments, idle_ms);
+        }
+
+        printf("blocks of %d nonzeroes (%d blocks): %.3lf ms\n", block_sizes[size], number_of_blocks, ms / AUTOTUNE_RUNS);
+
+        if (size == 0 || ms < best_ms)
+        {
+            best_ms = ms;
+            best_size = block_sizes[size];
+        }
+
+        free(block_bounds);
+    }
+
+    free(idle_ms);
+
+    return best_size;
+}
+
+/*!
+ * \brief Prints the average time of a schedule with the average and largest idle time of its threads, summed over runs.
+ */
+void print_schedule_times(const char *name, double ms, const double *idle_ms, int number_of_threads, int runs)
+{
+    double sum = 0;
+    double largest = 0;
+    int thread;
+
+    for (thread = 0; thread < number_of_threads; ++thread)
+    {
+        sum += idle_ms[thread];
+
+        if (idle_ms[thread] > largest)
+        {
+            largest = idle_ms[thread];
+        }
+    }
+
+    printf("%-14s %.3lf ms, idle per thread: average %.3lf ms, largest %.3lf ms\n", name, ms / runs, sum / number_of_threads / runs, largest / runs);
+}
+
+/*!
+ * \brief Times OpenMP static, OpenMP dynamic and work stealing over the same autotuned blocks, runs times each.
+ *        result is zeroed before every run (outside the timing), so it holds the work stealing product at the end.
+ */
+void compare_schedules(const cl_int *prefix, int number_of_units, int number_of_threads, int runs, BlockFunction compute, void *arguments, cl_double *result, int result_size)
+{
+    const char *names[3] = { "omp static", "omp dynamic", "work stealing" };
+    double *idle_ms = (double*)malloc(sizeof(double) * number_of_threads);
+    double *idle_sum = (double*)malloc(sizeof(double) * number_of_threads);
+    int number_of_blocks;
+    int schedule;
+
+    const int block_nonzeroes = autotune_block_nonzeroes(prefix, number_of_units, number_of_threads, compute, arguments);
+    int *block_bounds = create_blocks(prefix, number_of_units, block_nonzeroes, &number_of_blocks);
+
+    printf("autotuned blocks of %d nonzeroes, %d blocks, %d threads, %d runs\n", block_nonzeroes, number_of_blocks, number_of_threads, runs);
+
+    for (schedule = 0; schedule < 3; ++schedule)
+    {
+        double ms = 0;
+        int thread;
+        int run;
+
+        for (thread = 0; thread < number_of_threads; ++thread)
+        {
+            idle_sum[thread] = 0;
+        }
+
+        for (run = 0; run < runs; ++run)
+        {
+            memset(result, 0, sizeof(cl_double) * result_size);
+
+            ms += schedule == 2 ? run_work_stealing(block_bounds, number_of_blocks, number_of_threads, compute, arguments, idle_ms)
+                                : run_omp_schedule(block_bounds, number_of_blocks, number_of_threads, schedule == 1, compute, arguments, idle_ms);
+
+            for (thread = 0; thread < number_of_threads; ++thread)
+            {
+                idle_sum[thread] += idle_ms[thread];
+            }
+        }
+
+        print_schedule_times(names[schedule], ms, idle_sum, number_of_threads, runs);
+    }
+
+    free(block_bounds);
+    free(idle_ms);
+    free(idle_sum);
+}
+
+#endif
@@ -0,0 +1,432 @@
+#ifndef _SELECTOR_H
+#define _SELECTOR_H
+
+#define CL_TARGET_OPENCL_VERSION 300
+#include <CL/cl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <math.h>
+
+#include "enums.h"
+#include "formats.h"
+
+#define SELECTOR_SLICE_HEIGHT 32
+#define SELECTOR_BLOCK_SIZE 4
+#define CALIBRATION_PASSES 20
+
+/*!
+ * \brief Row statistics and fill ratios the format choice is made from.
+ */
+typedef struct
+{
+    int number_of_rows;
+    int number_of_columns;
+    int number_of_nonzeroes;
+    double row_mean;
+    double row_variance;
+    int longest_row;
+    int empty_rows;
+    int bandwidth;
+    int number_of_diagonals;
+    double block_fill;
+    double ell_fill;
+    double sell_fill;
+    int hyb_width;
+    double hyb_coo_share;
+} MatrixFeatures;
+
+/*!
+ * \brief Rules of select_format, checked in this order; the first one that holds picks the format and CSR is the fallback.
+ *        CooRowMean: row mean below it. EllFill, SellFill: fill at or above it. HybCooShare: COO part at most it.
+ *        CmrsRowMean: row mean at most it.
+ */
+typedef enum
+{
+    CooRowMean,
+    EllFill,
+    SellFill,
+    HybCooShare,
+    CmrsRowMean,
+    NumberOfThresholds
+} Threshold;
+
+typedef struct
+{
+    size_t global_work_size;
+    size_t local_work_size;
+    int slice_height;
+    int strip_height;
+    int hyb_width;
+} LaunchParameters;
+
+const char *spmv_format_names[NumberOfFormats] = { "coo", "csr", "ell", "sell", "cmrs", "hyb" };
+const char *threshold_names[NumberOfThresholds] = { "coo_row_mean", "ell_fill", "sell_fill", "hyb_coo_share", "cmrs_row_mean" };
+
+/*!
+ * \brief Computes the features of a CSR matrix in one pass over the rows (and one block count for block_fill).
+ *        The HYB width is the largest one reached by at least a third of the rows, as for the ELL part of HYB on GPUs.
+ */
+void extract_features(cl_int *ptr, cl_int *cols, int number_of_rows, int number_of_columns, MatrixFeatures *features)
+{
+    const int number_of_nonzeroes = ptr[number_of_rows];
+    char *diagonals = (char*)calloc((size_t)number_of_rows + number_of_columns, sizeof(char));
+    long long sell_slots = 0;
+    double sum_of_squares = 0;
+    int slice_longest = 0;
+    int i;
+    int j;
+
+    features->number_of_rows = number_of_rows;
+    features->number_of_columns = number_of_columns;
+    features->number_of_nonzeroes = number_of_nonzeroes;
+    features->longest_row = 0;
+    features->empty_rows = 0;
+    features->bandwidth = 0;
+    features->number_of_diagonals = 0;
+
+    for (i = 0; i < number_of_rows; ++i)
+    {
+        const int row_length = ptr[i + 1] - ptr[i];
+
+        sum_of_squares += (double)row_length * row_length;
+        features->longest_row = row_length > features->longest_row ? row_length : features->longest_row;
+        features->empty_rows += row_length == 0;
+        slice_longest = row_length > slice_longest ? row_length : slice_longest;
+
+        if (i % SELECTOR_SLICE_HEIGHT == SELECTOR_SLICE_HEIGHT - 1 || i == number_of_rows - 1)
+        {
+            sell_slots += (long long)slice_longest * SELECTOR_SLICE_HEIGHT;
+            slice_longest = 0;
+        }
+
+        for (j = ptr[i]; j < ptr[i + 1]; ++j)
+        {
+            const int distance = cols[j] > i ? cols[j] - i : i - cols[j];
+            const int diagonal = cols[j] - i + number_of_rows;
+
+            features->bandwidth = distance > features->bandwidth ? distance : features->bandwidth;
+            features->number_of_diagonals += diagonals[diagonal] == 0;
+            diagonals[diagonal] = 1;
+        }
+    }
+
+    free(diagonals);
+
+    features->row_mean = number_of_rows > 0 ? (double)number_of_nonzeroes / number_of_rows : 0;
+    features->row_variance = number_of_rows > 0 ? sum_of_squares / number_of_rows - features->row_mean * features->row_mean : 0;
+
+    const long number_of_blocks = count_bcsr_blocks(ptr, cols, number_of_rows, number_of_columns, SELECTOR_BLOCK_SIZE, SELECTOR_BLOCK_SIZE);
+
+    features->block_fill = number_of_blocks > 0 ? (double)number_of_nonzeroes / ((double)number_of_blocks * SELECTOR_BLOCK_SIZE * SELECTOR_BLOCK_SIZE) : 0;
+    features->ell_fill = features->longest_row > 0 ? (double)number_of_nonzeroes / ((double)features->longest_row * number_of_rows) : 1;
+    features->sell_fill = sell_slots > 0 ? (double)number_of_nonzeroes / sell_slots : 1;
+
+    /* rows_reaching[w] is the number of rows with at least w elements */
+    int *rows_reaching = (int*)calloc(features->longest_row + 2, sizeof(int));
+    long long coo_entries = 0;
+
+    for (i = 0; i < number_of_rows; ++i)
+    {
+        rows_reaching[ptr[i + 1] - ptr[i]]++;
+    }
+
+    for (i = features->longest_row - 1; i >= 0; --i)
+    {
+        rows_reaching[i] += rows_reaching[i + 1];
+    }
+
+    features->hyb_width = 0;
+
+    for (i = features->longest_row; i > 0; --i)
+    {
+        if (rows_reaching[i] >= (number_of_rows + 2) / 3)
+        {
+            features->hyb_width = i;
+            break;
+        }
+    }
+
+    for (i = features->hyb_width + 1; i <= features->longest_row; ++i)
+    {
+        coo_entries += rows_reaching[i];
+    }
+
+    features->hyb_coo_share = number_of_nonzeroes > 0 ? (double)coo_entries / number_of_nonzeroes : 0;
+
+    free(rows_reaching);
+}
+
+void print_features(const MatrixFeatures *features)
+{
+    printf("rows %d, columns %d, nonzeroes %d\n", features->number_of_rows, features->number_of_columns, features->number_of_nonzeroes);
+    printf("row length: mean %.2lf, variance %.2lf, longest %d, empty rows %d\n", features->row_mean, features->row_variance, features->longest_row, features->empty_rows);
+    printf("bandwidth %d, diagonals %d, %dx%d block fill %.3lf\n", features->bandwidth, features->number_of_diagonals, SELECTOR_BLOCK_SIZE, SELECTOR_BLOCK_SIZE, features->block_fill);
+    printf("ELL fill %.3lf, SELL-%d fill %.3lf, HYB width %d with %.1lf%% of the nonzeroes in COO\n",
+           features->ell_fill, SELECTOR_SLICE_HEIGHT, features->sell_fill, features->hyb_width, 100 * features->hyb_coo_share);
+}
+
+void set_default_thresholds(double *thresholds)
+{
+    thresholds[CooRowMean] = 2;
+    thresholds[EllFill] = 0.8;
+    thresholds[SellFill] = 0.8;
+    thresholds[HybCooShare] = 0.1;
+    thresholds[CmrsRowMean] = 16;
+}
+
+/*!
+ * \brief Reads "name value" lines written by write_thresholds, thresholds missing from the file keep their value.
+ */
+bool read_thresholds(const char *filename, double *thresholds)
+{
+    FILE *file = fopen(filename, "r");
+    char name[64];
+    double value;
+
+    if (file == NULL)
+    {
+        return false;
+    }
+
+    while (fscanf(file, "%63s %lf", name, &value) == 2)
+    {
+        int t;
+
+        for (t = 0; t < NumberOfThresholds; ++t)
+        {
+            if (strcmp(name, threshold_names[t]) == 0)
+            {
+                thresholds[t] = value;
+            }
+        }
+    }
+
+    fclose(file);
+
+    return true;
+}
+
+bool write_thresholds(const char *filename, const double *thresholds)
+{
+    FILE *file = fopen(filename, "w");
+    int t;
+
+    if (file == NULL)
+    {
+        printf("cannot write %s\n", filename);
+        return false;
+    }
+
+    for (t = 0; t < NumberOfThresholds; ++t)
+    {
+        fprintf(file, "%s %.17g\n", threshold_names[t], thresholds[t]);
+    }
+
+    fclose(file);
+
+    return true;
+}
+
+SpmvFormat select_format(const MatrixFeatures *features, const double *thresholds)
+{
+    if (features->row_mean < thresholds[CooRowMean])
+    {
+        return CooFormat;
+    }
+
+    if (features->ell_fill >= thresholds[EllFill])
+    {
+        return EllFormat;
+    }
+
+    if (features->sell_fill >= thresholds[SellFill])
+    {
+        return SellFormat;
+    }
+
+    if (features->hyb_width > 0 && features->hyb_coo_share <= thresholds[HybCooShare])
+    {
+        return HybFormat;
+    }
+
+    if (features->row_mean <= thresholds[CmrsRowMean])
+    {
+        return CmrsFormat;
+    }
+
+    return CsrFormat;
+}
+
+/*!
+ * \brief Launch sizes of the kernels of kernels/Coo.cl, Csr.cl, Ell.cl, Sigma_C.cl and Cmrs.cl: one work-item per COO entry or
+ *        CSR row, a work-group of 16 per ELL row, of 4 * strip height per CMRS strip and of slice height per SELL slice. CMRS
+ *        strips get fewer rows when rows are long. Sizes are capped at 2048 work-items per compute unit (the kernels loop over
+ *        the rest), except for SELL, where every slice needs its own work-group.
+ */
+void select_launch_parameters(const MatrixFeatures *features, SpmvFormat format, cl_uint compute_units, LaunchParameters *parameters)
+{
+    const size_t largest_global_work_size = (size_t)compute_units * 2048;
+    size_t work_items;
+
+    parameters->slice_height = SELECTOR_SLICE_HEIGHT;
+    parameters->strip_height = features->row_mean > 16 ? 4 : 8;
+    parameters->hyb_width = features->hyb_width;
+
+    switch (format)
+    {
+        case CooFormat:
+            parameters->local_work_size = 64;
+            work_items = features->number_of_nonzeroes;
+            break;
+        case EllFormat:
+        case HybFormat:
+            parameters->local_work_size = 16;
+            work_items = (size_t)features->number_of_rows * parameters->local_work_size;
+            break;
+        case SellFormat:
+            parameters->local_work_size = parameters->slice_height;
+            parameters->global_work_size = (size_t)(features->number_of_rows + parameters->slice_height - 1) / parameters->slice_height * parameters->slice_height;
+            return;
+        case CmrsFormat:
+            parameters->local_work_size = 4 * parameters->strip_height;
+            work_items = (size_t)(features->number_of_rows + parameters->strip_height - 1) / parameters->strip_height * parameters->local_work_size;
+            break;
+        default:
+            parameters->local_work_size = 256;
+            work_items = features->number_of_rows;
+            break;
+    }
+
+    work_items = work_items < largest_global_work_size ? work_items : largest_global_work_size;
+    parameters->global_work_size = (work_items + parameters->local_work_size - 1) / parameters->local_work_size * parameters->local_work_size;
+
+    if (parameters->global_work_size == 0)
+    {
+        parameters->global_work_size = parameters->local_work_size;
+    }
+}
+
+/*!
+ * \brief Sum over the matrices of the time of the selected format relative to the fastest one (1 per matrix is perfect).
+ */
+double score_thresholds(const MatrixFeatures *features, const double (*format_ms)[NumberOfFormats], int number_of_matrices, const double *thresholds)
+{
+    double score = 0;
+    int m;
+
+    for (m = 0; m < number_of_matrices; ++m)
+    {
+        double best_ms = format_ms[m][0];
+        int f;
+
+        for (f = 1; f < NumberOfFormats; ++f)
+        {
+            best_ms = format_ms[m][f] < best_ms ? format_ms[m][f] : best_ms;
+        }
+
+        score += format_ms[m][select_format(&features[m], thresholds)] / best_ms;
+    }
+
+    return score;
+}
+
+/*!
+ * \brief Descent from the given thresholds, every pass makes the single change that improves the score most. Candidates for a
+ *        threshold are the feature values of the matrices (so the rule just includes a matrix) and the disabling value. Returns the score.
+ */
+double descend_thresholds(const MatrixFeatures *features, const double (*format_ms)[NumberOfFormats], int number_of_matrices, const double *disabled, double *thresholds)
+{
+    double best_score = score_thresholds(features, format_ms, number_of_matrices, thresholds);
+    int pass;
+
+    for (pass = 0; pass < CALIBRATION_PASSES; ++pass)
+    {
+        int best_threshold = -1;
+        double best_value = 0;
+        int t;
+
+        for (t = 0; t < NumberOfThresholds; ++t)
+        {
+            const double previous = thresholds[t];
+            int m;
+
+            for (m = -1; m < number_of_matrices; ++m)
+            {
+                double score;
+
+                if (m < 0)
+                {
+                    thresholds[t] = disabled[t];
+                }
+                else
+                {
+                    switch (t)
+                    {
+                        case CooRowMean:
+                            thresholds[t] = nextafter(features[m].row_mean, INFINITY);
+                            break;
+                        case EllFill:
+                            thresholds[t] = features[m].ell_fill;
+                            break;
+                        case SellFill:
+                            thresholds[t] = features[m].sell_fill;
+                            break;
+                        case HybCooShare:
+                            thresholds[t] = features[m].hyb_coo_share;
+                            break;
+                        default:
+                            thresholds[t] = features[m].row_mean;
+                            break;
+                    }
+                }
+
+                score = score_thresholds(features, format_ms, number_of_matrices, thresholds);
+
+                if (score < best_score)
+                {
+                    best_score = score;
+                    best_threshold = t;
+                    best_value = thresholds[t];
+                }
+            }
+
+            thresholds[t] = previous;
+        }
+
+        if (best_threshold < 0)
+        {
+            break;
+        }
+
+        thresholds[best_threshold] = best_value;
+    }
+
+    return best_score;
+}
+
+/*!
+ * \brief Trains the thresholds on measured times. An earlier rule can hide a better later one from single changes, so the descent
+ *        runs from the given thresholds and from every rule disabled (CSR everywhere), and the better result is kept. Returns its score.
+ */
+double calibrate_thresholds(const MatrixFeatures *features, const double (*format_ms)[NumberOfFormats], int number_of_matrices, double *thresholds)
+{
+    const double disabled[NumberOfThresholds] = { 0, 2, 2, -1, -1 };
+    double from_disabled[NumberOfThresholds];
+
+    memcpy(from_disabled, disabled, sizeof(from_disabled));
+
+    const double score = descend_thresholds(features, format_ms, number_of_matrices, disabled, thresholds);
+    const double disabled_score = descend_thresholds(features, format_ms, number_of_matrices, disabled, from_disabled);
+
+    if (disabled_score < score)
+    {
+        memcpy(thresholds, from_disabled, sizeof(from_disabled));
+        return disabled_score;
+    }
+
+    return score;
+}
+
+#endif
@@ -0,0 +1,48 @@
+#ifndef _KERNEL_ATOMIC_H
+#define _KERNEL_ATOMIC_H
+
+#pragma OPENCL EXTENSION cl_khr_int64_base_atomics: enable
+
+/* adds delta to *valq with a compare-and-swap loop, OpenCL has no floating point atomic add */
+double __attribute__((overloadable)) atomic_add(__global double *valq, double delta)
+{
+   union {
+     double f;
+     unsigned long i;
+   } old_value;
+
+   union {
+     double f;
+     unsigned long i;
+   } new_value;
+
+  do {
+     old_value.f = *valq;
+     new_value.f = old_value.f + delta;
+   } while (atom_cmpxchg((volatile __global unsigned long *)valq, old_value.i, new_value.i) != old_value.i);
+
+   return old_value.f;
+}
+
+/* the same for local memory */
+double atomic_add_local(__local double *valq, double delta)
+{
+   union {
+     double f;
+     unsigned long i;
+   } old_value;
+
+   union {
+     double f;
+     unsigned long i;
+   } new_value;
+
+  do {
+     old_value.f = *valq;
+     new_value.f = old_value.f + delta;
+   } while (atom_cmpxchg((volatile __local unsigned long *)valq, old_value.i, new_value.i) != old_value.i);
+
+   return old_value.f;
+}
+
+#endif
@@ -0,0 +1,52 @@
+#include "Precision.h"
+
+#ifndef BLOCK_ROWS
+#define BLOCK_ROWS 3
+#endif
+
+#ifndef BLOCK_COLS
+#define BLOCK_COLS 3
+#endif
+
+__kernel void bcsr(__global const int *block_ptr, __global const int *block_col, __global const value_t *block_data, __global const vector_t *vect, __global double *output, const int N)
+{
+    size_t i;
+
+    for (i = get_global_id(0); i < N; i += get_global_size(0))
+    {
+        double sum[BLOCK_ROWS];
+        int r;
+        int c;
+        int j;
+
+        #pragma unroll
+        for (r = 0; r < BLOCK_ROWS; ++r)
+        {
+            sum[r] = 0;
+        }
+
+        for (j = block_ptr[i]; j < block_ptr[i+1]; ++j)
+        {
+            const int block = j * (BLOCK_ROWS * BLOCK_COLS);
+            const int first_col = block_col[j] * BLOCK_COLS;
+
+            #pragma unroll
+            for (c = 0; c < BLOCK_COLS; ++c)
+            {
+                const double x = LOAD_VECTOR(vect, first_col + c);
+
+                #pragma unroll
+                for (r = 0; r < BLOCK_ROWS; ++r)
+                {
+                    sum[r] += LOAD_VALUE(block_data, block + r * BLOCK_COLS + c) * x;
+                }
+            }
+        }
+
+        #pragma unroll
+        for (r = 0; r < BLOCK_ROWS; ++r)
+        {
+            output[i * BLOCK_ROWS + r] = sum[r];
+        }
+    }
+}
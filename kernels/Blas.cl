@@ -0,0 +1,112 @@
+#include "Reduction.h"
+
+/*
+ * Dense vector operations on double vectors of length N. Reductions are done in two steps:
+ * dot_partials leaves one partial sum per work-group and sum_partials, run as a single
+ * work-group, adds them up, so the result stays on the device.
+ */
+
+/* y = alpha * x + beta * y, y is not read when beta is 0 */
+__kernel void axpby(__global const double *x, __global double *y, const double alpha, const double beta, const int N)
+{
+    size_t i;
+
+    for (i = get_global_id(0); i < N; i += get_global_size(0))
+    {
+        y[i] = beta == 0 ? alpha * x[i] : alpha * x[i] + beta * y[i];
+    }
+}
+
+__kernel void dot_partials(__global const double *x, __global const double *y, __global double *partials, const int N, __local double *partial_data)
+{
+    double sum = 0;
+    size_t i;
+
+    for (i = get_global_id(0); i < N; i += get_global_size(0))
+    {
+        sum += x[i] * y[i];
+    }
+
+    sum = reduce_work_group(sum, partial_data);
+
+    if (get_local_id(0) == 0)
+    {
+        partials[get_group_id(0)] = sum;
+    }
+}
+
+/* result[index] = sum of the first N partials */
+__kernel void sum_partials(__global const double *partials, __global double *result, const int index, const int N, __local double *partial_data)
+{
+    double sum = 0;
+    size_t i;
+
+    for (i = get_local_id(0); i < N; i += get_local_size(0))
+    {
+        sum += partials[i];
+    }
+
+    sum = reduce_work_group(sum, partial_data);
+
+    if (get_local_id(0) == 0)
+    {
+        result[index] = sum;
+    }
+}
+
+/* z = inv_diag * r (Jacobi preconditioner), leaves partial sums of dot(r, z) and dot(r, r) */
+__kernel void jacobi_dot_partials(__global const double *r, __global const double *inv_diag, __global double *z, __global double *rz_partials, __global double *rr_partials, const int N, __local double *partial_data)
+{
+    double rz = 0;
+    double rr = 0;
+    size_t i;
+
+    for (i = get_global_id(0); i < N; i += get_global_size(0))
+    {
+        const double value = inv_diag[i] * r[i];
+
+        z[i] = value;
+        rz += r[i] * value;
+        rr += r[i] * r[i];
+    }
+
+    rz = reduce_work_group(rz, partial_data);
+    rr = reduce_work_group(rr, partial_data);
+
+    if (get_local_id(0) == 0)
+    {
+        rz_partials[get_group_id(0)] = rz;
+        rr_partials[get_group_id(0)] = rr;
+    }
+}
+
+/*
+ * Steps of a (preconditioned) conjugate gradient iteration which read their scalars from the device,
+ * so the host does not wait for them: scalars[rz_index] is dot(r, z) of the current iteration,
+ * scalars[pq_index] is dot(p, A * p) and scalars[rz_next_index] is dot(r, z) of the next one.
+ */
+
+/* x += alpha * p, r -= alpha * q with alpha = dot(r, z) / dot(p, q) */
+__kernel void cg_update_solution(__global double *x, __global double *r, __global const double *p, __global const double *q, __global const double *scalars, const int rz_index, const int pq_index, const int N)
+{
+    const double alpha = scalars[rz_index] / scalars[pq_index];
+    size_t i;
+
+    for (i = get_global_id(0); i < N; i += get_global_size(0))
+    {
+        x[i] += alpha * p[i];
+        r[i] -= alpha * q[i];
+    }
+}
+
+/* p = z + beta * p with beta = dot(r, z) of the next iteration / dot(r, z) of the current one */
+__kernel void cg_update_direction(__global double *p, __global const double *z, __global const double *scalars, const int rz_index, const int rz_next_index, const int N)
+{
+    const double beta = scalars[rz_next_index] / scalars[rz_index];
+    size_t i;
+
+    for (i = get_global_id(0); i < N; i += get_global_size(0))
+    {
+        p[i] = z[i] + beta * p[i];
+    }
+}
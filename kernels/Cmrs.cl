@@ -1,6 +1,17 @@
-__kernel void cmrs(__global const double *data, __global const int *indices, __global const int *strip_ptr, __global const int *row_in_strip, __global const double *vect, __global double *output, const int N, const int height, __local double *partial_data)
+#include "Precision.h"
+
+__kernel void cmrs(__global const value_t *data, __global const int *indices, __global const int *strip_ptr, __global const int *row_in_strip, __global const vector_t *vect, __global double *output, const int N, const int height, __local double *partial_data)
 {
     size_t i;
+    int row;
+
+    /* local memory starts undefined, every strip below leaves it zeroed again */
+    for (row = 0; row < height; ++row)
+    {
+        partial_data[get_local_id(0) * height + row] = 0;
+    }
+
+    barrier(CLK_LOCAL_MEM_FENCE);
     
     for (i = get_group_id(0); i < N; i += get_num_groups(0))
     {
@@ -15,7 +26,7 @@ __kernel void cmrs(__global const double *data, __global const int *indices, __g
             const int current_index = strip_start + j;
             const int strip_row = row_in_strip[current_index];
             
-            partial_data[(get_local_id(0) * height) + strip_row] += data[current_index] * vect[indices[current_index]];
+            partial_data[(get_local_id(0) * height) + strip_row] += LOAD_VALUE(data, current_index) * LOAD_VECTOR(vect, indices[current_index]);
         }
         
         barrier(CLK_LOCAL_MEM_FENCE);
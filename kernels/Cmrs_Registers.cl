@@ -0,0 +1,113 @@
+#ifdef USE_SUBGROUPS
+#pragma OPENCL EXTENSION cl_khr_subgroups : enable
+#endif
+
+#include "Precision.h"
+#include "Indices.h"
+#include "Reduction.h"
+
+double reduce_strip_row(double sum, __local double *partial_data)
+{
+#ifdef USE_SUBGROUPS
+    (void)partial_data;
+
+    return sub_group_reduce_add(sum);
+#else
+    return reduce_work_group(sum, partial_data);
+#endif
+}
+
+/*
+ * Elements of a strip are sorted by row, so every work-item walks its elements row after row and keeps
+ * only the sum of the current strip row in a register. The sums are reduced once per strip row by a
+ * sub-group (one strip per sub-group), or by the whole work-group when sub-groups are not supported,
+ * which needs local_size doubles of local memory whatever the height.
+ */
+__kernel void cmrs_registers(__global const value_t *data, __global const int *indices, __global const int *strip_ptr, __global const int *row_in_strip, __global const vector_t *vect, __global double *output, const int N, const int height, const int number_of_rows, __local double *partial_data)
+{
+#ifdef USE_SUBGROUPS
+    const size_t lane = get_sub_group_local_id();
+    const size_t number_of_lanes = get_sub_group_size();
+    const size_t first_strip = get_group_id(0) * get_num_sub_groups() + get_sub_group_id();
+    const size_t strip_step = get_num_groups(0) * get_num_sub_groups();
+#else
+    const size_t lane = get_local_id(0);
+    const size_t number_of_lanes = get_local_size(0);
+    const size_t first_strip = get_group_id(0);
+    const size_t strip_step = get_num_groups(0);
+#endif
+    size_t i;
+
+    for (i = first_strip; i < N; i += strip_step)
+    {
+        const int strip_end = strip_ptr[i + 1];
+        int current_index = strip_ptr[i] + lane;
+        int strip_row;
+
+        for (strip_row = 0; strip_row < height; ++strip_row)
+        {
+            const int row = i * height + strip_row;
+            double sum = 0;
+
+            while (current_index < strip_end && row_in_strip[current_index] == strip_row)
+            {
+                sum += LOAD_VALUE(data, current_index) * LOAD_VECTOR(vect, indices[current_index]);
+                current_index += number_of_lanes;
+            }
+
+            sum = reduce_strip_row(sum, partial_data);
+
+            if (lane == 0 && row < number_of_rows)
+            {
+                output[row] = sum;
+            }
+        }
+    }
+}
+
+/*
+ * cmrs_registers with columns stored as 16-bit offsets from a per-strip base.
+ */
+__kernel void cmrs_registers_compressed(__global const value_t *data, __global const ushort *deltas, __global const int *bases, __global const int *escaped_cols, __global const int *strip_ptr, __global const int *row_in_strip, __global const vector_t *vect, __global double *output, const int N, const int height, const int number_of_rows, __local double *partial_data)
+{
+#ifdef USE_SUBGROUPS
+    const size_t lane = get_sub_group_local_id();
+    const size_t number_of_lanes = get_sub_group_size();
+    const size_t first_strip = get_group_id(0) * get_num_sub_groups() + get_sub_group_id();
+    const size_t strip_step = get_num_groups(0) * get_num_sub_groups();
+#else
+    const size_t lane = get_local_id(0);
+    const size_t number_of_lanes = get_local_size(0);
+    const size_t first_strip = get_group_id(0);
+    const size_t strip_step = get_num_groups(0);
+#endif
+    size_t i;
+
+    for (i = first_strip; i < N; i += strip_step)
+    {
+        const int strip_start = strip_ptr[i];
+        const int strip_end = strip_ptr[i + 1];
+        const int base = bases[i];
+        int current_index = strip_start + lane;
+        int strip_row;
+
+        for (strip_row = 0; strip_row < height; ++strip_row)
+        {
+            const int row = i * height + strip_row;
+            double sum = 0;
+
+            while (current_index < strip_end && row_in_strip[current_index] == strip_row)
+            {
+                sum += LOAD_VALUE(data, current_index) * LOAD_VECTOR(vect, load_column(deltas, escaped_cols, base, current_index, strip_start));
+                current_index += number_of_lanes;
+            }
+
+            sum = reduce_strip_row(sum, partial_data);
+
+            if (lane == 0 && row < number_of_rows)
+            {
+                output[row] = sum;
+            }
+        }
+    }
+}
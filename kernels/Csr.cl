@@ -1,4 +1,9 @@
-__kernel void csr(__global const int *ptr, __global const int *col, __global const double *data, __global const double *vect, __global double *output, const int N)
+#include "Precision.h"
+#include "Indices.h"
+#include "Reduction.h"
+#include "Dictionary.h"
+
+__kernel void csr(__global const int *ptr, __global const int *col, __global const value_t *data, __global const vector_t *vect, __global double *output, const int N)
 {
     size_t i;
     
@@ -9,9 +14,142 @@ __kernel void csr(__global const int *ptr, __global const int *col, __global con
         
         for (j = ptr[i]; j < ptr[i+1]; ++j)
         {
-            sum += data[j] * vect[col[j]];
+            sum += LOAD_VALUE(data, j) * LOAD_VECTOR(vect, col[j]);
         }
         
         output[i] = sum;
     }
 }
+
+__kernel void csr_compressed(__global const int *ptr, __global const ushort *deltas, __global const int *bases, __global const int *escaped_cols, __global const value_t *data, __global const vector_t *vect, __global double *output, const int N)
+{
+    size_t i;
+    
+    for (i = get_global_id(0); i < N; i += get_global_size(0))
+    {
+        const int row_start = ptr[i];
+        const int base = bases[i];
+        double sum = 0;
+        int j;
+        
+        for (j = row_start; j < ptr[i+1]; ++j)
+        {
+            sum += LOAD_VALUE(data, j) * LOAD_VECTOR(vect, load_column(deltas, escaped_cols, base, j, row_start));
+        }
+        
+        output[i] = sum;
+    }
+}
+
+/* y = alpha * A * x + beta * y, y is not read when beta is 0 */
+__kernel void csr_axpby(__global const int *ptr, __global const int *col, __global const value_t *data, __global const vector_t *vect, __global double *output, const int N, const double alpha, const double beta)
+{
+    size_t i;
+    
+    for (i = get_global_id(0); i < N; i += get_global_size(0))
+    {
+        double sum = 0;
+        int j;
+        
+        for (j = ptr[i]; j < ptr[i+1]; ++j)
+        {
+            sum += LOAD_VALUE(data, j) * LOAD_VECTOR(vect, col[j]);
+        }
+        
+        output[i] = beta == 0 ? alpha * sum : alpha * sum + beta * output[i];
+    }
+}
+
+/* csr_axpby which also leaves the sum of x[i] * (A * x)[i] over the rows of every work-group in dot_partials */
+__kernel void csr_axpby_dot(__global const int *ptr, __global const int *col, __global const value_t *data, __global const vector_t *vect, __global double *output, const int N, const double alpha, const double beta, __global double *dot_partials, __local double *partial_data)
+{
+    double dot = 0;
+    size_t i;
+    
+    for (i = get_global_id(0); i < N; i += get_global_size(0))
+    {
+        double sum = 0;
+        int j;
+        
+        for (j = ptr[i]; j < ptr[i+1]; ++j)
+        {
+            sum += LOAD_VALUE(data, j) * LOAD_VECTOR(vect, col[j]);
+        }
+        
+        output[i] = beta == 0 ? alpha * sum : alpha * sum + beta * output[i];
+        dot += LOAD_VECTOR(vect, i) * sum;
+    }
+
+    dot = reduce_work_group(dot, partial_data);
+
+    if (get_local_id(0) == 0)
+    {
+        dot_partials[get_group_id(0)] = dot;
+    }
+}
+
+/* pattern matrix: every entry is value, so only columns are read and the row sum is scaled once */
+__kernel void csr_pattern(__global const int *ptr, __global const int *col, __global const vector_t *vect, __global double *output, const int N, const double value)
+{
+    size_t i;
+
+    for (i = get_global_id(0); i < N; i += get_global_size(0))
+    {
+        double sum = 0;
+        int j;
+
+        for (j = ptr[i]; j < ptr[i+1]; ++j)
+        {
+            sum += LOAD_VECTOR(vect, col[j]);
+        }
+
+        output[i] = value * sum;
+    }
+}
+
+/* values as codes into the dictionary of distinct values */
+__kernel void csr_dictionary(__global const int *ptr, __global const int *col, __global const code_t *codes, __constant double *dictionary, __global const vector_t *vect, __global double *output, const int N)
+{
+    size_t i;
+
+    for (i = get_global_id(0); i < N; i += get_global_size(0))
+    {
+        double sum = 0;
+        int j;
+
+        for (j = ptr[i]; j < ptr[i+1]; ++j)
+        {
+            sum += dictionary[codes[j]] * LOAD_VECTOR(vect, col[j]);
+        }
+
+        output[i] = sum;
+    }
+}
+
+/* one column panel of the column-blocked format: the panel's part of the vector is copied into local memory once per
+ * work-group, every segment is the part of one row inside the panel and adds to output (zeroed before the first panel) */
+__kernel void csr_column_panel(__global const int *segment_rows, __global const int *segment_ptr, __global const int *col, __global const value_t *data, __global const vector_t *vect, __global double *output, const int first_segment, const int number_of_segments, const int first_column, const int panel_width, __local double *tile)
+{
+    size_t i;
+
+    for (i = get_local_id(0); i < panel_width; i += get_local_size(0))
+    {
+        tile[i] = LOAD_VECTOR(vect, first_column + i);
+    }
+
+    barrier(CLK_LOCAL_MEM_FENCE);
+
+    for (i = get_global_id(0); i < number_of_segments; i += get_global_size(0))
+    {
+        const int segment = first_segment + i;
+        double sum = 0;
+        int j;
+
+        for (j = segment_ptr[segment]; j < segment_ptr[segment + 1]; ++j)
+        {
+            sum += LOAD_VALUE(data, j) * tile[col[j] - first_column];
+        }
+
+        output[segment_rows[segment]] += sum;
+    }
+}
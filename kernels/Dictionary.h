@@ -0,0 +1,20 @@
+#ifndef _KERNEL_DICTIONARY_H
+#define _KERNEL_DICTIONARY_H
+
+/*
+ * Values replaced by codes into a table of the distinct values (create_value_dictionary in
+ * inc/formats.h). The width of the codes is chosen at build time with -DVALUE_CODE_BITS=8 or 16,
+ * the table is passed as __constant, so it is cached close to the cores.
+ */
+
+#ifndef VALUE_CODE_BITS
+#define VALUE_CODE_BITS 8
+#endif
+
+#if VALUE_CODE_BITS == 16
+typedef ushort code_t;
+#else
+typedef uchar code_t;
+#endif
+
+#endif /* _KERNEL_DICTIONARY_H */
@@ -0,0 +1,19 @@
+#ifndef _KERNEL_INDICES_H
+#define _KERNEL_INDICES_H
+
+/*
+ * Columns compressed by compress_column_indices (inc/formats.h): element j, which is element
+ * j - segment_start of its row, slice or strip, is base + deltas[j], unless the segment spans
+ * too many columns and was escaped to 32-bit columns, which is marked by a negative base.
+ */
+int load_column(__global const ushort *deltas, __global const int *escaped_cols, const int base, const int j, const int segment_start)
+{
+    if (base >= 0)
+    {
+        return base + deltas[j];
+    }
+
+    return escaped_cols[j - segment_start - 1 - base];
+}
+
+#endif /* _KERNEL_INDICES_H */
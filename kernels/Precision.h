@@ -0,0 +1,45 @@
+#ifndef _KERNEL_PRECISION_H
+#define _KERNEL_PRECISION_H
+
+/*
+ * Storage precision of the matrix values and of the vector, chosen at build time with
+ * -DVALUE_PRECISION and -DVECTOR_PRECISION (values of the Precision enum in inc/enums.h).
+ * Values are always widened to double when loaded, so the accumulation stays in double.
+ * Half values are read with vload_half, which does not need cl_khr_fp16.
+ */
+
+#define PRECISION_DOUBLE 0
+#define PRECISION_SINGLE 1
+#define PRECISION_HALF   2
+
+#ifndef VALUE_PRECISION
+#define VALUE_PRECISION PRECISION_DOUBLE
+#endif
+
+#ifndef VECTOR_PRECISION
+#define VECTOR_PRECISION PRECISION_DOUBLE
+#endif
+
+#if VALUE_PRECISION == PRECISION_HALF
+typedef half value_t;
+#define LOAD_VALUE(data, i) ((double)vload_half((i), (data)))
+#elif VALUE_PRECISION == PRECISION_SINGLE
+typedef float value_t;
+#define LOAD_VALUE(data, i) ((double)(data)[i])
+#else
+typedef double value_t;
+#define LOAD_VALUE(data, i) ((data)[i])
+#endif
+
+#if VECTOR_PRECISION == PRECISION_HALF
+typedef half vector_t;
+#define LOAD_VECTOR(vect, i) ((double)vload_half((i), (vect)))
+#elif VECTOR_PRECISION == PRECISION_SINGLE
+typedef float vector_t;
+#define LOAD_VECTOR(vect, i) ((double)(vect)[i])
+#else
+typedef double vector_t;
+#define LOAD_VECTOR(vect, i) ((vect)[i])
+#endif
+
+#endif /* _KERNEL_PRECISION_H */
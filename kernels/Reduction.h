@@ -0,0 +1,34 @@
+#ifndef _KERNEL_REDUCTION_H
+#define _KERNEL_REDUCTION_H
+
+/*
+ * Sums value over the work-group, every work-item gets the sum. partial_data holds local_size
+ * doubles and local_size must be a power of two; all work-items of the group must call it.
+ */
+double reduce_work_group(double value, __local double *partial_data)
+{
+    const size_t local_id = get_local_id(0);
+    size_t step;
+
+    partial_data[local_id] = value;
+
+    barrier(CLK_LOCAL_MEM_FENCE);
+
+    for (step = get_local_size(0) / 2; step > 0; step >>= 1)
+    {
+        if (local_id < step)
+        {
+            partial_data[local_id] += partial_data[local_id + step];
+        }
+
+        barrier(CLK_LOCAL_MEM_FENCE);
+    }
+
+    value = partial_data[0];
+
+    barrier(CLK_LOCAL_MEM_FENCE);
+
+    return value;
+}
+
+#endif /* _KERNEL_REDUCTION_H */
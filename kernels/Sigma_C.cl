@@ -1,4 +1,74 @@
-__kernel void sigma_c(__global const double* data, __global const int* indices, __global const double* vect, __global double *output, __global const int *row_indices, const int C)
+#include "Precision.h"
+#include "Indices.h"
+#include "Reduction.h"
+#include "Dictionary.h"
+
+__kernel void sigma_c(__global const value_t *data, __global const int *indices, __global const vector_t *vect, __global double *output, __global const int *row_indices, const int C)
+{
+    size_t i = get_group_id(0);
+
+    const int index_offset = row_indices[i];
+    const int row_size = row_indices[i + 1];
+
+    size_t local_id = get_local_id(0);
+    size_t j;
+    double sum = 0;
+
+    for (j = local_id + index_offset; j < row_size; j += C)
+    {
+        sum += LOAD_VALUE(data, j) * LOAD_VECTOR(vect, indices[j]);
+    }
+
+    output[local_id + (i * C)] = sum;
+}
+
+__kernel void sigma_c_compressed(__global const value_t *data, __global const ushort *deltas, __global const int *bases, __global const int *escaped_cols, __global const vector_t *vect, __global double *output, __global const int *row_indices, const int C)
+{
+    size_t i = get_group_id(0);
+
+    const int index_offset = row_indices[i];
+    const int row_size = row_indices[i + 1];
+    const int base = bases[i];
+
+    size_t local_id = get_local_id(0);
+    size_t j;
+    double sum = 0;
+
+    for (j = local_id + index_offset; j < row_size; j += C)
+    {
+        sum += LOAD_VALUE(data, j) * LOAD_VECTOR(vect, load_column(deltas, escaped_cols, base, j, index_offset));
+    }
+
+    output[local_id + (i * C)] = sum;
+}
+
+/* pattern matrix: every entry is value, padding has column -1 */
+__kernel void sigma_c_pattern(__global const int *indices, __global const vector_t *vect, __global double *output, __global const int *row_indices, const int C, const double value)
+{
+    size_t i = get_group_id(0);
+
+    const int index_offset = row_indices[i];
+    const int row_size = row_indices[i + 1];
+
+    size_t local_id = get_local_id(0);
+    size_t j;
+    double sum = 0;
+
+    for (j = local_id + index_offset; j < row_size; j += C)
+    {
+        const int column = indices[j];
+
+        if (column >= 0)
+        {
+            sum += LOAD_VECTOR(vect, column);
+        }
+    }
+
+    output[local_id + (i * C)] = value * sum;
+}
+
+/* values as codes into the dictionary of distinct values, padding has the code of 0 */
+__kernel void sigma_c_dictionary(__global const code_t *codes, __constant double *dictionary, __global const int *indices, __global const vector_t *vect, __global double *output, __global const int *row_indices, const int C)
 {
     size_t i = get_group_id(0);
 
@@ -11,8 +81,57 @@ __kernel void sigma_c(__global const double* data, __global const int* indices,
 
     for (j = local_id + index_offset; j < row_size; j += C)
     {
-        sum += data[j] * vect[indices[j]];
+        sum += dictionary[codes[j]] * LOAD_VECTOR(vect, indices[j]);
     }
 
     output[local_id + (i * C)] = sum;
 }
+
+/* y = alpha * A * x + beta * y for every row of the slices, y is not read when beta is 0 */
+__kernel void sigma_c_axpby(__global const value_t *data, __global const int *indices, __global const vector_t *vect, __global double *output, __global const int *row_indices, const int C, const double alpha, const double beta)
+{
+    size_t i = get_group_id(0);
+
+    const int index_offset = row_indices[i];
+    const int row_size = row_indices[i + 1];
+    const size_t row = get_local_id(0) + (i * C);
+
+    size_t local_id = get_local_id(0);
+    size_t j;
+    double sum = 0;
+
+    for (j = local_id + index_offset; j < row_size; j += C)
+    {
+        sum += LOAD_VALUE(data, j) * LOAD_VECTOR(vect, indices[j]);
+    }
+
+    output[row] = beta == 0 ? alpha * sum : alpha * sum + beta * output[row];
+}
+
+/* sigma_c_axpby which also leaves the sum of x[row] * (A * x)[row] over the first N rows of every slice in dot_partials */
+__kernel void sigma_c_axpby_dot(__global const value_t *data, __global const int *indices, __global const vector_t *vect, __global double *output, __global const int *row_indices, const int C, const double alpha, const double beta, const int N, __global double *dot_partials, __local double *partial_data)
+{
+    size_t i = get_group_id(0);
+
+    const int index_offset = row_indices[i];
+    const int row_size = row_indices[i + 1];
+    const size_t row = get_local_id(0) + (i * C);
+
+    size_t local_id = get_local_id(0);
+    size_t j;
+    double sum = 0;
+
+    for (j = local_id + index_offset; j < row_size; j += C)
+    {
+        sum += LOAD_VALUE(data, j) * LOAD_VECTOR(vect, indices[j]);
+    }
+
+    output[row] = beta == 0 ? alpha * sum : alpha * sum + beta * output[row];
+
+    const double dot = reduce_work_group(row < N ? LOAD_VECTOR(vect, row) * sum : 0, partial_data);
+
+    if (local_id == 0)
+    {
+        dot_partials[i] = dot;
+    }
+}
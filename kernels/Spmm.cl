@@ -0,0 +1,169 @@
+/*
+ * Sparse matrix times k vectors. The vectors form a row-major block, element v of vector row c is
+ * vect[c * k + v], and so does the output. Every work-item multiplies one row (or strip) by
+ * VECTOR_BLOCK consecutive vectors, so each matrix value and column it loads is used VECTOR_BLOCK
+ * times from registers; the k / VECTOR_BLOCK work-items sharing a row find the matrix in cache.
+ * Values and vectors are stored as value_t and vector_t of Precision.h and summed in double.
+ */
+
+#include "Precision.h"
+
+#ifndef VECTOR_BLOCK
+#define VECTOR_BLOCK 4
+#endif
+
+__kernel void csr_spmm(__global const int *ptr, __global const int *col, __global const value_t *data, __global const vector_t *vect, __global double *output, const int N, const int k)
+{
+    const int vector_groups = k / VECTOR_BLOCK;
+    size_t item;
+
+    for (item = get_global_id(0); item < (size_t)N * vector_groups; item += get_global_size(0))
+    {
+        const int i = item / vector_groups;
+        const int first_vector = (item % vector_groups) * VECTOR_BLOCK;
+        double sum[VECTOR_BLOCK];
+        int b;
+        int j;
+
+        for (b = 0; b < VECTOR_BLOCK; ++b)
+        {
+            sum[b] = 0;
+        }
+
+        for (j = ptr[i]; j < ptr[i+1]; ++j)
+        {
+            const double value = LOAD_VALUE(data, j);
+            const int x = col[j] * k + first_vector;
+
+            for (b = 0; b < VECTOR_BLOCK; ++b)
+            {
+                sum[b] += value * LOAD_VECTOR(vect, x + b);
+            }
+        }
+
+        for (b = 0; b < VECTOR_BLOCK; ++b)
+        {
+            output[i * k + first_vector + b] = sum[b];
+        }
+    }
+}
+
+__kernel void ell_spmm(__global const value_t *data, __global const int *indices, __global const vector_t *vect, __global double *output, const int N, const int row_size, const int k)
+{
+    const int vector_groups = k / VECTOR_BLOCK;
+    size_t item;
+
+    for (item = get_global_id(0); item < (size_t)N * vector_groups; item += get_global_size(0))
+    {
+        const int i = item / vector_groups;
+        const int first_vector = (item % vector_groups) * VECTOR_BLOCK;
+        double sum[VECTOR_BLOCK];
+        int b;
+        int j;
+
+        for (b = 0; b < VECTOR_BLOCK; ++b)
+        {
+            sum[b] = 0;
+        }
+
+        for (j = row_size * i; j < row_size * (i + 1); ++j)
+        {
+            const double value = LOAD_VALUE(data, j);
+            const int x = indices[j] * k + first_vector;
+
+            for (b = 0; b < VECTOR_BLOCK; ++b)
+            {
+                sum[b] += value * LOAD_VECTOR(vect, x + b);
+            }
+        }
+
+        for (b = 0; b < VECTOR_BLOCK; ++b)
+        {
+            output[i * k + first_vector + b] = sum[b];
+        }
+    }
+}
+
+/* N is the number of rows padded to whole slices */
+__kernel void sigma_c_spmm(__global const value_t *data, __global const int *indices, __global const vector_t *vect, __global double *output, __global const int *row_indices, const int C, const int N, const int k)
+{
+    const int vector_groups = k / VECTOR_BLOCK;
+    size_t item;
+
+    for (item = get_global_id(0); item < (size_t)N * vector_groups; item += get_global_size(0))
+    {
+        const int i = item / vector_groups;
+        const int first_vector = (item % vector_groups) * VECTOR_BLOCK;
+        const int slice = i / C;
+        double sum[VECTOR_BLOCK];
+        int b;
+        int j;
+
+        for (b = 0; b < VECTOR_BLOCK; ++b)
+        {
+            sum[b] = 0;
+        }
+
+        for (j = row_indices[slice] + i % C; j < row_indices[slice + 1]; j += C)
+        {
+            const double value = LOAD_VALUE(data, j);
+            const int x = indices[j] * k + first_vector;
+
+            for (b = 0; b < VECTOR_BLOCK; ++b)
+            {
+                sum[b] += value * LOAD_VECTOR(vect, x + b);
+            }
+        }
+
+        for (b = 0; b < VECTOR_BLOCK; ++b)
+        {
+            output[i * k + first_vector + b] = sum[b];
+        }
+    }
+}
+
+/* elements of a strip are sorted by row, so the sums of a strip row are written as soon as the next row starts */
+__kernel void cmrs_spmm(__global const value_t *data, __global const int *indices, __global const int *strip_ptr, __global const int *row_in_strip, __global const vector_t *vect, __global double *output, const int N, const int height, const int k)
+{
+    const int vector_groups = k / VECTOR_BLOCK;
+    size_t item;
+
+    for (item = get_global_id(0); item < (size_t)N * vector_groups; item += get_global_size(0))
+    {
+        const int i = item / vector_groups;
+        const int first_vector = (item % vector_groups) * VECTOR_BLOCK;
+        const int strip_end = strip_ptr[i + 1];
+        int current_index = strip_ptr[i];
+        int strip_row;
+
+        for (strip_row = 0; strip_row < height; ++strip_row)
+        {
+            const int row = i * height + strip_row;
+            double sum[VECTOR_BLOCK];
+            int b;
+
+            for (b = 0; b < VECTOR_BLOCK; ++b)
+            {
+                sum[b] = 0;
+            }
+
+            while (current_index < strip_end && row_in_strip[current_index] == strip_row)
+            {
+                const double value = LOAD_VALUE(data, current_index);
+                const int x = indices[current_index] * k + first_vector;
+
+                for (b = 0; b < VECTOR_BLOCK; ++b)
+                {
+                    sum[b] += value * LOAD_VECTOR(vect, x + b);
+                }
+
+                ++current_index;
+            }
+
+            for (b = 0; b < VECTOR_BLOCK; ++b)
+            {
+                output[row * k + first_vector + b] = sum[b];
+            }
+        }
+    }
+}
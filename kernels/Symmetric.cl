@@ -0,0 +1,36 @@
+#pragma OPENCL EXTENSION cl_khr_fp64: enable
+
+#include "Atomic.h"
+#include "Precision.h"
+
+/*
+ * SpMV with one triangle of a symmetric matrix in CSR. An off-diagonal entry a_ij stands for a_ij and a_ji,
+ * so it adds a_ij * x_j to row i and a_ij * x_i to row j; the diagonal is used once. Other rows add to
+ * output[i] as well, so the row sum is added atomically too and output has to be zeroed before the kernel.
+ * The matrix is read once, half of what the expanded matrix needs.
+ */
+__kernel void csr_symmetric(__global const int *ptr, __global const int *col, __global const value_t *data, __global const vector_t *vect, __global double *output, const int N)
+{
+    size_t i;
+
+    for (i = get_global_id(0); i < N; i += get_global_size(0))
+    {
+        const double x = LOAD_VECTOR(vect, i);
+        double sum = 0;
+        int j;
+
+        for (j = ptr[i]; j < ptr[i+1]; ++j)
+        {
+            const double value = LOAD_VALUE(data, j);
+
+            sum += value * LOAD_VECTOR(vect, col[j]);
+
+            if (col[j] != i)
+            {
+                atomic_add(&output[col[j]], value * x);
+            }
+        }
+
+        atomic_add(&output[i], sum);
+    }
+}
@@ -0,0 +1,183 @@
+#pragma OPENCL EXTENSION cl_khr_fp64: enable
+
+#include "Atomic.h"
+#include "Precision.h"
+
+/*
+ * Transposed CSR multiplication, output = A^T * vect without building A^T. Row i of A is column i
+ * of A^T, so every entry of the row is scattered to output[col[j]]; output holds M (columns of A)
+ * values and has to be zeroed before the kernel.
+ */
+
+#ifndef TRANSPOSE_WINDOW
+#define TRANSPOSE_WINDOW 2048
+#endif
+
+__kernel void csr_transpose_atomic(__global const int *ptr, __global const int *col, __global const value_t *data, __global const vector_t *vect, __global double *output, const int N)
+{
+    size_t i;
+
+    for (i = get_global_id(0); i < N; i += get_global_size(0))
+    {
+        const double x = LOAD_VECTOR(vect, i);
+        int j;
+
+        for (j = ptr[i]; j < ptr[i+1]; ++j)
+        {
+            atomic_add(&output[col[j]], LOAD_VALUE(data, j) * x);
+        }
+    }
+}
+
+/*
+ * Privatised version: a work-group takes get_local_size(0) consecutive rows and accumulates the columns
+ * [first column of the block, + TRANSPOSE_WINDOW) in local memory, then adds the window to output once.
+ * Only columns outside the window go to global atomics, so a banded block touches global memory
+ * once per column instead of once per nonzero.
+ */
+__kernel void csr_transpose_private(__global const int *ptr, __global const int *col, __global const value_t *data, __global const vector_t *vect, __global double *output, const int N, const int M, __local double *window, __local int *window_start)
+{
+    const size_t local_id = get_local_id(0);
+    const size_t local_size = get_local_size(0);
+    size_t block;
+    size_t k;
+
+    for (block = get_group_id(0) * local_size; block < N; block += get_num_groups(0) * local_size)
+    {
+        const size_t i = block + local_id;
+
+        if (local_id == 0)
+        {
+            *window_start = M;
+        }
+
+        for (k = local_id; k < TRANSPOSE_WINDOW; k += local_size)
+        {
+            window[k] = 0;
+        }
+
+        barrier(CLK_LOCAL_MEM_FENCE);
+
+        if (i < N && ptr[i] < ptr[i+1])
+        {
+            atomic_min(window_start, col[ptr[i]]);
+        }
+
+        barrier(CLK_LOCAL_MEM_FENCE);
+
+        const int start = *window_start;
+
+        if (i < N)
+        {
+            const double x = LOAD_VECTOR(vect, i);
+            int j;
+
+            for (j = ptr[i]; j < ptr[i+1]; ++j)
+            {
+                const int offset = col[j] - start;
+                const double value = LOAD_VALUE(data, j) * x;
+
+                if (offset >= 0 && offset < TRANSPOSE_WINDOW)
+                {
+                    atomic_add_local(&window[offset], value);
+                }
+                else
+                {
+                    atomic_add(&output[col[j]], value);
+                }
+            }
+        }
+
+        barrier(CLK_LOCAL_MEM_FENCE);
+
+        for (k = local_id; k < TRANSPOSE_WINDOW && start + k < M; k += local_size)
+        {
+            if (window[k] != 0)
+            {
+                atomic_add(&output[start + k], window[k]);
+            }
+        }
+
+        barrier(CLK_LOCAL_MEM_FENCE);
+    }
+}
+
+/*
+ * Explicit transposition CSR -> CSC (the CSR of A^T) in three kernels: csc_count counts the entries
+ * of every column, csc_scan turns the counts into column pointers and csc_fill places the entries.
+ * Entries of a column are placed in the order the atomics are granted, so rows within a column
+ * are not sorted.
+ */
+
+__kernel void csc_count(__global const int *col, __global int *counts, const int number_of_nonzeroes)
+{
+    size_t j;
+
+    for (j = get_global_id(0); j < number_of_nonzeroes; j += get_global_size(0))
+    {
+        atomic_inc(&counts[col[j]]);
+    }
+}
+
+/* exclusive scan of M counts into col_ptr[0..M], run as a single work-group, every work-item scans one chunk */
+__kernel void csc_scan(__global const int *counts, __global int *col_ptr, const int M, __local int *chunk_sums)
+{
+    const size_t local_id = get_local_id(0);
+    const size_t local_size = get_local_size(0);
+    const size_t chunk = (M + local_size - 1) / local_size;
+    const size_t first = local_id * chunk;
+    const size_t last = first + chunk < M ? first + chunk : M;
+    size_t offset;
+    size_t k;
+    int sum = 0;
+
+    for (k = first; k < last; ++k)
+    {
+        sum += counts[k];
+    }
+
+    chunk_sums[local_id] = sum;
+    barrier(CLK_LOCAL_MEM_FENCE);
+
+    /* inclusive scan of the chunk sums */
+    for (offset = 1; offset < local_size; offset *= 2)
+    {
+        const int value = local_id >= offset ? chunk_sums[local_id - offset] : 0;
+
+        barrier(CLK_LOCAL_MEM_FENCE);
+        chunk_sums[local_id] += value;
+        barrier(CLK_LOCAL_MEM_FENCE);
+    }
+
+    sum = chunk_sums[local_id] - sum;
+
+    for (k = first; k < last; ++k)
+    {
+        col_ptr[k] = sum;
+        sum += counts[k];
+    }
+
+    if (local_id == local_size - 1)
+    {
+        col_ptr[M] = chunk_sums[local_id];
+    }
+}
+
+/* position starts as a copy of col_ptr and ends as col_ptr shifted by one column */
+__kernel void csc_fill(__global const int *ptr, __global const int *col, __global const value_t *data, const int N, __global int *position, __global int *csc_rows, __global value_t *csc_data)
+{
+    size_t i;
+
+    for (i = get_global_id(0); i < N; i += get_global_size(0))
+    {
+        int j;
+
+        for (j = ptr[i]; j < ptr[i+1]; ++j)
+        {
+            const int index = atomic_inc(&position[col[j]]);
+
+            csc_rows[index] = i;
+            csc_data[index] = data[j];
+        }
+    }
+}
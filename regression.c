@@ -0,0 +1,271 @@
+#define CL_TARGET_OPENCL_VERSION 300
+#include <CL/cl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <math.h>
+#include <time.h>
+
+#include "helper_functions.h"
+#include "formats.h"
+#include "selector.h"
+#include "bench.h"
+#include "generator.h"
+#include "regression.h"
+#include "enums.h"
+
+#define DEVICES_DEFAULT_SIZE 8
+
+/* synthetic matrices first, so the suite runs even where databases/ only has Git LFS pointers; R-MAT has empty rows */
+#define DEFAULT_SUITE "stencil2d:512,banded:100000:8,rmat:12:8,databases/cant-sorted.mtx"
+
+/*
+ * Performance regression check: runs a fixed suite of matrices in every format on one device and compares every
+ * median with the stored baseline, exiting with PerformanceRegression when any run got significantly slower or
+ * gave a wrong result. --update=1 runs the same suite and writes the baseline instead.
+ */
+int main(int argc, char *argv[])
+{
+    cl_uint number_of_devices = DEVICES_DEFAULT_SIZE;
+    cl_device_id device_ids[DEVICES_DEFAULT_SIZE];
+    const char *suite = get_option(argc, argv, "--suite", DEFAULT_SUITE);
+    const char *baseline_filename = get_option(argc, argv, "--baseline", "regression_baseline.json");
+    const char *device_type_option = get_option(argc, argv, "--device-type", "cpu");
+    const cl_uint device_number = (cl_uint)get_int_option(argc, argv, "--device", 0);
+    const int warmup = get_int_option(argc, argv, "--warmup", 3);
+    const int repeats = get_int_option(argc, argv, "--repeats", 20);
+    const double threshold = atof(get_option(argc, argv, "--threshold", "0.10"));
+    const double alpha = atof(get_option(argc, argv, "--alpha", "0.01"));
+    const bool update = get_int_option(argc, argv, "--update", 0) != 0;
+    cl_device_type device_type = CL_DEVICE_TYPE_CPU;
+    Baseline *baseline = (Baseline*)malloc(sizeof(Baseline));
+    Baseline *measured = (Baseline*)malloc(sizeof(Baseline));
+    int number_of_regressions = 0;
+    int number_of_improvements = 0;
+    int number_of_wrong = 0;
+    int number_of_new = 0;
+    int number_of_skipped = 0;
+
+    if (warmup < 0 || repeats < 8 || repeats > MAX_BASELINE_RUNS)
+    {
+        printf("--warmup must be at least 0 and --repeats between 8 and %d\n", MAX_BASELINE_RUNS);
+        return OtherError;
+    }
+
+    if (threshold < 0 || alpha <= 0 || alpha >= 1)
+    {
+        printf("--threshold must be at least 0 and --alpha between 0 and 1\n");
+        return OtherError;
+    }
+
+    if (strcmp(device_type_option, "gpu") == 0)
+    {
+        device_type = CL_DEVICE_TYPE_GPU;
+    }
+    else if (strcmp(device_type_option, "all") == 0)
+    {
+        device_type = CL_DEVICE_TYPE_ALL;
+    }
+    else if (strcmp(device_type_option, "cpu") != 0)
+    {
+        printf("unknown --device-type=%s, use cpu, gpu or all\n", device_type_option);
+        return OtherError;
+    }
+
+    if (!update && !read_baseline(baseline_filename, baseline))
+    {
+        printf("no baseline in %s, create it with --update=1\n", baseline_filename);
+        return FileError;
+    }
+
+    if (get_device_ids_of_type(device_type, &device_ids[0], &number_of_devices) != CL_SUCCESS)
+    {
+        return OpenCLDeviceError;
+    }
+
+    if (device_number >= number_of_devices)
+    {
+        printf("--device=%u but only %u devices were found\n", device_number, number_of_devices);
+        return OpenCLDeviceError;
+    }
+
+
+    /* prepare OpenCL programs, the SpMV kernel of every format */
+
+    cl_uint compute_units;
+    cl_int error;
+
+    clGetDeviceInfo(device_ids[device_number], CL_DEVICE_NAME, sizeof(measured->device), measured->device, NULL);
+    clGetDeviceInfo(device_ids[device_number], CL_DEVICE_MAX_COMPUTE_UNITS, sizeof(cl_uint), &compute_units, NULL);
+    measured->number_of_entries = 0;
+
+    if (!update && strcmp(baseline->device, measured->device) != 0)
+    {
+        printf("warning: baseline is from \"%s\", running on \"%s\"\n", baseline->device, measured->device);
+    }
+
+    cl_context context = clCreateContext(0, 1, &device_ids[device_number], NULL, NULL, &error);
+
+    if (NULL == context)
+    {
+        printf("context is null\n");
+        return OpenCLProgramError;
+    }
+
+    cl_command_queue command_queue = clCreateCommandQueueWithProperties(context, device_ids[device_number], 0, &error);
+
+    if (error != CL_SUCCESS)
+    {
+        printf("clCreateCommandQueueWithProperties error %d\n", error);
+        return OpenCLProgramError;
+    }
+
+    cl_program programs[NumberOfFormats];
+
+    if (!build_format_programs(context, device_ids[device_number], programs))
+    {
+        return OpenCLProgramError;
+    }
+
+    printf("%-32s %-5s %12s %12s %7s %9s  %s\n", "matrix", "format", "baseline_ms", "current_ms", "ratio", "p", "verdict");
+
+
+    /* every matrix of the suite with every format */
+
+    char *list = strdup(suite);
+    char *name;
+
+    for (name = strtok(list, ","); name != NULL; name = strtok(NULL, ","))
+    {
+        MatrixFeatures features;
+        int number_of_rows;
+        int number_of_columns;
+        int number_of_nonzeroes;
+        cl_int *ptr;
+        cl_int *cols;
+        cl_double *data;
+        int format;
+        int i;
+
+        /* a file that cannot be read (e.g. a Git LFS pointer) is skipped, the rest of the suite still runs */
+        if (load_matrix(name, true, &number_of_rows, &number_of_columns, &number_of_nonzeroes, &ptr, &cols, &data) == false)
+        {
+            printf("%-32s %-5s %12s %12s %7s %9s  skipped, cannot be read\n", name, "-", "-", "-", "-", "-");
+            ++number_of_skipped;
+            continue;
+        }
+
+        cl_double *vect = (cl_double*)malloc(sizeof(cl_double) * number_of_columns);
+        cl_double *expected = (cl_double*)malloc(sizeof(cl_double) * number_of_rows);
+        double *run_ms = (double*)malloc(sizeof(double) * repeats);
+
+        for (i = 0; i < number_of_columns; ++i)
+        {
+            vect[i] = i % 100;
+        }
+
+        compute_reference(ptr, cols, data, vect, number_of_rows, expected);
+        extract_features(ptr, cols, number_of_rows, number_of_columns, &features);
+
+        for (format = 0; format < NumberOfFormats; ++format)
+        {
+            const char *format_name = spmv_format_names[format];
+            LaunchParameters parameters;
+            BenchmarkResult benchmark;
+
+            select_launch_parameters(&features, (SpmvFormat)format, compute_units, &parameters);
+
+            if (benchmark_format(context, command_queue, programs, (SpmvFormat)format, &parameters, ptr, cols, data,
+                                 number_of_rows, number_of_columns, vect, expected, warmup, repeats, run_ms, &benchmark) != Success)
+            {
+                return OpenCLProgramError;
+            }
+
+            if (!benchmark.correct)
+            {
+                printf("%-32s %-5s %12s %12.4lf %7s %9s  wrong result\n", name, format_name, "-", benchmark.median_ms, "-", "-");
+                ++number_of_wrong;
+                continue;
+            }
+
+            if (update)
+            {
+                if (!add_baseline_entry(measured, name, format_name, run_ms, repeats, benchmark.median_ms))
+                {
+                    return OtherError;
+                }
+
+                printf("%-32s %-5s %12s %12.4lf %7s %9s  stored\n", name, format_name, "-", benchmark.median_ms, "-", "-");
+                continue;
+            }
+
+            const BaselineEntry *entry = find_baseline_entry(baseline, name, format_name);
+
+            if (entry == NULL)
+            {
+                printf("%-32s %-5s %12s %12.4lf %7s %9s  not in baseline\n", name, format_name, "-", benchmark.median_ms, "-", "-");
+                ++number_of_new;
+                continue;
+            }
+
+            double ratio;
+            double p_value;
+            const Verdict verdict = compare_with_baseline(entry, run_ms, repeats, benchmark.median_ms, threshold, alpha, &ratio, &p_value);
+
+            number_of_regressions += verdict == Regressed;
+            number_of_improvements += verdict == Improved;
+
+            printf("%-32s %-5s %12.4lf %12.4lf %7.3lf %9.2e  %s\n", name, format_name, entry->median_ms, benchmark.median_ms, ratio, p_value, verdict_names[verdict]);
+        }
+
+        free(ptr);
+        free(cols);
+        free(data);
+        free(vect);
+        free(expected);
+        free(run_ms);
+    }
+
+
+    /* summary */
+
+    if (update)
+    {
+        if (!write_baseline(baseline_filename, measured, warmup, repeats))
+        {
+            return FileError;
+        }
+
+        printf("\n%d runs written to %s\n", measured->number_of_entries, baseline_filename);
+    }
+    else
+    {
+        printf("\n%d regressed, %d improved, %d not in baseline (threshold %.1lf%%, alpha %.3lf)\n",
+               number_of_regressions, number_of_improvements, number_of_new, threshold * 100, alpha);
+    }
+
+    if (number_of_wrong > 0)
+    {
+        printf("%d runs gave a wrong result\n", number_of_wrong);
+    }
+
+    if (number_of_skipped > 0)
+    {
+        printf("%d matrices skipped, they could not be read\n", number_of_skipped);
+    }
+
+
+    /* release memory */
+
+    free(list);
+    free(baseline);
+    free(measured);
+
+    clFlush(command_queue);
+    clReleaseCommandQueue(command_queue);
+    release_format_programs(programs);
+    clReleaseContext(context);
+
+    return number_of_regressions > 0 || number_of_wrong > 0 ? PerformanceRegression : Success;
+}
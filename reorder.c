@@ -0,0 +1,483 @@
+#define CL_TARGET_OPENCL_VERSION 300
+#include <CL/cl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <time.h>
+
+#include "helper_functions.h"
+#include "formats.h"
+#include "reorder.h"
+#include "enums.h"
+
+#define DEVICES_DEFAULT_SIZE 8
+#define NUMBER_OF_FORMATS 4
+#define NUMBER_OF_ORDERINGS 3
+
+void compute_reference(const cl_int *ptr, const cl_int *cols, const cl_double *data, const cl_double *vect, int number_of_rows, cl_double *result);
+bool check_reordered_result(const cl_double *expected, const cl_double *result, int number_of_rows);
+int run_formats(cl_context context, cl_command_queue command_queue, cl_program program, cl_int *ptr, cl_int *cols, cl_double *data, int number_of_rows,
+                   const cl_double *vect, const int *perm, const cl_double *expected, int runs, int height, double *format_ms);
+
+int main(int argc, char *argv[])
+{
+    cl_uint number_of_devices = DEVICES_DEFAULT_SIZE;
+    cl_device_id device_ids[DEVICES_DEFAULT_SIZE];
+
+    if (get_device_ids(&device_ids[0], &number_of_devices) != CL_SUCCESS)
+    {
+        return OpenCLDeviceError;
+    }
+
+    for (cl_uint device_number = 0; device_number < number_of_devices; ++device_number)
+    {
+        int number_of_rows;
+        int number_of_columns;
+        int number_of_nonzeroes;
+        int i;
+        int ordering;
+        cl_int *ptr;
+        cl_int *cols;
+        cl_double *data;
+        cl_double *vect;
+        cl_double *expected;
+        double format_ms[NUMBER_OF_ORDERINGS][NUMBER_OF_FORMATS];
+        const char *ordering_names[NUMBER_OF_ORDERINGS] = { "original", "rcm", "degree" };
+        const char *run_names[NUMBER_OF_ORDERINGS];
+        const char *format_names[NUMBER_OF_FORMATS] = { "csr", "ell", "sigma_c", "cmrs" };
+        const char *filename = get_option(argc, argv, "--matrix", "databases/cant-sorted.mtx");
+        const char *ordering_option = get_option(argc, argv, "--ordering", "all");
+        const int runs = get_int_option(argc, argv, "--runs", 10);
+        const int height = get_int_option(argc, argv, "--height", 8);
+        int number_of_orderings = 0;
+
+        if (runs < 1)
+        {
+            printf("--runs must be at least 1\n");
+            return OtherError;
+        }
+
+        /* the original ordering is always run as the baseline, so only the others can be chosen */
+        bool known_ordering = strcmp(ordering_option, "all") == 0;
+
+        for (ordering = 1; ordering < NUMBER_OF_ORDERINGS; ++ordering)
+        {
+            known_ordering = known_ordering || strcmp(ordering_option, ordering_names[ordering]) == 0;
+        }
+
+        if (!known_ordering)
+        {
+            printf("unknown --ordering %s, valid orderings are", ordering_option);
+            for (ordering = 1; ordering < NUMBER_OF_ORDERINGS; ++ordering)
+            {
+                printf(" %s,", ordering_names[ordering]);
+            }
+            printf(" all\n");
+            return OtherError;
+        }
+
+
+        /* prepare data for calculations */
+
+        if (read_csr_from_file(filename, true, &number_of_rows, &number_of_columns, &number_of_nonzeroes, &ptr, &cols, &data) == false)
+        {
+            return FileError;
+        }
+
+        if (number_of_rows != number_of_columns)
+        {
+            printf("symmetric reordering needs a square matrix, %s is %d x %d\n", filename, number_of_rows, number_of_columns);
+            return OtherError;
+        }
+
+        vect = (cl_double*)malloc(sizeof(cl_double) * number_of_columns);
+        expected = (cl_double*)malloc(sizeof(cl_double) * number_of_rows);
+
+        for (i = 0; i < number_of_columns; ++i)
+        {
+            vect[i] = i % 100;
+        }
+
+        compute_reference(ptr, cols, data, vect, number_of_rows, expected);
+
+
+        /* prepare OpenCL program, the SpMM kernels with one vector */
+
+        cl_context context = clCreateContext(0, number_of_devices, device_ids, NULL, NULL, NULL);
+
+        if (NULL == context)
+        {
+            printf("context is null\n");
+            return OpenCLProgramError;
+        }
+
+        cl_int error;
+        cl_command_queue command_queue = clCreateCommandQueueWithProperties(context, device_ids[0], 0, &error);
+
+        if (error != CL_SUCCESS)
+        {
+            printf("clCreateCommandQueueWithProperties error %d\n", error);
+            return OpenCLProgramError;
+        }
+
+        cl_program program = build_program_from_file(context, device_ids[0], "kernels/Spmm.cl", "-I kernels -DVECTOR_BLOCK=1");
+
+        if (program == NULL)
+        {
+            return OpenCLProgramError;
+        }
+
+
+        /* every ordering is applied to the loaded matrix, x is permuted before and y after the multiplication */
+
+        for (ordering = 0; ordering < NUMBER_OF_ORDERINGS; ++ordering)
+        {
+            cl_int *permuted_ptr = ptr;
+            cl_int *permuted_cols = cols;
+            cl_double *permuted_data = data;
+            int *perm = NULL;
+            struct timespec start_time;
+            struct timespec end_time;
+            double reorder_ms = 0;
+
+            if (ordering > 0 && strcmp(ordering_option, "all") != 0 && strcmp(ordering_option, ordering_names[ordering]) != 0)
+            {
+                continue;
+            }
+
+            if (ordering > 0)
+            {
+                clock_gettime(CLOCK_MONOTONIC, &start_time);
+
+                perm = ordering == 1 ? create_rcm_permutation(ptr, cols, number_of_rows) : create_degree_permutation(ptr, number_of_rows);
+                permute_csr(ptr, cols, data, number_of_rows, perm, &permuted_ptr, &permuted_cols, &permuted_data);
+
+                clock_gettime(CLOCK_MONOTONIC, &end_time);
+                reorder_ms = (double)(end_time.tv_nsec - start_time.tv_nsec) / 1000000 + (double)(end_time.tv_sec - start_time.tv_sec) * 1000;
+            }
+
+            printf("\n%s ordering: bandwidth %d, profile %lld", ordering_names[ordering],
+                   compute_bandwidth(permuted_ptr, permuted_cols, number_of_rows), compute_profile(permuted_ptr, permuted_cols, number_of_rows));
+
+            if (ordering > 0)
+            {
+                printf(", reordering took %.2lf ms", reorder_ms);
+            }
+
+            printf("\n");
+
+            if (run_formats(context, command_queue, program, permuted_ptr, permuted_cols, permuted_data, number_of_rows,
+                            vect, perm, expected, runs, height, format_ms[number_of_orderings]) != Success)
+            {
+                return OpenCLProgramError;
+            }
+
+            run_names[number_of_orderings++] = ordering_names[ordering];
+
+            if (perm != NULL)
+            {
+                free(perm);
+                free(permuted_ptr);
+                free(permuted_cols);
+                free(permuted_data);
+            }
+        }
+
+
+        /* summary */
+
+        printf("\nspeedup over the original ordering\n%8s", "");
+        for (i = 0; i < NUMBER_OF_FORMATS; ++i)
+        {
+            printf(" %8s", format_names[i]);
+        }
+        printf("\n");
+
+        for (ordering = 1; ordering < number_of_orderings; ++ordering)
+        {
+            printf("%8s", run_names[ordering]);
+            for (i = 0; i < NUMBER_OF_FORMATS; ++i)
+            {
+                printf(" %8.2lf", format_ms[0][i] / format_ms[ordering][i]);
+            }
+            printf("\n");
+        }
+
+
+        /* release memory */
+
+        free(ptr);
+        free(cols);
+        free(data);
+        free(vect);
+        free(expected);
+
+        clFlush(command_queue);
+        clReleaseCommandQueue(command_queue);
+        clReleaseProgram(program);
+        clReleaseContext(context);
+
+        break;
+    }
+
+    return Success;
+}
+
+/*!
+ * \brief Builds ELL, SELL-C and CMRS from the (permuted) CSR, runs every format runs times and checks the result
+ *        after scattering it back with perm (NULL for the original order). format_ms gets the average times.
+ *        Returns Success or OpenCLProgramError.
+ */
+int run_formats(cl_context context, cl_command_queue command_queue, cl_program program, cl_int *ptr, cl_int *cols, cl_double *data, int number_of_rows,
+                   const cl_double *vect, const int *perm, const cl_double *expected, int runs, int height, double *format_ms)
+{
+    const char *kernel_names[NUMBER_OF_FORMATS] = { "csr_spmm", "ell_spmm", "sigma_c_spmm", "cmrs_spmm" };
+    const int number_of_nonzeroes = ptr[number_of_rows];
+    const int C = 32;
+    const int k = 1;
+    int row_size;
+    int number_of_slices;
+    int number_of_strips;
+    int format;
+    cl_int error;
+    cl_int *ell_cols;
+    cl_double *ell_data;
+    cl_int *row_indices;
+    cl_int *sell_cols;
+    cl_double *sell_data;
+    cl_int *strip_ptr;
+    cl_int *row_in_strip;
+
+    size_t global_work_size[1] = { 8192 };
+    size_t local_work_size[1] = { 256 };
+    cl_uint work_dim = 1;
+
+    create_ell(ptr, cols, data, number_of_rows, &row_size, &ell_cols, &ell_data);
+    create_sell(ptr, cols, data, number_of_rows, C, &number_of_slices, &row_indices, &sell_cols, &sell_data);
+    create_cmrs(ptr, number_of_rows, height, &number_of_strips, &strip_ptr, &row_in_strip);
+
+    const long ell_size = (long)row_size * number_of_rows;
+    const long sell_size = row_indices[number_of_slices];
+    const int sell_rows = number_of_slices * C;
+    const int cmrs_rows = number_of_strips * height;
+    const int output_rows = sell_rows > cmrs_rows ? sell_rows : cmrs_rows;
+    cl_double *permuted_vect = (cl_double*)malloc(sizeof(cl_double) * number_of_rows);
+    cl_double *output = (cl_double*)malloc(sizeof(cl_double) * output_rows);
+    cl_double *result = (cl_double*)malloc(sizeof(cl_double) * number_of_rows);
+
+    if (perm != NULL)
+    {
+        permute_vector(vect, perm, number_of_rows, permuted_vect);
+    }
+    else
+    {
+        memcpy(permuted_vect, vect, sizeof(cl_double) * number_of_rows);
+    }
+
+    cl_mem buffer_ptr          = clCreateBuffer(context, CL_MEM_READ_ONLY, sizeof(cl_int) * (number_of_rows + 1), NULL, &error);
+    cl_mem buffer_col          = clCreateBuffer(context, CL_MEM_READ_ONLY, sizeof(cl_int) * number_of_nonzeroes, NULL, &error);
+    cl_mem buffer_data         = clCreateBuffer(context, CL_MEM_READ_ONLY, sizeof(cl_double) * number_of_nonzeroes, NULL, &error);
+    cl_mem buffer_ell_cols     = clCreateBuffer(context, CL_MEM_READ_ONLY, sizeof(cl_int) * ell_size, NULL, &error);
+    cl_mem buffer_ell_data     = clCreateBuffer(context, CL_MEM_READ_ONLY, sizeof(cl_double) * ell_size, NULL, &error);
+    cl_mem buffer_row_indices  = clCreateBuffer(context, CL_MEM_READ_ONLY, sizeof(cl_int) * (number_of_slices + 1), NULL, &error);
+    cl_mem buffer_sell_cols    = clCreateBuffer(context, CL_MEM_READ_ONLY, sizeof(cl_int) * sell_size, NULL, &error);
+    cl_mem buffer_sell_data    = clCreateBuffer(context, CL_MEM_READ_ONLY, sizeof(cl_double) * sell_size, NULL, &error);
+    cl_mem buffer_strip_ptr    = clCreateBuffer(context, CL_MEM_READ_ONLY, sizeof(cl_int) * (number_of_strips + 1), NULL, &error);
+    cl_mem buffer_row_in_strip = clCreateBuffer(context, CL_MEM_READ_ONLY, sizeof(cl_int) * number_of_nonzeroes, NULL, &error);
+    cl_mem buffer_vect         = clCreateBuffer(context, CL_MEM_READ_ONLY, sizeof(cl_double) * number_of_rows, NULL, &error);
+    cl_mem buffer_output       = clCreateBuffer(context, CL_MEM_WRITE_ONLY, sizeof(cl_double) * output_rows, NULL, &error);
+
+    if (error != CL_SUCCESS)
+    {
+        printf("clCreateBuffer error %d\n", error);
+        return OpenCLProgramError;
+    }
+
+    error  = clEnqueueWriteBuffer(command_queue, buffer_ptr, CL_FALSE, 0, sizeof(cl_int) * (number_of_rows + 1), ptr, 0, NULL, NULL);
+    error |= clEnqueueWriteBuffer(command_queue, buffer_col, CL_FALSE, 0, sizeof(cl_int) * number_of_nonzeroes, cols, 0, NULL, NULL);
+    error |= clEnqueueWriteBuffer(command_queue, buffer_data, CL_FALSE, 0, sizeof(cl_double) * number_of_nonzeroes, data, 0, NULL, NULL);
+    error |= clEnqueueWriteBuffer(command_queue, buffer_ell_cols, CL_FALSE, 0, sizeof(cl_int) * ell_size, ell_cols, 0, NULL, NULL);
+    error |= clEnqueueWriteBuffer(command_queue, buffer_ell_data, CL_FALSE, 0, sizeof(cl_double) * ell_size, ell_data, 0, NULL, NULL);
+    error |= clEnqueueWriteBuffer(command_queue, buffer_row_indices, CL_FALSE, 0, sizeof(cl_int) * (number_of_slices + 1), row_indices, 0, NULL, NULL);
+    error |= clEnqueueWriteBuffer(command_queue, buffer_sell_cols, CL_FALSE, 0, sizeof(cl_int) * sell_size, sell_cols, 0, NULL, NULL);
+    error |= clEnqueueWriteBuffer(command_queue, buffer_sell_data, CL_FALSE, 0, sizeof(cl_double) * sell_size, sell_data, 0, NULL, NULL);
+    error |= clEnqueueWriteBuffer(command_queue, buffer_strip_ptr, CL_FALSE, 0, sizeof(cl_int) * (number_of_strips + 1), strip_ptr, 0, NULL, NULL);
+    error |= clEnqueueWriteBuffer(command_queue, buffer_row_in_strip, CL_FALSE, 0, sizeof(cl_int) * number_of_nonzeroes, row_in_strip, 0, NULL, NULL);
+    error |= clEnqueueWriteBuffer(command_queue, buffer_vect, CL_FALSE, 0, sizeof(cl_double) * number_of_rows, permuted_vect, 0, NULL, NULL);
+
+    if (error != CL_SUCCESS)
+    {
+        printf("clEnqueueWriteBuffer error %d\n", error);
+        return OpenCLProgramError;
+    }
+    clFinish(command_queue);
+
+    for (format = 0; format < NUMBER_OF_FORMATS; ++format)
+    {
+        cl_kernel kernel = clCreateKernel(program, kernel_names[format], &error);
+        double ms = 0;
+        int run;
+
+        if (error != CL_SUCCESS)
+        {
+            printf("clCreateKernel error %d\n", error);
+            return OpenCLProgramError;
+        }
+
+        switch (format)
+        {
+            case 0:
+                error  = clSetKernelArg(kernel, 0, sizeof(cl_mem), (void*)&buffer_ptr);
+                error |= clSetKernelArg(kernel, 1, sizeof(cl_mem), (void*)&buffer_col);
+                error |= clSetKernelArg(kernel, 2, sizeof(cl_mem), (void*)&buffer_data);
+                error |= clSetKernelArg(kernel, 3, sizeof(cl_mem), (void*)&buffer_vect);
+                error |= clSetKernelArg(kernel, 4, sizeof(cl_mem), (void*)&buffer_output);
+                error |= clSetKernelArg(kernel, 5, sizeof(int), (void*)&number_of_rows);
+                error |= clSetKernelArg(kernel, 6, sizeof(int), (void*)&k);
+                break;
+            case 1:
+                error  = clSetKernelArg(kernel, 0, sizeof(cl_mem), (void*)&buffer_ell_data);
+                error |= clSetKernelArg(kernel, 1, sizeof(cl_mem), (void*)&buffer_ell_cols);
+                error |= clSetKernelArg(kernel, 2, sizeof(cl_mem), (void*)&buffer_vect);
+                error |= clSetKernelArg(kernel, 3, sizeof(cl_mem), (void*)&buffer_output);
+                error |= clSetKernelArg(kernel, 4, sizeof(int), (void*)&number_of_rows);
+                error |= clSetKernelArg(kernel, 5, sizeof(int), (void*)&row_size);
+                error |= clSetKernelArg(kernel, 6, sizeof(int), (void*)&k);
+                break;
+            case 2:
+                error  = clSetKernelArg(kernel, 0, sizeof(cl_mem), (void*)&buffer_sell_data);
+                error |= clSetKernelArg(kernel, 1, sizeof(cl_mem), (void*)&buffer_sell_cols);
+                error |= clSetKernelArg(kernel, 2, sizeof(cl_mem), (void*)&buffer_vect);
+                error |= clSetKernelArg(kernel, 3, sizeof(cl_mem), (void*)&buffer_output);
+                error |= clSetKernelArg(kernel, 4, sizeof(cl_mem), (void*)&buffer_row_indices);
+                error |= clSetKernelArg(kernel, 5, sizeof(int), (void*)&C);
+                error |= clSetKernelArg(kernel, 6, sizeof(int), (void*)&sell_rows);
+                error |= clSetKernelArg(kernel, 7, sizeof(int), (void*)&k);
+                break;
+            default:
+                error  = clSetKernelArg(kernel, 0, sizeof(cl_mem), (void*)&buffer_data);
+                error |= clSetKernelArg(kernel, 1, sizeof(cl_mem), (void*)&buffer_col);
+                error |= clSetKernelArg(kernel, 2, sizeof(cl_mem), (void*)&buffer_strip_ptr);
+                error |= clSetKernelArg(kernel, 3, sizeof(cl_mem), (void*)&buffer_row_in_strip);
+                error |= clSetKernelArg(kernel, 4, sizeof(cl_mem), (void*)&buffer_vect);
+                error |= clSetKernelArg(kernel, 5, sizeof(cl_mem), (void*)&buffer_output);
+                error |= clSetKernelArg(kernel, 6, sizeof(int), (void*)&number_of_strips);
+                error |= clSetKernelArg(kernel, 7, sizeof(int), (void*)&height);
+                error |= clSetKernelArg(kernel, 8, sizeof(int), (void*)&k);
+                break;
+        }
+
+        if (error != CL_SUCCESS)
+        {
+            printf("clSetKernelArg errror\n");
+            return OpenCLProgramError;
+        }
+
+        for (run = 0; run < runs; ++run)
+        {
+            const double run_ms = run_kernel(command_queue, kernel, work_dim, global_work_size, local_work_size);
+
+            if (run_ms < 0)
+            {
+                return OpenCLProgramError;
+            }
+
+            ms += run_ms;
+        }
+
+        format_ms[format] = ms / runs;
+
+        error = clEnqueueReadBuffer(command_queue, buffer_output, CL_TRUE, 0, sizeof(cl_double) * number_of_rows, output, 0, NULL, NULL);
+
+        if (error != CL_SUCCESS)
+        {
+            printf("clEnqueueReadBuffer error %d\n", error);
+            return OpenCLProgramError;
+        }
+
+        if (perm != NULL)
+        {
+            unpermute_vector(output, perm, number_of_rows, result);
+        }
+        else
+        {
+            memcpy(result, output, sizeof(cl_double) * number_of_rows);
+        }
+
+        printf("%-12s %8.4lf ms %10.3lf GFlops, result is %s\n", kernel_names[format], format_ms[format], 2.0 * number_of_nonzeroes / format_ms[format] * 1e-6,
+               check_reordered_result(expected, result, number_of_rows) ? "ok" : "wrong");
+
+        clReleaseKernel(kernel);
+    }
+
+    clReleaseMemObject(buffer_ptr);
+    clReleaseMemObject(buffer_col);
+    clReleaseMemObject(buffer_data);
+    clReleaseMemObject(buffer_ell_cols);
+    clReleaseMemObject(buffer_ell_data);
+    clReleaseMemObject(buffer_row_indices);
+    clReleaseMemObject(buffer_sell_cols);
+    clReleaseMemObject(buffer_sell_data);
+    clReleaseMemObject(buffer_strip_ptr);
+    clReleaseMemObject(buffer_row_in_strip);
+    clReleaseMemObject(buffer_vect);
+    clReleaseMemObject(buffer_output);
+
+    free(ell_cols);
+    free(ell_data);
+    free(row_indices);
+    free(sell_cols);
+    free(sell_data);
+    free(strip_ptr);
+    free(row_in_strip);
+    free(permuted_vect);
+    free(output);
+    free(result);
+
+    return Success;
+}
+
+void compute_reference(const cl_int *ptr, const cl_int *cols, const cl_double *data, const cl_double *vect, int number_of_rows, cl_double *result)
+{
+    int i;
+
+    #pragma omp parallel for shared(ptr, cols, data, vect, number_of_rows, result) private(i)
+    for (i = 0; i < number_of_rows; ++i)
+    {
+        double sum = 0;
+        int j;
+
+        for (j = ptr[i]; j < ptr[i+1]; ++j)
+        {
+            sum += data[j] * vect[cols[j]];
+        }
+
+        result[i] = sum;
+    }
+}
+
+/*!
+ * \brief Reordering changes the order of the additions of a row, so rows are compared relative to the largest reference value.
+ */
+bool check_reordered_result(const cl_double *expected, const cl_double *result, int number_of_rows)
+{
+    double reference_max = 0;
+    int i;
+
+    for (i = 0; i < number_of_rows; ++i)
+    {
+        reference_max = fmax(reference_max, fabs(expected[i]));
+    }
+
+    for (i = 0; i < number_of_rows; ++i)
+    {
+        if (fabs(expected[i] - result[i]) > EPSILON * fmax(1, reference_max))
+        {
+            printf("wrong value at index %d: expected %f - calculated %f\n", i, expected[i], result[i]);
+            return false;
+        }
+    }
+
+    return true;
+}
@@ -0,0 +1,301 @@
+#define CL_TARGET_OPENCL_VERSION 300
+#include <CL/cl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <math.h>
+#include <time.h>
+
+#include "helper_functions.h"
+#include "formats.h"
+#include "selector.h"
+#include "bench.h"
+#include "enums.h"
+
+#define DEVICES_DEFAULT_SIZE 8
+#define MAX_CALIBRATION_MATRICES 64
+
+bool benchmark_all_formats(cl_context context, cl_command_queue command_queue, cl_program *programs, cl_uint compute_units,
+                           const char *filename, MatrixFeatures *features, double *format_ms, int runs);
+
+int main(int argc, char *argv[])
+{
+    cl_uint number_of_devices = DEVICES_DEFAULT_SIZE;
+    cl_device_id device_ids[DEVICES_DEFAULT_SIZE];
+
+    if (get_device_ids(&device_ids[0], &number_of_devices) != CL_SUCCESS)
+    {
+        return OpenCLDeviceError;
+    }
+
+    for (cl_uint device_number = 0; device_number < number_of_devices; ++device_number)
+    {
+        const char *filename = get_option(argc, argv, "--matrix", "databases/cant-sorted.mtx");
+        const char *thresholds_filename = get_option(argc, argv, "--thresholds", "selector_thresholds.txt");
+        const char *calibration_matrices = get_option(argc, argv, "--calibrate", "");
+        const int runs = get_int_option(argc, argv, "--runs", 10);
+        const bool compare = get_int_option(argc, argv, "--compare", 0) != 0;
+        double thresholds[NumberOfThresholds];
+        cl_uint compute_units;
+        int f;
+
+        if (runs < 1)
+        {
+            printf("--runs must be at least 1\n");
+            return OtherError;
+        }
+
+        clGetDeviceInfo(device_ids[0], CL_DEVICE_MAX_COMPUTE_UNITS, sizeof(cl_uint), &compute_units, NULL);
+
+
+        /* prepare OpenCL programs, the SpMV kernel of every format */
+
+        cl_context context = clCreateContext(0, number_of_devices, device_ids, NULL, NULL, NULL);
+
+        if (NULL == context)
+        {
+            printf("context is null\n");
+            return OpenCLProgramError;
+        }
+
+        cl_int error;
+        cl_command_queue command_queue = clCreateCommandQueueWithProperties(context, device_ids[0], 0, &error);
+
+        if (error != CL_SUCCESS)
+        {
+            printf("clCreateCommandQueueWithProperties error %d\n", error);
+            return OpenCLProgramError;
+        }
+
+        cl_program programs[NumberOfFormats];
+
+        if (!build_format_programs(context, device_ids[0], programs))
+        {
+            return OpenCLProgramError;
+        }
+
+        set_default_thresholds(thresholds);
+
+
+        /* calibration: time every format on every matrix and train the thresholds on the times */
+
+        if (calibration_matrices[0] != '\0')
+        {
+            MatrixFeatures *features = (MatrixFeatures*)malloc(sizeof(MatrixFeatures) * MAX_CALIBRATION_MATRICES);
+            double (*format_ms)[NumberOfFormats] = (double (*)[NumberOfFormats])malloc(sizeof(double) * NumberOfFormats * MAX_CALIBRATION_MATRICES);
+            char *list = strdup(calibration_matrices);
+            char *calibration_filename;
+            int number_of_matrices = 0;
+            int t;
+
+            for (calibration_filename = strtok(list, ","); calibration_filename != NULL && number_of_matrices < MAX_CALIBRATION_MATRICES;
+                 calibration_filename = strtok(NULL, ","))
+            {
+                printf("\n%s\n", calibration_filename);
+
+                if (!benchmark_all_formats(context, command_queue, programs, compute_units, calibration_filename,
+                                           &features[number_of_matrices], format_ms[number_of_matrices], runs))
+                {
+                    return OpenCLProgramError;
+                }
+
+                ++number_of_matrices;
+            }
+
+            const double default_score = score_thresholds(features, (const double (*)[NumberOfFormats])format_ms, number_of_matrices, thresholds);
+            const double score = calibrate_thresholds(features, (const double (*)[NumberOfFormats])format_ms, number_of_matrices, thresholds);
+
+            printf("\nselected / fastest time summed over %d matrices: %.3lf with the default thresholds, %.3lf calibrated\n", number_of_matrices, default_score, score);
+
+            for (t = 0; t < NumberOfThresholds; ++t)
+            {
+                printf("%s %.4lf\n", threshold_names[t], thresholds[t]);
+            }
+
+            if (!write_thresholds(thresholds_filename, thresholds))
+            {
+                return FileError;
+            }
+
+            printf("thresholds written to %s\n", thresholds_filename);
+
+            free(features);
+            free(format_ms);
+            free(list);
+        }
+        else
+        {
+            MatrixFeatures features;
+            LaunchParameters parameters;
+            int number_of_rows;
+            int number_of_columns;
+            int number_of_nonzeroes;
+            cl_int *ptr;
+            cl_int *cols;
+            cl_double *data;
+
+            if (read_csr_from_file(filename, true, &number_of_rows, &number_of_columns, &number_of_nonzeroes, &ptr, &cols, &data) == false)
+            {
+                return FileError;
+            }
+
+            if (read_thresholds(thresholds_filename, thresholds))
+            {
+                printf("thresholds from %s\n", thresholds_filename);
+            }
+            else
+            {
+                printf("default thresholds (%s not found, run with --calibrate to create it)\n", thresholds_filename);
+            }
+
+            extract_features(ptr, cols, number_of_rows, number_of_columns, &features);
+
+            const SpmvFormat format = select_format(&features, thresholds);
+
+            if (compare)
+            {
+                double format_ms[NumberOfFormats];
+
+                if (!benchmark_all_formats(context, command_queue, programs, compute_units, filename, &features, format_ms, runs))
+                {
+                    return OpenCLProgramError;
+                }
+
+                int fastest = 0;
+
+                for (f = 1; f < NumberOfFormats; ++f)
+                {
+                    fastest = format_ms[f] < format_ms[fastest] ? f : fastest;
+                }
+
+                printf("\nselected %s, fastest %s, selected / fastest time %.3lf\n", spmv_format_names[format], spmv_format_names[fastest], format_ms[format] / format_ms[fastest]);
+            }
+            else
+            {
+                cl_double *vect = (cl_double*)malloc(sizeof(cl_double) * number_of_columns);
+                cl_double *expected = (cl_double*)malloc(sizeof(cl_double) * number_of_rows);
+                double *run_ms = (double*)malloc(sizeof(double) * runs);
+                BenchmarkResult benchmark;
+                int i;
+
+                for (i = 0; i < number_of_columns; ++i)
+                {
+                    vect[i] = i % 100;
+                }
+
+                print_features(&features);
+                compute_reference(ptr, cols, data, vect, number_of_rows, expected);
+                select_launch_parameters(&features, format, compute_units, &parameters);
+
+                printf("\nselected %s: global work size %zu, local work size %zu", spmv_format_names[format], parameters.global_work_size, parameters.local_work_size);
+
+                if (format == SellFormat)
+                {
+                    printf(", C %d", parameters.slice_height);
+                }
+                else if (format == CmrsFormat)
+                {
+                    printf(", strip height %d", parameters.strip_height);
+                }
+                else if (format == HybFormat)
+                {
+                    printf(", ELL width %d", parameters.hyb_width);
+                }
+
+                printf("\n");
+
+                if (benchmark_format(context, command_queue, programs, format, &parameters, ptr, cols, data,
+                                     number_of_rows, number_of_columns, vect, expected, 0, runs, run_ms, &benchmark) != Success)
+                {
+                    return OpenCLProgramError;
+                }
+
+                calculate_and_print_performance(benchmark.median_ms, number_of_nonzeroes);
+                calculate_and_print_speed(benchmark.median_ms, number_of_nonzeroes);
+                printf("result is %s\n", benchmark.correct ? "ok" : "wrong");
+
+                free(vect);
+                free(expected);
+                free(run_ms);
+            }
+
+            free(ptr);
+            free(cols);
+            free(data);
+        }
+
+
+        /* release memory */
+
+        clFlush(command_queue);
+        clReleaseCommandQueue(command_queue);
+        release_format_programs(programs);
+        clReleaseContext(context);
+
+        break;
+    }
+
+    return Success;
+}
+
+/*!
+ * \brief Reads the matrix, extracts its features and times every format with its own launch parameters,
+ *        printing the time and whether the result is right. format_ms gets the median times.
+ */
+bool benchmark_all_formats(cl_context context, cl_command_queue command_queue, cl_program *programs, cl_uint compute_units,
+                           const char *filename, MatrixFeatures *features, double *format_ms, int runs)
+{
+    int number_of_rows;
+    int number_of_columns;
+    int number_of_nonzeroes;
+    cl_int *ptr;
+    cl_int *cols;
+    cl_double *data;
+    int format;
+    int i;
+
+    if (read_csr_from_file(filename, true, &number_of_rows, &number_of_columns, &number_of_nonzeroes, &ptr, &cols, &data) == false)
+    {
+        return false;
+    }
+
+    cl_double *vect = (cl_double*)malloc(sizeof(cl_double) * number_of_columns);
+    cl_double *expected = (cl_double*)malloc(sizeof(cl_double) * number_of_rows);
+    double *run_ms = (double*)malloc(sizeof(double) * runs);
+
+    for (i = 0; i < number_of_columns; ++i)
+    {
+        vect[i] = i % 100;
+    }
+
+    compute_reference(ptr, cols, data, vect, number_of_rows, expected);
+    extract_features(ptr, cols, number_of_rows, number_of_columns, features);
+    print_features(features);
+
+    for (format = 0; format < NumberOfFormats; ++format)
+    {
+        LaunchParameters parameters;
+        BenchmarkResult benchmark;
+
+        select_launch_parameters(features, (SpmvFormat)format, compute_units, &parameters);
+
+        if (benchmark_format(context, command_queue, programs, (SpmvFormat)format, &parameters, ptr, cols, data,
+                             number_of_rows, number_of_columns, vect, expected, 0, runs, run_ms, &benchmark) != Success)
+        {
+            return false;
+        }
+
+        format_ms[format] = benchmark.median_ms;
+        printf("%-5s %8.4lf ms, result is %s\n", spmv_format_names[format], format_ms[format], benchmark.correct ? "ok" : "wrong");
+    }
+
+    free(ptr);
+    free(cols);
+    free(data);
+    free(vect);
+    free(expected);
+    free(run_ms);
+
+    return true;
+}
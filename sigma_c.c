@@ -6,17 +6,24 @@
 #include <stdbool.h>
 #include <time.h>
 #include <math.h>
+#include <immintrin.h>
 
 #include "helper_functions.h"
+#include "formats.h"
+#include "precision.h"
 #include "enums.h"
 
 #define DEVICES_DEFAULT_SIZE 8
+#define CPU_SLICES_PER_CHUNK 16
+
+bool read_sell_c_from_file(const char *filename, int C, int *number_of_rows, int *number_of_columns, int *number_of_nonzeroes, int *number_of_slices, long *elements_sum, cl_int **row_indices, cl_int **cols, cl_double **data);
+void compute_using_cpu(cl_double *data, cl_double *vect, cl_int *cols, cl_int *row_indices, int number_of_slices, int C, int number_of_nonzeroes, cl_double **result);
+void compute_slice_using_cpu(const cl_double *data, const cl_double *vect, const cl_int *cols, int slice_start, int slice_end, int C, cl_double *result);
+void compute_slice_using_avx512(const cl_double *data, const cl_double *vect, const cl_int *cols, int slice_start, int slice_end, int C, cl_double *result);
+void compute_slice_using_avx2(const cl_double *data, const cl_double *vect, const cl_int *cols, int slice_start, int slice_end, int C, cl_double *result);
 
 int main(int argc, char *argv[])
 {
-    (void)argc;
-    (void)argv;
-
     cl_int error;
     cl_uint number_of_devices = DEVICES_DEFAULT_SIZE;
     cl_device_id device_ids[DEVICES_DEFAULT_SIZE];
@@ -34,14 +41,24 @@ int main(int argc, char *argv[])
         int number_of_slices;
         int row_indices_size;
         int number_of_groups;
+        int cpu_number_of_slices;
         int i;
-        FILE *file;
+        long elements_sum;
+        long cpu_elements_sum;
         cl_int *cols;
         cl_double *data;
         cl_int *row_indices;
+        cl_int *cpu_cols;
+        cl_double *cpu_data;
+        cl_int *cpu_row_indices;
         cl_double *vect;
         cl_double *output;
-        const char *filename = "databases/cant-sorted.mtx";
+        cl_double *output_cpu;
+        const char *filename = get_option(argc, argv, "--matrix", "databases/cant-sorted.mtx");
+        const bool compressed_indices = get_int_option(argc, argv, "--compressed-indices", 0) != 0;
+        const bool pattern = is_pattern_matrix_file(filename);
+        const bool value_dictionary = get_int_option(argc, argv, "--value-dictionary", 1) != 0;
+        const int cpu_vector_width = get_int_option(argc, argv, "--cpu-vector-width", get_cpu_vector_width());
         struct timespec start_time;
         struct timespec end_time;
 
@@ -52,165 +69,56 @@ int main(int argc, char *argv[])
         cl_uint work_dim = 1;
 
 
-        /* prepare data for calculations */
-
-        file = fopen(filename, "r");
-
-        if (file == NULL)
+        if (cpu_vector_width < 1)
         {
-            perror(filename);
-            return FileError;
+            printf("--cpu-vector-width must be at least 1\n");
+            return OtherError;
         }
 
-        if (read_size_of_matrices_from_file(file, &number_of_rows, &number_of_columns, &number_of_nonzeroes) == false)
-        {
-            fclose(file);
-            return FileError;
-        }
 
-        number_of_groups = (int)ceil((float)number_of_rows / (float)max_rows_to_check);
-        global_work_size[0] = number_of_groups * max_rows_to_check;
+        /* prepare data for calculations */
 
-        if (number_of_rows % max_rows_to_check == 0)
+        if (read_sell_c_from_file(filename, max_rows_to_check, &number_of_rows, &number_of_columns, &number_of_nonzeroes, &number_of_slices, &elements_sum, &row_indices, &cols, &data) == false)
         {
-            number_of_slices = number_of_rows / max_rows_to_check;
-        }
-        else
-        {
-            number_of_slices = (number_of_rows / max_rows_to_check) + 1;
+            return FileError;
         }
 
+        number_of_groups = number_of_slices;
+        global_work_size[0] = number_of_groups * max_rows_to_check;
         row_indices_size = number_of_slices + 1;
-        row_indices    = (cl_int *)malloc(row_indices_size * sizeof(cl_int));
-        row_indices[0] = 0;
-
-        int longest_col = 0;
-        int previous_row = 0;
-        int current_col_len = 0;
-        int rows_checked = 0;
-        int row_indices_index = 0;
-        long elements_sum = 0;
-        for (i = 0; i < number_of_nonzeroes; i++)
-        {
-            int current_row;
-            int current_col;
-            double value;
-
-            fscanf(file, "%d %d %lg\n", &current_row, &current_col, &value);
-
-            current_row--;
-
-            if (current_row == previous_row)
-            {
-                current_col_len++;
-            }
-            else
-            {
-                rows_checked++;
-
-                if (current_col_len > longest_col)
-                {
-                    longest_col = current_col_len;
-                }
-
-                if (rows_checked == max_rows_to_check)
-                {
-                    elements_sum += longest_col * max_rows_to_check;
-                    row_indices[row_indices_index + 1] = elements_sum;
-                    longest_col = 1;
-                    row_indices_index++;
-                    rows_checked = 0;
-                }
-
-                current_col_len = 1;
-                previous_row = current_row;
-            }
-        }
-
-        if (rows_checked != max_rows_to_check)
-        {
-            if (current_col_len > longest_col)
-            {
-                longest_col = current_col_len;
-            }
 
-            elements_sum += longest_col * max_rows_to_check;
-            row_indices[number_of_slices] = elements_sum;
-        }
-
-        if (fseek(file, 0, SEEK_SET) != 0)
+        vect = (cl_double*)malloc(sizeof(cl_double) * number_of_columns);
+        for (i = 0; i < number_of_columns; ++i)
         {
-            perror(filename);
-            return FileError;
+            vect[i] = i;
         }
 
-        if (read_size_of_matrices_from_file(file, &number_of_rows, &number_of_columns, &number_of_nonzeroes) == false)
-        {
-            fclose(file);
-            return FileError;
-        }
+        output = (cl_double*)malloc(sizeof(cl_double) * (number_of_groups * max_rows_to_check));
 
-        cols = (cl_int *)calloc(elements_sum, sizeof(cl_int));
-        data = (cl_double *)calloc(elements_sum, sizeof(cl_double));
+        const Precision value_precision = get_precision_option(argc, argv, "--precision");
+        const Precision vector_precision = get_precision_option(argc, argv, "--vector-precision");
+        const double tolerance = get_precision_tolerance(value_precision, vector_precision);
 
-        previous_row = 0;
-        rows_checked = 0;
-        row_indices_index = 0;
-        int start_index = row_indices[row_indices_index];
-        int current_index = start_index;
+        /* values and vector are narrowed once here, kernels widen them back to double */
+        void *device_data = convert_to_precision(data, elements_sum, value_precision);
+        void *device_vect = convert_to_precision(vect, number_of_columns, vector_precision);
 
-        for (i = 0; i < number_of_nonzeroes; i++)
-        {
-            int current_row;
-            int current_col;
-            double value;
+        printf("values stored as %s, vector as %s\n", get_precision_name(value_precision), get_precision_name(vector_precision));
 
-            fscanf(file, "%d %d %lg\n", &current_row, &current_col, &value);
+        /* values as codes into a table of the distinct values, when the table fits in constant memory */
+        cl_ulong max_constant_size = 0;
+        cl_double *dictionary = NULL;
+        void *codes = NULL;
+        size_t code_size = 0;
+        int number_of_values = 0;
 
-            current_col--;
-            current_row--;
+        clGetDeviceInfo(device_ids[0], CL_DEVICE_MAX_CONSTANT_BUFFER_SIZE, sizeof(cl_ulong), &max_constant_size, NULL);
 
-            if (previous_row == current_row)
-            {
-                data[current_index] = value;
-                cols[current_index] = current_col;
-                current_index += max_rows_to_check;
-            }
-            else
-            {
-                rows_checked++;
-
-                if (rows_checked == max_rows_to_check)
-                {
-                    rows_checked = 0;
-                    row_indices_index++;
-                    start_index = row_indices[row_indices_index];
-                }
-                else
-                {
-                    start_index++;
-                }
-
-                current_index = start_index;
-
-                previous_row = current_row;
-
-                cols[current_index] = current_col;
-                data[current_index] = value;
-                current_index += max_rows_to_check;
-            }
-        }
-
-        fclose(file);
-
-        vect = (cl_double*)malloc(sizeof(cl_double) * number_of_columns);
-        for (i = 0; i < number_of_columns; ++i)
+        if (value_dictionary)
         {
-            vect[i] = i;
+            number_of_values = create_value_dictionary(data, elements_sum, max_constant_size / sizeof(cl_double), get_precision_size(value_precision), &dictionary, &codes, &code_size);
         }
 
-        output = (cl_double*)malloc(sizeof(cl_double) * (number_of_groups * max_rows_to_check));
-
 
         /* prepare OpenCL program */
 
@@ -230,9 +138,9 @@ int main(int argc, char *argv[])
             return OpenCLProgramError;
         }
 
-        cl_mem buffer_data       = clCreateBuffer(context, CL_MEM_READ_ONLY, sizeof(cl_double) * elements_sum, NULL, &error);
+        cl_mem buffer_data       = clCreateBuffer(context, CL_MEM_READ_ONLY, get_precision_size(value_precision) * elements_sum, NULL, &error);
         cl_mem buffer_indices    = clCreateBuffer(context, CL_MEM_READ_ONLY, sizeof(cl_int) * elements_sum, NULL, &error);
-        cl_mem buffer_vect       = clCreateBuffer(context, CL_MEM_READ_ONLY, sizeof(cl_double) * number_of_columns, NULL, &error);
+        cl_mem buffer_vect       = clCreateBuffer(context, CL_MEM_READ_ONLY, get_precision_size(vector_precision) * number_of_columns, NULL, &error);
         cl_mem buffer_row_indices = clCreateBuffer(context, CL_MEM_READ_ONLY, sizeof(cl_int) * row_indices_size, NULL, &error);
         cl_mem buffer_output     = clCreateBuffer(context, CL_MEM_WRITE_ONLY, sizeof(cl_double) * (number_of_groups * max_rows_to_check), NULL, &error);
 
@@ -258,7 +166,16 @@ int main(int argc, char *argv[])
             return OpenCLProgramError;
         }
 
-        error = clBuildProgram(program, 0, NULL, NULL, NULL, NULL);
+        char build_options[128] = "";
+
+        append_precision_build_options(build_options, sizeof(build_options), value_precision, vector_precision);
+
+        if (number_of_values > 0)
+        {
+            snprintf(build_options + strlen(build_options), sizeof(build_options) - strlen(build_options), " -DVALUE_CODE_BITS=%d", (int)code_size * 8);
+        }
+
+        error = clBuildProgram(program, 0, NULL, build_options, NULL, NULL);
 
         if (error != CL_SUCCESS)
         {
@@ -290,9 +207,9 @@ int main(int argc, char *argv[])
             return OpenCLProgramError;
         }
 
-        error  = clEnqueueWriteBuffer(command_queue, buffer_data, CL_FALSE, 0, sizeof(cl_double) * elements_sum, data, 0, NULL, NULL);
+        error  = clEnqueueWriteBuffer(command_queue, buffer_data, CL_FALSE, 0, get_precision_size(value_precision) * elements_sum, device_data, 0, NULL, NULL);
         error |= clEnqueueWriteBuffer(command_queue, buffer_indices, CL_FALSE, 0, sizeof(cl_int) * elements_sum, cols, 0, NULL, NULL);
-        error |= clEnqueueWriteBuffer(command_queue, buffer_vect, CL_FALSE, 0, sizeof(cl_double) * number_of_columns, vect, 0, NULL, NULL);
+        error |= clEnqueueWriteBuffer(command_queue, buffer_vect, CL_FALSE, 0, get_precision_size(vector_precision) * number_of_columns, device_vect, 0, NULL, NULL);
         error |= clEnqueueWriteBuffer(command_queue, buffer_row_indices, CL_FALSE, 0, sizeof(cl_int) * row_indices_size, row_indices, 0, NULL, NULL);
 
         if (error != CL_SUCCESS)
@@ -336,7 +253,7 @@ int main(int argc, char *argv[])
             return OpenCLProgramError;
         }
 
-        if (check_result(filename, vect, output) == true)
+        if (check_result_with_tolerance(filename, vect, output, tolerance) == true)
         {
             printf("result is ok\n");
         }
@@ -351,6 +268,277 @@ int main(int argc, char *argv[])
 //         }
 
 
+        /* columns as 16-bit offsets from the smallest column of the slice */
+
+        if (compressed_indices)
+        {
+            cl_ushort *deltas;
+            cl_int *bases;
+            cl_int *escaped_cols;
+            const int number_of_escaped = compress_column_indices(row_indices, number_of_slices, cols, &deltas, &bases, &escaped_cols);
+
+            print_index_compression(elements_sum, number_of_nonzeroes, number_of_slices, number_of_escaped, get_precision_size(value_precision));
+
+            cl_mem buffer_deltas       = clCreateBuffer(context, CL_MEM_READ_ONLY, sizeof(cl_ushort) * elements_sum, NULL, &error);
+            cl_mem buffer_bases        = clCreateBuffer(context, CL_MEM_READ_ONLY, sizeof(cl_int) * number_of_slices, NULL, &error);
+            cl_mem buffer_escaped_cols = clCreateBuffer(context, CL_MEM_READ_ONLY, sizeof(cl_int) * (number_of_escaped > 0 ? number_of_escaped : 1), NULL, &error);
+
+            if (error != CL_SUCCESS)
+            {
+                printf("clCreateBuffer error %d\n", error);
+                return OpenCLProgramError;
+            }
+
+            cl_kernel compressed_kernel = clCreateKernel(program, "sigma_c_compressed", &error);
+
+            if (error != CL_SUCCESS)
+            {
+                printf("clCreateKernel error %d\n", error);
+                return OpenCLProgramError;
+            }
+
+            error =  clSetKernelArg(compressed_kernel, 0, sizeof(cl_mem), (void*)&buffer_data);
+            error |= clSetKernelArg(compressed_kernel, 1, sizeof(cl_mem), (void*)&buffer_deltas);
+            error |= clSetKernelArg(compressed_kernel, 2, sizeof(cl_mem), (void*)&buffer_bases);
+            error |= clSetKernelArg(compressed_kernel, 3, sizeof(cl_mem), (void*)&buffer_escaped_cols);
+            error |= clSetKernelArg(compressed_kernel, 4, sizeof(cl_mem), (void*)&buffer_vect);
+            error |= clSetKernelArg(compressed_kernel, 5, sizeof(cl_mem), (void*)&buffer_output);
+            error |= clSetKernelArg(compressed_kernel, 6, sizeof(cl_mem), (void*)&buffer_row_indices);
+            error |= clSetKernelArg(compressed_kernel, 7, sizeof(int), (void*)&max_rows_to_check);
+
+            if (error != CL_SUCCESS)
+            {
+                printf("clSetKernelArg errror\n");
+                return OpenCLProgramError;
+            }
+
+            error  = clEnqueueWriteBuffer(command_queue, buffer_deltas, CL_FALSE, 0, sizeof(cl_ushort) * elements_sum, deltas, 0, NULL, NULL);
+            error |= clEnqueueWriteBuffer(command_queue, buffer_bases, CL_FALSE, 0, sizeof(cl_int) * number_of_slices, bases, 0, NULL, NULL);
+            error |= clEnqueueWriteBuffer(command_queue, buffer_escaped_cols, CL_FALSE, 0, sizeof(cl_int) * (number_of_escaped > 0 ? number_of_escaped : 1), escaped_cols, 0, NULL, NULL);
+
+            if (error != CL_SUCCESS)
+            {
+                printf("clEnqueueWriteBuffer error %d\n", error);
+                return OpenCLProgramError;
+            }
+            clFinish(command_queue);
+
+            printf("\ncompressed column indices\n");
+
+            const double compressed_ms = run_kernel(command_queue, compressed_kernel, work_dim, global_work_size, local_work_size);
+
+            if (compressed_ms < 0)
+            {
+                return OpenCLProgramError;
+            }
+
+            calculate_and_print_performance(compressed_ms, number_of_nonzeroes);
+            printf("speedup over 32-bit columns %.2lf\n", ms / compressed_ms);
+
+            error = clEnqueueReadBuffer(command_queue, buffer_output, CL_TRUE, 0, sizeof(cl_double) * (number_of_groups * max_rows_to_check), output, 0, NULL, NULL);
+
+            if (error != CL_SUCCESS)
+            {
+                printf("clEnqueueReadBuffer error %d\n", error);
+                return OpenCLProgramError;
+            }
+
+            if (check_result_with_tolerance(filename, vect, output, tolerance) == true)
+            {
+                printf("compressed result is ok\n");
+            }
+            else
+            {
+                printf("compressed result is wrong\n");
+            }
+
+            clReleaseMemObject(buffer_deltas);
+            clReleaseMemObject(buffer_bases);
+            clReleaseMemObject(buffer_escaped_cols);
+            clReleaseKernel(compressed_kernel);
+
+            free(deltas);
+            free(bases);
+            free(escaped_cols);
+        }
+
+
+        /* values as 8- or 16-bit codes into the table of distinct values */
+
+        if (number_of_values > 0)
+        {
+            cl_mem buffer_codes      = clCreateBuffer(context, CL_MEM_READ_ONLY, code_size * elements_sum, NULL, &error);
+            cl_mem buffer_dictionary = clCreateBuffer(context, CL_MEM_READ_ONLY, sizeof(cl_double) * number_of_values, NULL, &error);
+
+            if (error != CL_SUCCESS)
+            {
+                printf("clCreateBuffer error %d\n", error);
+                return OpenCLProgramError;
+            }
+
+            cl_kernel dictionary_kernel = clCreateKernel(program, "sigma_c_dictionary", &error);
+
+            if (error != CL_SUCCESS)
+            {
+                printf("clCreateKernel error %d\n", error);
+                return OpenCLProgramError;
+            }
+
+            error  = clSetKernelArg(dictionary_kernel, 0, sizeof(cl_mem), (void*)&buffer_codes);
+            error |= clSetKernelArg(dictionary_kernel, 1, sizeof(cl_mem), (void*)&buffer_dictionary);
+            error |= clSetKernelArg(dictionary_kernel, 2, sizeof(cl_mem), (void*)&buffer_indices);
+            error |= clSetKernelArg(dictionary_kernel, 3, sizeof(cl_mem), (void*)&buffer_vect);
+            error |= clSetKernelArg(dictionary_kernel, 4, sizeof(cl_mem), (void*)&buffer_output);
+            error |= clSetKernelArg(dictionary_kernel, 5, sizeof(cl_mem), (void*)&buffer_row_indices);
+            error |= clSetKernelArg(dictionary_kernel, 6, sizeof(int), (void*)&max_rows_to_check);
+
+            if (error != CL_SUCCESS)
+            {
+                printf("clSetKernelArg errror\n");
+                return OpenCLProgramError;
+            }
+
+            error  = clEnqueueWriteBuffer(command_queue, buffer_codes, CL_FALSE, 0, code_size * elements_sum, codes, 0, NULL, NULL);
+            error |= clEnqueueWriteBuffer(command_queue, buffer_dictionary, CL_FALSE, 0, sizeof(cl_double) * number_of_values, dictionary, 0, NULL, NULL);
+
+            if (error != CL_SUCCESS)
+            {
+                printf("clEnqueueWriteBuffer error %d\n", error);
+                return OpenCLProgramError;
+            }
+            clFinish(command_queue);
+
+            printf("\ndictionary-compressed values\n");
+            print_value_dictionary(elements_sum, number_of_nonzeroes, number_of_values, code_size, get_precision_size(value_precision));
+
+            const double dictionary_ms = run_kernel(command_queue, dictionary_kernel, work_dim, global_work_size, local_work_size);
+
+            if (dictionary_ms < 0)
+            {
+                return OpenCLProgramError;
+            }
+
+            calculate_and_print_performance(dictionary_ms, number_of_nonzeroes);
+            printf("speedup over explicit values %.2lf\n", ms / dictionary_ms);
+
+            error = clEnqueueReadBuffer(command_queue, buffer_output, CL_TRUE, 0, sizeof(cl_double) * (number_of_groups * max_rows_to_check), output, 0, NULL, NULL);
+
+            if (error != CL_SUCCESS)
+            {
+                printf("clEnqueueReadBuffer error %d\n", error);
+                return OpenCLProgramError;
+            }
+
+            /* the dictionary keeps the values in double, so it is checked like the stored values */
+            if (check_result_with_tolerance(filename, vect, output, tolerance) == true)
+            {
+                printf("dictionary result is ok\n");
+            }
+            else
+            {
+                printf("dictionary result is wrong\n");
+            }
+
+            clReleaseMemObject(buffer_codes);
+            clReleaseMemObject(buffer_dictionary);
+            clReleaseKernel(dictionary_kernel);
+        }
+
+
+        /* pattern matrix: columns only, every value is 1 */
+
+        if (pattern)
+        {
+            const double value = 1;
+            cl_int *pattern_cols = create_pattern_indices(cols, data, elements_sum);
+            cl_mem buffer_pattern_cols = clCreateBuffer(context, CL_MEM_READ_ONLY, sizeof(cl_int) * elements_sum, NULL, &error);
+
+            if (error != CL_SUCCESS || clEnqueueWriteBuffer(command_queue, buffer_pattern_cols, CL_TRUE, 0, sizeof(cl_int) * elements_sum, pattern_cols, 0, NULL, NULL) != CL_SUCCESS)
+            {
+                printf("pattern column buffer error\n");
+                return OpenCLProgramError;
+            }
+
+            cl_kernel pattern_kernel = clCreateKernel(program, "sigma_c_pattern", &error);
+
+            if (error != CL_SUCCESS)
+            {
+                printf("clCreateKernel error %d\n", error);
+                return OpenCLProgramError;
+            }
+
+            error  = clSetKernelArg(pattern_kernel, 0, sizeof(cl_mem), (void*)&buffer_pattern_cols);
+            error |= clSetKernelArg(pattern_kernel, 1, sizeof(cl_mem), (void*)&buffer_vect);
+            error |= clSetKernelArg(pattern_kernel, 2, sizeof(cl_mem), (void*)&buffer_output);
+            error |= clSetKernelArg(pattern_kernel, 3, sizeof(cl_mem), (void*)&buffer_row_indices);
+            error |= clSetKernelArg(pattern_kernel, 4, sizeof(int), (void*)&max_rows_to_check);
+            error |= clSetKernelArg(pattern_kernel, 5, sizeof(double), (void*)&value);
+
+            if (error != CL_SUCCESS)
+            {
+                printf("clSetKernelArg errror\n");
+                return OpenCLProgramError;
+            }
+
+            printf("\npattern matrix without values\n");
+            print_pattern_savings(elements_sum, number_of_nonzeroes, get_precision_size(value_precision));
+
+            const double pattern_ms = run_kernel(command_queue, pattern_kernel, work_dim, global_work_size, local_work_size);
+
+            if (pattern_ms < 0)
+            {
+                return OpenCLProgramError;
+            }
+
+            calculate_and_print_performance(pattern_ms, number_of_nonzeroes);
+            printf("speedup over explicit values %.2lf\n", ms / pattern_ms);
+
+            error = clEnqueueReadBuffer(command_queue, buffer_output, CL_TRUE, 0, sizeof(cl_double) * (number_of_groups * max_rows_to_check), output, 0, NULL, NULL);
+
+            if (error != CL_SUCCESS)
+            {
+                printf("clEnqueueReadBuffer error %d\n", error);
+                return OpenCLProgramError;
+            }
+
+            if (check_result_with_tolerance(filename, vect, output, tolerance) == true)
+            {
+                printf("pattern result is ok\n");
+            }
+            else
+            {
+                printf("pattern result is wrong\n");
+            }
+
+            clReleaseMemObject(buffer_pattern_cols);
+            free(pattern_cols);
+            clReleaseKernel(pattern_kernel);
+        }
+
+
+        /* CPU, one slice is one register of the widest instructions the CPU has unless --cpu-vector-width asks for fewer lanes */
+
+        const int cpu_slice_height = cpu_vector_width < get_cpu_vector_width() ? cpu_vector_width : get_cpu_vector_width();
+
+        if (read_sell_c_from_file(filename, cpu_slice_height, &number_of_rows, &number_of_columns, &number_of_nonzeroes, &cpu_number_of_slices, &cpu_elements_sum, &cpu_row_indices, &cpu_cols, &cpu_data) == false)
+        {
+            return FileError;
+        }
+
+        output_cpu = (cl_double*)malloc(sizeof(cl_double) * (cpu_number_of_slices * cpu_slice_height));
+
+        compute_using_cpu(cpu_data, vect, cpu_cols, cpu_row_indices, cpu_number_of_slices, cpu_slice_height, number_of_nonzeroes, &output_cpu);
+
+        if (check_result(filename, vect, output_cpu) == true)
+        {
+            printf("cpu result is ok\n");
+        }
+        else
+        {
+            printf("cpu result is wrong\n");
+        }
+
+
         /* release memory */
 
         clReleaseMemObject(buffer_data);
@@ -361,8 +549,16 @@ int main(int argc, char *argv[])
         free(cols);
         free(data);
         free(row_indices);
+        free(cpu_cols);
+        free(cpu_data);
+        free(cpu_row_indices);
         free(vect);
+        free(device_data);
+        free(device_vect);
         free(output);
+        free(output_cpu);
+        free(dictionary);
+        free(codes);
         free(source);
 
         clFlush(command_queue);
@@ -377,3 +573,131 @@ int main(int argc, char *argv[])
 
     return Success;
 }
+
+/*!
+ * \brief Reads the file as CSR (symmetric files expanded) and converts it with create_sell, so rows may come in any order and may be empty.
+ */
+bool read_sell_c_from_file(const char *filename, int C, int *number_of_rows, int *number_of_columns, int *number_of_nonzeroes, int *number_of_slices, long *elements_sum, cl_int **row_indices, cl_int **cols, cl_double **data)
+{
+    cl_int *ptr;
+    cl_int *csr_cols;
+    cl_double *csr_data;
+
+    if (read_csr_from_file(filename, true, number_of_rows, number_of_columns, number_of_nonzeroes, &ptr, &csr_cols, &csr_data) == false)
+    {
+        return false;
+    }
+
+    create_sell(ptr, csr_cols, csr_data, *number_of_rows, C, number_of_slices, row_indices, cols, data);
+    *elements_sum = (*row_indices)[*number_of_slices];
+
+    free(ptr);
+    free(csr_cols);
+    free(csr_data);
+
+    return true;
+}
+
+void compute_using_cpu(cl_double *data, cl_double *vect, cl_int *cols, cl_int *row_indices, int number_of_slices, int C, int number_of_nonzeroes, cl_double **result)
+{
+    int i;
+    struct timespec start_time;
+    struct timespec end_time;
+    void (*compute_slice)(const cl_double *, const cl_double *, const cl_int *, int, int, int, cl_double *);
+
+    switch (C)
+    {
+        case 8:
+            compute_slice = compute_slice_using_avx512;
+            break;
+        case 4:
+            compute_slice = compute_slice_using_avx2;
+            break;
+        default:
+            compute_slice = compute_slice_using_cpu;
+            break;
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &start_time);
+
+    #pragma omp parallel for schedule(dynamic, CPU_SLICES_PER_CHUNK) shared(data, vect, cols, row_indices, number_of_slices, C, result, compute_slice) private(i)
+    for (i = 0; i < number_of_slices; ++i)
+    {
+        compute_slice(data, vect, cols, row_indices[i], row_indices[i + 1], C, &(*result)[i * C]);
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &end_time);
+    double ms = (double)(end_time.tv_nsec - start_time.tv_nsec) / 1000000 + (double)(end_time.tv_sec - start_time.tv_sec) * 1000;
+
+    printf("\nCPU calculations (C = %d)\n", C);
+    calculate_and_print_performance(ms, number_of_nonzeroes);
+}
+
+/*!
+ * \brief Multiplies one slice, every lane of the inner loop is one row of the slice.
+ */
+void compute_slice_using_cpu(const cl_double *data, const cl_double *vect, const cl_int *cols, int slice_start, int slice_end, int C, cl_double *result)
+{
+    cl_double sum[C];
+    int lane;
+    int index;
+
+    for (lane = 0; lane < C; ++lane)
+    {
+        sum[lane] = 0;
+    }
+
+    for (index = slice_start; index < slice_end; index += C)
+    {
+        #pragma omp simd
+        for (lane = 0; lane < C; ++lane)
+        {
+            sum[lane] += data[index + lane] * vect[cols[index + lane]];
+        }
+    }
+
+    for (lane = 0; lane < C; ++lane)
+    {
+        result[lane] = sum[lane];
+    }
+}
+
+/*!
+ * \brief Same as compute_slice_using_cpu for C == 8, one slice column fills one AVX-512 register.
+ */
+__attribute__((target("avx512f")))
+void compute_slice_using_avx512(const cl_double *data, const cl_double *vect, const cl_int *cols, int slice_start, int slice_end, int C, cl_double *result)
+{
+    __m512d sum = _mm512_setzero_pd();
+    int index;
+
+    for (index = slice_start; index < slice_end; index += C)
+    {
+        __m256i indices = _mm256_loadu_si256((const __m256i *)&cols[index]);
+        __m512d values = _mm512_loadu_pd(&data[index]);
+
+        sum = _mm512_fmadd_pd(values, _mm512_i32gather_pd(indices, vect, sizeof(cl_double)), sum);
+    }
+
+    _mm512_storeu_pd(result, sum);
+}
+
+/*!
+ * \brief Same as compute_slice_using_cpu for C == 4, one slice column fills one AVX2 register.
+ */
+__attribute__((target("avx2,fma")))
+void compute_slice_using_avx2(const cl_double *data, const cl_double *vect, const cl_int *cols, int slice_start, int slice_end, int C, cl_double *result)
+{
+    __m256d sum = _mm256_setzero_pd();
+    int index;
+
+    for (index = slice_start; index < slice_end; index += C)
+    {
+        __m128i indices = _mm_loadu_si128((const __m128i *)&cols[index]);
+        __m256d values = _mm256_loadu_pd(&data[index]);
+
+        sum = _mm256_fmadd_pd(values, _mm256_i32gather_pd(vect, indices, sizeof(cl_double)), sum);
+    }
+
+    _mm256_storeu_pd(result, sum);
+}
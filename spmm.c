@@ -0,0 +1,391 @@
+#define CL_TARGET_OPENCL_VERSION 300
+#include <CL/cl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <time.h>
+
+#include "helper_functions.h"
+#include "formats.h"
+#include "precision.h"
+#include "enums.h"
+
+#define DEVICES_DEFAULT_SIZE 8
+#define NUMBER_OF_SPMM_FORMATS 4
+#define MAX_VECTOR_BLOCK 8
+
+void compute_reference(cl_int *ptr, cl_int *cols, cl_double *data, cl_double *vect, int number_of_rows, int k, cl_double *result);
+bool check_spmm_result(const cl_double *expected, const cl_double *result, int number_of_rows, int k, double tolerance);
+
+int main(int argc, char *argv[])
+{
+    cl_int error;
+    cl_uint number_of_devices = DEVICES_DEFAULT_SIZE;
+    cl_device_id device_ids[DEVICES_DEFAULT_SIZE];
+
+    if (get_device_ids(&device_ids[0], &number_of_devices) != CL_SUCCESS)
+    {
+        return OpenCLDeviceError;
+    }
+
+    for (cl_uint device_number = 0; device_number < number_of_devices; ++device_number)
+    {
+        int number_of_rows;
+        int number_of_columns;
+        int number_of_nonzeroes;
+        int row_size;
+        int number_of_slices;
+        int number_of_strips;
+        int i;
+        cl_int *ptr;
+        cl_int *cols;
+        cl_double *data;
+        cl_int *ell_cols;
+        cl_double *ell_data;
+        cl_int *row_indices;
+        cl_int *sell_cols;
+        cl_double *sell_data;
+        cl_int *strip_ptr;
+        cl_int *row_in_strip;
+        cl_double *vect;
+        cl_double *output;
+        cl_double *expected;
+        const char *filename = get_option(argc, argv, "--matrix", "databases/cant-sorted.mtx");
+        const int max_vectors = get_int_option(argc, argv, "--max-vectors", 64);
+        const int C = 32;
+        const int height = get_int_option(argc, argv, "--height", 8);
+        const char *format_names[NUMBER_OF_SPMM_FORMATS] = { "csr", "ell", "sigma_c", "cmrs" };
+        const char *kernel_names[NUMBER_OF_SPMM_FORMATS] = { "csr_spmm", "ell_spmm", "sigma_c_spmm", "cmrs_spmm" };
+        double gflops[NUMBER_OF_SPMM_FORMATS][32];
+        int number_of_k = 0;
+        int k;
+
+        size_t global_work_size[1] = { 8192 };
+        size_t local_work_size[1] = { 256 };
+        cl_uint work_dim = 1;
+
+
+        /* prepare data for calculations */
+
+        if (read_csr_from_file(filename, true, &number_of_rows, &number_of_columns, &number_of_nonzeroes, &ptr, &cols, &data) == false)
+        {
+            return FileError;
+        }
+
+        create_ell(ptr, cols, data, number_of_rows, &row_size, &ell_cols, &ell_data);
+        create_sell(ptr, cols, data, number_of_rows, C, &number_of_slices, &row_indices, &sell_cols, &sell_data);
+        create_cmrs(ptr, number_of_rows, height, &number_of_strips, &strip_ptr, &row_in_strip);
+
+        const long ell_size = (long)row_size * number_of_rows;
+        const long sell_size = row_indices[number_of_slices];
+        const int sell_rows = number_of_slices * C;
+        const int cmrs_rows = number_of_strips * height;
+        const int output_rows = sell_rows > cmrs_rows ? sell_rows : cmrs_rows;
+
+        vect = (cl_double*)malloc(sizeof(cl_double) * number_of_columns * max_vectors);
+        output = (cl_double*)malloc(sizeof(cl_double) * output_rows * max_vectors);
+        expected = (cl_double*)malloc(sizeof(cl_double) * number_of_rows * max_vectors);
+
+        const Precision value_precision = get_precision_option(argc, argv, "--precision");
+        const Precision vector_precision = get_precision_option(argc, argv, "--vector-precision");
+        const double tolerance = get_precision_tolerance(value_precision, vector_precision);
+        const size_t value_size = get_precision_size(value_precision);
+        const size_t vector_size = get_precision_size(vector_precision);
+
+        /* values are narrowed once here, vectors for every k; kernels widen them back to double */
+        void *device_data = convert_to_precision(data, number_of_nonzeroes, value_precision);
+        void *device_ell_data = convert_to_precision(ell_data, ell_size, value_precision);
+        void *device_sell_data = convert_to_precision(sell_data, sell_size, value_precision);
+
+        printf("values stored as %s, vectors as %s\n", get_precision_name(value_precision), get_precision_name(vector_precision));
+
+
+        /* prepare OpenCL program */
+
+        cl_context context = clCreateContext(0, number_of_devices, device_ids, NULL, NULL, NULL);
+
+        if (NULL == context)
+        {
+            printf("context is null\n");
+            return OpenCLProgramError;
+        }
+
+        cl_command_queue command_queue = clCreateCommandQueueWithProperties(context, device_ids[0], 0, &error);
+
+        if (error != CL_SUCCESS)
+        {
+            printf("clCreateCommandQueueWithProperties error %d\n", error);
+            return OpenCLProgramError;
+        }
+
+        cl_mem buffer_ptr          = clCreateBuffer(context, CL_MEM_READ_ONLY, sizeof(cl_int) * (number_of_rows + 1), NULL, &error);
+        cl_mem buffer_col          = clCreateBuffer(context, CL_MEM_READ_ONLY, sizeof(cl_int) * number_of_nonzeroes, NULL, &error);
+        cl_mem buffer_data         = clCreateBuffer(context, CL_MEM_READ_ONLY, value_size * number_of_nonzeroes, NULL, &error);
+        cl_mem buffer_ell_cols     = clCreateBuffer(context, CL_MEM_READ_ONLY, sizeof(cl_int) * ell_size, NULL, &error);
+        cl_mem buffer_ell_data     = clCreateBuffer(context, CL_MEM_READ_ONLY, value_size * ell_size, NULL, &error);
+        cl_mem buffer_row_indices  = clCreateBuffer(context, CL_MEM_READ_ONLY, sizeof(cl_int) * (number_of_slices + 1), NULL, &error);
+        cl_mem buffer_sell_cols    = clCreateBuffer(context, CL_MEM_READ_ONLY, sizeof(cl_int) * sell_size, NULL, &error);
+        cl_mem buffer_sell_data    = clCreateBuffer(context, CL_MEM_READ_ONLY, value_size * sell_size, NULL, &error);
+        cl_mem buffer_strip_ptr    = clCreateBuffer(context, CL_MEM_READ_ONLY, sizeof(cl_int) * (number_of_strips + 1), NULL, &error);
+        cl_mem buffer_row_in_strip = clCreateBuffer(context, CL_MEM_READ_ONLY, sizeof(cl_int) * number_of_nonzeroes, NULL, &error);
+        cl_mem buffer_vect         = clCreateBuffer(context, CL_MEM_READ_ONLY, vector_size * number_of_columns * max_vectors, NULL, &error);
+        cl_mem buffer_output       = clCreateBuffer(context, CL_MEM_WRITE_ONLY, sizeof(cl_double) * output_rows * max_vectors, NULL, &error);
+
+        if (error != CL_SUCCESS)
+        {
+            printf("clCreateBuffer error %d\n", error);
+            return OpenCLProgramError;
+        }
+
+        error  = clEnqueueWriteBuffer(command_queue, buffer_ptr, CL_FALSE, 0, sizeof(cl_int) * (number_of_rows + 1), ptr, 0, NULL, NULL);
+        error |= clEnqueueWriteBuffer(command_queue, buffer_col, CL_FALSE, 0, sizeof(cl_int) * number_of_nonzeroes, cols, 0, NULL, NULL);
+        error |= clEnqueueWriteBuffer(command_queue, buffer_data, CL_FALSE, 0, value_size * number_of_nonzeroes, device_data, 0, NULL, NULL);
+        error |= clEnqueueWriteBuffer(command_queue, buffer_ell_cols, CL_FALSE, 0, sizeof(cl_int) * ell_size, ell_cols, 0, NULL, NULL);
+        error |= clEnqueueWriteBuffer(command_queue, buffer_ell_data, CL_FALSE, 0, value_size * ell_size, device_ell_data, 0, NULL, NULL);
+        error |= clEnqueueWriteBuffer(command_queue, buffer_row_indices, CL_FALSE, 0, sizeof(cl_int) * (number_of_slices + 1), row_indices, 0, NULL, NULL);
+        error |= clEnqueueWriteBuffer(command_queue, buffer_sell_cols, CL_FALSE, 0, sizeof(cl_int) * sell_size, sell_cols, 0, NULL, NULL);
+        error |= clEnqueueWriteBuffer(command_queue, buffer_sell_data, CL_FALSE, 0, value_size * sell_size, device_sell_data, 0, NULL, NULL);
+        error |= clEnqueueWriteBuffer(command_queue, buffer_strip_ptr, CL_FALSE, 0, sizeof(cl_int) * (number_of_strips + 1), strip_ptr, 0, NULL, NULL);
+        error |= clEnqueueWriteBuffer(command_queue, buffer_row_in_strip, CL_FALSE, 0, sizeof(cl_int) * number_of_nonzeroes, row_in_strip, 0, NULL, NULL);
+
+        if (error != CL_SUCCESS)
+        {
+            printf("clEnqueueWriteBuffer error %d\n", error);
+            return OpenCLProgramError;
+        }
+        clFinish(command_queue);
+
+
+        /* run programs, k is doubled so that it is always divisible by the vector block */
+
+        for (k = 1; k <= max_vectors && number_of_k < 32; k *= 2, ++number_of_k)
+        {
+            const int vector_block = k < MAX_VECTOR_BLOCK ? k : MAX_VECTOR_BLOCK;
+            char build_options[128];
+            int format;
+
+            for (i = 0; i < number_of_columns * k; ++i)
+            {
+                vect[i] = i / k + i % k;
+            }
+
+            compute_reference(ptr, cols, data, vect, number_of_rows, k, expected);
+
+            void *device_vect = convert_to_precision(vect, (size_t)number_of_columns * k, vector_precision);
+
+            error = clEnqueueWriteBuffer(command_queue, buffer_vect, CL_TRUE, 0, vector_size * number_of_columns * k, device_vect, 0, NULL, NULL);
+            free(device_vect);
+
+            if (error != CL_SUCCESS)
+            {
+                printf("clEnqueueWriteBuffer error %d\n", error);
+                return OpenCLProgramError;
+            }
+
+            snprintf(build_options, sizeof(build_options), "-DVECTOR_BLOCK=%d", vector_block);
+            append_precision_build_options(build_options, sizeof(build_options), value_precision, vector_precision);
+
+            cl_program program = build_program_from_file(context, device_ids[0], "kernels/Spmm.cl", build_options);
+
+            if (program == NULL)
+            {
+                return OpenCLProgramError;
+            }
+
+            printf("\nk = %d (%d vectors per work-item)\n", k, vector_block);
+
+            for (format = 0; format < NUMBER_OF_SPMM_FORMATS; ++format)
+            {
+                cl_kernel kernel = clCreateKernel(program, kernel_names[format], &error);
+                int output_rows_of_format = number_of_rows;
+
+                if (error != CL_SUCCESS)
+                {
+                    printf("clCreateKernel error %d\n", error);
+                    return OpenCLProgramError;
+                }
+
+                switch (format)
+                {
+                    case 0:
+                        error  = clSetKernelArg(kernel, 0, sizeof(cl_mem), (void*)&buffer_ptr);
+                        error |= clSetKernelArg(kernel, 1, sizeof(cl_mem), (void*)&buffer_col);
+                        error |= clSetKernelArg(kernel, 2, sizeof(cl_mem), (void*)&buffer_data);
+                        error |= clSetKernelArg(kernel, 3, sizeof(cl_mem), (void*)&buffer_vect);
+                        error |= clSetKernelArg(kernel, 4, sizeof(cl_mem), (void*)&buffer_output);
+                        error |= clSetKernelArg(kernel, 5, sizeof(int), (void*)&number_of_rows);
+                        error |= clSetKernelArg(kernel, 6, sizeof(int), (void*)&k);
+                        break;
+                    case 1:
+                        error  = clSetKernelArg(kernel, 0, sizeof(cl_mem), (void*)&buffer_ell_data);
+                        error |= clSetKernelArg(kernel, 1, sizeof(cl_mem), (void*)&buffer_ell_cols);
+                        error |= clSetKernelArg(kernel, 2, sizeof(cl_mem), (void*)&buffer_vect);
+                        error |= clSetKernelArg(kernel, 3, sizeof(cl_mem), (void*)&buffer_output);
+                        error |= clSetKernelArg(kernel, 4, sizeof(int), (void*)&number_of_rows);
+                        error |= clSetKernelArg(kernel, 5, sizeof(int), (void*)&row_size);
+                        error |= clSetKernelArg(kernel, 6, sizeof(int), (void*)&k);
+                        break;
+                    case 2:
+                        output_rows_of_format = sell_rows;
+                        error  = clSetKernelArg(kernel, 0, sizeof(cl_mem), (void*)&buffer_sell_data);
+                        error |= clSetKernelArg(kernel, 1, sizeof(cl_mem), (void*)&buffer_sell_cols);
+                        error |= clSetKernelArg(kernel, 2, sizeof(cl_mem), (void*)&buffer_vect);
+                        error |= clSetKernelArg(kernel, 3, sizeof(cl_mem), (void*)&buffer_output);
+                        error |= clSetKernelArg(kernel, 4, sizeof(cl_mem), (void*)&buffer_row_indices);
+                        error |= clSetKernelArg(kernel, 5, sizeof(int), (void*)&C);
+                        error |= clSetKernelArg(kernel, 6, sizeof(int), (void*)&sell_rows);
+                        error |= clSetKernelArg(kernel, 7, sizeof(int), (void*)&k);
+                        break;
+                    default:
+                        output_rows_of_format = cmrs_rows;
+                        error  = clSetKernelArg(kernel, 0, sizeof(cl_mem), (void*)&buffer_data);
+                        error |= clSetKernelArg(kernel, 1, sizeof(cl_mem), (void*)&buffer_col);
+                        error |= clSetKernelArg(kernel, 2, sizeof(cl_mem), (void*)&buffer_strip_ptr);
+                        error |= clSetKernelArg(kernel, 3, sizeof(cl_mem), (void*)&buffer_row_in_strip);
+                        error |= clSetKernelArg(kernel, 4, sizeof(cl_mem), (void*)&buffer_vect);
+                        error |= clSetKernelArg(kernel, 5, sizeof(cl_mem), (void*)&buffer_output);
+                        error |= clSetKernelArg(kernel, 6, sizeof(int), (void*)&number_of_strips);
+                        error |= clSetKernelArg(kernel, 7, sizeof(int), (void*)&height);
+                        error |= clSetKernelArg(kernel, 8, sizeof(int), (void*)&k);
+                        break;
+                }
+
+                if (error != CL_SUCCESS)
+                {
+                    printf("clSetKernelArg errror\n");
+                    return OpenCLProgramError;
+                }
+
+                double ms = run_kernel(command_queue, kernel, work_dim, global_work_size, local_work_size);
+
+                if (ms < 0 || clEnqueueReadBuffer(command_queue, buffer_output, CL_TRUE, 0, sizeof(cl_double) * output_rows_of_format * k, output, 0, NULL, NULL) != CL_SUCCESS)
+                {
+                    return OpenCLProgramError;
+                }
+
+                gflops[format][number_of_k] = 2.0 * number_of_nonzeroes * k / ms * 1e-6;
+
+                printf("%-8s %8.3lf ms %10.3lf GFlops, result is %s\n", format_names[format], ms, gflops[format][number_of_k],
+                       check_spmm_result(expected, output, number_of_rows, k, tolerance) ? "ok" : "wrong");
+
+                clReleaseKernel(kernel);
+            }
+
+            clReleaseProgram(program);
+        }
+
+
+        /* summary */
+
+        printf("\nGFlops as a function of k\n%6s", "k");
+        for (i = 0; i < NUMBER_OF_SPMM_FORMATS; ++i)
+        {
+            printf(" %10s", format_names[i]);
+        }
+        printf("\n");
+
+        for (i = 0, k = 1; i < number_of_k; ++i, k *= 2)
+        {
+            int format;
+
+            printf("%6d", k);
+            for (format = 0; format < NUMBER_OF_SPMM_FORMATS; ++format)
+            {
+                printf(" %10.3lf", gflops[format][i]);
+            }
+            printf("\n");
+        }
+
+
+        /* release memory */
+
+        clReleaseMemObject(buffer_ptr);
+        clReleaseMemObject(buffer_col);
+        clReleaseMemObject(buffer_data);
+        clReleaseMemObject(buffer_ell_cols);
+        clReleaseMemObject(buffer_ell_data);
+        clReleaseMemObject(buffer_row_indices);
+        clReleaseMemObject(buffer_sell_cols);
+        clReleaseMemObject(buffer_sell_data);
+        clReleaseMemObject(buffer_strip_ptr);
+        clReleaseMemObject(buffer_row_in_strip);
+        clReleaseMemObject(buffer_vect);
+        clReleaseMemObject(buffer_output);
+
+        free(ptr);
+        free(cols);
+        free(data);
+        free(ell_cols);
+        free(ell_data);
+        free(row_indices);
+        free(sell_cols);
+        free(sell_data);
+        free(device_data);
+        free(device_ell_data);
+        free(device_sell_data);
+        free(strip_ptr);
+        free(row_in_strip);
+        free(vect);
+        free(output);
+        free(expected);
+
+        clFlush(command_queue);
+        clReleaseCommandQueue(command_queue);
+        clReleaseContext(context);
+
+        break;
+    }
+
+    return Success;
+}
+
+void compute_reference(cl_int *ptr, cl_int *cols, cl_double *data, cl_double *vect, int number_of_rows, int k, cl_double *result)
+{
+    int i;
+
+    #pragma omp parallel for shared(ptr, cols, data, vect, number_of_rows, k, result) private(i)
+    for (i = 0; i < number_of_rows; ++i)
+    {
+        int j;
+        int v;
+
+        for (v = 0; v < k; ++v)
+        {
+            result[(long)i * k + v] = 0;
+        }
+
+        for (j = ptr[i]; j < ptr[i+1]; ++j)
+        {
+            for (v = 0; v < k; ++v)
+            {
+                result[(long)i * k + v] += data[j] * vect[(long)cols[j] * k + v];
+            }
+        }
+    }
+}
+
+/*!
+ * \brief Same criterion as check_result_with_tolerance, tolerance is relative to the largest value of all k products.
+ */
+bool check_spmm_result(const cl_double *expected, const cl_double *result, int number_of_rows, int k, double tolerance)
+{
+    double reference_max = 0;
+    long i;
+
+    for (i = 0; i < (long)number_of_rows * k; ++i)
+    {
+        reference_max = fmax(reference_max, fabs(expected[i]));
+    }
+
+    for (i = 0; i < (long)number_of_rows * k; ++i)
+    {
+        if (fabs(expected[i] - result[i]) > EPSILON * fmax(1, fabs(expected[i])) + tolerance * reference_max)
+        {
+            printf("wrong value in row %ld, vector %ld: expected %f - calculated %f\n", i / k, i % k, expected[i], result[i]);
+            return false;
+        }
+    }
+
+    return true;
+}
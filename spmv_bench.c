@@ -0,0 +1,315 @@
+#define CL_TARGET_OPENCL_VERSION 300
+#include <CL/cl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <math.h>
+#include <time.h>
+
+#include "helper_functions.h"
+#include "formats.h"
+#include "selector.h"
+#include "bench.h"
+#include "generator.h"
+#include "enums.h"
+
+#define DEVICES_DEFAULT_SIZE 8
+#define HOST_FORMAT NumberOfFormats
+
+void print_table_header(FILE *output, bool json);
+void print_table_row(FILE *output, bool json, bool first, const char *matrix, const char *device, const char *format,
+                     int number_of_rows, int number_of_columns, int number_of_nonzeroes, const BenchmarkResult *benchmark);
+bool parse_formats(const char *list, bool *selected);
+
+/*
+ * Runs every listed format on every listed matrix (on one OpenCL device, and on the host with "host") and writes
+ * one CSV line or JSON object per run.
+ */
+int main(int argc, char *argv[])
+{
+    cl_uint number_of_devices = DEVICES_DEFAULT_SIZE;
+    cl_device_id device_ids[DEVICES_DEFAULT_SIZE];
+    const char *matrices = get_option(argc, argv, "--matrices", "databases/cant-sorted.mtx");
+    const char *formats = get_option(argc, argv, "--formats", "coo,csr,ell,sell,cmrs,hyb,host");
+    const char *device_type_option = get_option(argc, argv, "--device-type", "gpu");
+    const char *output_format = get_option(argc, argv, "--output-format", "csv");
+    const char *output_filename = get_option(argc, argv, "--output", "");
+    const cl_uint device_number = (cl_uint)get_int_option(argc, argv, "--device", 0);
+    const int warmup = get_int_option(argc, argv, "--warmup", 2);
+    const int repeats = get_int_option(argc, argv, "--repeats", 10);
+    const bool expand_symmetric = get_int_option(argc, argv, "--expand-symmetric", 1) != 0;
+    const bool json = strcmp(output_format, "json") == 0;
+    cl_device_type device_type = CL_DEVICE_TYPE_GPU;
+    bool selected[NumberOfFormats + 1];
+    FILE *output = stdout;
+    bool first = true;
+
+    if (warmup < 0 || repeats < 1)
+    {
+        printf("--warmup must be at least 0 and --repeats at least 1\n");
+        return OtherError;
+    }
+
+    if (!json && strcmp(output_format, "csv") != 0)
+    {
+        printf("unknown --output-format=%s, use csv or json\n", output_format);
+        return OtherError;
+    }
+
+    if (!parse_formats(formats, selected))
+    {
+        return OtherError;
+    }
+
+    if (strcmp(device_type_option, "cpu") == 0)
+    {
+        device_type = CL_DEVICE_TYPE_CPU;
+    }
+    else if (strcmp(device_type_option, "all") == 0)
+    {
+        device_type = CL_DEVICE_TYPE_ALL;
+    }
+    else if (strcmp(device_type_option, "gpu") != 0)
+    {
+        printf("unknown --device-type=%s, use gpu, cpu or all\n", device_type_option);
+        return OtherError;
+    }
+
+    if (get_device_ids_of_type(device_type, &device_ids[0], &number_of_devices) != CL_SUCCESS)
+    {
+        return OpenCLDeviceError;
+    }
+
+    if (device_number >= number_of_devices)
+    {
+        printf("--device=%u but only %u devices were found\n", device_number, number_of_devices);
+        return OpenCLDeviceError;
+    }
+
+
+    /* prepare OpenCL programs, the SpMV kernel of every format */
+
+    char device_name[256];
+    cl_uint compute_units;
+    cl_int error;
+
+    clGetDeviceInfo(device_ids[device_number], CL_DEVICE_NAME, sizeof(device_name), device_name, NULL);
+    clGetDeviceInfo(device_ids[device_number], CL_DEVICE_MAX_COMPUTE_UNITS, sizeof(cl_uint), &compute_units, NULL);
+
+    cl_context context = clCreateContext(0, 1, &device_ids[device_number], NULL, NULL, &error);
+
+    if (NULL == context)
+    {
+        printf("context is null\n");
+        return OpenCLProgramError;
+    }
+
+    cl_command_queue command_queue = clCreateCommandQueueWithProperties(context, device_ids[device_number], 0, &error);
+
+    if (error != CL_SUCCESS)
+    {
+        printf("clCreateCommandQueueWithProperties error %d\n", error);
+        return OpenCLProgramError;
+    }
+
+    cl_program programs[NumberOfFormats];
+
+    if (!build_format_programs(context, device_ids[device_number], programs))
+    {
+        return OpenCLProgramError;
+    }
+
+    if (output_filename[0] != '\0')
+    {
+        output = fopen(output_filename, "w");
+
+        if (output == NULL)
+        {
+            perror(output_filename);
+            return FileError;
+        }
+    }
+
+    print_table_header(output, json);
+
+
+    /* every matrix with every format */
+
+    char *list = strdup(matrices);
+    char *filename;
+
+    for (filename = strtok(list, ","); filename != NULL; filename = strtok(NULL, ","))
+    {
+        MatrixFeatures features;
+        int number_of_rows;
+        int number_of_columns;
+        int number_of_nonzeroes;
+        cl_int *ptr;
+        cl_int *cols;
+        cl_double *data;
+        int format;
+        int i;
+
+        if (load_matrix(filename, expand_symmetric, &number_of_rows, &number_of_columns, &number_of_nonzeroes, &ptr, &cols, &data) == false)
+        {
+            return FileError;
+        }
+
+        cl_double *vect = (cl_double*)malloc(sizeof(cl_double) * number_of_columns);
+        cl_double *expected = (cl_double*)malloc(sizeof(cl_double) * number_of_rows);
+        double *run_ms = (double*)malloc(sizeof(double) * repeats);
+
+        for (i = 0; i < number_of_columns; ++i)
+        {
+            vect[i] = i % 100;
+        }
+
+        compute_reference(ptr, cols, data, vect, number_of_rows, expected);
+        extract_features(ptr, cols, number_of_rows, number_of_columns, &features);
+
+        for (format = 0; format <= HOST_FORMAT; ++format)
+        {
+            BenchmarkResult benchmark;
+
+            if (!selected[format])
+            {
+                continue;
+            }
+
+            if (format == HOST_FORMAT)
+            {
+                benchmark_host_csr(ptr, cols, data, number_of_rows, vect, expected, warmup, repeats, run_ms, &benchmark);
+            }
+            else
+            {
+                LaunchParameters parameters;
+
+                select_launch_parameters(&features, (SpmvFormat)format, compute_units, &parameters);
+
+                if (benchmark_format(context, command_queue, programs, (SpmvFormat)format, &parameters, ptr, cols, data,
+                                     number_of_rows, number_of_columns, vect, expected, warmup, repeats, run_ms, &benchmark) != Success)
+                {
+                    return OpenCLProgramError;
+                }
+            }
+
+            print_table_row(output, json, first, filename, format == HOST_FORMAT ? "host" : device_name, format == HOST_FORMAT ? "csr" : spmv_format_names[format],
+                            number_of_rows, number_of_columns, number_of_nonzeroes, &benchmark);
+            first = false;
+        }
+
+        free(ptr);
+        free(cols);
+        free(data);
+        free(vect);
+        free(expected);
+        free(run_ms);
+    }
+
+    if (json)
+    {
+        fprintf(output, "\n]\n");
+    }
+
+
+    /* release memory */
+
+    if (output != stdout)
+    {
+        fclose(output);
+    }
+
+    free(list);
+
+    clFlush(command_queue);
+    clReleaseCommandQueue(command_queue);
+    release_format_programs(programs);
+    clReleaseContext(context);
+
+    return Success;
+}
+
+/*!
+ * \brief Reads a comma separated list of coo, csr, ell, sell, cmrs, hyb and host into selected (NumberOfFormats + 1 flags).
+ */
+bool parse_formats(const char *list, bool *selected)
+{
+    char *copy = strdup(list);
+    char *name;
+    int format;
+
+    for (format = 0; format <= HOST_FORMAT; ++format)
+    {
+        selected[format] = false;
+    }
+
+    for (name = strtok(copy, ","); name != NULL; name = strtok(NULL, ","))
+    {
+        for (format = 0; format < NumberOfFormats && strcmp(name, spmv_format_names[format]) != 0; ++format)
+        {
+        }
+
+        if (format == NumberOfFormats && strcmp(name, "host") != 0)
+        {
+            printf("unknown format %s, use coo, csr, ell, sell, cmrs, hyb or host\n", name);
+            free(copy);
+            return false;
+        }
+
+        selected[format] = true;
+    }
+
+    free(copy);
+
+    return true;
+}
+
+void print_table_header(FILE *output, bool json)
+{
+    if (json)
+    {
+        fprintf(output, "[");
+    }
+    else
+    {
+        fprintf(output, "matrix,device,format,rows,columns,nonzeroes,conversion_ms,upload_ms,kernel_ms,min_ms,max_ms,gflops,gbps,footprint_bytes,status\n");
+    }
+}
+
+/*!
+ * \brief GFlops count two operations per nonzero and GB/s the matrix footprint plus reading x and writing y once, both at the median time.
+ */
+void print_table_row(FILE *output, bool json, bool first, const char *matrix, const char *device, const char *format,
+                     int number_of_rows, int number_of_columns, int number_of_nonzeroes, const BenchmarkResult *benchmark)
+{
+    const double bytes = (double)benchmark->footprint_bytes + sizeof(cl_double) * ((double)number_of_rows + number_of_columns);
+    const double gflops = 2.0 * number_of_nonzeroes / benchmark->median_ms * 1e-6;
+    const double gbps = bytes / benchmark->median_ms * 1e-6;
+    const char *status = benchmark->correct ? "ok" : "wrong";
+
+    if (json)
+    {
+        fprintf(output, "%s\n  {\"matrix\": ", first ? "" : ",");
+        print_json_string(output, matrix);
+        fprintf(output, ", \"device\": ");
+        print_json_string(output, device);
+        fprintf(output, ", \"format\": \"%s\", \"rows\": %d, \"columns\": %d, \"nonzeroes\": %d, \"conversion_ms\": %.4lf, \"upload_ms\": %.4lf, "
+                "\"kernel_ms\": %.4lf, \"min_ms\": %.4lf, \"max_ms\": %.4lf, \"gflops\": %.4lf, \"gbps\": %.4lf, \"footprint_bytes\": %zu, \"status\": \"%s\"}",
+                format, number_of_rows, number_of_columns, number_of_nonzeroes, benchmark->conversion_ms, benchmark->upload_ms,
+                benchmark->median_ms, benchmark->min_ms, benchmark->max_ms, gflops, gbps, benchmark->footprint_bytes, status);
+    }
+    else
+    {
+        print_csv_string(output, matrix);
+        fputc(',', output);
+        print_csv_string(output, device);
+        fputc(',', output);
+        print_csv_string(output, format);
+        fprintf(output, ",%d,%d,%d,%.4lf,%.4lf,%.4lf,%.4lf,%.4lf,%.4lf,%.4lf,%zu,", number_of_rows, number_of_columns, number_of_nonzeroes,
+                benchmark->conversion_ms, benchmark->upload_ms, benchmark->median_ms, benchmark->min_ms, benchmark->max_ms, gflops, gbps,
+                benchmark->footprint_bytes);
+        print_csv_string(output, status);
+        fputc('\n', output);
+    }
+}
@@ -0,0 +1,325 @@
+#define CL_TARGET_OPENCL_VERSION 300
+#include <CL/cl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <time.h>
+
+#include "helper_functions.h"
+#include "formats.h"
+#include "precision.h"
+#include "enums.h"
+
+#define DEVICES_DEFAULT_SIZE 8
+
+void compute_reference(cl_int *ptr, cl_int *cols, cl_double *data, cl_double *vect, int number_of_rows, cl_double *result);
+bool check_symmetric_result(const cl_double *expected, const cl_double *result, int number_of_rows, double tolerance);
+
+int main(int argc, char *argv[])
+{
+    cl_int error;
+    cl_uint number_of_devices = DEVICES_DEFAULT_SIZE;
+    cl_device_id device_ids[DEVICES_DEFAULT_SIZE];
+
+    if (get_device_ids(&device_ids[0], &number_of_devices) != CL_SUCCESS)
+    {
+        return OpenCLDeviceError;
+    }
+
+    for (cl_uint device_number = 0; device_number < number_of_devices; ++device_number)
+    {
+        int number_of_rows;
+        int number_of_columns;
+        int number_of_nonzeroes;
+        int number_of_triangle_nonzeroes;
+        int i;
+        int run;
+        cl_int *ptr;
+        cl_int *cols;
+        cl_double *data;
+        cl_int *triangle_ptr;
+        cl_int *triangle_cols;
+        cl_double *triangle_data;
+        cl_double *vect;
+        cl_double *output;
+        cl_double *expected;
+        double expanded_ms = 0;
+        double triangle_ms = 0;
+        const char *filename = get_option(argc, argv, "--matrix", "databases/cant-sorted.mtx");
+        const int runs = get_int_option(argc, argv, "--runs", 10);
+        char build_options[128] = "";
+
+        size_t global_work_size[1] = { 8192 };
+        size_t local_work_size[1] = { 256 };
+        cl_uint work_dim = 1;
+
+        if (is_symmetric_matrix_file(filename) == false)
+        {
+            printf("%s is not a symmetric Matrix Market file\n", filename);
+            return FileError;
+        }
+
+        if (runs < 1)
+        {
+            printf("--runs must be at least 1\n");
+            return OtherError;
+        }
+
+
+        /* prepare data for calculations, the triangle as stored in the file and the whole matrix for comparison */
+
+        if (read_csr_from_file(filename, false, &number_of_rows, &number_of_columns, &number_of_triangle_nonzeroes, &triangle_ptr, &triangle_cols, &triangle_data) == false
+            || read_csr_from_file(filename, true, &number_of_rows, &number_of_columns, &number_of_nonzeroes, &ptr, &cols, &data) == false)
+        {
+            return FileError;
+        }
+
+        vect = (cl_double*)malloc(sizeof(cl_double) * number_of_columns);
+        output = (cl_double*)malloc(sizeof(cl_double) * number_of_rows);
+        expected = (cl_double*)malloc(sizeof(cl_double) * number_of_rows);
+
+        for (i = 0; i < number_of_columns; ++i)
+        {
+            vect[i] = i % 100;
+        }
+
+        compute_reference(ptr, cols, data, vect, number_of_rows, expected);
+
+        const Precision value_precision = get_precision_option(argc, argv, "--precision");
+        const Precision vector_precision = get_precision_option(argc, argv, "--vector-precision");
+        const double tolerance = get_precision_tolerance(value_precision, vector_precision);
+        const size_t value_size = get_precision_size(value_precision);
+
+        void *device_data = convert_to_precision(data, number_of_nonzeroes, value_precision);
+        void *device_triangle_data = convert_to_precision(triangle_data, number_of_triangle_nonzeroes, value_precision);
+        void *device_vect = convert_to_precision(vect, number_of_columns, vector_precision);
+
+        printf("values stored as %s, vector as %s\n", get_precision_name(value_precision), get_precision_name(vector_precision));
+
+
+        /* prepare OpenCL program */
+
+        cl_context context = clCreateContext(0, number_of_devices, device_ids, NULL, NULL, NULL);
+
+        if (NULL == context)
+        {
+            printf("context is null\n");
+            return OpenCLProgramError;
+        }
+
+        cl_command_queue command_queue = clCreateCommandQueueWithProperties(context, device_ids[0], 0, &error);
+
+        if (error != CL_SUCCESS)
+        {
+            printf("clCreateCommandQueueWithProperties error %d\n", error);
+            return OpenCLProgramError;
+        }
+
+        cl_mem buffer_ptr           = clCreateBuffer(context, CL_MEM_READ_ONLY, sizeof(cl_int) * (number_of_rows + 1), NULL, &error);
+        cl_mem buffer_col           = clCreateBuffer(context, CL_MEM_READ_ONLY, sizeof(cl_int) * number_of_nonzeroes, NULL, &error);
+        cl_mem buffer_data          = clCreateBuffer(context, CL_MEM_READ_ONLY, value_size * number_of_nonzeroes, NULL, &error);
+        cl_mem buffer_triangle_ptr  = clCreateBuffer(context, CL_MEM_READ_ONLY, sizeof(cl_int) * (number_of_rows + 1), NULL, &error);
+        cl_mem buffer_triangle_col  = clCreateBuffer(context, CL_MEM_READ_ONLY, sizeof(cl_int) * number_of_triangle_nonzeroes, NULL, &error);
+        cl_mem buffer_triangle_data = clCreateBuffer(context, CL_MEM_READ_ONLY, value_size * number_of_triangle_nonzeroes, NULL, &error);
+        cl_mem buffer_vect          = clCreateBuffer(context, CL_MEM_READ_ONLY, get_precision_size(vector_precision) * number_of_columns, NULL, &error);
+        cl_mem buffer_output        = clCreateBuffer(context, CL_MEM_READ_WRITE, sizeof(cl_double) * number_of_rows, NULL, &error);
+
+        if (error != CL_SUCCESS)
+        {
+            printf("clCreateBuffer error %d\n", error);
+            return OpenCLProgramError;
+        }
+
+        error  = clEnqueueWriteBuffer(command_queue, buffer_ptr, CL_FALSE, 0, sizeof(cl_int) * (number_of_rows + 1), ptr, 0, NULL, NULL);
+        error |= clEnqueueWriteBuffer(command_queue, buffer_col, CL_FALSE, 0, sizeof(cl_int) * number_of_nonzeroes, cols, 0, NULL, NULL);
+        error |= clEnqueueWriteBuffer(command_queue, buffer_data, CL_FALSE, 0, value_size * number_of_nonzeroes, device_data, 0, NULL, NULL);
+        error |= clEnqueueWriteBuffer(command_queue, buffer_triangle_ptr, CL_FALSE, 0, sizeof(cl_int) * (number_of_rows + 1), triangle_ptr, 0, NULL, NULL);
+        error |= clEnqueueWriteBuffer(command_queue, buffer_triangle_col, CL_FALSE, 0, sizeof(cl_int) * number_of_triangle_nonzeroes, triangle_cols, 0, NULL, NULL);
+        error |= clEnqueueWriteBuffer(command_queue, buffer_triangle_data, CL_FALSE, 0, value_size * number_of_triangle_nonzeroes, device_triangle_data, 0, NULL, NULL);
+        error |= clEnqueueWriteBuffer(command_queue, buffer_vect, CL_FALSE, 0, get_precision_size(vector_precision) * number_of_columns, device_vect, 0, NULL, NULL);
+
+        if (error != CL_SUCCESS)
+        {
+            printf("clEnqueueWriteBuffer error %d\n", error);
+            return OpenCLProgramError;
+        }
+        clFinish(command_queue);
+
+        append_precision_build_options(build_options, sizeof(build_options), value_precision, vector_precision);
+
+        cl_program csr_program = build_program_from_file(context, device_ids[0], "kernels/Csr.cl", build_options);
+        cl_program symmetric_program = build_program_from_file(context, device_ids[0], "kernels/Symmetric.cl", build_options);
+
+        if (csr_program == NULL || symmetric_program == NULL)
+        {
+            return OpenCLProgramError;
+        }
+
+        cl_kernel expanded_kernel = clCreateKernel(csr_program, "csr", &error);
+        cl_kernel triangle_kernel = clCreateKernel(symmetric_program, "csr_symmetric", &error);
+
+        if (error != CL_SUCCESS)
+        {
+            printf("clCreateKernel error %d\n", error);
+            return OpenCLProgramError;
+        }
+
+
+        /* set data to kernels */
+
+        error  = clSetKernelArg(expanded_kernel, 0, sizeof(cl_mem), (void*)&buffer_ptr);
+        error |= clSetKernelArg(expanded_kernel, 1, sizeof(cl_mem), (void*)&buffer_col);
+        error |= clSetKernelArg(expanded_kernel, 2, sizeof(cl_mem), (void*)&buffer_data);
+        error |= clSetKernelArg(expanded_kernel, 3, sizeof(cl_mem), (void*)&buffer_vect);
+        error |= clSetKernelArg(expanded_kernel, 4, sizeof(cl_mem), (void*)&buffer_output);
+        error |= clSetKernelArg(expanded_kernel, 5, sizeof(int), (void*)&number_of_rows);
+
+        error |= clSetKernelArg(triangle_kernel, 0, sizeof(cl_mem), (void*)&buffer_triangle_ptr);
+        error |= clSetKernelArg(triangle_kernel, 1, sizeof(cl_mem), (void*)&buffer_triangle_col);
+        error |= clSetKernelArg(triangle_kernel, 2, sizeof(cl_mem), (void*)&buffer_triangle_data);
+        error |= clSetKernelArg(triangle_kernel, 3, sizeof(cl_mem), (void*)&buffer_vect);
+        error |= clSetKernelArg(triangle_kernel, 4, sizeof(cl_mem), (void*)&buffer_output);
+        error |= clSetKernelArg(triangle_kernel, 5, sizeof(int), (void*)&number_of_rows);
+
+        if (error != CL_SUCCESS)
+        {
+            printf("clSetKernelArg errror\n");
+            return OpenCLProgramError;
+        }
+
+
+        /* run programs */
+
+        for (run = 0; run < runs; ++run)
+        {
+            const double ms = run_kernel(command_queue, expanded_kernel, work_dim, global_work_size, local_work_size);
+
+            if (ms < 0)
+            {
+                return OpenCLProgramError;
+            }
+
+            expanded_ms += ms;
+        }
+
+        expanded_ms /= runs;
+
+        if (clEnqueueReadBuffer(command_queue, buffer_output, CL_TRUE, 0, sizeof(cl_double) * number_of_rows, output, 0, NULL, NULL) != CL_SUCCESS)
+        {
+            return OpenCLProgramError;
+        }
+
+        printf("expanded matrix: %d nonzeroes, %.3lf MB, %.4lf ms, result is %s\n", number_of_nonzeroes,
+               ((double)number_of_nonzeroes * (value_size + sizeof(cl_int)) + (number_of_rows + 1) * sizeof(cl_int)) * 1e-6, expanded_ms,
+               check_symmetric_result(expected, output, number_of_rows, tolerance) ? "ok" : "wrong");
+
+        /* the triangle kernel adds to output, zeroing it is part of its cost */
+        for (run = 0; run < runs; ++run)
+        {
+            const double zero_ms = zero_buffer(command_queue, buffer_output, sizeof(cl_double) * number_of_rows);
+            const double ms = run_kernel(command_queue, triangle_kernel, work_dim, global_work_size, local_work_size);
+
+            if (zero_ms < 0 || ms < 0)
+            {
+                return OpenCLProgramError;
+            }
+
+            triangle_ms += zero_ms + ms;
+        }
+
+        triangle_ms /= runs;
+
+        if (clEnqueueReadBuffer(command_queue, buffer_output, CL_TRUE, 0, sizeof(cl_double) * number_of_rows, output, 0, NULL, NULL) != CL_SUCCESS)
+        {
+            return OpenCLProgramError;
+        }
+
+        printf("one triangle:    %d nonzeroes, %.3lf MB, %.4lf ms, result is %s\n", number_of_triangle_nonzeroes,
+               ((double)number_of_triangle_nonzeroes * (value_size + sizeof(cl_int)) + (number_of_rows + 1) * sizeof(cl_int)) * 1e-6, triangle_ms,
+               check_symmetric_result(expected, output, number_of_rows, tolerance) ? "ok" : "wrong");
+        printf("speedup %.2lf\n", expanded_ms / triangle_ms);
+
+
+        /* release memory */
+
+        clReleaseKernel(expanded_kernel);
+        clReleaseKernel(triangle_kernel);
+
+        clReleaseMemObject(buffer_ptr);
+        clReleaseMemObject(buffer_col);
+        clReleaseMemObject(buffer_data);
+        clReleaseMemObject(buffer_triangle_ptr);
+        clReleaseMemObject(buffer_triangle_col);
+        clReleaseMemObject(buffer_triangle_data);
+        clReleaseMemObject(buffer_vect);
+        clReleaseMemObject(buffer_output);
+
+        free(ptr);
+        free(cols);
+        free(data);
+        free(triangle_ptr);
+        free(triangle_cols);
+        free(triangle_data);
+        free(device_data);
+        free(device_triangle_data);
+        free(device_vect);
+        free(vect);
+        free(output);
+        free(expected);
+
+        clFlush(command_queue);
+        clReleaseCommandQueue(command_queue);
+        clReleaseProgram(csr_program);
+        clReleaseProgram(symmetric_program);
+        clReleaseContext(context);
+
+        break;
+    }
+
+    return Success;
+}
+
+void compute_reference(cl_int *ptr, cl_int *cols, cl_double *data, cl_double *vect, int number_of_rows, cl_double *result)
+{
+    int i;
+
+    #pragma omp parallel for shared(ptr, cols, data, vect, number_of_rows, result) private(i)
+    for (i = 0; i < number_of_rows; ++i)
+    {
+        double sum = 0;
+        int j;
+
+        for (j = ptr[i]; j < ptr[i+1]; ++j)
+        {
+            sum += data[j] * vect[cols[j]];
+        }
+
+        result[i] = sum;
+    }
+}
+
+/*!
+ * \brief Same criterion as check_result_with_tolerance, against the expanded matrix computed on the host.
+ */
+bool check_symmetric_result(const cl_double *expected, const cl_double *result, int number_of_rows, double tolerance)
+{
+    double reference_max = 0;
+    int i;
+
+    for (i = 0; i < number_of_rows; ++i)
+    {
+        reference_max = fmax(reference_max, fabs(expected[i]));
+    }
+
+    for (i = 0; i < number_of_rows; ++i)
+    {
+        if (fabs(expected[i] - result[i]) > EPSILON * fmax(1, fabs(expected[i])) + tolerance * reference_max)
+        {
+            printf("wrong value at index %d: expected %f - calculated %f\n", i, expected[i], result[i]);
+            return false;
+        }
+    }
+
+    return true;
+}
@@ -0,0 +1,420 @@
+#define CL_TARGET_OPENCL_VERSION 300
+#include <CL/cl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <time.h>
+
+#include "helper_functions.h"
+#include "formats.h"
+#include "precision.h"
+#include "enums.h"
+
+#define DEVICES_DEFAULT_SIZE 8
+#define NUMBER_OF_ON_THE_FLY_MODES 3
+#define TRANSPOSE_WINDOW 2048
+
+void compute_transposed_reference(cl_int *ptr, cl_int *cols, cl_double *data, cl_double *vect, int number_of_rows, int number_of_columns, cl_double *result);
+bool check_transposed_result(const cl_double *expected, const cl_double *result, int number_of_columns);
+
+int main(int argc, char *argv[])
+{
+    cl_int error;
+    cl_uint number_of_devices = DEVICES_DEFAULT_SIZE;
+    cl_device_id device_ids[DEVICES_DEFAULT_SIZE];
+
+    if (get_device_ids(&device_ids[0], &number_of_devices) != CL_SUCCESS)
+    {
+        return OpenCLDeviceError;
+    }
+
+    for (cl_uint device_number = 0; device_number < number_of_devices; ++device_number)
+    {
+        int number_of_rows;
+        int number_of_columns;
+        int number_of_nonzeroes;
+        int i;
+        int j;
+        int mode;
+        int run;
+        cl_int *ptr;
+        cl_int *cols;
+        cl_double *data;
+        cl_int *coo_rows;
+        cl_double *vect;
+        cl_double *output;
+        cl_double *expected;
+        double ms[NUMBER_OF_ON_THE_FLY_MODES];
+        double transpose_ms = 0;
+        double csc_ms = 0;
+        double best_ms;
+        const char *filename = get_option(argc, argv, "--matrix", "databases/cant-sorted.mtx");
+        const int runs = get_int_option(argc, argv, "--runs", 10);
+        const char *mode_names[NUMBER_OF_ON_THE_FLY_MODES] = { "csr atomic scatter", "csr privatised scatter", "coo with row and col swapped" };
+        char build_options[128] = "";
+
+        size_t global_work_size[1] = { 8192 };
+        size_t local_work_size[1] = { 256 };
+        size_t scan_work_size[1] = { 256 };
+        cl_uint work_dim = 1;
+
+        if (runs < 1)
+        {
+            printf("--runs must be at least 1\n");
+            return OtherError;
+        }
+
+
+        /* prepare data for calculations */
+
+        if (read_csr_from_file(filename, true, &number_of_rows, &number_of_columns, &number_of_nonzeroes, &ptr, &cols, &data) == false)
+        {
+            return FileError;
+        }
+
+        coo_rows = (cl_int*)malloc(sizeof(cl_int) * number_of_nonzeroes);
+
+        for (i = 0; i < number_of_rows; ++i)
+        {
+            for (j = ptr[i]; j < ptr[i+1]; ++j)
+            {
+                coo_rows[j] = i;
+            }
+        }
+
+        /* A^T * vect takes a vector as long as a column of A and gives one as long as a row */
+        vect = (cl_double*)malloc(sizeof(cl_double) * number_of_rows);
+        output = (cl_double*)malloc(sizeof(cl_double) * number_of_columns);
+        expected = (cl_double*)malloc(sizeof(cl_double) * number_of_columns);
+
+        for (i = 0; i < number_of_rows; ++i)
+        {
+            vect[i] = i % 100;
+        }
+
+        compute_transposed_reference(ptr, cols, data, vect, number_of_rows, number_of_columns, expected);
+
+
+        /* prepare OpenCL program */
+
+        cl_context context = clCreateContext(0, number_of_devices, device_ids, NULL, NULL, NULL);
+
+        if (NULL == context)
+        {
+            printf("context is null\n");
+            return OpenCLProgramError;
+        }
+
+        cl_command_queue command_queue = clCreateCommandQueueWithProperties(context, device_ids[0], 0, &error);
+
+        if (error != CL_SUCCESS)
+        {
+            printf("clCreateCommandQueueWithProperties error %d\n", error);
+            return OpenCLProgramError;
+        }
+
+        cl_mem buffer_ptr      = clCreateBuffer(context, CL_MEM_READ_ONLY, sizeof(cl_int) * (number_of_rows + 1), NULL, &error);
+        cl_mem buffer_col      = clCreateBuffer(context, CL_MEM_READ_ONLY, sizeof(cl_int) * number_of_nonzeroes, NULL, &error);
+        cl_mem buffer_data     = clCreateBuffer(context, CL_MEM_READ_ONLY, sizeof(cl_double) * number_of_nonzeroes, NULL, &error);
+        cl_mem buffer_coo_rows = clCreateBuffer(context, CL_MEM_READ_ONLY, sizeof(cl_int) * number_of_nonzeroes, NULL, &error);
+        cl_mem buffer_vect     = clCreateBuffer(context, CL_MEM_READ_ONLY, sizeof(cl_double) * number_of_rows, NULL, &error);
+        cl_mem buffer_output   = clCreateBuffer(context, CL_MEM_READ_WRITE, sizeof(cl_double) * number_of_columns, NULL, &error);
+        cl_mem buffer_counts   = clCreateBuffer(context, CL_MEM_READ_WRITE, sizeof(cl_int) * number_of_columns, NULL, &error);
+        cl_mem buffer_csc_ptr  = clCreateBuffer(context, CL_MEM_READ_WRITE, sizeof(cl_int) * (number_of_columns + 1), NULL, &error);
+        cl_mem buffer_position = clCreateBuffer(context, CL_MEM_READ_WRITE, sizeof(cl_int) * number_of_columns, NULL, &error);
+        cl_mem buffer_csc_rows = clCreateBuffer(context, CL_MEM_READ_WRITE, sizeof(cl_int) * number_of_nonzeroes, NULL, &error);
+        cl_mem buffer_csc_data = clCreateBuffer(context, CL_MEM_READ_WRITE, sizeof(cl_double) * number_of_nonzeroes, NULL, &error);
+
+        if (error != CL_SUCCESS)
+        {
+            printf("clCreateBuffer error %d\n", error);
+            return OpenCLProgramError;
+        }
+
+        error  = clEnqueueWriteBuffer(command_queue, buffer_ptr, CL_FALSE, 0, sizeof(cl_int) * (number_of_rows + 1), ptr, 0, NULL, NULL);
+        error |= clEnqueueWriteBuffer(command_queue, buffer_col, CL_FALSE, 0, sizeof(cl_int) * number_of_nonzeroes, cols, 0, NULL, NULL);
+        error |= clEnqueueWriteBuffer(command_queue, buffer_data, CL_FALSE, 0, sizeof(cl_double) * number_of_nonzeroes, data, 0, NULL, NULL);
+        error |= clEnqueueWriteBuffer(command_queue, buffer_coo_rows, CL_FALSE, 0, sizeof(cl_int) * number_of_nonzeroes, coo_rows, 0, NULL, NULL);
+        error |= clEnqueueWriteBuffer(command_queue, buffer_vect, CL_FALSE, 0, sizeof(cl_double) * number_of_rows, vect, 0, NULL, NULL);
+
+        if (error != CL_SUCCESS)
+        {
+            printf("clEnqueueWriteBuffer error %d\n", error);
+            return OpenCLProgramError;
+        }
+        clFinish(command_queue);
+
+        append_precision_build_options(build_options, sizeof(build_options), DoublePrecision, DoublePrecision);
+        snprintf(build_options + strlen(build_options), sizeof(build_options) - strlen(build_options), " -DTRANSPOSE_WINDOW=%d", TRANSPOSE_WINDOW);
+
+        cl_program transpose_program = build_program_from_file(context, device_ids[0], "kernels/Transpose.cl", build_options);
+        cl_program coo_program = build_program_from_file(context, device_ids[0], "kernels/Coo.cl", build_options);
+        cl_program csr_program = build_program_from_file(context, device_ids[0], "kernels/Csr.cl", build_options);
+
+        if (transpose_program == NULL || coo_program == NULL || csr_program == NULL)
+        {
+            return OpenCLProgramError;
+        }
+
+        cl_kernel on_the_fly_kernels[NUMBER_OF_ON_THE_FLY_MODES];
+
+        on_the_fly_kernels[0] = clCreateKernel(transpose_program, "csr_transpose_atomic", &error);
+        on_the_fly_kernels[1] = clCreateKernel(transpose_program, "csr_transpose_private", &error);
+        on_the_fly_kernels[2] = clCreateKernel(coo_program, "coo", &error);
+
+        cl_kernel count_kernel = clCreateKernel(transpose_program, "csc_count", &error);
+        cl_kernel scan_kernel = clCreateKernel(transpose_program, "csc_scan", &error);
+        cl_kernel fill_kernel = clCreateKernel(transpose_program, "csc_fill", &error);
+        cl_kernel csc_kernel = clCreateKernel(csr_program, "csr", &error);
+
+        if (error != CL_SUCCESS)
+        {
+            printf("clCreateKernel error %d\n", error);
+            return OpenCLProgramError;
+        }
+
+
+        /* set data to kernels */
+
+        error  = clSetKernelArg(on_the_fly_kernels[0], 0, sizeof(cl_mem), (void*)&buffer_ptr);
+        error |= clSetKernelArg(on_the_fly_kernels[0], 1, sizeof(cl_mem), (void*)&buffer_col);
+        error |= clSetKernelArg(on_the_fly_kernels[0], 2, sizeof(cl_mem), (void*)&buffer_data);
+        error |= clSetKernelArg(on_the_fly_kernels[0], 3, sizeof(cl_mem), (void*)&buffer_vect);
+        error |= clSetKernelArg(on_the_fly_kernels[0], 4, sizeof(cl_mem), (void*)&buffer_output);
+        error |= clSetKernelArg(on_the_fly_kernels[0], 5, sizeof(int), (void*)&number_of_rows);
+
+        error |= clSetKernelArg(on_the_fly_kernels[1], 0, sizeof(cl_mem), (void*)&buffer_ptr);
+        error |= clSetKernelArg(on_the_fly_kernels[1], 1, sizeof(cl_mem), (void*)&buffer_col);
+        error |= clSetKernelArg(on_the_fly_kernels[1], 2, sizeof(cl_mem), (void*)&buffer_data);
+        error |= clSetKernelArg(on_the_fly_kernels[1], 3, sizeof(cl_mem), (void*)&buffer_vect);
+        error |= clSetKernelArg(on_the_fly_kernels[1], 4, sizeof(cl_mem), (void*)&buffer_output);
+        error |= clSetKernelArg(on_the_fly_kernels[1], 5, sizeof(int), (void*)&number_of_rows);
+        error |= clSetKernelArg(on_the_fly_kernels[1], 6, sizeof(int), (void*)&number_of_columns);
+        error |= clSetKernelArg(on_the_fly_kernels[1], 7, sizeof(cl_double) * TRANSPOSE_WINDOW, NULL);
+        error |= clSetKernelArg(on_the_fly_kernels[1], 8, sizeof(cl_int), NULL);
+
+        /* the COO kernel sums into output[row], so passing the columns as rows gives A^T * vect */
+        error |= clSetKernelArg(on_the_fly_kernels[2], 0, sizeof(cl_mem), (void*)&buffer_col);
+        error |= clSetKernelArg(on_the_fly_kernels[2], 1, sizeof(cl_mem), (void*)&buffer_coo_rows);
+        error |= clSetKernelArg(on_the_fly_kernels[2], 2, sizeof(cl_mem), (void*)&buffer_data);
+        error |= clSetKernelArg(on_the_fly_kernels[2], 3, sizeof(cl_mem), (void*)&buffer_vect);
+        error |= clSetKernelArg(on_the_fly_kernels[2], 4, sizeof(cl_mem), (void*)&buffer_output);
+        error |= clSetKernelArg(on_the_fly_kernels[2], 5, sizeof(int), (void*)&number_of_nonzeroes);
+
+        error |= clSetKernelArg(count_kernel, 0, sizeof(cl_mem), (void*)&buffer_col);
+        error |= clSetKernelArg(count_kernel, 1, sizeof(cl_mem), (void*)&buffer_counts);
+        error |= clSetKernelArg(count_kernel, 2, sizeof(int), (void*)&number_of_nonzeroes);
+
+        error |= clSetKernelArg(scan_kernel, 0, sizeof(cl_mem), (void*)&buffer_counts);
+        error |= clSetKernelArg(scan_kernel, 1, sizeof(cl_mem), (void*)&buffer_csc_ptr);
+        error |= clSetKernelArg(scan_kernel, 2, sizeof(int), (void*)&number_of_columns);
+        error |= clSetKernelArg(scan_kernel, 3, sizeof(cl_int) * scan_work_size[0], NULL);
+
+        error |= clSetKernelArg(fill_kernel, 0, sizeof(cl_mem), (void*)&buffer_ptr);
+        error |= clSetKernelArg(fill_kernel, 1, sizeof(cl_mem), (void*)&buffer_col);
+        error |= clSetKernelArg(fill_kernel, 2, sizeof(cl_mem), (void*)&buffer_data);
+        error |= clSetKernelArg(fill_kernel, 3, sizeof(int), (void*)&number_of_rows);
+        error |= clSetKernelArg(fill_kernel, 4, sizeof(cl_mem), (void*)&buffer_position);
+        error |= clSetKernelArg(fill_kernel, 5, sizeof(cl_mem), (void*)&buffer_csc_rows);
+        error |= clSetKernelArg(fill_kernel, 6, sizeof(cl_mem), (void*)&buffer_csc_data);
+
+        /* CSC of A is CSR of A^T, so the plain CSR kernel multiplies it */
+        error |= clSetKernelArg(csc_kernel, 0, sizeof(cl_mem), (void*)&buffer_csc_ptr);
+        error |= clSetKernelArg(csc_kernel, 1, sizeof(cl_mem), (void*)&buffer_csc_rows);
+        error |= clSetKernelArg(csc_kernel, 2, sizeof(cl_mem), (void*)&buffer_csc_data);
+        error |= clSetKernelArg(csc_kernel, 3, sizeof(cl_mem), (void*)&buffer_vect);
+        error |= clSetKernelArg(csc_kernel, 4, sizeof(cl_mem), (void*)&buffer_output);
+        error |= clSetKernelArg(csc_kernel, 5, sizeof(int), (void*)&number_of_columns);
+
+        if (error != CL_SUCCESS)
+        {
+            printf("clSetKernelArg errror\n");
+            return OpenCLProgramError;
+        }
+
+
+        /* run programs */
+
+        printf("A^T * x, %d x %d matrix, %d nonzeroes, average of %d runs\n", number_of_rows, number_of_columns, number_of_nonzeroes, runs);
+
+        /* on the fly, scattering into output, which has to be zeroed every time */
+        for (mode = 0; mode < NUMBER_OF_ON_THE_FLY_MODES; ++mode)
+        {
+            const size_t *mode_local_work_size = mode == 2 ? NULL : local_work_size;
+
+            ms[mode] = 0;
+
+            for (run = 0; run < runs; ++run)
+            {
+                const double zero_ms = zero_buffer(command_queue, buffer_output, sizeof(cl_double) * number_of_columns);
+                const double kernel_ms = run_kernel(command_queue, on_the_fly_kernels[mode], work_dim, global_work_size, mode_local_work_size);
+
+                if (zero_ms < 0 || kernel_ms < 0)
+                {
+                    return OpenCLProgramError;
+                }
+
+                ms[mode] += zero_ms + kernel_ms;
+            }
+
+            ms[mode] /= runs;
+
+            if (clEnqueueReadBuffer(command_queue, buffer_output, CL_TRUE, 0, sizeof(cl_double) * number_of_columns, output, 0, NULL, NULL) != CL_SUCCESS)
+            {
+                return OpenCLProgramError;
+            }
+
+            printf("%-30s %10.4lf ms %8.3lf GFlops, result is %s\n", mode_names[mode], ms[mode], 2.0 * number_of_nonzeroes / (ms[mode] * 1e6),
+                   check_transposed_result(expected, output, number_of_columns) ? "ok" : "wrong");
+        }
+
+        /* explicit transpose: count, scan, fill, then plain CSR SpMV on the result */
+        for (run = 0; run < runs; ++run)
+        {
+            const double zero_ms = zero_buffer(command_queue, buffer_counts, sizeof(cl_int) * number_of_columns);
+            const double count_ms = run_kernel(command_queue, count_kernel, work_dim, global_work_size, local_work_size);
+            const double scan_ms = run_kernel(command_queue, scan_kernel, work_dim, scan_work_size, scan_work_size);
+            struct timespec start_time;
+            struct timespec end_time;
+
+            clock_gettime(CLOCK_MONOTONIC, &start_time);
+            error = clEnqueueCopyBuffer(command_queue, buffer_csc_ptr, buffer_position, 0, 0, sizeof(cl_int) * number_of_columns, 0, NULL, NULL);
+            clFinish(command_queue);
+            clock_gettime(CLOCK_MONOTONIC, &end_time);
+
+            const double fill_ms = run_kernel(command_queue, fill_kernel, work_dim, global_work_size, local_work_size);
+
+            if (zero_ms < 0 || count_ms < 0 || scan_ms < 0 || fill_ms < 0 || error != CL_SUCCESS)
+            {
+                return OpenCLProgramError;
+            }
+
+            transpose_ms += zero_ms + count_ms + scan_ms + fill_ms + (double)(end_time.tv_nsec - start_time.tv_nsec) / 1000000 + (double)(end_time.tv_sec - start_time.tv_sec) * 1000;
+        }
+
+        transpose_ms /= runs;
+
+        for (run = 0; run < runs; ++run)
+        {
+            const double kernel_ms = run_kernel(command_queue, csc_kernel, work_dim, global_work_size, local_work_size);
+
+            if (kernel_ms < 0)
+            {
+                return OpenCLProgramError;
+            }
+
+            csc_ms += kernel_ms;
+        }
+
+        csc_ms /= runs;
+
+        if (clEnqueueReadBuffer(command_queue, buffer_output, CL_TRUE, 0, sizeof(cl_double) * number_of_columns, output, 0, NULL, NULL) != CL_SUCCESS)
+        {
+            return OpenCLProgramError;
+        }
+
+        printf("%-30s %10.4lf ms\n", "csr -> csc transposition", transpose_ms);
+        printf("%-30s %10.4lf ms %8.3lf GFlops, result is %s\n", "csr kernel on csc", csc_ms, 2.0 * number_of_nonzeroes / (csc_ms * 1e6),
+               check_transposed_result(expected, output, number_of_columns) ? "ok" : "wrong");
+
+        /* n multiplications cost n * best_ms on the fly and transpose_ms + n * csc_ms with the explicit transpose */
+        best_ms = ms[0];
+
+        for (mode = 1; mode < NUMBER_OF_ON_THE_FLY_MODES; ++mode)
+        {
+            best_ms = fmin(best_ms, ms[mode]);
+        }
+
+        if (best_ms > csc_ms)
+        {
+            printf("break-even: the explicit transpose pays off from %d multiplications on\n", (int)ceil(transpose_ms / (best_ms - csc_ms)));
+        }
+        else
+        {
+            printf("break-even: none, multiplying on the fly is faster for any number of multiplications\n");
+        }
+
+
+        /* release memory */
+
+        for (mode = 0; mode < NUMBER_OF_ON_THE_FLY_MODES; ++mode)
+        {
+            clReleaseKernel(on_the_fly_kernels[mode]);
+        }
+
+        clReleaseKernel(count_kernel);
+        clReleaseKernel(scan_kernel);
+        clReleaseKernel(fill_kernel);
+        clReleaseKernel(csc_kernel);
+
+        clReleaseMemObject(buffer_ptr);
+        clReleaseMemObject(buffer_col);
+        clReleaseMemObject(buffer_data);
+        clReleaseMemObject(buffer_coo_rows);
+        clReleaseMemObject(buffer_vect);
+        clReleaseMemObject(buffer_output);
+        clReleaseMemObject(buffer_counts);
+        clReleaseMemObject(buffer_csc_ptr);
+        clReleaseMemObject(buffer_position);
+        clReleaseMemObject(buffer_csc_rows);
+        clReleaseMemObject(buffer_csc_data);
+
+        free(ptr);
+        free(cols);
+        free(data);
+        free(coo_rows);
+        free(vect);
+        free(output);
+        free(expected);
+
+        clFlush(command_queue);
+        clReleaseCommandQueue(command_queue);
+        clReleaseProgram(transpose_program);
+        clReleaseProgram(coo_program);
+        clReleaseProgram(csr_program);
+        clReleaseContext(context);
+
+        break;
+    }
+
+    return Success;
+}
+
+void compute_transposed_reference(cl_int *ptr, cl_int *cols, cl_double *data, cl_double *vect, int number_of_rows, int number_of_columns, cl_double *result)
+{
+    int i;
+    int j;
+
+    for (i = 0; i < number_of_columns; ++i)
+    {
+        result[i] = 0;
+    }
+
+    for (i = 0; i < number_of_rows; ++i)
+    {
+        for (j = ptr[i]; j < ptr[i+1]; ++j)
+        {
+            result[cols[j]] += data[j] * vect[i];
+        }
+    }
+}
+
+/*!
+ * \brief Compares with a relative tolerance, the atomics add up every output value in a different order than the reference.
+ */
+bool check_transposed_result(const cl_double *expected, const cl_double *result, int number_of_columns)
+{
+    int i;
+
+    for (i = 0; i < number_of_columns; ++i)
+    {
+        if (fabs(expected[i] - result[i]) > EPSILON * fmax(1, fabs(expected[i])))
+        {
+            printf("wrong value at index %d: expected %f - calculated %f\n", i, expected[i], result[i]);
+            return false;
+        }
+    }
+
+    return true;
+}